@@ -126,6 +126,9 @@ extern float atanf( float );
 
 #define DEFAULT_SCORE_LINE_FORMAT	"s"
 
+#define DEFAULT_MATRIX_PTILE		64	/* probes per tile with "-A matrix=" */
+#define DEFAULT_MATRIX_GTILE		1024	/* gallery fingerprints per tile */
+
 #define DM	125
 #define FD	5625
 #define FDD	500
@@ -207,6 +210,197 @@ struct xytq_struct {
 #define XYTQ_NULL ( (struct xytq_struct *) NULL ) /* bz_load() */
 
 
+/**************************************************************************/
+/* In BZ_ALLOC.C : Supports reentrant matching with a caller-owned context */
+/**************************************************************************/
+/* A sorted Web as bz_match() walks it: narrow key columns, each     */
+/* contiguous, and a separate column with the rest of each edge      */
+/* packed by BZ_EDGE_INFO(); filled from row pointers by bz_edges_fill() */
+struct bz_edges {
+	short * dist;			/* Squared edge length, ascending */
+	short * beta1;			/* Smaller Beta angle of the edge's endpoints */
+	short * beta2;			/* Larger Beta angle of the edge's endpoints */
+	int * info;			/* K and J point numbers and ThetaKJ */
+};
+
+#define BZ_EDGE_INFO(k,j,theta)	( ( ( (theta) + 1024 ) << 20 ) | ( (k) << 10 ) | (j) )
+#define BZ_EDGE_K(info)		( ( (info) >> 10 ) & 0x3FF )
+#define BZ_EDGE_J(info)		( (info) & 0x3FF )
+#define BZ_EDGE_THETA(info)	( ( (info) >> 20 ) - 1024 )
+
+/* Tests up to BZ_FILTER_WIDTH On-File edges, starting at column index   */
+/* j0, against one Subject edge for bz_match(); see BZ_SIMD.C.  Returns  */
+/* a bit for each edge whose distance and Betas are both compatible,    */
+/* and sets bits for edges too short and too long to be compatible.  An */
+/* implementation may stop after the first edge that is too long.       */
+typedef unsigned int (*bz_filter_fn)( struct bz_edges *, int j0, int n,
+			int dist, int beta1, int beta2,
+			unsigned int * too_short, unsigned int * too_long );
+
+#define BZ_FILTER_WIDTH	32	/* Bits in the masks of a bz_filter_fn */
+
+/* All scratch tables used by a single match live in one of these.  A     */
+/* context may be reused for any number of matches, but must only be used */
+/* by one thread at a time.  Separate contexts may be used concurrently.  */
+struct bz_ctx {
+	/* Tables supporting "core" bozorth algorithm */
+	int colp[ COLP_SIZE_1 ][ COLP_SIZE_2 ];	/* Sorted table of compatible edge pairs from bz_match() */
+	int scols[ SCOLS_SIZE_1 ][ COLS_SIZE_2 ];	/* Subject's pointwise comparison table */
+	int fcols[ FCOLS_SIZE_1 ][ COLS_SIZE_2 ];	/* On-File Record's pointwise comparison table */
+	int * scolpt[ SCOLPT_SIZE ];		/* Subject's sorted list of pointers to rows in scols[] */
+	int * fcolpt[ FCOLPT_SIZE ];		/* On-File Record's sorted list of pointers to rows in fcols[] */
+	struct bz_edges sedges;			/* Subject's sorted Web as walked by bz_match() */
+	struct bz_edges fedges;			/* On-File Record's sorted Web as walked by bz_match() */
+	short sdist[ SCOLS_SIZE_1 ];		/* Storage for sedges, unless it is kept elsewhere */
+	short sbeta1[ SCOLS_SIZE_1 ];
+	short sbeta2[ SCOLS_SIZE_1 ];
+	int sinfo[ SCOLS_SIZE_1 ];
+	short fdist[ FCOLS_SIZE_1 ];		/* Storage for fedges, unless it is kept elsewhere */
+	short fbeta1[ FCOLS_SIZE_1 ];
+	short fbeta2[ FCOLS_SIZE_1 ];
+	int finfo[ FCOLS_SIZE_1 ];
+	bz_filter_fn filter;			/* Set by bz_filter_select() on first use */
+	int sc[ SC_SIZE ];			/* Flags all compatible edges in the Subject's Web */
+	int yl[ YL_SIZE_1 ][ YL_SIZE_2 ];
+
+	/* Tables used significantly by bz_sift() */
+	int rq[ RQ_SIZE ];
+	int tq[ TQ_SIZE ];
+	int zz[ ZZ_SIZE ];
+	int rx[ RX_SIZE ];
+	int mm[ MM_SIZE ];
+	int nn[ NN_SIZE ];
+	int qq[ QQ_SIZE ];
+	int rk[ RK_SIZE ];
+	int cp[ CP_SIZE ];
+	int rp[ RP_SIZE ];
+	int rf[ RF_SIZE_1 ][ RF_SIZE_2 ];
+	int cf[ CF_SIZE_1 ][ CF_SIZE_2 ];
+	int y[ Y_SIZE ];
+
+	/* Tables used only within bz_match() */
+	int rot[ ROT_SIZE_1 ][ ROT_SIZE_2 ];
+	int * rtp[ ROT_SIZE_1 ];
+
+	/* Tables used only between bz_match_score() & bz_final_loop() */
+	int ct[ CT_SIZE ];
+	int gct[ GCT_SIZE ];
+	int ctt[ CTT_SIZE ];
+	int ctp[ CTP_SIZE_1 ][ CTP_SIZE_2 ];
+	int yy[ YY_SIZE_1 ][ YY_SIZE_2 ][ YY_SIZE_3 ];
+	int sct[ SCT_SIZE_1 ][ SCT_SIZE_2 ];
+
+	/* Filenames reported in diagnostics; if NULL, the names */
+	/* set with set_probe_filename() and set_gallery_filename() are used */
+	char * pfile;
+	char * gfile;
+
+	/* If > 0, scores computed within this context stop as soon as */
+	/* it is certain whether they meet this threshold; see         */
+	/* bz_match_score_thresh_ctx() and bz_ctx_set_threshold()      */
+	int threshold;
+};
+
+#define BZ_CTX_NULL ( (struct bz_ctx *) NULL )
+
+#define BZ_PROBE_FILENAME(ctx)   ( (ctx)->pfile != CNULL ? (ctx)->pfile : get_probe_filename() )
+#define BZ_GALLERY_FILENAME(ctx) ( (ctx)->gfile != CNULL ? (ctx)->gfile : get_gallery_filename() )
+
+/**************************************************************************/
+/* In BZ_WEB.C : Supports galleries of precomputed Webs */
+/**************************************************************************/
+#define BZ_WEB_MAGIC		"BZ3WEB\n"
+#define BZ_WEB_MAGIC_SIZE	8
+#define BZ_WEB_VERSION		1
+#define BZ_WEB_BYTE_ORDER	0x01020304
+
+/* A Web gallery file mapped into memory by bz_web_load() */
+struct bz_web {
+	char * filename;
+	char * map;
+	size_t maplen;
+	int count;			/* Number of gallery records */
+	int m1_xyt;			/* Settings the Webs were built with */
+	int max_minutiae;
+	unsigned int * index;		/* (high,low) offset of each record */
+};
+
+/* A Web gallery file being written by bz_web_append() */
+struct bz_web_out {
+	char * filename;
+	FILE * fp;
+	int count;
+	int max_count;
+	unsigned long * offsets;	/* Offset of each record written so far */
+	unsigned long pos;
+};
+
+/* A Web built once by bz_web_mem_build() and kept in memory */
+struct bz_web_mem {
+	struct xyt_struct xyt;		/* Minutiae the Web was built from */
+	int len;			/* Pruned length of the sorted Web */
+	struct bz_edges edges;		/* Its len sorted edges, all in one allocation */
+};
+
+#define BZ_WEB_NULL	( (struct bz_web *) NULL )
+#define BZ_WEB_OUT_NULL	( (struct bz_web_out *) NULL )
+
+/**************************************************************************/
+/* In BZ_SIMD.C : Supports vectorized edge filters for bz_match() */
+/**************************************************************************/
+#define BZ_ISA_AUTO	0	/* Fastest filter the host supports */
+#define BZ_ISA_SCALAR	1
+#define BZ_ISA_SSE2	2
+#define BZ_ISA_AVX2	3
+
+/**************************************************************************/
+/* In BZ_PACK.C : Supports packed galleries of XYTQ records */
+/**************************************************************************/
+#define BZ_PACK_MAGIC		"BZ3PAK\n"
+#define BZ_PACK_MAGIC_SIZE	8
+#define BZ_PACK_VERSION		1
+#define BZ_PACK_BYTE_ORDER	0x01020304
+#define BZ_PACK_BUFSIZE		( 1 << 20 )	/* stdio buffer for streaming reads */
+
+/* A packed gallery file opened by bz_pack_open() */
+struct bz_pack {
+	char * filename;
+	FILE * fp;
+	char * buf;
+	int count;			/* Number of gallery records */
+	int next;			/* Record returned by the next bz_pack_read() */
+	unsigned long index_offset;
+};
+
+/* A packed gallery file being written by bz_pack_append() */
+struct bz_pack_out {
+	char * filename;
+	FILE * fp;
+	int count;
+	int max_count;
+	unsigned long * offsets;	/* Offset of each record written so far */
+	unsigned long pos;
+};
+
+#define BZ_PACK_NULL		( (struct bz_pack *) NULL )
+#define BZ_PACK_OUT_NULL	( (struct bz_pack_out *) NULL )
+
+/**************************************************************************/
+/* Score matrices written by "bozorth3 -A matrix=<format>": text rows,  */
+/* or BZ_MATRIX_MAGIC and BZ_MATRIX_HEADER_INTS ints (byte order,        */
+/* version, format, rows, columns, 3 reserved) followed by binary rows  */
+/**************************************************************************/
+#define BZ_MATRIX_MAGIC		"BZ3MAT\n"
+#define BZ_MATRIX_MAGIC_SIZE	8
+#define BZ_MATRIX_HEADER_INTS	8
+#define BZ_MATRIX_VERSION	1
+#define BZ_MATRIX_BYTE_ORDER	0x01020304
+
+#define BZ_MATRIX_TEXT		0
+#define BZ_MATRIX_INT		1	/* int rows */
+#define BZ_MATRIX_FLOAT		2	/* float rows */
+
+
 /**************************************************************************/
 /**************************************************************************/
                            /* GLOBAL VARIABLES */
@@ -229,29 +423,8 @@ extern FILE *errorfp;
 /**************************************************************************/
 /* In: BZ_GBLS.C */
 /**************************************************************************/
-/* Global arrays supporting "core" bozorth algorithm */
-extern int colp[ COLP_SIZE_1 ][ COLP_SIZE_2 ];
-extern int scols[ SCOLS_SIZE_1 ][ COLS_SIZE_2 ];
-extern int fcols[ FCOLS_SIZE_1 ][ COLS_SIZE_2 ];
-extern int * scolpt[ SCOLPT_SIZE ];
-extern int * fcolpt[ FCOLPT_SIZE ];
-extern int sc[ SC_SIZE ];
-extern int yl[ YL_SIZE_1 ][ YL_SIZE_2 ];
-/* Global arrays supporting "core" bozorth algorithm continued: */
-/*    Globals used significantly by sift() */
-extern int rq[ RQ_SIZE ];
-extern int tq[ TQ_SIZE ];
-extern int zz[ ZZ_SIZE ];
-extern int rx[ RX_SIZE ];
-extern int mm[ MM_SIZE ];
-extern int nn[ NN_SIZE ];
-extern int qq[ QQ_SIZE ];
-extern int rk[ RK_SIZE ];
-extern int cp[ CP_SIZE ];
-extern int rp[ RP_SIZE ];
-extern int rf[RF_SIZE_1][RF_SIZE_2];
-extern int cf[CF_SIZE_1][CF_SIZE_2];
-extern int y[20000];
+/* Matcher context used by the non-reentrant (legacy) entry points */
+extern struct bz_ctx bz_gbl_ctx;
 
 /**************************************************************************/
 /**************************************************************************/
@@ -262,16 +435,34 @@ extern int bozorth_probe_init( struct xyt_struct *);
 extern int bozorth_gallery_init( struct xyt_struct *);
 extern int bozorth_to_gallery(int, struct xyt_struct *, struct xyt_struct *);
 extern int bozorth_main(struct xyt_struct *, struct xyt_struct *);
+extern int bozorth_probe_init_ctx(struct bz_ctx *, struct xyt_struct *);
+extern int bozorth_gallery_init_ctx(struct bz_ctx *, struct xyt_struct *);
+extern int bozorth_to_gallery_ctx(struct bz_ctx *, int, struct xyt_struct *,
+                    struct xyt_struct *);
+extern int bozorth_main_ctx(struct bz_ctx *, struct xyt_struct *,
+                    struct xyt_struct *);
 /* In: BOZORTH3.C */
 extern void bz_comp(int, int [], int [], int [], int *, int [][COLS_SIZE_2],
                     int *[]);
 extern void bz_find(int *, int *[]);
+extern void bz_edges_fill(int *[], int, short [], short [], short [], int [],
+                    struct bz_edges *);
 extern int bz_match(int, int);
 extern int bz_match_score(int, struct xyt_struct *, struct xyt_struct *);
 extern void bz_sift(int *, int, int *, int, int, int, int *, int *);
+extern int bz_match_ctx(struct bz_ctx *, int, int);
+extern int bz_match_score_ctx(struct bz_ctx *, int, struct xyt_struct *,
+                    struct xyt_struct *);
+extern int bz_match_score_thresh_ctx(struct bz_ctx *, int,
+                    struct xyt_struct *, struct xyt_struct *, int);
+extern void bz_sift_ctx(struct bz_ctx *, int *, int, int *, int, int, int,
+                    int *, int *);
 /* In: BZ_ALLOC.C */
 extern char *malloc_or_exit(int, const char *);
 extern char *malloc_or_return_error(int, const char *);
+extern struct bz_ctx *bz_ctx_alloc(void);
+extern void bz_ctx_free(struct bz_ctx *);
+extern void bz_ctx_set_threshold(struct bz_ctx *, int);
 /* In: BZ_IO.C */
 extern int parse_line_range(const char *, int *, int *);
 extern void set_progname(int, char *, pid_t);
@@ -285,11 +476,45 @@ extern char *get_next_file(char *, FILE *, FILE *, int *, int *, char *,
 extern char *get_score_filename(const char *, const char *);
 extern char *get_score_line(const char *, const char *, int, int, const char *);
 extern struct xyt_struct *bz_load(const char *);
+extern struct xytq_struct *bz_load_xytq(const char *);
 extern struct xyt_struct *bz_prune(struct xytq_struct *, int);
 extern int fd_readable(int);
+/* In: BZ_PACK.C */
+extern struct bz_pack_out *bz_pack_create(const char *);
+extern int bz_pack_append(struct bz_pack_out *, const char *,
+                    struct xytq_struct *);
+extern int bz_pack_finish(struct bz_pack_out *);
+extern struct bz_pack *bz_pack_open(const char *);
+extern int bz_pack_read(struct bz_pack *, char *, struct xytq_struct *);
+extern int bz_pack_seek(struct bz_pack *, int);
+extern void bz_pack_close(struct bz_pack *);
+/* In: BZ_SIMD.C */
+extern int bz_set_isa(int);
+extern int bz_isa_resolve(void);
+extern char *bz_isa_name(int);
+extern bz_filter_fn bz_filter_select(void);
 /* In: BZ_SORT.C */
 extern int sort_quality_decreasing(const void *, const void *);
 extern int sort_x_y(const void *, const void *);
 extern int sort_order_decreasing(int [], int, int []);
+/* In: BZ_WEB.C */
+extern struct bz_web_out *bz_web_create(const char *);
+extern int bz_web_append(struct bz_web_out *, struct bz_ctx *, const char *,
+                    struct xyt_struct *);
+extern int bz_web_finish(struct bz_web_out *);
+extern struct bz_web *bz_web_load(const char *);
+extern void bz_web_free(struct bz_web *);
+extern char *bz_web_name(struct bz_web *, int);
+extern int bozorth_gallery_init_web(struct bz_web *, int, struct xyt_struct *);
+extern int bozorth_to_web(int, struct xyt_struct *, struct bz_web *, int);
+extern int bozorth_gallery_init_web_ctx(struct bz_ctx *, struct bz_web *, int,
+                    struct xyt_struct *);
+extern int bozorth_to_web_ctx(struct bz_ctx *, int, struct xyt_struct *,
+                    struct bz_web *, int);
+extern int bz_web_mem_build(struct bz_ctx *, struct xyt_struct *,
+                    struct bz_web_mem *);
+extern void bz_web_mem_free(struct bz_web_mem *);
+extern int bozorth_web_mem_ctx(struct bz_ctx *, struct bz_web_mem *,
+                    struct bz_web_mem *);
 
 #endif /* !_BOZORTH_H */
@@ -88,6 +88,11 @@ extern char                *optarg;
 extern int                 optind,opterr,optopt;
 extern void                usage( FILE * );
 extern void                print_version( FILE * );
+extern int                 search_gallery_mt( struct xyt_struct *, char *, FILE *,
+                                struct bz_web *, struct bz_pack *, int, char **, int *, int, int, int, FILE *,
+                                const char *, int, int, int, int );
+extern int                 search_matrix( FILE *, FILE *, struct bz_pack *, int, int, int, int,
+                                int, int, int, FILE *, int );
 
 /**********************************************************************************/
 
@@ -118,6 +123,16 @@ int argcount;
 int threshold_set = 0;
 int threshold = -1;
 int threshold_stop_flag = 0;
+int threshold_flags = 0;		/* count of "-T" and "-t" flags */
+int clip_threshold = 0;			/* true if "-t": stop each match once the threshold is decided */
+
+int threads_set = 0;
+int nthreads = 0;			/* 0 means one worker thread per online CPU */
+int threaded_search;
+int matrix_search;
+int matrix_fmt = -1;			/* BZ_MATRIX_* format of "-A matrix=<format>" */
+int ptile_size = DEFAULT_MATRIX_PTILE;
+int gtile_size = DEFAULT_MATRIX_GTILE;
 
 #ifdef PARALLEL_SEARCH
 int stop_read_fd  = -1;
@@ -135,6 +150,9 @@ char * fixed_gallery_file = CNULL;
 char * outdir             = CNULL;
 char * outfile            = CNULL;
 char * errorfile          = CNULL;
+char * web_file           = CNULL;
+char * pack_file          = CNULL;
+char * gallery_opt        = CNULL;	/* "-A" option naming a gallery file, if any */
 
 FILE * gallery_fp         = FPNULL;
 FILE * probe_fp           = FPNULL;
@@ -151,6 +169,8 @@ int line_count;
 char ** lines		= (char **) NULL;
 struct xyt_struct * pstruct = XYT_NULL;
 struct xyt_struct * gstruct = XYT_NULL;
+struct bz_web * web	= BZ_WEB_NULL;
+struct bz_pack * pack	= BZ_PACK_NULL;
 int probe_len		= 0;		/* set and used only with a fixed_probe_file */
 int pline_begin		= -1;
 int pline_end		= -1;
@@ -160,7 +180,7 @@ int plineno		= 0;
 int glineno		= 0;
 int exit_status		= 0;
 
-static char default_getopt_spec[] = "+A:bhlM:m:n:P:p:G:g:D:o:e:T:qtvV";
+static char default_getopt_spec[] = "+A:bhlM:m:n:P:p:G:g:D:o:e:T:qt:vV";
 static char * getopt_spec;
 
 
@@ -207,6 +227,13 @@ while (1) {
 			static char A_pl[]       = "plines=";
 			static char A_gl[]       = "glines=";
 			static char A_fmt[]      = "outfmt=";
+			static char A_threads[]  = "threads=";
+			static char A_web[]      = "web=";
+			static char A_packed[]   = "packed=";
+			static char A_matrix[]   = "matrix=";
+			static char A_ptile[]    = "ptile=";
+			static char A_gtile[]    = "gtile=";
+			static char A_simd[]     = "simd=";
 			/* Note that these selective verbose options are */
                         /* not currently listed in usage() */
 			static char A_verbose[]  = "verbose=";
@@ -260,6 +287,82 @@ while (1) {
 				outfmt = optarg + strlen(A_fmt);
 				break;
 			}
+			if ( strncmp(optarg,A_threads,strlen(A_threads)) == 0 ) {
+				nthreads = atoi( optarg + strlen(A_threads) );
+				if ( nthreads < 0 ) {
+					fprintf( stderr, "%s: WARNING: negative thread count (%d) is illegal\n",
+								PROGRAM, nthreads );
+					++parse_errors;
+				}
+				threads_set = 1;
+				if ( verbose_main )
+					fprintf( stderr, "Worker threads set to %d\n", nthreads );
+				break;
+			}
+			if ( strncmp(optarg,A_web,strlen(A_web)) == 0 ) {
+				gallery_from_argv = 0;
+				web_file = optarg + strlen(A_web);
+				if ( verbose_main )
+					fprintf( stderr, "Web gallery file is %s\n", web_file );
+				break;
+			}
+			if ( strncmp(optarg,A_packed,strlen(A_packed)) == 0 ) {
+				gallery_from_argv = 0;
+				pack_file = optarg + strlen(A_packed);
+				if ( verbose_main )
+					fprintf( stderr, "Packed gallery file is %s\n", pack_file );
+				break;
+			}
+			if ( strncmp(optarg,A_matrix,strlen(A_matrix)) == 0 ) {
+				if ( strcmp( optarg + strlen(A_matrix), "text" ) == 0 )
+					matrix_fmt = BZ_MATRIX_TEXT;
+				else if ( strcmp( optarg + strlen(A_matrix), "int" ) == 0 )
+					matrix_fmt = BZ_MATRIX_INT;
+				else if ( strcmp( optarg + strlen(A_matrix), "float" ) == 0 )
+					matrix_fmt = BZ_MATRIX_FLOAT;
+				else {
+					fprintf( stderr, "%s: ERROR: bad score matrix format \"%s\"\n",
+								PROGRAM, optarg+strlen(A_matrix) );
+					++parse_errors;
+				}
+				break;
+			}
+			if ( strncmp(optarg,A_ptile,strlen(A_ptile)) == 0 ) {
+				ptile_size = atoi( optarg + strlen(A_ptile) );
+				if ( ptile_size <= 0 ) {
+					fprintf( stderr, "%s: WARNING: non-positive probe tile size (%d) is illegal\n",
+								PROGRAM, ptile_size );
+					++parse_errors;
+				}
+				break;
+			}
+			if ( strncmp(optarg,A_gtile,strlen(A_gtile)) == 0 ) {
+				gtile_size = atoi( optarg + strlen(A_gtile) );
+				if ( gtile_size <= 0 ) {
+					fprintf( stderr, "%s: WARNING: non-positive gallery tile size (%d) is illegal\n",
+								PROGRAM, gtile_size );
+					++parse_errors;
+				}
+				break;
+			}
+			if ( strncmp(optarg,A_simd,strlen(A_simd)) == 0 ) {
+				int isa;
+
+				for ( isa = BZ_ISA_AUTO; isa <= BZ_ISA_AVX2; isa++ )
+					if ( strcmp( optarg + strlen(A_simd), bz_isa_name( isa ) ) == 0 )
+						break;
+				if ( isa > BZ_ISA_AVX2 ) {
+					fprintf( stderr, "%s: ERROR: bad edge filter \"%s\"\n",
+								PROGRAM, optarg+strlen(A_simd) );
+					++parse_errors;
+				} else if ( bz_set_isa( isa ) < 0 ) {
+					fprintf( stderr, "%s: ERROR: edge filter \"%s\" is not supported on this host\n",
+								PROGRAM, optarg+strlen(A_simd) );
+					++parse_errors;
+				} else if ( verbose_main )
+					fprintf( stderr, "Edge filter is %s\n", bz_isa_name( bz_isa_resolve() ) );
+				break;
+			}
 			if ( strncmp(optarg,A_mm,strlen(A_mm)) == 0 ) {
 				min_computable_minutiae = atoi( optarg + strlen(A_mm) );
 				if ( min_computable_minutiae < 0 ) {
@@ -420,6 +523,18 @@ while (1) {
 				++parse_errors;
 			}
 			threshold_set = 1;
+			++threshold_flags;
+			break;
+		case 't':
+			threshold = atoi( optarg );
+			if ( threshold <= 0 ) {
+				fprintf( stderr, "%s: WARNING: non-positive threshold (%d) is illegal with \"-t\"\n",
+								PROGRAM, threshold );
+				++parse_errors;
+			}
+			threshold_set = 1;
+			clip_threshold = 1;
+			++threshold_flags;
 			break;
 		case 'q':
 			threshold_stop_flag = 1;
@@ -452,7 +567,9 @@ if ( mates_list != CNULL && fixed_gallery_file != CNULL ) {
 	++parse_errors;
 }
 
-if ( gallery_list != CNULL && probe_list != CNULL ) {
+matrix_search = ( matrix_fmt >= 0 );
+
+if ( gallery_list != CNULL && probe_list != CNULL && ! matrix_search ) {
 	fprintf( stderr, "%s: ERROR: flags \"-G\" and \"-P\" are not currently compatible\n", PROGRAM );
 	++parse_errors;
 }
@@ -473,11 +590,69 @@ if ( no_output && outdir != CNULL ) {
 	++parse_errors;
 }
 
+if ( threshold_flags > 1 ) {
+	fprintf( stderr, "%s: ERROR: flags \"-T\" and \"-t\" are incompatible\n", PROGRAM );
+	++parse_errors;
+}
+
 if ( threshold_stop_flag && ! threshold_set ) {
 	fprintf( stderr, "%s: ERROR: flag \"-q\" and requires that a threshold be set\n", PROGRAM );
 	++parse_errors;
 }
 
+if ( matrix_search ) {			/* -P probes.lis { -G gallery.lis | -A packed=<file> } */
+	if ( probe_list == CNULL || ( gallery_list == CNULL && pack_file == CNULL ) ) {
+		fprintf( stderr, "%s: ERROR: option \"-A matrix=<format>\" requires \"-P\" and either \"-G\" or \"-A packed=<file>\"\n", PROGRAM );
+		++parse_errors;
+	}
+	if ( fixed_probe_file != CNULL || fixed_gallery_file != CNULL || mates_list != CNULL || web_file != CNULL ) {
+		fprintf( stderr, "%s: ERROR: option \"-A matrix=<format>\" is incompatible with \"-p\", \"-g\", \"-M\" and \"-A web=<file>\"\n", PROGRAM );
+		++parse_errors;
+	}
+	if ( threshold_set ) {
+		fprintf( stderr, "%s: ERROR: option \"-A matrix=<format>\" is incompatible with \"-T\", \"-t\" and \"-q\" flags\n", PROGRAM );
+		++parse_errors;
+	}
+	if ( dry_run ) {
+		fprintf( stderr, "%s: ERROR: options \"-A matrix=<format>\" and \"-A dryrun\" are incompatible\n", PROGRAM );
+		++parse_errors;
+	}
+}
+
+if ( threads_set && ! matrix_search ) {	/* -p probefile.xyt { gallery*.xyt | -G gallery.lis } */
+	if ( fixed_probe_file == CNULL ) {
+		fprintf( stderr, "%s: ERROR: option \"-A threads=#\" requires \"-p\" flag\n", PROGRAM );
+		++parse_errors;
+	}
+	if ( fixed_gallery_file != CNULL || mates_list != CNULL || probe_list != CNULL ) {
+		fprintf( stderr, "%s: ERROR: option \"-A threads=#\" is incompatible with \"-g\", \"-M\" and \"-P\" flags\n", PROGRAM );
+		++parse_errors;
+	}
+}
+
+if ( web_file != CNULL && pack_file != CNULL ) {
+	fprintf( stderr, "%s: ERROR: options \"-A web=<file>\" and \"-A packed=<file>\" are incompatible\n", PROGRAM );
+	++parse_errors;
+}
+if ( web_file != CNULL )
+	gallery_opt = "-A web=<file>";
+else if ( pack_file != CNULL )
+	gallery_opt = "-A packed=<file>";
+if ( gallery_opt != CNULL && ! matrix_search ) {	/* -p probefile.xyt -A {web,packed}=<file> */
+	if ( fixed_probe_file == CNULL ) {
+		fprintf( stderr, "%s: ERROR: option \"%s\" requires \"-p\" flag\n", PROGRAM, gallery_opt );
+		++parse_errors;
+	}
+	if ( fixed_gallery_file != CNULL || gallery_list != CNULL || mates_list != CNULL || probe_list != CNULL ) {
+		fprintf( stderr, "%s: ERROR: option \"%s\" is incompatible with \"-g\", \"-G\", \"-M\" and \"-P\" flags\n", PROGRAM, gallery_opt );
+		++parse_errors;
+	}
+	if ( dry_run ) {
+		fprintf( stderr, "%s: ERROR: options \"%s\" and \"-A dryrun\" are incompatible\n", PROGRAM, gallery_opt );
+		++parse_errors;
+	}
+}
+
 #ifdef PARALLEL_SEARCH
 if ( stop_read_fd >= 0 && ! threshold_stop_flag ) {
 	fprintf( stderr, "%s: ERROR: if stop read fd is set, the threshold stop flag be also set\n", PROGRAM );
@@ -503,6 +678,18 @@ if ( stop_read_fd >= 0 || stop_write_fd >= 0 ) {	/* -p probefile.xyt { gallery*.
 	}
 	stop_fds = 1;
 }
+if ( stop_fds && matrix_search ) {
+	fprintf( stderr, "%s: ERROR: options \"-A [rw]fd=#\" are incompatible with \"-A matrix=<format>\"\n", PROGRAM );
+	++parse_errors;
+}
+if ( stop_fds && threads_set ) {
+	fprintf( stderr, "%s: ERROR: options \"-A [rw]fd=#\" are incompatible with \"-A threads=#\"\n", PROGRAM );
+	++parse_errors;
+}
+if ( stop_fds && gallery_opt != CNULL ) {
+	fprintf( stderr, "%s: ERROR: options \"-A [rw]fd=#\" are incompatible with \"%s\"\n", PROGRAM, gallery_opt );
+	++parse_errors;
+}
 #endif
 
 if ( gline_begin > 0 && gallery_list == CNULL ) {
@@ -694,6 +881,16 @@ if ( ! dry_run ) {
 		}
 		probe_len = bozorth_probe_init( pstruct );
 	}
+	if ( web_file != CNULL ) {
+		web = bz_web_load( web_file );
+		if ( web == BZ_WEB_NULL )
+			exit(1);
+	}
+	if ( pack_file != CNULL ) {
+		pack = bz_pack_open( pack_file );
+		if ( pack == BZ_PACK_NULL )
+			exit(1);
+	}
 	if ( fixed_gallery_file != CNULL ) {
 		gstruct = bz_load( fixed_gallery_file );
 		if ( gstruct == XYT_NULL ) {
@@ -711,13 +908,46 @@ if ( ! no_output && lflag )
 
 
 
+/* With "-t", scores are only computed far enough to decide the threshold */
+if ( clip_threshold )
+	bz_ctx_set_threshold( &bz_gbl_ctx, threshold );
+
+
+
 line_count = 0;
 plineno = 0;
 glineno = 0;
 
 
 
-while (1) {
+/* With "-A threads=#" the gallery is scored by a pool of workers, */
+/* each with its own matcher context, instead of the loop below.   */
+/* A Web or packed gallery ("-A web=<file>", "-A packed=<file>")  */
+/* is always searched this way, with a single worker unless more   */
+/* threads are requested.                                          */
+threaded_search = ( ( threads_set || gallery_opt != CNULL ) && ! dry_run && ! matrix_search );
+if ( gallery_opt != CNULL && ! threads_set )
+	nthreads = 1;
+if ( threaded_search )
+	nerrors += search_gallery_mt( pstruct, fixed_probe_file, gallery_fp, web, pack,
+					argc, argv, &optind, gline_begin, gline_end, nthreads,
+					no_output ? FPNULL : outfp, outfmt,
+					threshold_set, threshold, threshold_stop_flag, clip_threshold );
+
+/* With "-A matrix=<format>" every probe in the list is matched */
+/* against every gallery fingerprint, a tile of each at a time.  */
+if ( matrix_search ) {
+	if ( ! threads_set )
+		nthreads = 1;
+	nerrors += search_matrix( probe_fp, gallery_fp, pack,
+					pline_begin, pline_end, gline_begin, gline_end,
+					nthreads, ptile_size, gtile_size,
+					no_output ? FPNULL : outfp, matrix_fmt );
+}
+
+
+
+while ( ! threaded_search && ! matrix_search ) {
 	int n = 0;
 	char * p;
 	char * g;
@@ -983,6 +1213,13 @@ if ( ! no_output ) {
 
 
 
+if ( web != BZ_WEB_NULL )
+	bz_web_free( web );
+if ( pack != BZ_PACK_NULL )
+	bz_pack_close( pack );
+
+
+
 if ( mates_fp != FPNULL ) {
 	if ( fclose( mates_fp ) != 0 ) {
 		fprintf( errorfp, "%s: ERROR: fclose() of mates list \"%s\" failed: %s\n",
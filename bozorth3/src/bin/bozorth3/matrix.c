@@ -0,0 +1,390 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/***********************************************************************
+      PACKAGE:        Bozorth Fingerprint Matcher
+
+      FILE:           MATRIX.C
+
+
+#proc: search_matrix - Matches every probe in a list against every
+#proc:            gallery fingerprint in a list or packed gallery file,
+#proc:            one tile of probes by one tile of gallery at a time,
+#proc:            and writes the scores as a matrix
+
+***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/param.h>
+#include <bozorth.h>
+#include <util.h>
+
+/* One tile of probes or gallery fingerprints, each of whose Webs */
+/* is built once and kept while the tile is in use.               */
+struct matrix_tile {
+	char ** files;			/* Filenames to load, or NULL */
+	struct xyt_struct ** xyts;	/* Templates already read, or NULL */
+	struct bz_web_mem * webs;
+	int * status;			/* 0 if the Web was built, -1 if not */
+	int n;
+};
+
+struct matrix_state {
+	struct bz_ctx ** ctxs;		/* One matcher context per worker */
+	struct matrix_tile * building;	/* Tile whose Webs are being built */
+	struct matrix_tile ptile;
+	struct matrix_tile gtile;
+	int * band;			/* Scores of the probe tile, ptile.n by ncols */
+	int ncols;
+	int gbase;			/* Column of gallery tile item 0 */
+};
+
+/***********************************************************************/
+static void matrix_tile_alloc( struct matrix_tile * tile, int size, int from_files )
+{
+tile->files  = (char **) NULL;
+tile->xyts   = (struct xyt_struct **) NULL;
+if ( from_files )
+	tile->files = (char **) malloc_or_exit( (int) ( size * sizeof(char *) ), "tile filename table" );
+else
+	tile->xyts = (struct xyt_struct **) malloc_or_exit( (int) ( size * sizeof(struct xyt_struct *) ), "tile template table" );
+tile->webs   = (struct bz_web_mem *) malloc_or_exit( (int) ( size * sizeof(struct bz_web_mem) ), "tile Web table" );
+tile->status = (int *) malloc_or_exit( (int) ( size * sizeof(int) ), "tile status table" );
+tile->n      = 0;
+}
+
+/***********************************************************************/
+static void matrix_tile_release( struct matrix_tile * tile )
+{
+int i;
+
+for ( i = 0; i < tile->n; i++ )
+	if ( tile->status[i] == 0 )
+		bz_web_mem_free( &tile->webs[i] );
+tile->n = 0;
+}
+
+/***********************************************************************/
+static void matrix_tile_free( struct matrix_tile * tile )
+{
+matrix_tile_release( tile );
+if ( tile->files != (char **) NULL )
+	free( (char *) tile->files );
+if ( tile->xyts != (struct xyt_struct **) NULL )
+	free( (char *) tile->xyts );
+free( (char *) tile->webs );
+free( (char *) tile->status );
+}
+
+/***********************************************************************/
+static int matrix_build_one( void * arg, const int worker, const int item )
+{
+struct matrix_state * st = (struct matrix_state *) arg;
+struct matrix_tile * tile = st->building;
+struct xyt_struct * xyt;
+
+if ( tile->files != (char **) NULL )
+	xyt = bz_load( tile->files[item] );
+else
+	xyt = tile->xyts[item];
+tile->status[item] = -1;
+if ( xyt == XYT_NULL )
+	return 0;
+tile->status[item] = bz_web_mem_build( st->ctxs[worker], xyt, &tile->webs[item] );
+free( (char *) xyt );
+if ( tile->xyts != (struct xyt_struct **) NULL )
+	tile->xyts[item] = XYT_NULL;
+return 0;
+}
+
+/***********************************************************************/
+static int matrix_score_one( void * arg, const int worker, const int item )
+{
+struct matrix_state * st = (struct matrix_state *) arg;
+int pi;
+int gi;
+
+pi = item / st->gtile.n;
+gi = item % st->gtile.n;
+st->band[ pi * st->ncols + st->gbase + gi ] =
+	bozorth_web_mem_ctx( st->ctxs[worker], &st->ptile.webs[pi], &st->gtile.webs[gi] );
+return 0;
+}
+
+/***********************************************************************/
+/* Builds the Webs of a tile; returns the number of errors encountered */
+/***********************************************************************/
+static int matrix_build_tile( struct matrix_state * st, struct matrix_tile * tile, int nthreads )
+{
+int i;
+int nerrors = 0;
+
+st->building = tile;
+(void) work_pool_run( matrix_build_one, (void *) st, tile->n, nthreads );
+for ( i = 0; i < tile->n; i++ )
+	if ( tile->status[i] != 0 )
+		++nerrors;
+return nerrors;
+}
+
+/***********************************************************************/
+/* Reads a list file into a table of filenames; returns the count */
+/***********************************************************************/
+static int matrix_read_list( FILE * fp, int begin, int end, char *** names )
+{
+int count = 0;
+int max_count = 1024;
+int lineno = 0;
+int done_now = 0;
+int done_afterwards = 0;
+char * f;
+char line[ MAX_LINE_LENGTH ];
+
+*names = (char **) malloc_or_exit( (int) ( max_count * sizeof(char *) ), "list filename table" );
+while (1) {
+	f = get_next_file( CNULL, fp, FPNULL, &done_now, &done_afterwards,
+				&line[0], 0, (char **) NULL, (int *) NULL, &lineno, begin, end );
+	if ( done_now )
+		break;
+	if ( count == max_count ) {
+		char ** bigger;
+
+		max_count *= 2;
+		bigger = (char **) malloc_or_exit( (int) ( max_count * sizeof(char *) ), "list filename table" );
+		memcpy( (char *) bigger, (char *) *names, count * sizeof(char *) );
+		free( (char *) *names );
+		*names = bigger;
+	}
+	(*names)[count] = malloc_or_exit( (int) strlen(f) + 1, "list filename" );
+	strcpy( (*names)[count], f );
+	count++;
+}
+return count;
+}
+
+/***********************************************************************/
+static int matrix_write_header( FILE * outfp, int fmt, int nrows, int ncols )
+{
+char magic[ BZ_MATRIX_MAGIC_SIZE ];
+int hdr[ BZ_MATRIX_HEADER_INTS ];
+
+memset( magic, 0, sizeof magic );
+strcpy( magic, BZ_MATRIX_MAGIC );
+memset( (char *) hdr, 0, sizeof hdr );
+hdr[0] = BZ_MATRIX_BYTE_ORDER;
+hdr[1] = BZ_MATRIX_VERSION;
+hdr[2] = fmt;
+hdr[3] = nrows;
+hdr[4] = ncols;
+if ( fwrite( magic, 1, sizeof magic, outfp ) != sizeof magic ||
+     fwrite( (char *) hdr, sizeof(int), BZ_MATRIX_HEADER_INTS, outfp ) != BZ_MATRIX_HEADER_INTS ) {
+	fprintf( errorfp, "%s: ERROR: write of the score matrix header failed\n", get_progname() );
+	return -1;
+}
+return 0;
+}
+
+/***********************************************************************/
+static int matrix_write_rows( FILE * outfp, int fmt, int * band, int nrows, int ncols )
+{
+int r;
+int c;
+
+for ( r = 0; r < nrows; r++ ) {
+	int * row = &band[ r * ncols ];
+
+	if ( fmt == BZ_MATRIX_TEXT ) {
+		for ( c = 0; c < ncols; c++ )
+			fprintf( outfp, c == 0 ? "%d" : " %d", row[c] );
+		putc( '\n', outfp );
+	} else if ( fmt == BZ_MATRIX_INT ) {
+		(void) fwrite( (char *) row, sizeof(int), (size_t) ncols, outfp );
+	} else {
+		for ( c = 0; c < ncols; c++ ) {
+			float f = (float) row[c];
+
+			(void) fwrite( (char *) &f, sizeof(float), 1, outfp );
+		}
+	}
+	if ( ferror( outfp ) ) {
+		fprintf( errorfp, "%s: ERROR: score matrix write failure\n", get_progname() );
+		return -1;
+	}
+}
+return 0;
+}
+
+/***********************************************************************/
+/* Matches every probe against every gallery fingerprint.  Probes are */
+/* taken ptile_size at a time and the gallery gtile_size at a time;   */
+/* each probe's Web is built once per probe tile and each gallery     */
+/* Web once per (probe tile, gallery tile) pair, rather than once for */
+/* every match.  The scores of a probe tile are kept until the whole  */
+/* gallery has been matched, then written as rows of the matrix.      */
+/*                                                                     */
+/* Returns the number of errors encountered                            */
+/***********************************************************************/
+int search_matrix(
+	FILE * probe_fp,		/* INPUT: probe list */
+	FILE * gallery_fp,		/* INPUT: gallery list, or NULL */
+	struct bz_pack * pack,		/* INPUT: packed gallery to stream instead, or NULL */
+	int pline_begin,
+	int pline_end,
+	int gline_begin,
+	int gline_end,
+	int nthreads,			/* INPUT: worker threads; 0 means one per CPU */
+	int ptile_size,
+	int gtile_size,
+	FILE * outfp,			/* INPUT: NULL if scores are not to be printed */
+	int fmt				/* INPUT: BZ_MATRIX_TEXT, _INT or _FLOAT */
+	)
+{
+struct matrix_state st;
+struct xytq_struct * xytq = XYTQ_NULL;
+char ** pfiles;
+char ** gfiles = (char **) NULL;
+int nprobes;
+int ngallery;
+int nerrors = 0;
+int pbase;
+int i;
+char gline[ MAX_LINE_LENGTH ];
+
+
+nthreads = work_pool_nthreads( nthreads, INT_MAX );
+
+nprobes = matrix_read_list( probe_fp, pline_begin, pline_end, &pfiles );
+if ( pack != BZ_PACK_NULL ) {
+	ngallery = pack->count;
+	xytq = (struct xytq_struct *) malloc_or_exit( (int) sizeof(struct xytq_struct), "packed gallery record" );
+} else {
+	ngallery = matrix_read_list( gallery_fp, gline_begin, gline_end, &gfiles );
+}
+if ( verbose_main )
+	fprintf( errorfp, "matching %d probes against %d gallery fingerprints with %d threads\n",
+				nprobes, ngallery, nthreads );
+
+if ( ptile_size > nprobes )
+	ptile_size = nprobes;
+if ( gtile_size > ngallery )
+	gtile_size = ngallery;
+if ( ptile_size < 1 )
+	ptile_size = 1;
+if ( gtile_size < 1 )
+	gtile_size = 1;
+
+st.ncols = ngallery;
+st.ctxs  = (struct bz_ctx **) malloc_or_exit( (int) ( nthreads * sizeof(struct bz_ctx *) ), "matcher context table" );
+st.band  = (int *) malloc_or_exit( (int) ( ptile_size * ( ngallery > 0 ? ngallery : 1 ) * sizeof(int) ), "score matrix band" );
+matrix_tile_alloc( &st.ptile, ptile_size, 1 );
+matrix_tile_alloc( &st.gtile, gtile_size, pack == BZ_PACK_NULL );
+for ( i = 0; i < nthreads; i++ ) {
+	st.ctxs[i] = bz_ctx_alloc();
+	if ( st.ctxs[i] == BZ_CTX_NULL )
+		exit(1);
+}
+
+if ( outfp != FPNULL && fmt != BZ_MATRIX_TEXT )
+	if ( matrix_write_header( outfp, fmt, nprobes, ngallery ) < 0 )
+		++nerrors;
+
+for ( pbase = 0; nerrors == 0 && pbase < nprobes; pbase += ptile_size ) {
+	st.ptile.n = MIN( ptile_size, nprobes - pbase );
+	for ( i = 0; i < st.ptile.n; i++ )
+		st.ptile.files[i] = pfiles[ pbase + i ];
+	nerrors += matrix_build_tile( &st, &st.ptile, nthreads );
+
+	if ( pack != BZ_PACK_NULL && nerrors == 0 )
+		if ( bz_pack_seek( pack, 0 ) < 0 )
+			++nerrors;
+
+	for ( st.gbase = 0; nerrors == 0 && st.gbase < ngallery; st.gbase += gtile_size ) {
+		st.gtile.n = MIN( gtile_size, ngallery - st.gbase );
+		if ( pack != BZ_PACK_NULL ) {
+			for ( i = 0; i < st.gtile.n; i++ ) {
+				st.gtile.xyts[i] = XYT_NULL;
+				if ( bz_pack_read( pack, &gline[0], xytq ) <= 0 ) {
+					fprintf( errorfp, "%s: ERROR: record %d of packed gallery file \"%s\" could not be read\n",
+								get_progname(), st.gbase+i+1, pack->filename );
+					continue;
+				}
+				st.gtile.xyts[i] = bz_prune( xytq, 0 );
+			}
+		} else {
+			for ( i = 0; i < st.gtile.n; i++ )
+				st.gtile.files[i] = gfiles[ st.gbase + i ];
+		}
+		nerrors += matrix_build_tile( &st, &st.gtile, nthreads );
+
+		if ( nerrors == 0 )
+			(void) work_pool_run( matrix_score_one, (void *) &st, st.ptile.n * st.gtile.n, nthreads );
+		matrix_tile_release( &st.gtile );
+	}
+
+	if ( nerrors == 0 && outfp != FPNULL )
+		if ( matrix_write_rows( outfp, fmt, st.band, MIN( ptile_size, nprobes - pbase ), ngallery ) < 0 )
+			++nerrors;
+	matrix_tile_release( &st.ptile );
+}
+
+for ( i = 0; i < nthreads; i++ )
+	bz_ctx_free( st.ctxs[i] );
+free( (char *) st.ctxs );
+free( (char *) st.band );
+matrix_tile_free( &st.ptile );
+matrix_tile_free( &st.gtile );
+for ( i = 0; i < nprobes; i++ )
+	free( pfiles[i] );
+free( (char *) pfiles );
+if ( gfiles != (char **) NULL ) {
+	for ( i = 0; i < ngallery; i++ )
+		free( gfiles[i] );
+	free( (char *) gfiles );
+}
+if ( xytq != XYTQ_NULL )
+	free( (char *) xytq );
+
+return nerrors;
+}
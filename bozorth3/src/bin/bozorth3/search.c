@@ -0,0 +1,334 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/***********************************************************************
+      PACKAGE:        Bozorth Fingerprint Matcher
+
+      FILE:           SEARCH.C
+
+
+#proc: search_gallery_mt - Matches a fixed probe against a gallery
+#proc:            list, Web gallery file or packed gallery file using
+#proc:            a pool of worker threads, printing score lines in
+#proc:            gallery order
+
+***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <bozorth.h>
+#include <util.h>
+
+/* Gallery filenames are read and scored this many at a time, which */
+/* bounds memory use for arbitrarily long gallery lists.            */
+#define SEARCH_BATCH_SIZE	65536
+
+/* Templates streamed from a packed gallery are held in memory while */
+/* a batch is scored, so those batches are kept smaller.             */
+#define SEARCH_PACKED_BATCH_SIZE	4096
+
+#define SEARCH_SKIPPED		0
+#define SEARCH_SCORED		1
+#define SEARCH_LOAD_FAILED	2
+
+struct search_state {
+	struct xyt_struct * pstruct;
+	char * probe_file;
+	struct bz_ctx ** ctxs;		/* One matcher context per worker */
+	int * probe_lens;		/* Pruned probe Web length in each context */
+	struct bz_web * web;		/* Precomputed gallery Webs, or NULL */
+	int base;			/* Web record number of batch item 0 */
+	char ** gfiles;
+	struct xyt_struct ** gstructs;	/* Templates read from a packed gallery, or NULL */
+	int * scores;
+	int * status;
+	int stop_early;			/* -q: stop at first score >= threshold */
+	int threshold;
+	pthread_mutex_t lock;
+	int stop_at;			/* No need to score items after this one */
+};
+
+/***********************************************************************/
+static int search_one( void * arg, const int worker, const int item )
+{
+struct search_state * st = (struct search_state *) arg;
+struct bz_ctx * ctx = st->ctxs[worker];
+struct xyt_struct * gstruct;
+int stop_at;
+int n;
+
+
+pthread_mutex_lock( &st->lock );
+stop_at = st->stop_at;
+pthread_mutex_unlock( &st->lock );
+if ( item > stop_at ) {
+	st->status[item] = SEARCH_SKIPPED;
+	return 0;
+}
+
+ctx->pfile = st->probe_file;
+ctx->gfile = st->gfiles[item];
+
+if ( st->web != BZ_WEB_NULL ) {
+	n = bozorth_to_web_ctx( ctx, st->probe_lens[worker], st->pstruct, st->web, st->base + item );
+} else if ( st->gstructs != (struct xyt_struct **) NULL ) {
+	n = bozorth_to_gallery_ctx( ctx, st->probe_lens[worker], st->pstruct, st->gstructs[item] );
+} else {
+	gstruct = bz_load( st->gfiles[item] );
+	if ( gstruct == XYT_NULL )
+		n = -1;
+	else {
+		n = bozorth_to_gallery_ctx( ctx, st->probe_lens[worker], st->pstruct, gstruct );
+		free( (char *) gstruct );
+	}
+}
+if ( n < 0 ) {
+	st->status[item] = SEARCH_LOAD_FAILED;
+	pthread_mutex_lock( &st->lock );
+	if ( item < st->stop_at )
+		st->stop_at = item;
+	pthread_mutex_unlock( &st->lock );
+	return 0;
+}
+
+st->scores[item] = n;
+st->status[item] = SEARCH_SCORED;
+
+if ( st->stop_early && n >= st->threshold ) {
+	pthread_mutex_lock( &st->lock );
+	if ( item < st->stop_at )
+		st->stop_at = item;
+	pthread_mutex_unlock( &st->lock );
+}
+return 0;
+}
+
+/***********************************************************************/
+/* Returns the number of errors encountered */
+/***********************************************************************/
+int search_gallery_mt(
+	struct xyt_struct * pstruct,	/* INPUT: fixed probe */
+	char * probe_file,		/* INPUT: fixed probe's filename */
+	FILE * gallery_fp,		/* INPUT: gallery list, or NULL to take filenames from argv */
+	struct bz_web * web,		/* INPUT: Web gallery to search instead, or NULL */
+	struct bz_pack * pack,		/* INPUT: packed gallery to stream instead, or NULL */
+	int argc,
+	char ** argv,
+	int * optind,
+	int gline_begin,
+	int gline_end,
+	int nthreads,			/* INPUT: worker threads; 0 means one per CPU */
+	FILE * outfp,			/* INPUT: NULL if scores are not to be printed */
+	const char * outfmt,
+	int threshold_set,
+	int threshold,
+	int threshold_stop_flag,
+	int clip_threshold		/* INPUT: true to stop each match once the threshold is decided */
+	)
+{
+struct search_state st;
+int nerrors = 0;
+int done = 0;
+int glineno = 0;
+int next_web = 0;
+int batch_size;
+int nfiles;
+int i;
+struct xytq_struct * xytq = XYTQ_NULL;
+char gline[ MAX_LINE_LENGTH ];
+
+
+nthreads = work_pool_nthreads( nthreads, INT_MAX );
+if ( verbose_main )
+	fprintf( errorfp, "searching gallery with %d threads\n", nthreads );
+
+st.pstruct     = pstruct;
+st.probe_file  = probe_file;
+st.stop_early  = threshold_set && threshold_stop_flag;
+st.threshold   = threshold;
+st.web         = web;
+st.gstructs    = (struct xyt_struct **) NULL;
+batch_size     = SEARCH_BATCH_SIZE;
+if ( pack != BZ_PACK_NULL ) {
+	batch_size = SEARCH_PACKED_BATCH_SIZE;
+	st.gstructs = (struct xyt_struct **) malloc_or_exit( (int) ( batch_size * sizeof(struct xyt_struct *) ), "gallery template table" );
+	xytq = (struct xytq_struct *) malloc_or_exit( (int) sizeof(struct xytq_struct), "packed gallery record" );
+}
+st.ctxs        = (struct bz_ctx **) malloc_or_exit( (int) ( nthreads * sizeof(struct bz_ctx *) ), "matcher context table" );
+st.probe_lens  = (int *) malloc_or_exit( (int) ( nthreads * sizeof(int) ), "probe length table" );
+st.gfiles      = (char **) malloc_or_exit( (int) ( SEARCH_BATCH_SIZE * sizeof(char *) ), "gallery filename table" );
+st.scores      = (int *) malloc_or_exit( (int) ( SEARCH_BATCH_SIZE * sizeof(int) ), "gallery score table" );
+st.status      = (int *) malloc_or_exit( (int) ( SEARCH_BATCH_SIZE * sizeof(int) ), "gallery status table" );
+pthread_mutex_init( &st.lock, NULL );
+
+/* Each worker builds the probe's Web once in its own context */
+for ( i = 0; i < nthreads; i++ ) {
+	st.ctxs[i] = bz_ctx_alloc();
+	if ( st.ctxs[i] == BZ_CTX_NULL )
+		exit(1);
+	st.probe_lens[i] = bozorth_probe_init_ctx( st.ctxs[i], pstruct );
+	if ( clip_threshold )
+		bz_ctx_set_threshold( st.ctxs[i], threshold );
+}
+
+while ( ! done ) {
+	int done_now = 0;
+	int done_afterwards = 0;
+	char * g;
+
+	st.base = next_web;
+	for ( nfiles = 0; nfiles < batch_size; ) {
+		if ( pack != BZ_PACK_NULL ) {
+			int s;
+
+			s = bz_pack_read( pack, &gline[0], xytq );
+			if ( s <= 0 ) {
+				if ( s < 0 )
+					++nerrors;
+				done = 1;
+				break;
+			}
+			st.gstructs[nfiles] = bz_prune( xytq, 0 );
+			if ( st.gstructs[nfiles] == XYT_NULL ) {
+				++nerrors;
+				done = 1;
+				break;
+			}
+			st.gfiles[nfiles] = malloc_or_exit( (int) strlen(gline) + 1, "gallery filename" );
+			strcpy( st.gfiles[nfiles], gline );
+			nfiles++;
+			continue;
+		}
+		if ( web != BZ_WEB_NULL ) {
+			if ( next_web >= web->count ) {
+				done = 1;
+				break;
+			}
+			g = bz_web_name( web, next_web );
+			if ( g == CNULL ) {
+				fprintf( errorfp, "%s: ERROR: record %d of Web gallery file \"%s\" is corrupt\n",
+							get_progname(), next_web+1, web->filename );
+				++nerrors;
+				done = 1;
+				break;
+			}
+			st.gfiles[nfiles++] = g;
+			next_web++;
+			continue;
+		}
+		g = get_next_file( CNULL, gallery_fp, FPNULL, &done_now, &done_afterwards,
+					&gline[0], argc, argv, optind, &glineno, gline_begin, gline_end );
+		if ( done_now ) {
+			done = 1;
+			break;
+		}
+		st.gfiles[nfiles] = malloc_or_exit( (int) strlen(g) + 1, "gallery filename" );
+		strcpy( st.gfiles[nfiles], g );
+		nfiles++;
+		if ( done_afterwards ) {
+			done = 1;
+			break;
+		}
+	}
+
+	st.stop_at = nfiles;
+	(void) work_pool_run( search_one, (void *) &st, nfiles, nthreads );
+
+	/* Report in gallery order, exactly as the sequential loop would */
+	for ( i = 0; i < nfiles; i++ ) {
+		if ( verbose_main )
+			fprintf( errorfp, "probefile=%s galleryfile=%s\n", probe_file, st.gfiles[i] );
+
+		if ( st.status[i] == SEARCH_LOAD_FAILED ) {
+			++nerrors;
+			if ( verbose_main )
+				fprintf( errorfp, "breaking main loop after encountering an open failure\n" );
+			done = 1;
+			break;
+		}
+
+		if ( ! threshold_set || st.scores[i] >= threshold ) {
+			if ( outfp != FPNULL ) {
+				if ( fputs( get_score_line( probe_file, st.gfiles[i], st.scores[i], 1, outfmt ), outfp ) == EOF ) {
+					fprintf( errorfp, "%s: ERROR: fputs() of the match score line failed\n", get_progname() );
+					exit(1);
+				}
+				if ( ferror( outfp ) ) {
+					fprintf( errorfp, "%s: ERROR: match score write failure\n", get_progname() );
+					exit(1);
+				}
+			}
+			if ( threshold_set && threshold_stop_flag ) {
+				if ( verbose_main )
+					fprintf( errorfp, "breaking main loop after threshold met\n" );
+				done = 1;
+				break;
+			}
+		}
+	}
+
+	if ( web == BZ_WEB_NULL )
+		for ( i = 0; i < nfiles; i++ )
+			free( st.gfiles[i] );
+	if ( st.gstructs != (struct xyt_struct **) NULL )
+		for ( i = 0; i < nfiles; i++ )
+			free( (char *) st.gstructs[i] );
+}
+
+for ( i = 0; i < nthreads; i++ )
+	bz_ctx_free( st.ctxs[i] );
+pthread_mutex_destroy( &st.lock );
+free( (char *) st.ctxs );
+free( (char *) st.probe_lens );
+free( (char *) st.gfiles );
+free( (char *) st.scores );
+free( (char *) st.status );
+if ( st.gstructs != (struct xyt_struct **) NULL )
+	free( (char *) st.gstructs );
+if ( xytq != XYTQ_NULL )
+	free( (char *) xytq );
+
+return nerrors;
+}
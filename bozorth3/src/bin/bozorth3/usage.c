@@ -71,8 +71,13 @@ fprintf( fp, "        %s [options] -G gallery.lis probe*.xyt\n",          PROGRA
 fprintf( fp, "   To compute match scores for one fingerprint against many:\n" );
 fprintf( fp, "        %s [options] -p probefile.xyt      gallery*.xyt\n", PROGRAM );
 fprintf( fp, "        %s [options] -p probefile.xyt   -G gallery.lis\n",  PROGRAM );
+fprintf( fp, "        %s [options] -p probefile.xyt   -A web=gallery.web\n", PROGRAM );
+fprintf( fp, "        %s [options] -p probefile.xyt   -A packed=gallery.pak\n", PROGRAM );
 fprintf( fp, "        %s [options] -g galleryfile.xyt    probe*.xyt\n",   PROGRAM );
 fprintf( fp, "        %s [options] -g galleryfile.xyt -P probes.lis\n",   PROGRAM );
+fprintf( fp, "   To compute a matrix of match scores for many fingerprints against many:\n" );
+fprintf( fp, "        %s [options] -A matrix=<format> -P probes.lis -G gallery.lis\n", PROGRAM );
+fprintf( fp, "        %s [options] -A matrix=<format> -P probes.lis -A packed=gallery.pak\n", PROGRAM );
 fprintf( fp, "\n" );
 fprintf( fp, "General options:\n" );
 fprintf( fp, "   -h                      print this help message and exit\n" );
@@ -98,9 +103,19 @@ fprintf( fp, "          maxfiles=#       set maximum number of files in any gall
 fprintf( fp, "          plines=#-#       process a subset of files in the probe file\n" );
 fprintf( fp, "          glines=#-#       process a subset of files in the gallery file\n" );
 fprintf( fp, "          dryrun           only print the filenames between which match scores would be computed\n" );
+fprintf( fp, "          threads=#        with \"-p\", match the gallery using # worker threads (0 = one per CPU)\n" );
+fprintf( fp, "          web=<file>       with \"-p\", match against a Web gallery file built by bzweb\n" );
+fprintf( fp, "          packed=<file>    with \"-p\", stream the gallery from a packed gallery file built by bzpack\n" );
+fprintf( fp, "          ptile=#          with \"-A matrix\", match # probes at a time [%d]\n",
+								DEFAULT_MATRIX_PTILE );
+fprintf( fp, "          gtile=#          with \"-A matrix\", match # gallery fingerprints at a time [%d]\n",
+								DEFAULT_MATRIX_GTILE );
+fprintf( fp, "          simd=<filter>    match edges with the auto, scalar, sse2 or avx2 filter [auto]\n" );
 fprintf( fp, "\n" );
 fprintf( fp, "Thresholding options:\n" );
 fprintf( fp, "   -T <threshold>          set match score threshold\n" );
+fprintf( fp, "   -t <threshold>          like -T, but stop each match as soon as the threshold is met or can't be,\n" );
+fprintf( fp, "                           printing scores clipped to the threshold\n" );
 fprintf( fp, "   -q                      quit processing the probe file when a gallery file is found that meets the match score threshold\n" );
 
 #ifdef PARALLEL_SEARCH
@@ -111,6 +126,8 @@ fprintf( fp, "   -A rfd=<fd>             monitor this file descriptor for readab
 fprintf( fp, "\n" );
 fprintf( fp, "Output options:\n" );
 fprintf( fp, "   -A nooutput             compute match scores, but don't print them\n" );
+fprintf( fp, "   -A matrix=<format>      print every probe's scores against the whole gallery as a row of a\n" );
+fprintf( fp, "                           matrix; format is text, int or float (the last two are binary)\n" );
 fprintf( fp, "   -A outfmt=[spg]*        output lines will contain (s)core, (p)robe and/or (g)allery filename [%s]\n",
 								DEFAULT_SCORE_LINE_FORMAT );
 fprintf( fp, "   -D <score-dir>          set the directory to write score files in\n" );
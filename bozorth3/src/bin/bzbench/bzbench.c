@@ -0,0 +1,296 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/***********************************************************************
+      PACKAGE:        Bozorth Fingerprint Matcher
+
+      FILE:           BZBENCH.C
+
+#cat: bzbench - Times the edge filters bz_match() can use, the scalar
+#cat:            one and each vectorized one the host supports, on every
+#cat:            pair of the fingerprint minutiae (x,y,theta) files
+#cat:            given, and checks that every filter finds the same
+#cat:            compatible edge pairs and match scores as the scalar
+#cat:            one.  Each file's Web is built once beforehand, so only
+#cat:            bz_match() and scoring are timed.  Exits with 1 if any
+#cat:            filter differs.
+
+***********************************************************************/
+
+#include <usebsd.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <bozorth.h>
+#include <version.h>
+
+/* Globals used by the Bozorth3 library; see bozorth3.c */
+int m1_xyt                  = 0;
+int max_minutiae            = DEFAULT_BOZORTH_MINUTIAE;
+int min_computable_minutiae = MIN_COMPUTABLE_BOZORTH_MINUTIAE;
+
+int verbose_main      = 0;
+int verbose_load      = 0;
+int verbose_bozorth   = 0;
+int verbose_threshold = 0;
+
+FILE * errorfp            = FPNULL;
+
+extern char                *optarg;
+extern int                 optind;
+
+#define BZBENCH_PROGRAM	"bzbench"
+
+/**********************************************************************************/
+static void usage( FILE * fp )
+{
+fprintf( fp, "Usage:\n" );
+fprintf( fp, "        %s [options] file1.xyt file2.xyt ...\n", BZBENCH_PROGRAM );
+fprintf( fp, "\n" );
+fprintf( fp, "Options:\n" );
+fprintf( fp, "   -h                      print this help message and exit\n" );
+fprintf( fp, "   -m1                     all xyt files use representation according to ANSI INCITS 378-2004\n");
+fprintf( fp, "   -n <max-minutiae>       set maximum number of munitiae to use from any file [%d]; legal range is [%d,%d]\n",
+								DEFAULT_BOZORTH_MINUTIAE,
+								MIN_BOZORTH_MINUTIAE,
+								MAX_BOZORTH_MINUTIAE );
+fprintf( fp, "   -r <repeats>            match every pair this many times [1]\n" );
+}
+
+/**********************************************************************************/
+static double wall_time( void )
+{
+struct timeval tv;
+
+gettimeofday( &tv, (void *) NULL );
+return (double) tv.tv_sec + (double) tv.tv_usec / 1000000.0;
+}
+
+/**********************************************************************************/
+/* Matches every pair of Webs with the given filter, repeats times.  The   */
+/* edge pair counts and scores of the first pass are left in np[] and      */
+/* score[]; the seconds spent in bz_match_ctx(), and in it and scoring     */
+/* together, are returned in *match_time and *total_time.                  */
+/* Returns 0, or -1 if the host can't run the filter                       */
+/**********************************************************************************/
+static int bench_isa( int isa, struct bz_web_mem webs[], int nfiles, int repeats,
+			int np[], int score[], double * match_time, double * total_time )
+{
+struct bz_ctx * ctx;
+int r;
+int p;
+int g;
+int n;
+int s;
+double start;
+double mid;
+
+if ( bz_set_isa( isa ) != 0 )
+	return -1;
+ctx = bz_ctx_alloc();		/* A new context picks up the filter */
+if ( ctx == BZ_CTX_NULL )
+	exit(1);
+
+*match_time = 0.0;
+*total_time = 0.0;
+for ( r = 0; r < repeats; r++ ) {
+	for ( p = 0; p < nfiles; p++ ) {
+		ctx->sedges = webs[p].edges;
+		for ( g = 0; g < nfiles; g++ ) {
+			ctx->fedges = webs[g].edges;
+			start = wall_time();
+			n = bz_match_ctx( ctx, webs[p].len, webs[g].len );
+			mid = wall_time();
+			s = bz_match_score_ctx( ctx, n, &webs[p].xyt, &webs[g].xyt );
+			*match_time += mid - start;
+			*total_time += wall_time() - start;
+			if ( r == 0 ) {
+				np[ p * nfiles + g ] = n;
+				score[ p * nfiles + g ] = s;
+			}
+		}
+	}
+}
+
+bz_ctx_free( ctx );
+return 0;
+}
+
+/**********************************************************************************/
+int main( int argc, char ** argv )
+{
+int parse_errors = 0;
+int nerrors = 0;
+int repeats = 1;
+int nfiles;
+int npairs;
+int i;
+int isa;
+int ndiff;
+int * ref_np;
+int * ref_score;
+int * np;
+int * score;
+double match_time;
+double total_time;
+double ref_match_time = 0.0;
+struct xyt_struct * xyt;
+struct bz_web_mem * webs;
+struct bz_ctx * ctx;
+
+errorfp = stderr;
+
+if ((argc == 2) && (strcmp(argv[1], "-version") == 0)) {
+	getVersion();
+	exit(0);
+}
+
+while (1) {
+	int c;
+
+	c = getopt( argc, argv, "+hm:n:r:" );
+	if ( c == -1 )
+		break;
+
+	switch ( c ) {
+		case 'h':
+			usage( stdout );
+			exit(0);
+		case 'm': /* "-m1" */
+			if ( strcmp(optarg,"1") != 0) {
+				fprintf( stderr, "%s: ERROR: illegal -m option (-m%s), \"-m1\" expected\n",
+					BZBENCH_PROGRAM, optarg);
+				++parse_errors;
+			}
+			m1_xyt = 1;
+			break;
+		case 'n':
+			max_minutiae = atoi( optarg );
+			if ( max_minutiae < MIN_BOZORTH_MINUTIAE || max_minutiae > MAX_BOZORTH_MINUTIAE ) {
+				fprintf( stderr, "%s: ERROR: max_minutiae (%d) is outside the legal range [%d,%d]\n",
+								BZBENCH_PROGRAM, max_minutiae,
+								MIN_BOZORTH_MINUTIAE, MAX_BOZORTH_MINUTIAE );
+				++parse_errors;
+			}
+			break;
+		case 'r':
+			repeats = atoi( optarg );
+			if ( repeats < 1 ) {
+				fprintf( stderr, "%s: ERROR: repeats (%d) must be at least 1\n",
+								BZBENCH_PROGRAM, repeats );
+				++parse_errors;
+			}
+			break;
+		default:
+			usage( stderr );
+			exit(1);
+	}
+}
+
+if ( optind >= argc ) {
+	fprintf( stderr, "%s: ERROR: no xyt-files are specified on the command line\n", BZBENCH_PROGRAM );
+	++parse_errors;
+}
+if ( parse_errors > 0 ) {
+	usage( stderr );
+	exit(1);
+}
+
+set_progname( 0, BZBENCH_PROGRAM, (pid_t)0 );
+
+nfiles = argc - optind;
+npairs = nfiles * nfiles;
+/* Build each file's Web once, so only matching is timed */
+ctx = bz_ctx_alloc();
+if ( ctx == BZ_CTX_NULL )
+	exit(1);
+webs = (struct bz_web_mem *) malloc_or_exit( nfiles * (int) sizeof(struct bz_web_mem), "Webs" );
+for ( i = 0; i < nfiles; i++ ) {
+	xyt = bz_load( argv[ optind + i ] );
+	if ( xyt == XYT_NULL )
+		exit(1);
+	if ( bz_web_mem_build( ctx, xyt, &webs[i] ) != 0 )
+		exit(1);
+	free( (char *) xyt );
+}
+bz_ctx_free( ctx );
+ref_np    = (int *) malloc_or_exit( npairs * (int) sizeof(int), "edge pair counts" );
+ref_score = (int *) malloc_or_exit( npairs * (int) sizeof(int), "scores" );
+np        = (int *) malloc_or_exit( npairs * (int) sizeof(int), "edge pair counts" );
+score     = (int *) malloc_or_exit( npairs * (int) sizeof(int), "scores" );
+
+printf( "%d pairs, %d repeats\n", npairs, repeats );
+printf( "%-8s %12s %12s %9s %12s\n", "filter", "bz_match s", "+score s", "speedup", "differences" );
+
+for ( isa = BZ_ISA_SCALAR; isa <= BZ_ISA_AVX2; isa++ ) {
+	if ( bench_isa( isa, webs, nfiles, repeats,
+			isa == BZ_ISA_SCALAR ? ref_np : np,
+			isa == BZ_ISA_SCALAR ? ref_score : score,
+			&match_time, &total_time ) != 0 ) {
+		printf( "%-8s %12s\n", bz_isa_name( isa ), "unsupported" );
+		continue;
+	}
+	ndiff = 0;
+	if ( isa == BZ_ISA_SCALAR )
+		ref_match_time = match_time;
+	else {
+		for ( i = 0; i < npairs; i++ )
+			if ( np[i] != ref_np[i] || score[i] != ref_score[i] )
+				++ndiff;
+	}
+	printf( "%-8s %12.3f %12.3f %8.2fx %12d\n", bz_isa_name( isa ),
+			match_time, total_time,
+			match_time > 0.0 ? ref_match_time / match_time : 0.0, ndiff );
+	nerrors += ndiff;
+}
+
+for ( i = 0; i < nfiles; i++ )
+	bz_web_mem_free( &webs[i] );
+free( (char *) webs );
+free( (char *) ref_np );
+free( (char *) ref_score );
+free( (char *) np );
+free( (char *) score );
+
+exit( nerrors > 0 ? 1 : 0 );
+}
@@ -0,0 +1,378 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/***********************************************************************
+      PACKAGE:        Bozorth Fingerprint Matcher
+
+      FILE:           BZCHECK.C
+
+#cat: bzcheck - Checks that bz_comp() builds the same pairwise comparison
+#cat:            tables as the original Bozorth3 code, which called
+#cat:            atanf() for every edge and kept the row pointers sorted
+#cat:            with a binary search and insertion as each row was made.
+#cat:            Every edge angle in the (dx,dy) domain is compared
+#cat:            under both the default and "-m1" conventions, then the
+#cat:            sorted tables of random minutiae sets and of any xyt
+#cat:            files given are compared row by row.  Exits with 1 if
+#cat:            anything differs.
+
+***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <bozorth.h>
+#include <version.h>
+
+/* Globals used by the Bozorth3 library; see bozorth3.c */
+int m1_xyt                  = 0;
+int max_minutiae            = DEFAULT_BOZORTH_MINUTIAE;
+int min_computable_minutiae = MIN_COMPUTABLE_BOZORTH_MINUTIAE;
+
+int verbose_main      = 0;
+int verbose_load      = 0;
+int verbose_bozorth   = 0;
+int verbose_threshold = 0;
+
+FILE * errorfp            = FPNULL;
+
+#define BZCHECK_PROGRAM	"bzcheck"
+#define BZCHECK_SETS	200		/* random minutiae sets per convention */
+
+static int ref_cols[ SCOLS_SIZE_1 ][ COLS_SIZE_2 ];
+static int * ref_colptrs[ SCOLS_SIZE_1 ];
+static int new_cols[ SCOLS_SIZE_1 ][ COLS_SIZE_2 ];
+static int * new_colptrs[ SCOLS_SIZE_1 ];
+
+static unsigned long rand_state = 1;
+
+/**********************************************************************************/
+/* The bz_comp() of the original Bozorth3 code, as the reference */
+/**********************************************************************************/
+static void ref_comp(
+	int npoints,
+	int xcol[     MAX_BOZORTH_MINUTIAE ],
+	int ycol[     MAX_BOZORTH_MINUTIAE ],
+	int thetacol[ MAX_BOZORTH_MINUTIAE ],
+	int * ncomparisons,
+	int cols[][ COLS_SIZE_2 ],
+	int * colptrs[]
+	)
+{
+int i, j, k;
+int b;
+int t;
+int n;
+int l;
+int table_index;
+int dx;
+int dy;
+int distance;
+int theta_kj;
+int beta_j;
+int beta_k;
+int * c;
+
+c = &cols[0][0];
+
+table_index = 0;
+for ( k = 0; k < npoints - 1; k++ ) {
+	for ( j = k + 1; j < npoints; j++ ) {
+		if ( thetacol[j] > 0 ) {
+			if ( thetacol[k] == thetacol[j] - 180 )
+				continue;
+		} else {
+			if ( thetacol[k] == thetacol[j] + 180 )
+				continue;
+		}
+
+		dx = xcol[j] - xcol[k];
+		dy = ycol[j] - ycol[k];
+		distance = SQUARED(dx) + SQUARED(dy);
+		if ( distance > SQUARED(DM) ) {
+			if ( dx > DM )
+				break;
+			else
+				continue;
+		}
+
+		if ( dx == 0 )
+			theta_kj = 90;
+		else {
+			double dz;
+
+			if ( m1_xyt )
+				dz = ( 180.0F / PI_SINGLE ) * atanf( (float) -dy / (float) dx );
+			else
+				dz = ( 180.0F / PI_SINGLE ) * atanf( (float) dy / (float) dx );
+			if ( dz < 0.0F )
+				dz -= 0.5F;
+			else
+				dz += 0.5F;
+			theta_kj = (int) dz;
+		}
+
+		beta_k = theta_kj - thetacol[k];
+		beta_k = IANGLE180(beta_k);
+
+		beta_j = theta_kj - thetacol[j] + 180;
+		beta_j = IANGLE180(beta_j);
+
+		if ( beta_k < beta_j ) {
+			*c++ = distance;
+			*c++ = beta_k;
+			*c++ = beta_j;
+			*c++ = k+1;
+			*c++ = j+1;
+			*c++ = theta_kj;
+		} else {
+			*c++ = distance;
+			*c++ = beta_j;
+			*c++ = beta_k;
+			*c++ = k+1;
+			*c++ = j+1;
+			*c++ = theta_kj + 400;
+		}
+
+		b = 0;
+		t = table_index + 1;
+		l = 1;
+		n = -1;
+
+		while ( t - b > 1 ) {
+			int * midpoint;
+
+			l = ( b + t ) / 2;
+			midpoint = colptrs[l-1];
+
+			for ( i=0; i < 3; i++ ) {
+				int dd, ff;
+
+				dd = cols[table_index][i];
+				ff = midpoint[i];
+				n = SENSE(dd,ff);
+				if ( n < 0 ) {
+					t = l;
+					break;
+				}
+				if ( n > 0 ) {
+					b = l;
+					break;
+				}
+			}
+
+			if ( n == 0 ) {
+				n = 1;
+				b = l;
+			}
+		}
+
+		if ( n == 1 )
+			++l;
+
+		for ( i = table_index; i >= l; --i )
+			colptrs[i] = colptrs[i-1];
+
+		colptrs[l-1] = &cols[table_index][0];
+		++table_index;
+
+		if ( table_index == 19999 )
+			goto COMP_END;
+	}
+}
+
+COMP_END:
+	*ncomparisons = table_index;
+}
+
+/**********************************************************************************/
+/* Builds both tables for a minutiae set; returns 1 if they differ */
+/**********************************************************************************/
+static int check_set( int n, int x[], int y[], int t[], const char * what )
+{
+int i;
+int ref_n;
+int new_n;
+
+ref_comp( n, x, y, t, &ref_n, ref_cols, ref_colptrs );
+bz_comp( n, x, y, t, &new_n, new_cols, new_colptrs );
+
+if ( ref_n != new_n ) {
+	fprintf( errorfp, "%s: %s (-m1 %d): %d rows, expected %d\n",
+				BZCHECK_PROGRAM, what, m1_xyt, new_n, ref_n );
+	return 1;
+}
+for ( i = 0; i < ref_n; i++ ) {
+	if ( memcmp( ref_cols[i], new_cols[i], COLS_SIZE_2 * sizeof(int) ) != 0 ||
+	     ref_colptrs[i] - &ref_cols[0][0] != new_colptrs[i] - &new_cols[0][0] ) {
+		fprintf( errorfp, "%s: %s (-m1 %d): row %d differs\n",
+					BZCHECK_PROGRAM, what, m1_xyt, i );
+		return 1;
+	}
+}
+return 0;
+}
+
+/**********************************************************************************/
+/* Compares the angle of every edge within DM under the current convention */
+/**********************************************************************************/
+static int check_angles( int * nedges )
+{
+int dx;
+int dy;
+int x[2];
+int y[2];
+int t[2];
+int nerrors = 0;
+char what[ 64 ];
+
+x[0] = 0;
+y[0] = 0;
+t[0] = 0;
+t[1] = 10;
+for ( dy = -DM; dy <= DM; dy++ ) {
+	for ( dx = -DM; dx <= DM; dx++ ) {
+		if ( SQUARED(dx) + SQUARED(dy) > SQUARED(DM) )
+			continue;
+		x[1] = dx;
+		y[1] = dy;
+		sprintf( what, "edge (%d,%d)", dx, dy );
+		nerrors += check_set( 2, x, y, t, what );
+		++*nedges;
+	}
+}
+return nerrors;
+}
+
+/**********************************************************************************/
+static int next_rand( int n )
+{
+rand_state = rand_state * 1103515245UL + 12345UL;
+return (int) ( ( rand_state >> 16 ) & 0x7FFF ) % n;
+}
+
+/**********************************************************************************/
+/* Compares the tables of random minutiae sets, sorted on x as bz_load()   */
+/* leaves them.  The points are crowded so that many edges tie on distance */
+/* and Betas, and some points repeat, to exercise the order of ties.       */
+/**********************************************************************************/
+static int check_random_sets( void )
+{
+int s;
+int i;
+int j;
+int n;
+int tmp;
+int x[ MAX_BOZORTH_MINUTIAE ];
+int y[ MAX_BOZORTH_MINUTIAE ];
+int t[ MAX_BOZORTH_MINUTIAE ];
+int nerrors = 0;
+char what[ 64 ];
+
+for ( s = 0; s < BZCHECK_SETS; s++ ) {
+	n = 2 + next_rand( MAX_BOZORTH_MINUTIAE - 1 );
+	for ( i = 0; i < n; i++ ) {
+		if ( i > 0 && next_rand( 8 ) == 0 ) {
+			x[i] = x[i-1];
+			y[i] = y[i-1];
+		} else {
+			x[i] = next_rand( 100 + s * 2 );
+			y[i] = next_rand( 100 + s * 2 );
+		}
+		t[i] = next_rand( 360 ) - 179;
+	}
+	for ( i = 1; i < n; i++ ) {
+		for ( j = i; j > 0 && x[j-1] > x[j]; j-- ) {
+			tmp = x[j]; x[j] = x[j-1]; x[j-1] = tmp;
+			tmp = y[j]; y[j] = y[j-1]; y[j-1] = tmp;
+			tmp = t[j]; t[j] = t[j-1]; t[j-1] = tmp;
+		}
+	}
+	sprintf( what, "random set %d", s );
+	nerrors += check_set( n, x, y, t, what );
+}
+return nerrors;
+}
+
+/**********************************************************************************/
+int main( int argc, char ** argv )
+{
+int i;
+int nerrors = 0;
+int nedges = 0;
+int nfiles = 0;
+struct xyt_struct * xyt;
+
+errorfp = stderr;
+
+if ((argc == 2) && (strcmp(argv[1], "-version") == 0)) {
+	getVersion();
+	exit(0);
+}
+if ((argc >= 2) && (argv[1][0] == '-')) {
+	fprintf( stderr, "Usage: %s [file.xyt ...]\n", BZCHECK_PROGRAM );
+	exit(1);
+}
+
+set_progname( 0, BZCHECK_PROGRAM, (pid_t)0 );
+
+for ( m1_xyt = 0; m1_xyt <= 1; m1_xyt++ ) {
+	nerrors += check_angles( &nedges );
+	rand_state = 1;
+	nerrors += check_random_sets();
+
+	for ( i = 1; i < argc; i++ ) {
+		xyt = bz_load( argv[i] );
+		if ( xyt == XYT_NULL ) {
+			++nerrors;
+			continue;
+		}
+		nerrors += check_set( xyt->nrows, xyt->xcol, xyt->ycol, xyt->thetacol, argv[i] );
+		free( (char *) xyt );
+		++nfiles;
+	}
+}
+
+printf( "%s: %d edge angles, %d random sets, %d files: %d differences\n",
+		BZCHECK_PROGRAM, nedges, 2 * BZCHECK_SETS, nfiles, nerrors );
+exit( nerrors > 0 ? 1 : 0 );
+}
@@ -0,0 +1,250 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/***********************************************************************
+      PACKAGE:        Bozorth Fingerprint Matcher
+
+      FILE:           BZWEB.C
+
+
+#cat: bzweb - Precomputes the pairwise comparison tables ("Webs") of
+#cat:            a gallery of fingerprint minutiae (x,y,theta) files and
+#cat:            stores them in a single Web gallery file that bozorth3
+#cat:            can match against with "-A web=<file>".
+
+***********************************************************************/
+
+#include <usebsd.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <bozorth.h>
+#include <version.h>
+
+/* Globals used by the Bozorth3 library; see bozorth3.c */
+int m1_xyt                  = 0;
+int max_minutiae            = DEFAULT_BOZORTH_MINUTIAE;
+int min_computable_minutiae = MIN_COMPUTABLE_BOZORTH_MINUTIAE;
+
+int verbose_main      = 0;
+int verbose_load      = 0;
+int verbose_bozorth   = 0;
+int verbose_threshold = 0;
+
+FILE * errorfp            = FPNULL;
+
+extern char                *optarg;
+extern int                 optind;
+
+#define BZWEB_PROGRAM	"bzweb"
+
+/**********************************************************************************/
+static void usage( FILE * fp )
+{
+fprintf( fp, "Usage:\n" );
+fprintf( fp, "        %s [options] -o gallery.web gallery*.xyt\n",  BZWEB_PROGRAM );
+fprintf( fp, "        %s [options] -o gallery.web -G gallery.lis\n", BZWEB_PROGRAM );
+fprintf( fp, "\n" );
+fprintf( fp, "Options:\n" );
+fprintf( fp, "   -h                      print this help message and exit\n" );
+fprintf( fp, "   -v                      enable verbose mode\n" );
+fprintf( fp, "   -m1                     all xyt files use representation according to ANSI INCITS 378-2004\n");
+fprintf( fp, "   -n <max-minutiae>       set maximum number of munitiae to use from any file [%d]; legal range is [%d,%d]\n",
+								DEFAULT_BOZORTH_MINUTIAE,
+								MIN_BOZORTH_MINUTIAE,
+								MAX_BOZORTH_MINUTIAE );
+fprintf( fp, "   -o <web-file>           set the Web gallery file to write\n" );
+fprintf( fp, "   -G <gallery.lis>        read gallery filenames from a list file\n" );
+fprintf( fp, "\n" );
+fprintf( fp, "The -m1 and -n settings must match those later given to %s.\n", PROGRAM );
+}
+
+/**********************************************************************************/
+int main( int argc, char ** argv )
+{
+int parse_errors = 0;
+int nerrors = 0;
+int done_now = 0;
+int done_afterwards = 0;
+int glineno = 0;
+char * gallery_list = CNULL;
+char * outfile = CNULL;
+char * g;
+FILE * gallery_fp = FPNULL;
+struct bz_ctx * ctx;
+struct bz_web_out * out;
+struct xyt_struct * gstruct;
+char gline[ MAX_LINE_LENGTH ];
+
+
+
+errorfp = stderr;
+
+if ((argc == 2) && (strcmp(argv[1], "-version") == 0)) {
+	getVersion();
+	exit(0);
+}
+
+while (1) {
+	int c;
+
+	c = getopt( argc, argv, "+hvm:n:o:G:" );
+	if ( c == -1 )
+		break;
+
+	switch ( c ) {
+		case 'h':
+			usage( stdout );
+			exit(0);
+		case 'v':
+			verbose_load = 1;
+			verbose_main = 1;
+			break;
+		case 'm': /* "-m1" */
+			if ( strcmp(optarg,"1") != 0) {
+				fprintf( stderr, "%s: ERROR: illegal -m option (-m%s), \"-m1\" expected\n",
+					BZWEB_PROGRAM, optarg);
+				++parse_errors;
+			}
+			m1_xyt = 1;
+			break;
+		case 'n':
+			max_minutiae = atoi( optarg );
+			if ( max_minutiae < MIN_BOZORTH_MINUTIAE || max_minutiae > MAX_BOZORTH_MINUTIAE ) {
+				fprintf( stderr, "%s: ERROR: max_minutiae (%d) is outside the legal range [%d,%d]\n",
+								BZWEB_PROGRAM, max_minutiae,
+								MIN_BOZORTH_MINUTIAE, MAX_BOZORTH_MINUTIAE );
+				++parse_errors;
+			}
+			break;
+		case 'o':
+			outfile = optarg;
+			break;
+		case 'G':
+			gallery_list = optarg;
+			break;
+		default:
+			usage( stderr );
+			exit(1);
+	}
+}
+
+if ( outfile == CNULL ) {
+	fprintf( stderr, "%s: ERROR: flag \"-o\" is required\n", BZWEB_PROGRAM );
+	++parse_errors;
+}
+if ( gallery_list != CNULL && optind < argc ) {
+	fprintf( stderr, "%s: ERROR: no xyt-files can be specified on the command line with \"-G\"\n", BZWEB_PROGRAM );
+	++parse_errors;
+}
+if ( gallery_list == CNULL && optind >= argc ) {
+	fprintf( stderr, "%s: ERROR: no xyt-files are specified on the command line\n", BZWEB_PROGRAM );
+	++parse_errors;
+}
+if ( parse_errors > 0 ) {
+	usage( stderr );
+	exit(1);
+}
+
+set_progname( 0, BZWEB_PROGRAM, (pid_t)0 );
+
+
+
+if ( gallery_list != CNULL ) {
+	gallery_fp = fopen( gallery_list, "r" );
+	if ( gallery_fp == FPNULL ) {
+		fprintf( errorfp, "%s: ERROR: fopen() of gallery list file \"%s\" failed: %s\n",
+								get_progname(), gallery_list, strerror(errno) );
+		exit(1);
+	}
+}
+
+ctx = bz_ctx_alloc();
+if ( ctx == BZ_CTX_NULL )
+	exit(1);
+
+out = bz_web_create( outfile );
+if ( out == BZ_WEB_OUT_NULL )
+	exit(1);
+
+
+
+while ( ! done_afterwards ) {
+	g = get_next_file( CNULL, gallery_fp, FPNULL, &done_now, &done_afterwards,
+				&gline[0], argc, argv, &optind, &glineno, -1, -1 );
+	if ( done_now )
+		break;
+
+	gstruct = bz_load( g );
+	if ( gstruct == XYT_NULL ) {
+		++nerrors;
+		break;
+	}
+	ctx->gfile = g;
+	if ( bz_web_append( out, ctx, g, gstruct ) != 0 )
+		++nerrors;
+	free( (char *) gstruct );
+	if ( nerrors > 0 )
+		break;
+}
+
+
+
+if ( bz_web_finish( out ) != 0 )
+	++nerrors;
+bz_ctx_free( ctx );
+
+if ( gallery_fp != FPNULL ) {
+	if ( fclose( gallery_fp ) != 0 ) {
+		fprintf( errorfp, "%s: ERROR: fclose() of gallery list \"%s\" failed: %s\n",
+								get_progname(), gallery_list, strerror(errno) );
+		++nerrors;
+	}
+}
+
+if ( nerrors > 0 ) {
+	(void) unlink( outfile );
+	exit(1);
+}
+exit(0);
+}
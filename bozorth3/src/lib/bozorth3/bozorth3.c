@@ -62,6 +62,8 @@ of the software.
 #cat:            of pairwise comparison entries
 #cat: bz_find -  trims sorted table of pairwise minutia comparisons to
 #cat:            a max distance of 75^2
+#cat: bz_edges_fill - copies the sorted rows of a pairwise comparison
+#cat:            table into the columns bz_match() walks
 #cat: bz_match - takes the two pairwise minutia comparison tables (a probe
 #cat:            table and a gallery table) and compiles a list of
 #cat:            all relatively "compatible" entries between the two
@@ -75,12 +77,56 @@ of the software.
 #cat: bz_final_loop - (declared static) a final postprocess after
 #cat:            the main match table traversal which looks to combine
 #cat:            clusters of compatible paths
+#cat: bz_match_ctx - reentrant version of bz_match that works within
+#cat:            a caller-owned matcher context
+#cat: bz_match_score_ctx - reentrant version of bz_match_score
+#cat: bz_match_score_thresh_ctx - version of bz_match_score_ctx that
+#cat:            stops as soon as it is certain whether the score meets
+#cat:            a threshold, returning the score clipped to it
+#cat: bz_sift_ctx - reentrant version of bz_sift
+#cat: bz_atan_init - (declared static) fills the table of rounded
+#cat:            edge angles used by bz_comp
 
 ***********************************************************************/
 
 #include <stdio.h>
+#include <pthread.h>
 #include <bozorth.h>
 
+/* Rounded angle in degrees of every edge bz_comp() can see, indexed */
+/* [dy+DM][dx+DM]; both deltas are bounded by DM since the distance  */
+/* is.  The "-m1" convention is looked up with dy negated.           */
+#define ATAN_TAB_SIZE	( 2 * DM + 1 )
+
+static signed char atan_tab[ ATAN_TAB_SIZE ][ ATAN_TAB_SIZE ];
+static pthread_once_t atan_tab_once = PTHREAD_ONCE_INIT;
+
+/***********************************************************************/
+/* Computes each entry exactly as bz_comp() used to compute it per   */
+/* edge, so table lookups give bit-identical angles on any platform. */
+/***********************************************************************/
+static void bz_atan_init( void )
+{
+int dx;
+int dy;
+double dz;
+
+for ( dy = -DM; dy <= DM; dy++ ) {
+	for ( dx = -DM; dx <= DM; dx++ ) {
+		if ( dx == 0 ) {
+			atan_tab[ dy + DM ][ dx + DM ] = 90;
+			continue;
+		}
+		dz = ( 180.0F / PI_SINGLE ) * atanf( (float) dy / (float) dx );
+		if ( dz < 0.0F )
+			dz -= 0.5F;
+		else
+			dz += 0.5F;
+		atan_tab[ dy + DM ][ dx + DM ] = (signed char) (int) dz;
+	}
+}
+}
+
 /***********************************************************************/
 void bz_comp(
 	int npoints,				/* INPUT: # of points */
@@ -90,17 +136,17 @@ void bz_comp(
 
 	int * ncomparisons,			/* OUTPUT: number of pointwise comparisons */
 	int cols[][ COLS_SIZE_2 ],		/* OUTPUT: pointwise comparison table */
-	int * colptrs[]				/* INPUT and OUTPUT: sorted list of pointers to rows in cols[] */
+	int * colptrs[]				/* OUTPUT: sorted list of pointers to rows in cols[] */
 	)
 {
 int i, j, k;
 
-int b;
-int t;
 int n;
-int l;
+int * row;
+int * prev;
 
 int table_index;
+int dcount[ SQUARED(DM) + 1 ];		/* Rows per distance, then next slot in colptrs[] for each distance */
 
 int dx;
 int dy;
@@ -114,8 +160,12 @@ int * c;
 
 
 
+pthread_once( &atan_tab_once, bz_atan_init );
+
 c = &cols[0][0];
 
+INT_SET( dcount, SQUARED(DM) + 1, 0 );
+
 table_index = 0;
 for ( k = 0; k < npoints - 1; k++ ) {
 	for ( j = k + 1; j < npoints; j++ ) {
@@ -144,21 +194,10 @@ for ( k = 0; k < npoints - 1; k++ ) {
 		}
 
 					/* The distance is in the range [ 0, 125^2 ] */
-		if ( dx == 0 )
-			theta_kj = 90;
-		else {
-			double dz;
-
-			if ( m1_xyt )
-				dz = ( 180.0F / PI_SINGLE ) * atanf( (float) -dy / (float) dx );
-			else
-				dz = ( 180.0F / PI_SINGLE ) * atanf( (float) dy / (float) dx );
-			if ( dz < 0.0F )
-				dz -= 0.5F;
-			else
-				dz += 0.5F;
-			theta_kj = (int) dz;
-		}
+		if ( m1_xyt )
+			theta_kj = atan_tab[ DM - dy ][ DM + dx ];
+		else
+			theta_kj = atan_tab[ DM + dy ][ DM + dx ];
 
 
 		beta_k = theta_kj - thetacol[k];
@@ -190,61 +229,7 @@ for ( k = 0; k < npoints - 1; k++ ) {
 
 
 
-		b = 0;
-		t = table_index + 1;
-		l = 1;
-		n = -1;			/* Init binary search state ... */
-
-
-
-
-		while ( t - b > 1 ) {
-			int * midpoint;
-
-			l = ( b + t ) / 2;
-			midpoint = colptrs[l-1];
-
-
-
-
-			for ( i=0; i < 3; i++ ) {
-				int dd, ff;
-
-				dd = cols[table_index][i];
-
-				ff = midpoint[i];
-
-
-				n = SENSE(dd,ff);
-
-
-				if ( n < 0 ) {
-					t = l;
-					break;
-				}
-				if ( n > 0 ) {
-					b = l;
-					break;
-				}
-			}
-
-			if ( n == 0 ) {
-				n = 1;
-				b = l;
-			}
-		} /* END while */
-
-		if ( n == 1 )
-			++l;
-
-
-
-
-		for ( i = table_index; i >= l; --i )
-			colptrs[i] = colptrs[i-1];
-
-
-		colptrs[l-1] = &cols[table_index][0];
+		++dcount[distance];			/* Rows are sorted once the table is complete */
 		++table_index;
 
 
@@ -263,6 +248,35 @@ for ( k = 0; k < npoints - 1; k++ ) {
 COMP_END:
 	*ncomparisons = table_index;
 
+
+
+/* Sort the row pointers on distance, then beta_k, then beta_j, with  */
+/* rows that tie on all three left in the order they were generated.  */
+/* First a counting sort on distance, which is stable ...             */
+n = 0;
+for ( i = 0; i <= SQUARED(DM); i++ ) {
+	k = dcount[i];
+	dcount[i] = n;
+	n += k;
+}
+for ( i = 0; i < table_index; i++ )
+	colptrs[ dcount[ cols[i][0] ]++ ] = &cols[i][0];
+
+/* ... then an insertion sort within each run of equal distances, */
+/* which is just as stable and touches only a few rows per run    */
+for ( i = 1; i < table_index; i++ ) {
+	row = colptrs[i];
+	for ( j = i; j > 0; j-- ) {
+		prev = colptrs[j-1];
+		if ( prev[0] != row[0] )
+			break;
+		if ( prev[1] < row[1] || ( prev[1] == row[1] && prev[2] <= row[2] ) )
+			break;
+		colptrs[j] = prev;
+	}
+	colptrs[j] = row;
+}
+
 }
 
 /***********************************************************************/
@@ -333,6 +347,67 @@ while ( shiftcount-- > 0 ) {
 *r1 = ptr;
 }
 
+/***********************************************************************/
+/* Index of the lowest and highest bits set in a non-zero mask */
+/***********************************************************************/
+static int bz_low_bit( unsigned int m )
+{
+#ifdef __GNUC__
+return __builtin_ctz( m );
+#else
+int i;
+
+for ( i = 0; ( m & 1 ) == 0; i++ )
+	m >>= 1;
+return i;
+#endif
+}
+
+static int bz_high_bit( unsigned int m )
+{
+#ifdef __GNUC__
+return 31 - __builtin_clz( m );
+#else
+int i;
+
+for ( i = -1; m != 0; i++ )
+	m >>= 1;
+return i;
+#endif
+}
+
+/***********************************************************************/
+/* Copies the first len sorted rows into separate columns: the three   */
+/* keys bz_match() compares, as shorts, and the rest packed into one   */
+/* int per edge.  Distances are at most DM^2 and every other value is  */
+/* a small angle or point number, so nothing is lost.                  */
+/***********************************************************************/
+void bz_edges_fill(
+	int * colptrs[],	/* INPUT:  sorted row pointers from bz_comp() */
+	int len,		/* INPUT:  number of rows to copy */
+	short dist[],		/* OUTPUT: storage for each column */
+	short beta1[],
+	short beta2[],
+	int info[],
+	struct bz_edges * edges	/* OUTPUT: set to the columns above */
+	)
+{
+int i;
+int * row;
+
+for ( i = 0; i < len; i++ ) {
+	row = colptrs[i];
+	dist[i]  = (short) row[0];
+	beta1[i] = (short) row[1];
+	beta2[i] = (short) row[2];
+	info[i]  = BZ_EDGE_INFO( row[3], row[4], row[5] );
+}
+edges->dist  = dist;
+edges->beta1 = beta1;
+edges->beta2 = beta2;
+edges->info  = info;
+}
+
 /***********************************************************************/
 /* Builds list of compatible edge pairs between the 2 Webs. */
 /* The Edge pair DeltaThetaKJs and endpoints are sorted     */
@@ -346,13 +421,30 @@ int bz_match(
 	int gallery_ptrlist_len		/* INPUT:  pruned length of On-File Record's pointer list */
 	)
 {
+return bz_match_ctx( &bz_gbl_ctx, probe_ptrlist_len, gallery_ptrlist_len );
+}
+
+/***********************************************************************/
+int bz_match_ctx(
+	struct bz_ctx * ctx,		/* INPUT and OUTPUT: matcher context holding both Webs and the match table */
+	int probe_ptrlist_len,		/* INPUT:  pruned length of Subject's pointer list */
+	int gallery_ptrlist_len		/* INPUT:  pruned length of On-File Record's pointer list */
+	)
+{
 int i;			/* Temp index */
 int ii;			/* Temp index */
 int edge_pair_index;	/* Compatible edge pair index */
-float dz;		/* Delta difference and delta angle stats */
-float fi;		/* Distance limit based on factor TK */
-int * ss;		/* Subject's comparison stats row */
-int * ff;		/* On-File Record's comparison stats row */
+int ss;			/* Subject's edge distance */
+int sb1;		/* Subject's edge Betas */
+int sb2;
+int sinfo;		/* Subject's packed K, J and ThetaKJ */
+int finfo;		/* On-File Record's packed K, J and ThetaKJ */
+int jb;			/* First On-File Record's row index in a block */
+int nb;			/* Number of rows in the block */
+unsigned int cand;	/* Rows in the block compatible with the Subject's edge */
+unsigned int too_short;	/* Rows in the block shorter than compatible */
+unsigned int too_long;	/* Rows in the block longer than compatible */
+unsigned int below;	/* Rows before the first one too long */
 int j;			/* On-File Record's row index */
 int k;			/* Subject's row index */
 int st;			/* Starting On-File Record's row index */
@@ -366,21 +458,14 @@ int t;			/* Top of search range */
 register int * rotptr;
 
 
-#define ROT_SIZE_1 20000
-#define ROT_SIZE_2 5
-
-static int rot[ ROT_SIZE_1 ][ ROT_SIZE_2 ];
-
-
-static int * rtp[ ROT_SIZE_1 ];
-
-
-
+/* These now owned by the matcher context (struct bz_ctx in bozorth.h) */
+/* struct bz_edges sedges;				 INPUT */
+/* struct bz_edges fedges;				 INPUT */
+/* int   colp[ COLP_SIZE_1 ][ COLP_SIZE_2 ];		 OUTPUT */
+/* int   rot[ ROT_SIZE_1 ][ ROT_SIZE_2 ];			 SCRATCH */
+/* int * rtp[ ROT_SIZE_1 ];				 SCRATCH */
 
 /* These now externally defined in bozorth.h */
-/* extern int * scolpt[ SCOLPT_SIZE ];			 INPUT */
-/* extern int * fcolpt[ FCOLPT_SIZE ];			 INPUT */
-/* extern int   colp[ COLP_SIZE_1 ][ COLP_SIZE_2 ];	 OUTPUT */
 /* extern int verbose_bozorth; */
 /* extern FILE * errorfp; */
 /* extern char * get_progname( void ); */
@@ -391,84 +476,67 @@ static int * rtp[ ROT_SIZE_1 ];
 
 
 
+if ( ctx->filter == (bz_filter_fn) NULL )
+	ctx->filter = bz_filter_select();
+
 st = 1;
 edge_pair_index = 0;
-rotptr = &rot[0][0];
+rotptr = &ctx->rot[0][0];
 
 /* Foreach sorted edge in Subject's Web ... */
 
 for ( k = 1; k < probe_ptrlist_len; k++ ) {
-	ss = scolpt[k-1];
-
-	/* Foreach sorted edge in On-File Record's Web ... */
-
-	for ( j = st; j <= gallery_ptrlist_len; j++ ) {
-		ff = fcolpt[j-1];
-		dz = *ff - *ss;
-
-		fi = ( 2.0F * TK ) * ( *ff + *ss );
-
-
-
-
-
-
-
-
-		if ( SQUARED(dz) > SQUARED(fi) ) {
-			if ( dz < 0 ) {
-
-				st = j + 1;
-
-				continue;
-			} else
-				break;
-
-
-		}
-
-
-
-		for ( i = 1; i < 3; i++ ) {
-			float dz_squared;
-
-			dz = *(ss+i) - *(ff+i);
-			dz_squared = SQUARED(dz);
-
-
-
-
-			if ( dz_squared > TXS && dz_squared < CTXS )
-				break;
+	ss  = ctx->sedges.dist[k-1];
+	sb1 = ctx->sedges.beta1[k-1];
+	sb2 = ctx->sedges.beta2[k-1];
+
+	/* Foreach block of sorted edges in On-File Record's Web ... */
+
+	for ( jb = st; jb <= gallery_ptrlist_len; jb += BZ_FILTER_WIDTH ) {
+		nb = gallery_ptrlist_len - jb + 1;
+		if ( nb > BZ_FILTER_WIDTH )
+			nb = BZ_FILTER_WIDTH;
+
+		/* Edges too short move the start up for the next Subject */
+		/* edge; the first one too long ends the search.           */
+		cand = (*ctx->filter)( &ctx->fedges, jb - 1, nb, ss, sb1, sb2, &too_short, &too_long );
+		if ( too_long != 0 ) {
+			below = ( too_long & ( ~too_long + 1 ) ) - 1;
+			cand      &= below;
+			too_short &= below;
 		}
+		if ( too_short != 0 )
+			st = jb + bz_high_bit( too_short ) + 1;
 
-		if ( i < 3 )
-			continue;
-
-
+		/* Foreach compatible edge in the block ... */
 
+		while ( cand != 0 ) {
+			j = jb + bz_low_bit( cand );
+			cand &= cand - 1;
 
+			sinfo = ctx->sedges.info[k-1];
+			finfo = ctx->fedges.info[j-1];
 
 
-		if ( *(ss+5) >= 220 ) {
-			p1 = *(ss+5) - 580;
-			n  = 1;
-		} else {
-			p1 = *(ss+5);
-			n  = 0;
-		}
+			if ( BZ_EDGE_THETA(sinfo) >= 220 ) {
+				p1 = BZ_EDGE_THETA(sinfo) - 580;
+				n  = 1;
+			} else {
+				p1 = BZ_EDGE_THETA(sinfo);
+				n  = 0;
+			}
 
 
-		if ( *(ff+5) >= 220 ) {
-			p2 = *(ff+5) - 580;
-			b  = 1;
-		} else {
-			p2 = *(ff+5);
-			b  = 0;
-		}
+			if ( BZ_EDGE_THETA(finfo) >= 220 ) {
+				p2 = BZ_EDGE_THETA(finfo) - 580;
+				b  = 1;
+			} else {
+				p2 = BZ_EDGE_THETA(finfo);
+				b  = 0;
+			}
 
-		p1 -= p2;
-		p1 = IANGLE180(p1);
+			p1 -= p2;
+			p1 = IANGLE180(p1);
 
 
 
@@ -493,80 +561,84 @@ for ( k = 1; k < probe_ptrlist_len; k++ ) {
 
 
 
-		if ( n != b ) {
+			if ( n != b ) {
 
-			*rotptr++ = p1;
-			*rotptr++ = *(ss+3);
-			*rotptr++ = *(ss+4);
+				*rotptr++ = p1;
+				*rotptr++ = BZ_EDGE_K(sinfo);
+				*rotptr++ = BZ_EDGE_J(sinfo);
 
-			*rotptr++ = *(ff+4);
-			*rotptr++ = *(ff+3);
-		} else {
-			*rotptr++ = p1;
-			*rotptr++ = *(ss+3);
-			*rotptr++ = *(ss+4);
+				*rotptr++ = BZ_EDGE_J(finfo);
+				*rotptr++ = BZ_EDGE_K(finfo);
+			} else {
+				*rotptr++ = p1;
+				*rotptr++ = BZ_EDGE_K(sinfo);
+				*rotptr++ = BZ_EDGE_J(sinfo);
 
-			*rotptr++ = *(ff+3);
-			*rotptr++ = *(ff+4);
-		}
+				*rotptr++ = BZ_EDGE_K(finfo);
+				*rotptr++ = BZ_EDGE_J(finfo);
+			}
 
 
 
 
 
 
-		n = -1;
-		l = 1;
-		b = 0;
-		t = edge_pair_index + 1;
-		while ( t - b > 1 ) {
-			l = ( b + t ) / 2;
+			n = -1;
+			l = 1;
+			b = 0;
+			t = edge_pair_index + 1;
+			while ( t - b > 1 ) {
+				l = ( b + t ) / 2;
 
-			for ( i = 0; i < 3; i++ ) {
-				static int ii_table[] = { 1, 3, 2 };
+				for ( i = 0; i < 3; i++ ) {
+					static int ii_table[] = { 1, 3, 2 };
 
-								/*	1 = Subject's Kth, */
-								/*	3 = On-File's Jth or Kth (depending), */
-								/*	2 = Subject's Jth */
+									/*	1 = Subject's Kth, */
+									/*	3 = On-File's Jth or Kth (depending), */
+									/*	2 = Subject's Jth */
 
-				ii = ii_table[i];
-				p1 = rot[edge_pair_index][ii];
-				p2 = *( rtp[l-1] + ii );
+					ii = ii_table[i];
+					p1 = ctx->rot[edge_pair_index][ii];
+					p2 = *( ctx->rtp[l-1] + ii );
 
-				n = SENSE(p1,p2);
+					n = SENSE(p1,p2);
 
-				if ( n < 0 ) {
-					t = l;
-					break;
+					if ( n < 0 ) {
+						t = l;
+						break;
+					}
+					if ( n > 0 ) {
+						b = l;
+						break;
+					}
 				}
-				if ( n > 0 ) {
+
+				if ( n == 0 ) {
+					n = 1;
 					b = l;
-					break;
 				}
-			}
-
-			if ( n == 0 ) {
-				n = 1;
-				b = l;
-			}
-		} /* END while() for binary search */
+			} /* END while() for binary search */
 
 
-		if ( n == 1 )
-			++l;
+			if ( n == 1 )
+				++l;
 
-		rtp_insert( rtp, l, edge_pair_index, &rot[edge_pair_index][0] );
-		++edge_pair_index;
+			rtp_insert( ctx->rtp, l, edge_pair_index, &ctx->rot[edge_pair_index][0] );
+			++edge_pair_index;
 
-		if ( edge_pair_index == 19999 ) {
+			if ( edge_pair_index == 19999 ) {
 #ifndef NOVERBOSE
-			if ( verbose_bozorth )
-				fprintf( errorfp, "%s: bz_match(): WARNING: list is full, breaking loop early [p=%s; g=%s]\n",
-							get_progname(), get_probe_filename(), get_gallery_filename() );
+				if ( verbose_bozorth )
+					fprintf( errorfp, "%s: bz_match(): WARNING: list is full, breaking loop early [p=%s; g=%s]\n",
+								get_progname(), BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 #endif
-			goto END;		/* break out if list exceeded */
-		}
+				goto END;		/* break out if list exceeded */
+			}
+
+		} /* END WHILE compatible edge */
 
+		if ( too_long != 0 )
+			break;
 	} /* END FOR On-File (edge) distance */
 
 } /* END FOR Subject (edge) distance */
@@ -575,13 +647,18 @@ for ( k = 1; k < probe_ptrlist_len; k++ ) {
 
 END:
 {
-	int * colp_ptr = &colp[0][0];
+	int * colp_ptr = &ctx->colp[0][0];
 
 	for ( i = 0; i < edge_pair_index; i++ ) {
-		INT_COPY( colp_ptr, rtp[i], COLP_SIZE_2 );
+		INT_COPY( colp_ptr, ctx->rtp[i], COLP_SIZE_2 );
 
 
 	}
+
+	/* bz_match_score() scans runs of equal colp[][1] and colp[][3] */
+	/* one row past the end, so terminate the list with a row that  */
+	/* can match no run rather than whatever a prior match left.    */
+	INT_SET( colp_ptr, COLP_SIZE_2, 0 );
 }
 
 
@@ -590,16 +667,11 @@ return edge_pair_index;			/* Return the number of compatible edge pairs stored i
 }
 
 /**************************************************************************/
-/* These global arrays are declared "static" as they are only used        */
-/* between bz_match_score() & bz_final_loop()                             */
+/* The arrays ct[], gct[], ctt[], ctp[][] and yy[][][] are only used      */
+/* between bz_match_score() & bz_final_loop(); they were once declared    */
+/* "static" here and are now owned by the matcher context                 */
 /**************************************************************************/
-static int ct[ CT_SIZE ];
-static int gct[ GCT_SIZE ];
-static int ctt[ CTT_SIZE ];
-static int ctp[ CTP_SIZE_1 ][ CTP_SIZE_2 ];
-static int yy[ YY_SIZE_1 ][ YY_SIZE_2 ][ YY_SIZE_3 ];
-
-static int    bz_final_loop( int );
+static int    bz_final_loop( struct bz_ctx *, int, int );
 
 /**************************************************************************/
 int bz_match_score(
@@ -608,6 +680,34 @@ int bz_match_score(
 	struct xyt_struct * gstruct
 	)
 {
+return bz_match_score_ctx( &bz_gbl_ctx, np, pstruct, gstruct );
+}
+
+/**************************************************************************/
+int bz_match_score_ctx(
+	struct bz_ctx * ctx,
+	int np,
+	struct xyt_struct * pstruct,
+	struct xyt_struct * gstruct
+	)
+{
+return bz_match_score_thresh_ctx( ctx, np, pstruct, gstruct, ctx->threshold );
+}
+
+/***********************************************************************/
+/* With a threshold > 0, returns the threshold itself as soon as the   */
+/* score is known to meet it, and otherwise a value below the          */
+/* threshold that is no less than the score (the score itself if it   */
+/* is below MMSTR).  With a threshold <= 0, returns the exact score.   */
+/***********************************************************************/
+int bz_match_score_thresh_ctx(
+	struct bz_ctx * ctx,
+	int np,
+	struct xyt_struct * pstruct,
+	struct xyt_struct * gstruct,
+	int threshold
+	)
+{
 int kx, kq;
 int ftt;
 int tot;
@@ -646,13 +746,13 @@ if ( pstruct->nrows < min_computable_minutiae ) {
 			fprintf( errorfp, "%s: bz_match_score(): both probe and gallery file have too few minutiae (%d,%d) to compute a real Bozorth match score; min. is %d [p=%s; g=%s]\n",
 						get_progname(),
 						pstruct->nrows, gstruct->nrows, min_computable_minutiae,
-						get_probe_filename(), get_gallery_filename() );
+						BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 	} else {
 		if ( verbose_bozorth )
 			fprintf( errorfp, "%s: bz_match_score(): probe file has too few minutiae (%d) to compute a real Bozorth match score; min. is %d [p=%s; g=%s]\n",
 						get_progname(),
 						pstruct->nrows, min_computable_minutiae,
-						get_probe_filename(), get_gallery_filename() );
+						BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 	}
 #endif
 	return ZERO_MATCH_SCORE;
@@ -666,7 +766,7 @@ if ( gstruct->nrows < min_computable_minutiae ) {
 		fprintf( errorfp, "%s: bz_match_score(): gallery file has too few minutiae (%d) to compute a real Bozorth match score; min. is %d [p=%s; g=%s]\n",
 						get_progname(),
 						gstruct->nrows, min_computable_minutiae,
-						get_probe_filename(), get_gallery_filename() );
+						BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 #endif
 	return ZERO_MATCH_SCORE;
 }
@@ -680,18 +780,19 @@ if ( gstruct->nrows < min_computable_minutiae ) {
 
 
 								/* initialize tables to 0's */
-INT_SET( (int *) &yl, YL_SIZE_1 * YL_SIZE_2, 0 );
+INT_SET( (int *) ctx->yl, YL_SIZE_1 * YL_SIZE_2, 0 );
 
 
 
-INT_SET( (int *) &sc, SC_SIZE, 0 );
-INT_SET( (int *) &cp, CP_SIZE, 0 );
-INT_SET( (int *) &rp, RP_SIZE, 0 );
-INT_SET( (int *) &tq, TQ_SIZE, 0 );
-INT_SET( (int *) &rq, RQ_SIZE, 0 );
-INT_SET( (int *) &zz, ZZ_SIZE, 1000 );				/* zz[] initialized to 1000's */
+INT_SET( (int *) ctx->sc, SC_SIZE, 0 );
+INT_SET( (int *) ctx->cp, CP_SIZE, 0 );
+INT_SET( (int *) ctx->rp, RP_SIZE, 0 );
+INT_SET( (int *) ctx->tq, TQ_SIZE, 0 );
+INT_SET( (int *) ctx->rq, RQ_SIZE, 0 );
+INT_SET( (int *) ctx->zz, ZZ_SIZE, 1000 );				/* zz[] initialized to 1000's */
 
 INT_SET( (int *) &avn, AVN_SIZE, 0 );				/* avn[0...4] <== 0; */
+INT_SET( (int *) &rr, RR_SIZE, 0 );				/* rr[] can be read before it is set */
 
 
 
@@ -707,19 +808,19 @@ match_score = 0;
 for ( k = 0; k < np - 1; k++ ) {
 					/* printf( "compute(): looping with k=%d\n", k ); */
 
-	if ( sc[k] )			/* If SC counter for current pair already incremented ... */
+	if ( ctx->sc[k] )			/* If SC counter for current pair already incremented ... */
 		continue;		/*		Skip to next pair */
 
 
-	i = colp[k][1];
-	t = colp[k][3];
+	i = ctx->colp[k][1];
+	t = ctx->colp[k][3];
 
 
 
 
-	qq[0]   = i;
-	rq[t-1] = i;
-	tq[i-1] = t;
+	ctx->qq[0]   = i;
+	ctx->rq[t-1] = i;
+	ctx->tq[i-1] = t;
 
 
 	ww = 0;
@@ -744,22 +845,22 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 
-			kz = colp[kx][2];
-			l  = colp[kx][4];
+			kz = ctx->colp[kx][2];
+			l  = ctx->colp[kx][4];
 			kx++;
-			bz_sift( &ww, kz, &qh, l, kx, ftt, &tot, &qq_overflow );
+			bz_sift_ctx( ctx, &ww, kz, &qh, l, kx, ftt, &tot, &qq_overflow );
 			if ( qq_overflow ) {
 				fprintf( errorfp, "%s: WARNING: bz_match_score(): qq[] overflow from bz_sift() #1 [p=%s; g=%s]\n",
-							get_progname(), get_probe_filename(), get_gallery_filename() );
+							get_progname(), BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 				return QQ_OVERFLOW_SCORE;
 			}
 
 #ifndef NOVERBOSE
 			if ( verbose_bozorth )
-				printf( "x1 %d %d %d %d %d %d\n", kx, colp[kx][0], colp[kx][1], colp[kx][2], colp[kx][3], colp[kx][4] );
+				printf( "x1 %d %d %d %d %d %d\n", kx, ctx->colp[kx][0], ctx->colp[kx][1], ctx->colp[kx][2], ctx->colp[kx][3], ctx->colp[kx][4] );
 #endif
 
-		} while ( colp[kx][3] == colp[k][3] && colp[kx][1] == colp[k][1] );
+		} while ( ctx->colp[kx][3] == ctx->colp[k][3] && ctx->colp[kx][1] == ctx->colp[k][1] );
 			/* While the startpoints of lookahead edge pairs are the same as the starting points of the */
 			/* current pair, set KQ to lookahead edge pair index where above bz_sift() loop left off */
 
@@ -772,12 +873,12 @@ for ( k = 0; k < np - 1; k++ ) {
 					if ( z == 1 ) {
 						if ( (j+1) > QQ_SIZE ) {
 							fprintf( errorfp, "%s: WARNING: bz_match_score(): qq[] overflow #1 in bozorth3(); j-1 is %d [p=%s; g=%s]\n",
-								get_progname(), j-1, get_probe_filename(), get_gallery_filename() );
+								get_progname(), j-1, BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 							return QQ_OVERFLOW_SCORE;
 						}
-						p1 = qq[j];
+						p1 = ctx->qq[j];
 					} else {
-						p1 = tq[p1-1];
+						p1 = ctx->tq[p1-1];
 
 					}
 
@@ -786,23 +887,23 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 
-					if ( colp[i][2*z] != p1 )
+					if ( ctx->colp[i][2*z] != p1 )
 						break;
 				}
 
 
 				if ( z == 3 ) {
-					z = colp[i][1];
-					l = colp[i][3];
+					z = ctx->colp[i][1];
+					l = ctx->colp[i][3];
 
 
 
-					if ( z != colp[k][1] && l != colp[k][3] ) {
+					if ( z != ctx->colp[k][1] && l != ctx->colp[k][3] ) {
 						kx = i + 1;
-						bz_sift( &ww, z, &qh, l, kx, ftt, &tot, &qq_overflow );
+						bz_sift_ctx( ctx, &ww, z, &qh, l, kx, ftt, &tot, &qq_overflow );
 						if ( qq_overflow ) {
 							fprintf( errorfp, "%s: WARNING: bz_match_score(): qq[] overflow from bz_sift() #2 [p=%s; g=%s]\n",
-								get_progname(), get_probe_filename(), get_gallery_filename() );
+								get_progname(), BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 							return QQ_OVERFLOW_SCORE;
 						}
 					}
@@ -829,17 +930,17 @@ for ( k = 0; k < np - 1; k++ ) {
 					if ( i == 1 ) {
 						if ( (j+1) > QQ_SIZE ) {
 							fprintf( errorfp, "%s: WARNING: bz_match_score(): qq[] overflow #2 in bozorth3(); j-1 is %d [p=%s; g=%s]\n",
-								get_progname(), j-1, get_probe_filename(), get_gallery_filename() );
+								get_progname(), j-1, BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 							return QQ_OVERFLOW_SCORE;
 						}
-						p1 = qq[j];
+						p1 = ctx->qq[j];
 					} else {
-						p1 = tq[p1-1];
+						p1 = ctx->tq[p1-1];
 					}
 
 
 
-					p2 = colp[l-1][i*2-1];
+					p2 = ctx->colp[l-1][i*2-1];
 
 					n = SENSE(p1,p2);
 
@@ -861,23 +962,23 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 					/* Locates the head of consecutive sequence of edge pairs all having the same starting Subject and On-File edgepoints */
-					while ( colp[l-2][3] == p2 && colp[l-2][1] == colp[l-1][1] )
+					while ( ctx->colp[l-2][3] == p2 && ctx->colp[l-2][1] == ctx->colp[l-1][1] )
 						l--;
 
 					kx = l - 1;
 
 
 					do {
-						kz = colp[kx][2];
-						l  = colp[kx][4];
+						kz = ctx->colp[kx][2];
+						l  = ctx->colp[kx][4];
 						kx++;
-						bz_sift( &ww, kz, &qh, l, kx, ftt, &tot, &qq_overflow );
+						bz_sift_ctx( ctx, &ww, kz, &qh, l, kx, ftt, &tot, &qq_overflow );
 						if ( qq_overflow ) {
 							fprintf( errorfp, "%s: WARNING: bz_match_score(): qq[] overflow from bz_sift() #3 [p=%s; g=%s]\n",
-								get_progname(), get_probe_filename(), get_gallery_filename() );
+								get_progname(), BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 							return QQ_OVERFLOW_SCORE;
 						}
-					} while ( colp[kx][3] == p2 && colp[kx][1] == colp[kx-1][1] );
+					} while ( ctx->colp[kx][3] == p2 && ctx->colp[kx][1] == ctx->colp[kx-1][1] );
 
 					break;
 				} /* END if ( n == 0 ) */
@@ -898,7 +999,7 @@ for ( k = 0; k < np - 1; k++ ) {
 			for ( i = 0; i < tot; i++ ) {
 
 
-				int colp_value = colp[ y[i]-1 ][0];
+				int colp_value = ctx->colp[ ctx->y[i]-1 ][0];
 				if ( colp_value < 0 ) {
 					kk += colp_value;
 					n++;
@@ -935,7 +1036,7 @@ for ( k = 0; k < np - 1; k++ ) {
 
 			kk = 0;
 			for ( i = 0; i < tot; i++ ) {
-				int diff = colp[ y[i]-1 ][0] - jj;
+				int diff = ctx->colp[ ctx->y[i]-1 ][0] - jj;
 				j = SQUARED( diff );
 
 
@@ -944,7 +1045,7 @@ for ( k = 0; k < np - 1; k++ ) {
 				if ( j > TXS && j < CTXS )
 					kk++;
 				else
-					y[i-kk] = y[i];
+					ctx->y[i-kk] = ctx->y[i];
 			} /* END FOR i */
 
 			tot -= kk;				/* Adjust the total edge pairs TOT based on # of edge pairs skipped */
@@ -960,11 +1061,11 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 			for ( i = tot-1 ; i >= 0; i-- ) {
-				int idx = y[i] - 1;
-				if ( rk[idx] == 0 ) {
-					sc[idx] = -1;
+				int idx = ctx->y[i] - 1;
+				if ( ctx->rk[idx] == 0 ) {
+					ctx->sc[idx] = -1;
 				} else {
-					sc[idx] = rk[idx];
+					ctx->sc[idx] = ctx->rk[idx];
 				}
 			}
 			ftt--;
@@ -978,7 +1079,7 @@ for ( k = 0; k < np - 1; k++ ) {
 			int pd = 0;
 
 			for ( i = 0; i < tot; i++ ) {
-				int idx = y[i] - 1;
+				int idx = ctx->y[i] - 1;
 				for ( ii = 1; ii < 4; ii++ ) {
 
 
@@ -989,15 +1090,15 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 
-					jj = colp[idx][kk];
+					jj = ctx->colp[idx][kk];
 
 					switch ( ii ) {
 					  case 1:
-						if ( colp[idx][0] < 0 ) {
-							pd += colp[idx][0];
+						if ( ctx->colp[idx][0] < 0 ) {
+							pd += ctx->colp[idx][0];
 							pb++;
 						} else {
-							pa += colp[idx][0];
+							pa += ctx->colp[idx][0];
 							pc++;
 						}
 						break;
@@ -1027,15 +1128,15 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 
-						p1 = colp[idx][ 2 * ii + jj ];
+						p1 = ctx->colp[idx][ 2 * ii + jj ];
 
 
 						b = 0;
-						t = yl[ii][tp] + 1;
+						t = ctx->yl[ii][tp] + 1;
 
 						while ( t - b > 1 ) {
 							l  = ( b + t ) / 2;
-							p2 = yy[l-1][ii][tp];
+							p2 = ctx->yy[l-1][ii][tp];
 							n  = SENSE(p1,p2);
 
 							if ( n < 0 ) {
@@ -1053,12 +1154,12 @@ for ( k = 0; k < np - 1; k++ ) {
 							if ( n == 1 )
 								++l;
 
-							for ( kk = yl[ii][tp]; kk >= l; --kk ) {
-								yy[kk][ii][tp] = yy[kk-1][ii][tp];
+							for ( kk = ctx->yl[ii][tp]; kk >= l; --kk ) {
+								ctx->yy[kk][ii][tp] = ctx->yy[kk-1][ii][tp];
 							}
 
-							++yl[ii][tp];
-							yy[l-1][ii][tp] = p1;
+							++ctx->yl[ii][tp];
+							ctx->yy[l-1][ii][tp] = p1;
 
 
 						} /* END if ( n != 0 ) */
@@ -1100,14 +1201,17 @@ for ( k = 0; k < np - 1; k++ ) {
 				avn[ii] = 0;
 			}
 
-			ct[tp]  = tot;
-			gct[tp] = tot;
+			ctx->ct[tp]  = tot;
+			ctx->gct[tp] = tot;
 
 			if ( tot > match_score )		/* If current TOT > match_score ... */
 				match_score = tot;		/*	Keep track of max TOT in match_score */
 
-			ctt[tp]    = 0;		/* Init CTT[TP] to 0 */
-			ctp[tp][0] = tp;	/* Store TP into CTP */
+			if ( threshold > 0 && tot >= threshold )	/* Final score is never less than any group's TOT */
+				return threshold;
+
+			ctx->ctt[tp]    = 0;		/* Init CTT[TP] to 0 */
+			ctx->ctp[tp][0] = tp;	/* Store TP into CTP */
 
 			for ( ii = 0; ii < tp; ii++ ) {
 				int found;
@@ -1296,7 +1400,7 @@ for ( k = 0; k < np - 1; k++ ) {
 					ll = 0;
 
 					do {
-						while ( yy[jj][kk][ii] < yy[ll][kk][tp] && jj < yl[kk][ii] ) {
+						while ( ctx->yy[jj][kk][ii] < ctx->yy[ll][kk][tp] && jj < ctx->yl[kk][ii] ) {
 
 							jj++;
 						}
@@ -1304,7 +1408,7 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 
-						while ( yy[jj][kk][ii] > yy[ll][kk][tp] && ll < yl[kk][tp] ) {
+						while ( ctx->yy[jj][kk][ii] > ctx->yy[ll][kk][tp] && ll < ctx->yl[kk][tp] ) {
 
 							ll++;
 						}
@@ -1312,23 +1416,23 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 
-						if ( yy[jj][kk][ii] == yy[ll][kk][tp] && jj < yl[kk][ii] && ll < yl[kk][tp] ) {
+						if ( ctx->yy[jj][kk][ii] == ctx->yy[ll][kk][tp] && jj < ctx->yl[kk][ii] && ll < ctx->yl[kk][tp] ) {
 							found = 1;
 							break;
 						}
 
 
-					} while ( jj < yl[kk][ii] && ll < yl[kk][tp] );
+					} while ( jj < ctx->yl[kk][ii] && ll < ctx->yl[kk][tp] );
 					if ( found )
 						break;
 				} /* END for kk */
 
 				if ( ! found ) {			/* If we didn't find what we were searching for ... */
-					gct[ii] += ct[tp];
-					if ( gct[ii] > match_score )
-						match_score = gct[ii];
-					++ctt[ii];
-					ctp[ii][ctt[ii]] = tp;
+					ctx->gct[ii] += ctx->ct[tp];
+					if ( ctx->gct[ii] > match_score )
+						match_score = ctx->gct[ii];
+					++ctx->ctt[ii];
+					ctx->ctp[ii][ctx->ctt[ii]] = tp;
 				}
 
 			} /* END for ii in [0,TP-1] prior TP group */
@@ -1342,59 +1446,59 @@ for ( k = 0; k < np - 1; k++ ) {
 
 		if ( qh > QQ_SIZE ) {
 			fprintf( errorfp, "%s: WARNING: bz_match_score(): qq[] overflow #3 in bozorth3(); qh-1 is %d [p=%s; g=%s]\n",
-					get_progname(), qh-1, get_probe_filename(), get_gallery_filename() );
+					get_progname(), qh-1, BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 			return QQ_OVERFLOW_SCORE;
 		}
 		for ( i = qh - 1; i > 0; i-- ) {
-			n = qq[i] - 1;
-			if ( ( tq[n] - 1 ) >= 0 ) {
-				rq[tq[n]-1] = 0;
-				tq[n]       = 0;
-				zz[n]       = 1000;
+			n = ctx->qq[i] - 1;
+			if ( ( ctx->tq[n] - 1 ) >= 0 ) {
+				ctx->rq[ctx->tq[n]-1] = 0;
+				ctx->tq[n]       = 0;
+				ctx->zz[n]       = 1000;
 			}
 		}
 
 		for ( i = dw - 1; i >= 0; i-- ) {
 			n = rr[i] - 1;
-			if ( tq[n] ) {
-				rq[tq[n]-1] = 0;
-				tq[n]       = 0;
+			if ( ctx->tq[n] ) {
+				ctx->rq[ctx->tq[n]-1] = 0;
+				ctx->tq[n]       = 0;
 			}
 		}
 
 		i = 0;
 		j = ww - 1;
 		while ( i >= 0 && j >= 0 ) {
-			if ( nn[j] < mm[j] ) {
-				++nn[j];
+			if ( ctx->nn[j] < ctx->mm[j] ) {
+				++ctx->nn[j];
 
 				for ( i = ww - 1; i >= 0; i-- ) {
-					int rt = rx[i];
+					int rt = ctx->rx[i];
 					if ( rt < 0 ) {
 						rt = - rt;
 						rt--;
-						z  = rf[i][nn[i]-1]-1;
+						z  = ctx->rf[i][ctx->nn[i]-1]-1;
 
 
 
-						if (( tq[z] != (rt+1) && tq[z] ) || ( rq[rt] != (z+1) && rq[rt] ))
+						if (( ctx->tq[z] != (rt+1) && ctx->tq[z] ) || ( ctx->rq[rt] != (z+1) && ctx->rq[rt] ))
 							break;
 
 
-						tq[z]  = rt+1;
-						rq[rt] = z+1;
+						ctx->tq[z]  = rt+1;
+						ctx->rq[rt] = z+1;
 						rr[i]  = z+1;
 					} else {
 						rt--;
-						z = cf[i][nn[i]-1]-1;
+						z = ctx->cf[i][ctx->nn[i]-1]-1;
 
 
-						if (( tq[rt] != (z+1) && tq[rt] ) || ( rq[z] != (rt+1) && rq[z] ))
+						if (( ctx->tq[rt] != (z+1) && ctx->tq[rt] ) || ( ctx->rq[z] != (rt+1) && ctx->rq[z] ))
 							break;
 
 
-						tq[rt] = z+1;
-						rq[z]  = rt+1;
+						ctx->tq[rt] = z+1;
+						ctx->rq[z]  = rt+1;
 						rr[i]  = rt+1;
 					}
 				} /* END for i */
@@ -1402,16 +1506,16 @@ for ( k = 0; k < np - 1; k++ ) {
 				if ( i >= 0 ) {
 					for ( z = i + 1; z < ww; z++) {
 						n = rr[z] - 1;
-						if ( tq[n] - 1 >= 0 ) {
-							rq[tq[n]-1] = 0;
-							tq[n]       = 0;
+						if ( ctx->tq[n] - 1 >= 0 ) {
+							ctx->rq[ctx->tq[n]-1] = 0;
+							ctx->tq[n]       = 0;
 						}
 					}
 					j = ww - 1;
 				}
 
 			} else {
-				nn[j] = 1;
+				ctx->nn[j] = 1;
 				j--;
 			}
 
@@ -1432,19 +1536,19 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 
-	n = qq[0] - 1;
-	if ( tq[n] - 1 >= 0 ) {
-		rq[tq[n]-1] = 0;
-		tq[n]       = 0;
+	n = ctx->qq[0] - 1;
+	if ( ctx->tq[n] - 1 >= 0 ) {
+		ctx->rq[ctx->tq[n]-1] = 0;
+		ctx->tq[n]       = 0;
 	}
 
 	for ( i = ww-1; i >= 0; i-- ) {
-		n = rx[i];
+		n = ctx->rx[i];
 		if ( n < 0 ) {
 			n = - n;
-			rp[n-1] = 0;
+			ctx->rp[n-1] = 0;
 		} else {
-			cp[n-1] = 0;
+			ctx->cp[n-1] = 0;
 		}
 
 	}
@@ -1454,17 +1558,22 @@ for ( k = 0; k < np - 1; k++ ) {
 
 
 if ( match_score < MMSTR ) {
+	if ( threshold > 0 && match_score >= threshold )
+		return threshold;
 	return match_score;
 }
 
-match_score = bz_final_loop( tp );
+if ( threshold > 0 && match_score < threshold )	/* No cluster can total more than the largest GCT */
+	return match_score;
+
+match_score = bz_final_loop( ctx, tp, threshold );
 return match_score;
 }
 
 
 /***********************************************************************/
 /* These globals signficantly used by bz_sift () */
-/* Now externally defined in bozorth.h */
+/* Now owned by the matcher context (struct bz_ctx in bozorth.h) */
 /* extern int sc[ SC_SIZE ]; */
 /* extern int rq[ RQ_SIZE ]; */
 /* extern int tq[ TQ_SIZE ]; */
@@ -1481,6 +1590,22 @@ return match_score;
 /* extern int y[ Y_SIZE ]; */
 
 void bz_sift(
+	int * ww,
+	int   kz,
+	int * qh,
+	int   l,
+	int   kx,
+	int   ftt,
+	int * tot,
+	int * qq_overflow
+	)
+{
+bz_sift_ctx( &bz_gbl_ctx, ww, kz, qh, l, kx, ftt, tot, qq_overflow );
+}
+
+/***********************************************************************/
+void bz_sift_ctx(
+	struct bz_ctx * ctx,	/* INPUT and OUTPUT; matcher context */
 	int * ww,		/* INPUT and OUTPUT; endpoint groups index; *ww may be bumped by one or by two */
 	int   kz,		/* INPUT only;       endpoint of lookahead Subject edge */
 	int * qh,		/* INPUT and OUTPUT; the value is an index into qq[] and is stored in zz[]; *qh may be bumped by one */
@@ -1502,32 +1627,32 @@ int t;
 
 
 
-n = tq[ kz - 1];	/* Lookup On-File edgepoint stored in TQ at index of endpoint of lookahead Subject edge */
-t = rq[ l  - 1];	/* Lookup Subject edgepoint stored in RQ at index of endpoint of lookahead On-File edge */
+n = ctx->tq[ kz - 1];	/* Lookup On-File edgepoint stored in TQ at index of endpoint of lookahead Subject edge */
+t = ctx->rq[ l  - 1];	/* Lookup Subject edgepoint stored in RQ at index of endpoint of lookahead On-File edge */
 
 if ( n == 0 && t == 0 ) {
 
 
-	if ( sc[kx-1] != ftt ) {
-		y[ (*tot)++ ] = kx;
-		rk[kx-1] = sc[kx-1];
-		sc[kx-1] = ftt;
+	if ( ctx->sc[kx-1] != ftt ) {
+		ctx->y[ (*tot)++ ] = kx;
+		ctx->rk[kx-1] = ctx->sc[kx-1];
+		ctx->sc[kx-1] = ftt;
 	}
 
 	if ( *qh >= QQ_SIZE ) {
 		fprintf( errorfp, "%s: ERROR: bz_sift(): qq[] overflow #1; the index [*qh] is %d [p=%s; g=%s]\n",
 						get_progname(),
-						*qh, get_probe_filename(), get_gallery_filename() );
+						*qh, BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 		*qq_overflow = 1;
 		return;
 	}
-	qq[ *qh ]  = kz;
-	zz[ kz-1 ] = (*qh)++;
+	ctx->qq[ *qh ]  = kz;
+	ctx->zz[ kz-1 ] = (*qh)++;
 
 
 				/* The TQ and RQ locations are set, so set them ... */
-	tq[ kz-1 ] = l;
-	rq[ l-1 ] = kz;
+	ctx->tq[ kz-1 ] = l;
+	ctx->rq[ l-1 ] = kz;
 
 	return;
 } /* END if ( n == 0 && t == 0 ) */
@@ -1542,22 +1667,22 @@ if ( n == 0 && t == 0 ) {
 
 if ( n == l ) {
 
-	if ( sc[kx-1] != ftt ) {
-		if ( zz[kx-1] == 1000 ) {
+	if ( ctx->sc[kx-1] != ftt ) {
+		if ( ctx->zz[kx-1] == 1000 ) {
 			if ( *qh >= QQ_SIZE ) {
 				fprintf( errorfp, "%s: ERROR: bz_sift(): qq[] overflow #2; the index [*qh] is %d [p=%s; g=%s]\n",
 							get_progname(),
 							*qh,
-							get_probe_filename(), get_gallery_filename() );
+							BZ_PROBE_FILENAME(ctx), BZ_GALLERY_FILENAME(ctx) );
 				*qq_overflow = 1;
 				return;
 			}
-			qq[*qh]  = kz;
-			zz[kz-1] = (*qh)++;
+			ctx->qq[*qh]  = kz;
+			ctx->zz[kz-1] = (*qh)++;
 		}
-		y[(*tot)++] = kx;
-		rk[kx-1] = sc[kx-1];
-		sc[kx-1] = ftt;
+		ctx->y[(*tot)++] = kx;
+		ctx->rk[kx-1] = ctx->sc[kx-1];
+		ctx->sc[kx-1] = ftt;
 	}
 
 	return;
@@ -1582,22 +1707,22 @@ register int * lptr;
 /* If lookahead Subject endpoint previously assigned to TQ but not paired with lookahead On-File endpoint ... */
 
 if ( n ) {
-	b = cp[ kz - 1 ];
+	b = ctx->cp[ kz - 1 ];
 	if ( b == 0 ) {
 		b              = ++*ww;
 		b_index        = b - 1;
-		cp[kz-1]       = b;
-		cf[b_index][0] = n;
-		mm[b_index]    = 1;
-		nn[b_index]    = 1;
-		rx[b_index]    = kz;
+		ctx->cp[kz-1]       = b;
+		ctx->cf[b_index][0] = n;
+		ctx->mm[b_index]    = 1;
+		ctx->nn[b_index]    = 1;
+		ctx->rx[b_index]    = kz;
 
 	} else {
 		b_index = b - 1;
 	}
 
-	lim = mm[b_index];
-	lptr = &cf[b_index][0];
+	lim = ctx->mm[b_index];
+	lptr = &ctx->cf[b_index][0];
 	notfound = 1;
 
 #ifndef NOVERBOSE
@@ -1618,8 +1743,8 @@ if ( n ) {
 		}
 	}
 	if ( notfound ) {		/* If lookahead On-File endpoint not in list ... */
-		cf[b_index][i] = l;
-		++mm[b_index];
+		ctx->cf[b_index][i] = l;
+		++ctx->mm[b_index];
 	}
 } /* END if ( n ) */
 
@@ -1627,23 +1752,23 @@ if ( n ) {
 /* If lookahead On-File endpoint previously assigned to RQ but not paired with lookahead Subject endpoint... */
 
 if ( t ) {
-	b = rp[ l - 1 ];
+	b = ctx->rp[ l - 1 ];
 	if ( b == 0 ) {
 		b              = ++*ww;
 		b_index        = b - 1;
-		rp[l-1]        = b;
-		rf[b_index][0] = t;
-		mm[b_index]    = 1;
-		nn[b_index]    = 1;
-		rx[b_index]    = -l;
+		ctx->rp[l-1]        = b;
+		ctx->rf[b_index][0] = t;
+		ctx->mm[b_index]    = 1;
+		ctx->nn[b_index]    = 1;
+		ctx->rx[b_index]    = -l;
 
 
 	} else {
 		b_index = b - 1;
 	}
 
-	lim = mm[b_index];
-	lptr = &rf[b_index][0];
+	lim = ctx->mm[b_index];
+	lptr = &ctx->rf[b_index][0];
 	notfound = 1;
 
 #ifndef NOVERBOSE
@@ -1664,8 +1789,8 @@ if ( t ) {
 		}
 	}
 	if ( notfound ) {		/* If lookahead Subject endpoint not in list ... */
-		rf[b_index][i] = kz;
-		++mm[b_index];
+		ctx->rf[b_index][i] = kz;
+		++ctx->mm[b_index];
 	}
 } /* END if ( t ) */
 
@@ -1675,94 +1800,106 @@ if ( t ) {
 
 /**************************************************************************/
 
-static int bz_final_loop( int tp )
+static int bz_final_loop( struct bz_ctx * ctx, int tp, int threshold )
 {
 int ii, i, t, b, n, k, j, kk, jj;
 int lim;
 int match_score;
+int gct_max[ GCT_SIZE ];		/* Largest of gct[ii...tp-1], with a threshold */
+
+/* The sct[][] array originally declared global, then moved */
+/* here as "static" because it is only used herein and will  */
+/* exceed the stack allocation on our local systems.  It is  */
+/* now owned by the matcher context so this is reentrant.    */
 
-/* This array originally declared global, but moved here */
-/* locally because it is only used herein.  The use of   */
-/* "static" is required as the array will exceed the     */
-/* stack allocation on our local systems otherwise.      */
-static int sct[ SCT_SIZE_1 ][ SCT_SIZE_2 ];
+if ( threshold > 0 && tp > 0 ) {
+	gct_max[tp-1] = ctx->gct[tp-1];
+	for ( ii = tp - 2; ii >= 0; ii-- )
+		gct_max[ii] = ( ctx->gct[ii] > gct_max[ii+1] ) ? ctx->gct[ii] : gct_max[ii+1];
+}
 
 match_score = 0;
 for ( ii = 0; ii < tp; ii++ ) {				/* For each index up to the current value of TP ... */
 
-		if ( match_score >= gct[ii] )		/* if next group total not bigger than current match_score.. */
+		if ( threshold > 0 && gct_max[ii] < threshold )	/* No remaining cluster can reach the threshold */
+			return ( match_score > gct_max[ii] ) ? match_score : gct_max[ii];
+
+		if ( match_score >= ctx->gct[ii] )		/* if next group total not bigger than current match_score.. */
 			continue;			/*		skip to next TP index */
 
-		lim = ctt[ii] + 1;
+		lim = ctx->ctt[ii] + 1;
 		for ( i = 0; i < lim; i++ ) {
-			sct[i][0] = ctp[ii][i];
+			ctx->sct[i][0] = ctx->ctp[ii][i];
 		}
 
 		t     = 0;
-		y[0]  = lim;
-		cp[0] = 1;
+		ctx->y[0]  = lim;
+		ctx->cp[0] = 1;
 		b     = 0;
 		n     = 1;
 		do {					/* looping until T < 0 ... */
-			if ( y[t] - cp[t] > 1 ) {
-				k = sct[cp[t]][t];
-				j = ctt[k] + 1;
+			if ( ctx->y[t] - ctx->cp[t] > 1 ) {
+				k = ctx->sct[ctx->cp[t]][t];
+				j = ctx->ctt[k] + 1;
 				for ( i = 0; i < j; i++ ) {
-					rp[i] = ctp[k][i];
+					ctx->rp[i] = ctx->ctp[k][i];
 				}
 				k  = 0;
-				kk = cp[t];
+				kk = ctx->cp[t];
 				jj = 0;
 
 				do {
-					while ( rp[jj] < sct[kk][t] && jj < j )
+					while ( ctx->rp[jj] < ctx->sct[kk][t] && jj < j )
 						jj++;
-					while ( rp[jj] > sct[kk][t] && kk < y[t] )
+					while ( ctx->rp[jj] > ctx->sct[kk][t] && kk < ctx->y[t] )
 						kk++;
-					while ( rp[jj] == sct[kk][t] && kk < y[t] && jj < j ) {
-						sct[k][t+1] = sct[kk][t];
+					while ( ctx->rp[jj] == ctx->sct[kk][t] && kk < ctx->y[t] && jj < j ) {
+						ctx->sct[k][t+1] = ctx->sct[kk][t];
 						k++;
 						kk++;
 						jj++;
 					}
-				} while ( kk < y[t] && jj < j );
+				} while ( kk < ctx->y[t] && jj < j );
 
 				t++;
-				cp[t] = 1;
-				y[t]  = k;
+				ctx->cp[t] = 1;
+				ctx->y[t]  = k;
 				b     = t;
 				n     = 1;
 			} else {
 				int tot = 0;
 
-				lim = y[t];
+				lim = ctx->y[t];
 				for ( i = n-1; i < lim; i++ ) {
-					tot += ct[ sct[i][t] ];
+					tot += ctx->ct[ ctx->sct[i][t] ];
 				}
 
 				for ( i = 0; i < b; i++ ) {
-					tot += ct[ sct[0][i] ];
+					tot += ctx->ct[ ctx->sct[0][i] ];
 				}
 
 				if ( tot > match_score ) {		/* If the current total is larger than the running total ... */
 					match_score = tot;		/*	then set match_score to the new total */
 					for ( i = 0; i < b; i++ ) {
-						rk[i] = sct[0][i];
+						ctx->rk[i] = ctx->sct[0][i];
 					}
 
 					{
 					int rk_index = b;
-					lim = y[t];
+					lim = ctx->y[t];
 					for ( i = n-1; i < lim; ) {
-						rk[ rk_index++ ] = sct[ i++ ][ t ];
+						ctx->rk[ rk_index++ ] = ctx->sct[ i++ ][ t ];
 					}
 					}
+
+					if ( threshold > 0 && match_score >= threshold )
+						return threshold;
 				}
 				b = t;
 				t--;
 				if ( t >= 0 ) {
-					++cp[t];
-					n = y[t];
+					++ctx->cp[t];
+					n = ctx->y[t];
 				}
 			} /* END IF */
 
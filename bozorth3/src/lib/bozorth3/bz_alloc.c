@@ -60,6 +60,11 @@ of the software.
 #cat:        specified length exiting directly upon system error
 #cat: malloc_or_return_error - allocates a buffer of bytes from the heap
 #cat:        of specified length returning an error code upon system error
+#cat: bz_ctx_alloc - allocates a zero-initialized matcher context for use
+#cat:        with the reentrant *_ctx() matching routines
+#cat: bz_ctx_free - deallocates a matcher context
+#cat: bz_ctx_set_threshold - sets the threshold against which scores
+#cat:        computed within a matcher context may stop early
 
 ***********************************************************************/
 
@@ -109,3 +114,41 @@ if ( p == CNULL ) {
 }
 return p;
 }
+
+/***********************************************************************/
+/* returns BZ_CTX_NULL on error */
+struct bz_ctx * bz_ctx_alloc( void )
+{
+struct bz_ctx * ctx;
+
+/* Zero-fill so a new context starts out exactly as the global tables */
+/* in bz_gbls.c do at program startup */
+ctx = (struct bz_ctx *) calloc( 1, sizeof(struct bz_ctx) );
+if ( ctx == BZ_CTX_NULL ) {
+	fprintf( errorfp, "%s: ERROR: calloc() of %lu bytes for matcher context failed: %s\n",
+						get_progname(),
+						(unsigned long) sizeof(struct bz_ctx),
+						strerror( errno )
+						);
+	return BZ_CTX_NULL;
+}
+return ctx;
+}
+
+/***********************************************************************/
+void bz_ctx_free( struct bz_ctx * ctx )
+{
+if ( ctx != BZ_CTX_NULL )
+	free( (char *) ctx );
+}
+
+/***********************************************************************/
+/* Once set, every score computed within ctx (by bozorth_main_ctx(),   */
+/* bozorth_to_gallery_ctx(), etc.) is clipped to the threshold: it     */
+/* equals the threshold if the score meets it, and is below it if not. */
+/* A threshold <= 0 restores exact scores.                             */
+/***********************************************************************/
+void bz_ctx_set_threshold( struct bz_ctx * ctx, int threshold )
+{
+ctx->threshold = ( threshold > 0 ) ? threshold : 0;
+}
@@ -68,6 +68,13 @@ of the software.
 #cat:                        single probe fingerprint is to be matched
 #cat:                        to a single gallery fingerprint as in
 #cat:                        verificaiton mode
+#cat: bozorth_probe_init_ctx - reentrant version of bozorth_probe_init
+#cat:                        that builds its table in a caller-owned
+#cat:                        matcher context
+#cat: bozorth_gallery_init_ctx - reentrant version of
+#cat:                        bozorth_gallery_init
+#cat: bozorth_to_gallery_ctx - reentrant version of bozorth_to_gallery
+#cat: bozorth_main_ctx -     reentrant version of bozorth_main
 
 ***********************************************************************/
 
@@ -80,6 +87,41 @@ of the software.
 
 int bozorth_probe_init( struct xyt_struct * pstruct )
 {
+return bozorth_probe_init_ctx( &bz_gbl_ctx, pstruct );
+}
+
+/**************************************************************************/
+
+int bozorth_gallery_init( struct xyt_struct * gstruct )
+{
+return bozorth_gallery_init_ctx( &bz_gbl_ctx, gstruct );
+}
+
+/**************************************************************************/
+
+int bozorth_to_gallery(
+		int probe_len,
+		struct xyt_struct * pstruct,
+		struct xyt_struct * gstruct
+		)
+{
+return bozorth_to_gallery_ctx( &bz_gbl_ctx, probe_len, pstruct, gstruct );
+}
+
+/**************************************************************************/
+
+int bozorth_main(
+		struct xyt_struct * pstruct,
+		struct xyt_struct * gstruct
+		)
+{
+return bozorth_main_ctx( &bz_gbl_ctx, pstruct, gstruct );
+}
+
+/**************************************************************************/
+
+int bozorth_probe_init_ctx( struct bz_ctx * ctx, struct xyt_struct * pstruct )
+{
 int sim;	/* number of pointwise comparisons for Subject's record*/
 int msim;	/* Pruned length of Subject's comparison pointer list */
 
@@ -93,20 +135,22 @@ bz_comp(
 	pstruct->ycol,
 	pstruct->thetacol,
 	&sim,
-	scols,
-	scolpt );
+	ctx->scols,
+	ctx->scolpt );
 
 msim = sim;	/* Init search to end of Subject's pointwise comparison table (last edge in Web) */
 
 
 
-bz_find( &msim, scolpt );
+bz_find( &msim, ctx->scolpt );
 
 
 
 if ( msim < FDD )	/* Makes sure there are a reasonable number of edges (at least 500, if possible) to analyze in the Web */
 	msim = ( sim > FDD ) ? FDD : sim;
 
+bz_edges_fill( ctx->scolpt, msim, ctx->sdist, ctx->sbeta1, ctx->sbeta2, ctx->sinfo, &ctx->sedges );
+
 
 
 
@@ -116,7 +160,7 @@ return msim;
 
 /**************************************************************************/
 
-int bozorth_gallery_init( struct xyt_struct * gstruct )
+int bozorth_gallery_init_ctx( struct bz_ctx * ctx, struct xyt_struct * gstruct )
 {
 int fim;	/* number of pointwise comparisons for On-File record*/
 int mfim;	/* Pruned length of On-File Record's pointer list */
@@ -130,20 +174,22 @@ bz_comp(
 	gstruct->ycol,
 	gstruct->thetacol,
 	&fim,
-	fcols,
-	fcolpt );
+	ctx->fcols,
+	ctx->fcolpt );
 
 mfim = fim;	/* Init search to end of On-File Record's pointwise comparison table (last edge in Web) */
 
 
 
-bz_find( &mfim, fcolpt );
+bz_find( &mfim, ctx->fcolpt );
 
 
 
 if ( mfim < FDD )	/* Makes sure there are a reasonable number of edges (at least 500, if possible) to analyze in the Web */
 	mfim = ( fim > FDD ) ? FDD : fim;
 
+bz_edges_fill( ctx->fcolpt, mfim, ctx->fdist, ctx->fbeta1, ctx->fbeta2, ctx->finfo, &ctx->fedges );
+
 
 
 
@@ -153,7 +199,8 @@ return mfim;
 
 /**************************************************************************/
 
-int bozorth_to_gallery(
+int bozorth_to_gallery_ctx(
+		struct bz_ctx * ctx,
 		int probe_len,
 		struct xyt_struct * pstruct,
 		struct xyt_struct * gstruct
@@ -162,14 +209,15 @@ int bozorth_to_gallery(
 int np;
 int gallery_len;
 
-gallery_len = bozorth_gallery_init( gstruct );
-np = bz_match( probe_len, gallery_len );
-return bz_match_score( np, pstruct, gstruct );
+gallery_len = bozorth_gallery_init_ctx( ctx, gstruct );
+np = bz_match_ctx( ctx, probe_len, gallery_len );
+return bz_match_score_ctx( ctx, np, pstruct, gstruct );
 }
 
 /**************************************************************************/
 
-int bozorth_main(
+int bozorth_main_ctx(
+		struct bz_ctx * ctx,
 		struct xyt_struct * pstruct,
 		struct xyt_struct * gstruct
 		)
@@ -184,26 +232,26 @@ int gallery_len;
 #ifdef DEBUG
 	printf( "PROBE_INIT() called\n" );
 #endif
-probe_len   = bozorth_probe_init( pstruct );
+probe_len   = bozorth_probe_init_ctx( ctx, pstruct );
 
 
 #ifdef DEBUG
 	printf( "GALLERY_INIT() called\n" );
 #endif
-gallery_len = bozorth_gallery_init( gstruct );
+gallery_len = bozorth_gallery_init_ctx( ctx, gstruct );
 
 
 #ifdef DEBUG
 	printf( "BZ_MATCH() called\n" );
 #endif
-np = bz_match( probe_len, gallery_len );
+np = bz_match_ctx( ctx, probe_len, gallery_len );
 
 
 #ifdef DEBUG
 	printf( "BZ_MATCH() returned %d edge pairs\n", np );
 	printf( "COMPUTE() called\n" );
 #endif
-ms = bz_match_score( np, pstruct, gstruct );
+ms = bz_match_score_ctx( ctx, np, pstruct, gstruct );
 
 
 #ifdef DEBUG
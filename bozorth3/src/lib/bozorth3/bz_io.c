@@ -82,6 +82,8 @@ of the software.
 #cat:            specified
 #cat: bz_load -  loads the contents of the specified XYT file into
 #cat:            structured memory
+#cat: bz_load_xytq - loads all minutiae and qualities from the
+#cat:            specified XYT file without pruning them
 #cat: fd_readable - when multiple bozorth processes are being run
 #cat:            concurrently and one of the processes determines a
 #cat:            has been found, the other processes poll a file
@@ -368,13 +370,38 @@ to be returned, the highest-quality minutiae are returned.
 
 /***********************************************************************/
 struct xyt_struct * bz_load( const char * xyt_file )
+{
+   struct xyt_struct * xyt_s;
+   struct xytq_struct * xytq_s;
+
+   xytq_s = bz_load_xytq( xyt_file );
+   if ( xytq_s == XYTQ_NULL )
+      return XYT_NULL;
+
+   xyt_s = bz_prune(xytq_s, 0);
+   free( (char *) xytq_s );
+   if ( xyt_s == XYT_NULL )
+      return XYT_NULL;
+   
+   if ( verbose_load )
+      fprintf( errorfp, "Loaded %s\n", xyt_file );
+
+   return xyt_s;
+} 
+
+/************************************************************************
+Load a 3-4 column (X,Y,T[,Q]) set of minutiae from the specified file
+and return all of them (up to MAX_FILE_MINUTIAE) in a XYTQ structure,
+with the quality set to 1 if the file has no quality column.  Nothing
+is pruned or normalized; bz_prune() does that.
+*************************************************************************/
+struct xytq_struct * bz_load_xytq( const char * xyt_file )
 {
    int nminutiae;
    int m;
    int i;
    int nargs_expected;
    FILE * fp;
-   struct xyt_struct * xyt_s;
    struct xytq_struct * xytq_s;
    int xvals_lng[MAX_FILE_MINUTIAE],   /* Temporary lists to store all the minutaie from a file */
        yvals_lng[MAX_FILE_MINUTIAE],
@@ -390,7 +417,7 @@ struct xyt_struct * bz_load( const char * xyt_file )
    {
       fprintf( errorfp, "%s: ERROR: fopen() of minutiae file \"%s\" failed: %s\n",
                 get_progname(), xyt_file, strerror(errno) );
-      return XYT_NULL;
+      return XYTQ_NULL;
    }
 
    nminutiae = 0;
@@ -410,7 +437,7 @@ struct xyt_struct * bz_load( const char * xyt_file )
          {
             fprintf( errorfp, "%s: ERROR: sscanf() failed on line %u in minutiae file \"%s\"\n",
                      get_progname(), nminutiae+1, xyt_file );
-            return XYT_NULL;
+            return XYTQ_NULL;
          }
          nargs_expected = m;
       } 
@@ -420,7 +447,7 @@ struct xyt_struct * bz_load( const char * xyt_file )
          {
             fprintf( errorfp, "%s: ERROR: inconsistent argument count on line %u of minutiae file \"%s\"\n",
                      get_progname(), nminutiae+1, xyt_file );
-            return XYT_NULL;
+            return XYTQ_NULL;
          }
       }
       if ( m == 3 )
@@ -435,7 +462,7 @@ struct xyt_struct * bz_load( const char * xyt_file )
    {
       fprintf( errorfp, "%s: ERROR: fclose() of minutiae file \"%s\" failed: %s\n",
                      get_progname(), xyt_file, strerror(errno) );
-      return XYT_NULL;
+      return XYTQ_NULL;
    }
    
    xytq_s = (struct xytq_struct *)malloc(sizeof(struct xytq_struct));
@@ -445,7 +472,7 @@ struct xyt_struct * bz_load( const char * xyt_file )
                                                      get_progname(),
                                                      strerror(errno)
                                                      );
-      return XYT_NULL;
+      return XYTQ_NULL;
    }
 
    xytq_s->nrows = nminutiae;
@@ -457,13 +484,8 @@ struct xyt_struct * bz_load( const char * xyt_file )
       xytq_s->qualitycol[i] = qvals_lng[i];
    }
 
-   xyt_s = bz_prune(xytq_s, 0);
-   
-   if ( verbose_load )
-      fprintf( errorfp, "Loaded %s\n", xyt_file );
-
-   return xyt_s;
-} 
+   return xytq_s;
+}
 
 /************************************************************************
 Load a XYTQ structure and return a XYT struct. 
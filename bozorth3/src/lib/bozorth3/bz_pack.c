@@ -0,0 +1,396 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/***********************************************************************
+      LIBRARY: FING - NIST Fingerprint Systems Utilities
+
+      FILE:           BZ_PACK.C
+
+      Contains routines that store the minutiae of many gallery
+      fingerprints in a single "packed" binary file, and that stream
+      them back in file order.  Reading one large file sequentially
+      avoids the per-template open()/stat() and text parsing cost of
+      loading thousands of small XYT files.
+
+      File layout (all integers are 32 bits in the byte order of the
+      machine that wrote the file; every record starts on a 4-byte
+      boundary):
+
+         header:  magic "BZ3PAK\n\0", byte order mark, version,
+                  record count, index offset (high word, low word),
+                  3 reserved words
+         records: name length (including NUL), name padded to 4 bytes,
+                  nrows, x[nrows], y[nrows], theta[nrows], quality[nrows]
+         index:   record offset (high word, low word) for each record
+
+      Records hold every minutia read by bz_load_xytq(), unpruned, so
+      a packed gallery can be used with any "-m1" or max minutiae
+      setting; bz_prune() is applied as each record is read.
+
+***********************************************************************
+
+      ROUTINES:
+#cat: bz_pack_create - opens a new packed gallery file for writing
+#cat: bz_pack_append - appends a gallery fingerprint's minutiae to a
+#cat:            packed gallery file
+#cat: bz_pack_finish - writes the record index and closes a packed
+#cat:            gallery file
+#cat: bz_pack_open - opens a packed gallery file for sequential reading
+#cat: bz_pack_read - reads the next record from a packed gallery file
+#cat: bz_pack_seek - positions a packed gallery file at a given record
+#cat: bz_pack_close - closes a packed gallery file opened for reading
+
+***********************************************************************/
+
+#include <usebsd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <bozorth.h>
+
+#define BZ_PACK_HEADER_INTS	8
+
+#define BZ_PACK_PAD4(n)		( ( (n) + 3 ) & ~3 )
+
+/***********************************************************************/
+static int bz_pack_write( struct bz_pack_out * out, char * buf, int nbytes )
+{
+if ( nbytes > 0 && fwrite( buf, 1, (size_t) nbytes, out->fp ) != (size_t) nbytes ) {
+	fprintf( errorfp, "%s: ERROR: fwrite() to packed gallery file \"%s\" failed: %s\n",
+				get_progname(), out->filename, strerror(errno) );
+	return -1;
+}
+out->pos += (unsigned long) nbytes;
+return 0;
+}
+
+/***********************************************************************/
+static int bz_pack_write_header( struct bz_pack_out * out, unsigned long index_offset )
+{
+int hdr[ BZ_PACK_HEADER_INTS ];
+char magic[ BZ_PACK_MAGIC_SIZE ];
+
+memset( magic, 0, sizeof magic );
+strcpy( magic, BZ_PACK_MAGIC );
+hdr[0] = BZ_PACK_BYTE_ORDER;
+hdr[1] = BZ_PACK_VERSION;
+hdr[2] = out->count;
+hdr[3] = (int) ( ( index_offset >> 16 ) >> 16 );
+hdr[4] = (int) ( index_offset & 0xFFFFFFFFUL );
+hdr[5] = 0;
+hdr[6] = 0;
+hdr[7] = 0;
+if ( bz_pack_write( out, magic, (int) sizeof magic ) != 0 )
+	return -1;
+return bz_pack_write( out, (char *) hdr, (int) sizeof hdr );
+}
+
+/***********************************************************************/
+/* returns BZ_PACK_OUT_NULL on error */
+struct bz_pack_out * bz_pack_create( const char * filename )
+{
+struct bz_pack_out * out;
+
+out = (struct bz_pack_out *) malloc_or_return_error( (int) sizeof(struct bz_pack_out), "packed gallery writer" );
+if ( out == BZ_PACK_OUT_NULL )
+	return BZ_PACK_OUT_NULL;
+out->filename  = (char *) filename;
+out->count     = 0;
+out->max_count = 0;
+out->offsets   = (unsigned long *) NULL;
+out->pos       = 0;
+
+out->fp = fopen( filename, "wb" );
+if ( out->fp == FPNULL ) {
+	fprintf( errorfp, "%s: ERROR: fopen() of packed gallery file \"%s\" failed: %s\n",
+				get_progname(), filename, strerror(errno) );
+	free( (char *) out );
+	return BZ_PACK_OUT_NULL;
+}
+
+/* Placeholder; rewritten with the final count by bz_pack_finish() */
+if ( bz_pack_write_header( out, 0UL ) != 0 ) {
+	(void) fclose( out->fp );
+	free( (char *) out );
+	return BZ_PACK_OUT_NULL;
+}
+return out;
+}
+
+/***********************************************************************/
+/* returns 0 on success, -1 on error */
+int bz_pack_append(
+	struct bz_pack_out * out,	/* INPUT and OUTPUT: file being written */
+	const char * name,		/* INPUT: name to report in score lines */
+	struct xytq_struct * xytq	/* INPUT: minutiae as returned by bz_load_xytq() */
+	)
+{
+int n;
+int namelen;
+char pad[4];
+
+namelen = (int) strlen( name ) + 1;
+if ( namelen > MAX_LINE_LENGTH ) {
+	fprintf( errorfp, "%s: ERROR: gallery name \"%s\" is too long for a packed gallery file\n",
+				get_progname(), name );
+	return -1;
+}
+
+if ( out->count == out->max_count ) {
+	unsigned long * offsets;
+	int max_count;
+
+	max_count = ( out->max_count == 0 ) ? 1024 : 2 * out->max_count;
+	offsets = (unsigned long *) realloc( (char *) out->offsets, max_count * sizeof(unsigned long) );
+	if ( offsets == (unsigned long *) NULL ) {
+		fprintf( errorfp, "%s: ERROR: realloc() of packed gallery index for %d records failed: %s\n",
+					get_progname(), max_count, strerror(errno) );
+		return -1;
+	}
+	out->offsets   = offsets;
+	out->max_count = max_count;
+}
+out->offsets[ out->count ] = out->pos;
+
+memset( pad, 0, sizeof pad );
+n = xytq->nrows;
+if ( bz_pack_write( out, (char *) &namelen, (int) sizeof(int) ) != 0 ||
+     bz_pack_write( out, (char *) name, namelen ) != 0 ||
+     bz_pack_write( out, pad, BZ_PACK_PAD4(namelen) - namelen ) != 0 ||
+     bz_pack_write( out, (char *) &n, (int) sizeof(int) ) != 0 ||
+     bz_pack_write( out, (char *) xytq->xcol, n * (int) sizeof(int) ) != 0 ||
+     bz_pack_write( out, (char *) xytq->ycol, n * (int) sizeof(int) ) != 0 ||
+     bz_pack_write( out, (char *) xytq->thetacol, n * (int) sizeof(int) ) != 0 ||
+     bz_pack_write( out, (char *) xytq->qualitycol, n * (int) sizeof(int) ) != 0 )
+	return -1;
+
+++out->count;
+return 0;
+}
+
+/***********************************************************************/
+/* Writes the index, rewrites the header and frees the writer. */
+/* returns 0 on success, -1 on error */
+int bz_pack_finish( struct bz_pack_out * out )
+{
+int i;
+int ret = 0;
+int pair[2];
+unsigned long index_offset;
+
+index_offset = out->pos;
+for ( i = 0; i < out->count && ret == 0; i++ ) {
+	pair[0] = (int) ( ( out->offsets[i] >> 16 ) >> 16 );
+	pair[1] = (int) ( out->offsets[i] & 0xFFFFFFFFUL );
+	ret = bz_pack_write( out, (char *) pair, (int) sizeof pair );
+}
+
+if ( ret == 0 ) {
+	if ( fseek( out->fp, 0L, SEEK_SET ) != 0 ) {
+		fprintf( errorfp, "%s: ERROR: fseek() on packed gallery file \"%s\" failed: %s\n",
+					get_progname(), out->filename, strerror(errno) );
+		ret = -1;
+	} else
+		ret = bz_pack_write_header( out, index_offset );
+}
+
+if ( fclose( out->fp ) != 0 ) {
+	fprintf( errorfp, "%s: ERROR: fclose() of packed gallery file \"%s\" failed: %s\n",
+				get_progname(), out->filename, strerror(errno) );
+	ret = -1;
+}
+if ( out->offsets != (unsigned long *) NULL )
+	free( (char *) out->offsets );
+free( (char *) out );
+return ret;
+}
+
+/***********************************************************************/
+/* returns BZ_PACK_NULL on error */
+struct bz_pack * bz_pack_open( const char * filename )
+{
+struct bz_pack * pack;
+char magic[ BZ_PACK_MAGIC_SIZE ];
+int hdr[ BZ_PACK_HEADER_INTS ];
+
+pack = (struct bz_pack *) malloc_or_return_error( (int) sizeof(struct bz_pack), "packed gallery" );
+if ( pack == BZ_PACK_NULL )
+	return BZ_PACK_NULL;
+pack->filename = (char *) filename;
+pack->next     = 0;
+
+pack->fp = fopen( filename, "rb" );
+if ( pack->fp == FPNULL ) {
+	fprintf( errorfp, "%s: ERROR: fopen() of packed gallery file \"%s\" failed: %s\n",
+				get_progname(), filename, strerror(errno) );
+	free( (char *) pack );
+	return BZ_PACK_NULL;
+}
+
+/* Records are read front to back; a large buffer and a hint to the */
+/* kernel keep reads sequential and let readahead run ahead of us.  */
+pack->buf = malloc_or_return_error( BZ_PACK_BUFSIZE, "packed gallery read buffer" );
+if ( pack->buf != CNULL )
+	(void) setvbuf( pack->fp, pack->buf, _IOFBF, BZ_PACK_BUFSIZE );
+#ifdef POSIX_FADV_SEQUENTIAL
+(void) posix_fadvise( fileno( pack->fp ), (off_t) 0, (off_t) 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+if ( fread( magic, 1, sizeof magic, pack->fp ) != sizeof magic ||
+     memcmp( magic, BZ_PACK_MAGIC, BZ_PACK_MAGIC_SIZE ) != 0 ) {
+	fprintf( errorfp, "%s: ERROR: \"%s\" is not a packed gallery file\n",
+				get_progname(), filename );
+	bz_pack_close( pack );
+	return BZ_PACK_NULL;
+}
+if ( fread( (char *) hdr, sizeof(int), BZ_PACK_HEADER_INTS, pack->fp ) != BZ_PACK_HEADER_INTS ||
+     hdr[0] != BZ_PACK_BYTE_ORDER || hdr[1] != BZ_PACK_VERSION || hdr[2] < 0 ) {
+	fprintf( errorfp, "%s: ERROR: packed gallery file \"%s\" was written in an incompatible format\n",
+				get_progname(), filename );
+	bz_pack_close( pack );
+	return BZ_PACK_NULL;
+}
+pack->count        = hdr[2];
+pack->index_offset = ( ( (unsigned long) (unsigned int) hdr[3] << 16 ) << 16 ) | (unsigned long) (unsigned int) hdr[4];
+
+if ( verbose_load )
+	fprintf( errorfp, "Opened %d packed gallery records in %s\n", pack->count, filename );
+
+return pack;
+}
+
+/***********************************************************************/
+/* Reads the next record.  Returns 1 if one was read, 0 at the end of  */
+/* the gallery, or -1 on error.  name must hold MAX_LINE_LENGTH chars. */
+/***********************************************************************/
+int bz_pack_read( struct bz_pack * pack, char * name, struct xytq_struct * xytq )
+{
+int namelen;
+int n;
+char pad[4];
+
+if ( pack->next >= pack->count )
+	return 0;
+
+if ( fread( (char *) &namelen, sizeof(int), 1, pack->fp ) != 1 )
+	goto READ_ERROR;
+if ( namelen <= 0 || namelen > MAX_LINE_LENGTH )
+	goto CORRUPT;
+if ( fread( name, 1, (size_t) namelen, pack->fp ) != (size_t) namelen ||
+     fread( pad, 1, (size_t) ( BZ_PACK_PAD4(namelen) - namelen ), pack->fp ) != (size_t) ( BZ_PACK_PAD4(namelen) - namelen ) )
+	goto READ_ERROR;
+if ( name[ namelen - 1 ] != '\0' )
+	goto CORRUPT;
+
+if ( fread( (char *) &n, sizeof(int), 1, pack->fp ) != 1 )
+	goto READ_ERROR;
+if ( n < 0 || n > MAX_FILE_MINUTIAE )
+	goto CORRUPT;
+if ( fread( (char *) xytq->xcol,       sizeof(int), (size_t) n, pack->fp ) != (size_t) n ||
+     fread( (char *) xytq->ycol,       sizeof(int), (size_t) n, pack->fp ) != (size_t) n ||
+     fread( (char *) xytq->thetacol,   sizeof(int), (size_t) n, pack->fp ) != (size_t) n ||
+     fread( (char *) xytq->qualitycol, sizeof(int), (size_t) n, pack->fp ) != (size_t) n )
+	goto READ_ERROR;
+xytq->nrows = n;
+
+++pack->next;
+return 1;
+
+READ_ERROR:
+	if ( ferror( pack->fp ) ) {
+		fprintf( errorfp, "%s: ERROR: fread() of record %d from packed gallery file \"%s\" failed: %s\n",
+					get_progname(), pack->next+1, pack->filename, strerror(errno) );
+		return -1;
+	}
+	/* Otherwise an unexpected end of file */
+CORRUPT:
+	fprintf( errorfp, "%s: ERROR: record %d of packed gallery file \"%s\" is truncated or corrupt\n",
+				get_progname(), pack->next+1, pack->filename );
+	return -1;
+}
+
+/***********************************************************************/
+/* Positions the file so the next bz_pack_read() returns record recno */
+/* (0-based).  Returns 0 on success, -1 on error.                     */
+/***********************************************************************/
+int bz_pack_seek( struct bz_pack * pack, int recno )
+{
+int pair[2];
+unsigned long offset;
+
+if ( recno < 0 || recno > pack->count ) {
+	fprintf( errorfp, "%s: ERROR: record %d is out of range for packed gallery file \"%s\"\n",
+				get_progname(), recno+1, pack->filename );
+	return -1;
+}
+if ( recno == pack->count ) {
+	pack->next = recno;
+	return 0;
+}
+
+offset = pack->index_offset + (unsigned long) recno * sizeof pair;
+if ( fseek( pack->fp, (long) offset, SEEK_SET ) != 0 ||
+     fread( (char *) pair, sizeof(int), 2, pack->fp ) != 2 ) {
+	fprintf( errorfp, "%s: ERROR: index of packed gallery file \"%s\" is truncated or unreadable\n",
+				get_progname(), pack->filename );
+	return -1;
+}
+offset = ( ( (unsigned long) (unsigned int) pair[0] << 16 ) << 16 ) | (unsigned long) (unsigned int) pair[1];
+if ( fseek( pack->fp, (long) offset, SEEK_SET ) != 0 ) {
+	fprintf( errorfp, "%s: ERROR: fseek() on packed gallery file \"%s\" failed: %s\n",
+				get_progname(), pack->filename, strerror(errno) );
+	return -1;
+}
+pack->next = recno;
+return 0;
+}
+
+/***********************************************************************/
+void bz_pack_close( struct bz_pack * pack )
+{
+if ( pack == BZ_PACK_NULL )
+	return;
+(void) fclose( pack->fp );
+if ( pack->buf != CNULL )
+	free( pack->buf );
+free( (char *) pack );
+}
@@ -0,0 +1,381 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/***********************************************************************
+      LIBRARY: FING - NIST Fingerprint Systems Utilities
+
+      FILE:           BZ_SIMD.C
+
+      Contains the edge filters bz_match() uses to find the On-File
+      edges compatible with each Subject edge: a portable scalar
+      filter, and SSE2 and AVX2 filters that test 8 or 16 edges at a
+      time on x86-64 hosts built with GCC or Clang.
+
+      Every filter computes the same distance test as the original
+      scalar loop, in single precision and in the same order, so the
+      edge pairs found, and the match scores, do not depend on which
+      filter is used.  The Beta tests are exact in 16-bit integers.
+
+      The filter is chosen at run time from the host's CPU features,
+      unless a particular one is requested with bz_set_isa().
+
+***********************************************************************
+
+      ROUTINES:
+#cat: bz_set_isa - requests a particular edge filter, or the fastest
+#cat:            one the host supports
+#cat: bz_isa_resolve - returns the edge filter that will be used
+#cat: bz_isa_name - returns the name of an edge filter
+#cat: bz_filter_select - returns the edge filter that will be used,
+#cat:            as a function that bz_match() can call
+
+***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <bozorth.h>
+
+#if ! defined(BZ_NO_SIMD) && defined(__x86_64__) && \
+    ( defined(__clang__) || __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#define BZ_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/* A Beta difference d fails when TXS < d^2 < CTXS, */
+/* that is when BETA_LO < |d| < BETA_HI             */
+#define BETA_LO	11
+#define BETA_HI	349
+
+static int bz_isa_request = BZ_ISA_AUTO;
+
+/***********************************************************************/
+static int bz_isa_supported( int isa )
+{
+switch ( isa ) {
+	case BZ_ISA_SCALAR:
+		return 1;
+#ifdef BZ_X86_SIMD
+	case BZ_ISA_SSE2:		/* Part of every x86-64 CPU */
+		return 1;
+	case BZ_ISA_AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports( "avx2" ) ? 1 : 0;
+#endif
+	default:
+		return 0;
+}
+}
+
+/***********************************************************************/
+/* Returns 0, or -1 if the host can't run the requested filter.  Must  */
+/* be called before any matching, since each context keeps the filter */
+/* it first used.                                                      */
+/***********************************************************************/
+int bz_set_isa( int isa )
+{
+if ( isa != BZ_ISA_AUTO && ! bz_isa_supported( isa ) )
+	return -1;
+bz_isa_request = isa;
+return 0;
+}
+
+/***********************************************************************/
+int bz_isa_resolve( void )
+{
+if ( bz_isa_request != BZ_ISA_AUTO )
+	return bz_isa_request;
+if ( bz_isa_supported( BZ_ISA_AVX2 ) )
+	return BZ_ISA_AVX2;
+if ( bz_isa_supported( BZ_ISA_SSE2 ) )
+	return BZ_ISA_SSE2;
+return BZ_ISA_SCALAR;
+}
+
+/***********************************************************************/
+char * bz_isa_name( int isa )
+{
+switch ( isa ) {
+	case BZ_ISA_AUTO:	return "auto";
+	case BZ_ISA_SCALAR:	return "scalar";
+	case BZ_ISA_SSE2:	return "sse2";
+	case BZ_ISA_AVX2:	return "avx2";
+	default:		return "unknown";
+}
+}
+
+/***********************************************************************/
+/* The reference filter: one edge at a time, stopping at the first    */
+/* edge that is too long, exactly as bz_match() always has.           */
+/***********************************************************************/
+static unsigned int bz_filter_scalar(
+	struct bz_edges * f,
+	int j0,
+	int n,
+	int ss,
+	int sb1,
+	int sb2,
+	unsigned int * too_short,
+	unsigned int * too_long
+	)
+{
+int i;
+int ff;
+int db1;
+int db2;
+float dz;
+float fi;
+unsigned int cand;
+unsigned int shrt;
+
+cand = 0;
+shrt = 0;
+*too_long = 0;
+for ( i = 0; i < n; i++ ) {
+	ff = f->dist[j0+i];
+	dz = ff - ss;
+	fi = ( 2.0F * TK ) * ( ff + ss );
+	if ( SQUARED(dz) > SQUARED(fi) ) {
+		if ( dz < 0 ) {
+			shrt |= 1U << i;
+			continue;
+		}
+		*too_long = 1U << i;
+		break;
+	}
+
+	db1 = sb1 - f->beta1[j0+i];
+	db2 = sb2 - f->beta2[j0+i];
+	if ( SQUARED(db1) > TXS && SQUARED(db1) < CTXS )
+		continue;
+	if ( SQUARED(db2) > TXS && SQUARED(db2) < CTXS )
+		continue;
+	cand |= 1U << i;
+}
+*too_short = shrt;
+return cand;
+}
+
+#ifdef BZ_X86_SIMD
+/***********************************************************************/
+/* 8 edges at a time: distances as two vectors of 4 floats, Betas as  */
+/* one vector of 8 shorts                                             */
+/***********************************************************************/
+static unsigned int bz_filter_sse2(
+	struct bz_edges * f,
+	int j0,
+	int n,
+	int ss,
+	int sb1,
+	int sb2,
+	unsigned int * too_short,
+	unsigned int * too_long
+	)
+{
+int i;
+int m;
+unsigned int cand;
+unsigned int shrt;
+unsigned int lng;
+unsigned int tcand;
+unsigned int tshrt;
+__m128i vss, vsb1, vsb2, vlo, vhi, zero;
+__m128 vtk;
+
+vss  = _mm_set1_epi32( ss );
+vsb1 = _mm_set1_epi16( (short) sb1 );
+vsb2 = _mm_set1_epi16( (short) sb2 );
+vlo  = _mm_set1_epi16( BETA_LO );
+vhi  = _mm_set1_epi16( BETA_HI );
+zero = _mm_setzero_si128();
+vtk  = _mm_set1_ps( 2.0F * TK );
+
+cand = 0;
+shrt = 0;
+lng  = 0;
+for ( i = 0; i + 8 <= n; i += 8 ) {
+	__m128i d, dd, ds, b, db, rej;
+	__m128 dz, fi, fail, neg;
+	int h;
+
+	d = _mm_loadu_si128( (__m128i *) ( f->dist + j0 + i ) );
+	for ( h = 0; h < 2; h++ ) {
+		dd = ( h == 0 ) ? _mm_unpacklo_epi16( d, d ) : _mm_unpackhi_epi16( d, d );
+		dd = _mm_srai_epi32( dd, 16 );
+		ds = _mm_sub_epi32( dd, vss );
+		dz = _mm_cvtepi32_ps( ds );
+		fi = _mm_mul_ps( vtk, _mm_cvtepi32_ps( _mm_add_epi32( dd, vss ) ) );
+		fail = _mm_cmpgt_ps( _mm_mul_ps( dz, dz ), _mm_mul_ps( fi, fi ) );
+		neg  = _mm_castsi128_ps( _mm_cmplt_epi32( ds, zero ) );
+		shrt |= (unsigned int) _mm_movemask_ps( _mm_and_ps( fail, neg ) ) << ( i + 4 * h );
+		lng  |= (unsigned int) _mm_movemask_ps( _mm_andnot_ps( neg, fail ) ) << ( i + 4 * h );
+		m = _mm_movemask_ps( fail );
+		cand |= (unsigned int) ( ~m & 0xF ) << ( i + 4 * h );
+	}
+
+	b  = _mm_loadu_si128( (__m128i *) ( f->beta1 + j0 + i ) );
+	db = _mm_sub_epi16( vsb1, b );
+	db = _mm_max_epi16( db, _mm_sub_epi16( zero, db ) );
+	rej = _mm_and_si128( _mm_cmpgt_epi16( db, vlo ), _mm_cmplt_epi16( db, vhi ) );
+	b  = _mm_loadu_si128( (__m128i *) ( f->beta2 + j0 + i ) );
+	db = _mm_sub_epi16( vsb2, b );
+	db = _mm_max_epi16( db, _mm_sub_epi16( zero, db ) );
+	rej = _mm_or_si128( rej, _mm_and_si128( _mm_cmpgt_epi16( db, vlo ), _mm_cmplt_epi16( db, vhi ) ) );
+	m = _mm_movemask_epi8( _mm_packs_epi16( rej, zero ) );
+	cand &= ~( (unsigned int) m << i );
+
+	if ( lng != 0 ) {
+		*too_short = shrt;
+		*too_long = lng;
+		return cand;
+	}
+}
+
+if ( i < n ) {
+	tcand = bz_filter_scalar( f, j0 + i, n - i, ss, sb1, sb2, &tshrt, &lng );
+	cand |= tcand << i;
+	shrt |= tshrt << i;
+	lng <<= i;
+}
+*too_short = shrt;
+*too_long = lng;
+return cand;
+}
+
+/***********************************************************************/
+/* 16 edges at a time: distances as two vectors of 8 floats, Betas as */
+/* one vector of 16 shorts                                            */
+/***********************************************************************/
+__attribute__(( target("avx2") ))
+static unsigned int bz_filter_avx2(
+	struct bz_edges * f,
+	int j0,
+	int n,
+	int ss,
+	int sb1,
+	int sb2,
+	unsigned int * too_short,
+	unsigned int * too_long
+	)
+{
+int i;
+int m;
+unsigned int cand;
+unsigned int shrt;
+unsigned int lng;
+unsigned int tcand;
+unsigned int tshrt;
+__m256i vss, vsb1, vsb2, vlo, vhi, zero;
+__m256 vtk;
+
+vss  = _mm256_set1_epi32( ss );
+vsb1 = _mm256_set1_epi16( (short) sb1 );
+vsb2 = _mm256_set1_epi16( (short) sb2 );
+vlo  = _mm256_set1_epi16( BETA_LO );
+vhi  = _mm256_set1_epi16( BETA_HI );
+zero = _mm256_setzero_si256();
+vtk  = _mm256_set1_ps( 2.0F * TK );
+
+cand = 0;
+shrt = 0;
+lng  = 0;
+for ( i = 0; i + 16 <= n; i += 16 ) {
+	__m256i d, dd, ds, b, db, rej;
+	__m256 dz, fi, fail, neg;
+	int h;
+
+	d = _mm256_loadu_si256( (__m256i *) ( f->dist + j0 + i ) );
+	for ( h = 0; h < 2; h++ ) {
+		dd = _mm256_cvtepi16_epi32( ( h == 0 ) ? _mm256_castsi256_si128( d ) : _mm256_extracti128_si256( d, 1 ) );
+		ds = _mm256_sub_epi32( dd, vss );
+		dz = _mm256_cvtepi32_ps( ds );
+		fi = _mm256_mul_ps( vtk, _mm256_cvtepi32_ps( _mm256_add_epi32( dd, vss ) ) );
+		fail = _mm256_cmp_ps( _mm256_mul_ps( dz, dz ), _mm256_mul_ps( fi, fi ), _CMP_GT_OQ );
+		neg  = _mm256_castsi256_ps( _mm256_cmpgt_epi32( zero, ds ) );
+		shrt |= (unsigned int) _mm256_movemask_ps( _mm256_and_ps( fail, neg ) ) << ( i + 8 * h );
+		lng  |= (unsigned int) _mm256_movemask_ps( _mm256_andnot_ps( neg, fail ) ) << ( i + 8 * h );
+		m = _mm256_movemask_ps( fail );
+		cand |= (unsigned int) ( ~m & 0xFF ) << ( i + 8 * h );
+	}
+
+	b  = _mm256_loadu_si256( (__m256i *) ( f->beta1 + j0 + i ) );
+	db = _mm256_abs_epi16( _mm256_sub_epi16( vsb1, b ) );
+	rej = _mm256_and_si256( _mm256_cmpgt_epi16( db, vlo ), _mm256_cmpgt_epi16( vhi, db ) );
+	b  = _mm256_loadu_si256( (__m256i *) ( f->beta2 + j0 + i ) );
+	db = _mm256_abs_epi16( _mm256_sub_epi16( vsb2, b ) );
+	rej = _mm256_or_si256( rej, _mm256_and_si256( _mm256_cmpgt_epi16( db, vlo ), _mm256_cmpgt_epi16( vhi, db ) ) );
+	m = _mm_movemask_epi8( _mm_packs_epi16( _mm256_castsi256_si128( rej ), _mm256_extracti128_si256( rej, 1 ) ) );
+	cand &= ~( (unsigned int) m << i );
+
+	if ( lng != 0 ) {
+		*too_short = shrt;
+		*too_long = lng;
+		return cand;
+	}
+}
+
+if ( i < n ) {
+	tcand = bz_filter_scalar( f, j0 + i, n - i, ss, sb1, sb2, &tshrt, &lng );
+	cand |= tcand << i;
+	shrt |= tshrt << i;
+	lng <<= i;
+}
+*too_short = shrt;
+*too_long = lng;
+return cand;
+}
+#endif
+
+/***********************************************************************/
+bz_filter_fn bz_filter_select( void )
+{
+switch ( bz_isa_resolve() ) {
+#ifdef BZ_X86_SIMD
+	case BZ_ISA_AVX2:
+		return bz_filter_avx2;
+	case BZ_ISA_SSE2:
+		return bz_filter_sse2;
+#endif
+	default:
+		return bz_filter_scalar;
+}
+}
@@ -116,29 +116,33 @@ qsort_decreasing() - quicksort an array of integers in decreasing
                      order [based on multisort.c, by Michael Garris
                      and Ted Zwiesler, 1986]
 ********************************************************/
-/* Used by custom quicksort code below */
-static int   stack[BZ_STACKSIZE];
-static int * stack_pointer = stack;
+/* Used by custom quicksort code below.  The stack is allocated by each */
+/* call to qsort_decreasing() so concurrent sorts (as when gallery files */
+/* are loaded by several matcher threads) do not share it.               */
+struct bz_stack {
+	int   items[BZ_STACKSIZE];
+	int * pointer;
+};
 
 /***********************************************************************/
 /* return values: 0 == successful, 1 == error */
-static int popstack( int *popval )
+static int popstack( struct bz_stack * stack, int *popval )
 {
-if ( --stack_pointer < stack ) {
+if ( --stack->pointer < stack->items ) {
 	fprintf( errorfp, "%s: ERROR: popstack(): stack underflow\n", get_progname() );
 	return 1;
 }
 
-*popval = *stack_pointer;
+*popval = *stack->pointer;
 return 0;
 }
 
 /***********************************************************************/
 /* return values: 0 == successful, 1 == error */
-static int pushstack( int position )
+static int pushstack( struct bz_stack * stack, int position )
 {
-*stack_pointer++ = position;
-if ( stack_pointer > ( stack + BZ_STACKSIZE ) ) {
+*stack->pointer++ = position;
+if ( stack->pointer > ( stack->items + BZ_STACKSIZE ) ) {
 	fprintf( errorfp, "%s: ERROR: pushstack(): stack overflow\n", get_progname() );
 	return 1;
 }
@@ -234,37 +238,39 @@ static int qsort_decreasing( struct cell v[], int left, int right )
 int pivot;
 int llen, rlen;
 int lleft, lright, rleft, rright;
+struct bz_stack stack;
 
 
-if ( pushstack( left  ))
+stack.pointer = stack.items;
+if ( pushstack( &stack, left  ))
 	return 1;
-if ( pushstack( right ))
+if ( pushstack( &stack, right ))
 	return 2;
-while ( stack_pointer != stack ) {
-	if (popstack(&right))
+while ( stack.pointer != stack.items ) {
+	if (popstack( &stack, &right))
 		return 3;
-	if (popstack(&left ))
+	if (popstack( &stack, &left ))
 		return 4;
 	if ( right - left > 0 ) {
 		pivot = select_pivot( v, left, right );
 		partition_dec( v, &llen, &rlen, &lleft, &lright, &rleft, &rright, pivot, left, right );
 		if ( llen > rlen ) {
-			if ( pushstack( lleft  ))
+			if ( pushstack( &stack, lleft  ))
 				return 5;
-			if ( pushstack( lright ))
+			if ( pushstack( &stack, lright ))
 				return 6;
-			if ( pushstack( rleft  ))
+			if ( pushstack( &stack, rleft  ))
 				return 7;
-			if ( pushstack( rright ))
+			if ( pushstack( &stack, rright ))
 				return 8;
 		} else{
-			if ( pushstack( rleft  ))
+			if ( pushstack( &stack, rleft  ))
 				return 9;
-			if ( pushstack( rright ))
+			if ( pushstack( &stack, rright ))
 				return 10;
-			if ( pushstack( lleft  ))
+			if ( pushstack( &stack, lleft  ))
 				return 11;
-			if ( pushstack( lright ))
+			if ( pushstack( &stack, lright ))
 				return 12;
 		}
 	}
@@ -0,0 +1,591 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/***********************************************************************
+      LIBRARY: FING - NIST Fingerprint Systems Utilities
+
+      FILE:           BZ_WEB.C
+
+      Contains routines that store the pruned minutiae and sorted
+      pairwise comparison table ("Web") of many gallery fingerprints
+      in a single binary file, and that map such a file back into
+      memory so that a probe can be matched against each gallery
+      fingerprint without recomputing its Web.
+
+      File layout (all integers are 32 bits in the byte order of the
+      machine that wrote the file; every record starts on a 4-byte
+      boundary):
+
+         header:  magic "BZ3WEB\n\0", byte order mark, version,
+                  m1 flag, max minutiae, record count,
+                  index offset (high word, low word)
+         records: name length (including NUL), name padded to 4 bytes,
+                  nrows, x[nrows], y[nrows], theta[nrows],
+                  nedges, Web rows [nedges][COLS_SIZE_2]
+         index:   record offset (high word, low word) for each record
+
+      The same routines also keep Webs in memory (struct bz_web_mem)
+      so that each one of a tile of probes or gallery fingerprints is
+      built once and then matched against many others.
+
+      Only the first "pruned length" rows of the sorted Web are kept,
+      as bz_match() never looks beyond them.  Because the Web depends
+      on the "-m1" representation and on the max minutiae setting,
+      both are recorded and checked when the file is loaded.
+
+***********************************************************************
+
+      ROUTINES:
+#cat: bz_web_create - opens a new Web gallery file for writing
+#cat: bz_web_append - computes the Web of a gallery fingerprint and
+#cat:            appends it to a Web gallery file
+#cat: bz_web_finish - writes the record index and closes a Web
+#cat:            gallery file
+#cat: bz_web_load - maps a Web gallery file into memory
+#cat: bz_web_free - unmaps a Web gallery file
+#cat: bz_web_name - returns the name stored with a Web gallery record
+#cat: bozorth_gallery_init_web - sets up a stored gallery Web for
+#cat:            matching in place of bozorth_gallery_init
+#cat: bozorth_to_web - matches the current probe against a stored
+#cat:            gallery Web
+#cat: bozorth_gallery_init_web_ctx - reentrant version of
+#cat:            bozorth_gallery_init_web
+#cat: bozorth_to_web_ctx - reentrant version of bozorth_to_web
+#cat: bz_web_mem_build - builds the Web of a fingerprint once and keeps
+#cat:            a copy in memory
+#cat: bz_web_mem_free - deallocates the Web kept by bz_web_mem_build
+#cat: bozorth_web_mem_ctx - matches two Webs kept in memory
+
+***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <bozorth.h>
+
+#define BZ_WEB_HEADER_INTS	8
+#define BZ_WEB_HEADER_SIZE	( BZ_WEB_MAGIC_SIZE + BZ_WEB_HEADER_INTS * 4 )
+
+#define BZ_WEB_PAD4(n)		( ( (n) + 3 ) & ~3 )
+
+/***********************************************************************/
+static int bz_web_write_ints( struct bz_web_out * out, int * buf, int n )
+{
+if ( n > 0 && fwrite( (char *) buf, sizeof(int), (size_t) n, out->fp ) != (size_t) n ) {
+	fprintf( errorfp, "%s: ERROR: fwrite() to Web gallery file \"%s\" failed: %s\n",
+				get_progname(), out->filename, strerror(errno) );
+	return -1;
+}
+out->pos += (unsigned long) n * sizeof(int);
+return 0;
+}
+
+/***********************************************************************/
+static int bz_web_write_header( struct bz_web_out * out, unsigned long index_offset )
+{
+int hdr[ BZ_WEB_HEADER_INTS ];
+char magic[ BZ_WEB_MAGIC_SIZE ];
+
+memset( magic, 0, sizeof magic );
+strcpy( magic, BZ_WEB_MAGIC );
+if ( fwrite( magic, 1, sizeof magic, out->fp ) != sizeof magic ) {
+	fprintf( errorfp, "%s: ERROR: fwrite() to Web gallery file \"%s\" failed: %s\n",
+				get_progname(), out->filename, strerror(errno) );
+	return -1;
+}
+out->pos += sizeof magic;
+
+hdr[0] = BZ_WEB_BYTE_ORDER;
+hdr[1] = BZ_WEB_VERSION;
+hdr[2] = m1_xyt;
+hdr[3] = max_minutiae;
+hdr[4] = out->count;
+hdr[5] = (int) ( ( index_offset >> 16 ) >> 16 );
+hdr[6] = (int) ( index_offset & 0xFFFFFFFFUL );
+hdr[7] = 0;
+return bz_web_write_ints( out, hdr, BZ_WEB_HEADER_INTS );
+}
+
+/***********************************************************************/
+/* returns BZ_WEB_OUT_NULL on error */
+struct bz_web_out * bz_web_create( const char * filename )
+{
+struct bz_web_out * out;
+
+out = (struct bz_web_out *) malloc_or_return_error( (int) sizeof(struct bz_web_out), "Web gallery writer" );
+if ( out == BZ_WEB_OUT_NULL )
+	return BZ_WEB_OUT_NULL;
+out->filename  = (char *) filename;
+out->count     = 0;
+out->max_count = 0;
+out->offsets   = (unsigned long *) NULL;
+out->pos       = 0;
+
+out->fp = fopen( filename, "wb" );
+if ( out->fp == FPNULL ) {
+	fprintf( errorfp, "%s: ERROR: fopen() of Web gallery file \"%s\" failed: %s\n",
+				get_progname(), filename, strerror(errno) );
+	free( (char *) out );
+	return BZ_WEB_OUT_NULL;
+}
+
+/* Placeholder; rewritten with the final count by bz_web_finish() */
+if ( bz_web_write_header( out, 0UL ) != 0 ) {
+	(void) fclose( out->fp );
+	free( (char *) out );
+	return BZ_WEB_OUT_NULL;
+}
+return out;
+}
+
+/***********************************************************************/
+/* returns 0 on success, -1 on error */
+int bz_web_append(
+	struct bz_web_out * out,	/* INPUT and OUTPUT: file being written */
+	struct bz_ctx * ctx,		/* SCRATCH: matcher context used to build the Web */
+	const char * name,		/* INPUT: name to report in score lines */
+	struct xyt_struct * gstruct	/* INPUT: gallery minutiae as returned by bz_load() */
+	)
+{
+int n;
+int i;
+int mfim;
+int namelen;
+char pad[4];
+
+if ( out->count == out->max_count ) {
+	unsigned long * offsets;
+	int max_count;
+
+	max_count = ( out->max_count == 0 ) ? 1024 : 2 * out->max_count;
+	offsets = (unsigned long *) realloc( (char *) out->offsets, max_count * sizeof(unsigned long) );
+	if ( offsets == (unsigned long *) NULL ) {
+		fprintf( errorfp, "%s: ERROR: realloc() of Web gallery index for %d records failed: %s\n",
+					get_progname(), max_count, strerror(errno) );
+		return -1;
+	}
+	out->offsets   = offsets;
+	out->max_count = max_count;
+}
+out->offsets[ out->count ] = out->pos;
+
+mfim = bozorth_gallery_init_ctx( ctx, gstruct );
+
+namelen = (int) strlen( name ) + 1;
+if ( bz_web_write_ints( out, &namelen, 1 ) != 0 )
+	return -1;
+memset( pad, 0, sizeof pad );
+if ( fwrite( name, 1, (size_t) namelen, out->fp ) != (size_t) namelen ||
+     fwrite( pad, 1, (size_t) ( BZ_WEB_PAD4(namelen) - namelen ), out->fp ) != (size_t) ( BZ_WEB_PAD4(namelen) - namelen ) ) {
+	fprintf( errorfp, "%s: ERROR: fwrite() to Web gallery file \"%s\" failed: %s\n",
+				get_progname(), out->filename, strerror(errno) );
+	return -1;
+}
+out->pos += BZ_WEB_PAD4(namelen);
+
+n = gstruct->nrows;
+if ( bz_web_write_ints( out, &n, 1 ) != 0 ||
+     bz_web_write_ints( out, gstruct->xcol, n ) != 0 ||
+     bz_web_write_ints( out, gstruct->ycol, n ) != 0 ||
+     bz_web_write_ints( out, gstruct->thetacol, n ) != 0 )
+	return -1;
+
+if ( bz_web_write_ints( out, &mfim, 1 ) != 0 )
+	return -1;
+for ( i = 0; i < mfim; i++ )
+	if ( bz_web_write_ints( out, ctx->fcolpt[i], COLS_SIZE_2 ) != 0 )
+		return -1;
+
+++out->count;
+return 0;
+}
+
+/***********************************************************************/
+/* Writes the index, rewrites the header and frees the writer. */
+/* returns 0 on success, -1 on error */
+int bz_web_finish( struct bz_web_out * out )
+{
+int i;
+int ret = 0;
+int pair[2];
+unsigned long index_offset;
+
+index_offset = out->pos;
+for ( i = 0; i < out->count && ret == 0; i++ ) {
+	pair[0] = (int) ( ( out->offsets[i] >> 16 ) >> 16 );
+	pair[1] = (int) ( out->offsets[i] & 0xFFFFFFFFUL );
+	ret = bz_web_write_ints( out, pair, 2 );
+}
+
+if ( ret == 0 ) {
+	if ( fseek( out->fp, 0L, SEEK_SET ) != 0 ) {
+		fprintf( errorfp, "%s: ERROR: fseek() on Web gallery file \"%s\" failed: %s\n",
+					get_progname(), out->filename, strerror(errno) );
+		ret = -1;
+	} else
+		ret = bz_web_write_header( out, index_offset );
+}
+
+if ( fclose( out->fp ) != 0 ) {
+	fprintf( errorfp, "%s: ERROR: fclose() of Web gallery file \"%s\" failed: %s\n",
+				get_progname(), out->filename, strerror(errno) );
+	ret = -1;
+}
+if ( out->offsets != (unsigned long *) NULL )
+	free( (char *) out->offsets );
+free( (char *) out );
+return ret;
+}
+
+/***********************************************************************/
+/* returns BZ_WEB_NULL on error */
+struct bz_web * bz_web_load( const char * filename )
+{
+int fd;
+int * hdr;
+int count;
+struct stat sb;
+struct bz_web * web;
+unsigned long index_offset;
+
+fd = open( filename, O_RDONLY );
+if ( fd < 0 ) {
+	fprintf( errorfp, "%s: ERROR: open() of Web gallery file \"%s\" failed: %s\n",
+				get_progname(), filename, strerror(errno) );
+	return BZ_WEB_NULL;
+}
+if ( fstat( fd, &sb ) != 0 ) {
+	fprintf( errorfp, "%s: ERROR: fstat() of Web gallery file \"%s\" failed: %s\n",
+				get_progname(), filename, strerror(errno) );
+	(void) close( fd );
+	return BZ_WEB_NULL;
+}
+if ( (unsigned long) sb.st_size < BZ_WEB_HEADER_SIZE ) {
+	fprintf( errorfp, "%s: ERROR: Web gallery file \"%s\" is too short\n",
+				get_progname(), filename );
+	(void) close( fd );
+	return BZ_WEB_NULL;
+}
+
+web = (struct bz_web *) malloc_or_return_error( (int) sizeof(struct bz_web), "Web gallery" );
+if ( web == BZ_WEB_NULL ) {
+	(void) close( fd );
+	return BZ_WEB_NULL;
+}
+web->filename = (char *) filename;
+web->maplen   = (size_t) sb.st_size;
+web->map      = (char *) mmap( (void *) NULL, web->maplen, PROT_READ, MAP_SHARED, fd, (off_t) 0 );
+(void) close( fd );
+if ( web->map == (char *) MAP_FAILED ) {
+	fprintf( errorfp, "%s: ERROR: mmap() of Web gallery file \"%s\" failed: %s\n",
+				get_progname(), filename, strerror(errno) );
+	free( (char *) web );
+	return BZ_WEB_NULL;
+}
+
+hdr = (int *) ( web->map + BZ_WEB_MAGIC_SIZE );
+if ( memcmp( web->map, BZ_WEB_MAGIC, BZ_WEB_MAGIC_SIZE ) != 0 ) {
+	fprintf( errorfp, "%s: ERROR: \"%s\" is not a Web gallery file\n",
+				get_progname(), filename );
+	bz_web_free( web );
+	return BZ_WEB_NULL;
+}
+if ( hdr[0] != BZ_WEB_BYTE_ORDER || hdr[1] != BZ_WEB_VERSION ) {
+	fprintf( errorfp, "%s: ERROR: Web gallery file \"%s\" was written in an incompatible format\n",
+				get_progname(), filename );
+	bz_web_free( web );
+	return BZ_WEB_NULL;
+}
+
+web->m1_xyt       = hdr[2];
+web->max_minutiae = hdr[3];
+count             = hdr[4];
+index_offset      = ( ( (unsigned long) (unsigned int) hdr[5] << 16 ) << 16 ) | (unsigned long) (unsigned int) hdr[6];
+
+if ( web->m1_xyt != m1_xyt ) {
+	fprintf( errorfp, "%s: ERROR: Web gallery file \"%s\" was built %s \"-m1\"\n",
+				get_progname(), filename, web->m1_xyt ? "with" : "without" );
+	bz_web_free( web );
+	return BZ_WEB_NULL;
+}
+if ( web->max_minutiae != max_minutiae ) {
+	fprintf( errorfp, "%s: ERROR: Web gallery file \"%s\" was built with max minutiae %d, not %d\n",
+				get_progname(), filename, web->max_minutiae, max_minutiae );
+	bz_web_free( web );
+	return BZ_WEB_NULL;
+}
+if ( count < 0 || index_offset % 4 != 0 || index_offset > web->maplen ||
+     ( web->maplen - index_offset ) / ( 2 * sizeof(int) ) < (unsigned long) count ) {
+	fprintf( errorfp, "%s: ERROR: Web gallery file \"%s\" is truncated or corrupt\n",
+				get_progname(), filename );
+	bz_web_free( web );
+	return BZ_WEB_NULL;
+}
+web->count = count;
+web->index = (unsigned int *) ( web->map + index_offset );
+
+if ( verbose_load )
+	fprintf( errorfp, "Mapped %d Webs from %s\n", web->count, filename );
+
+return web;
+}
+
+/***********************************************************************/
+void bz_web_free( struct bz_web * web )
+{
+if ( web == BZ_WEB_NULL )
+	return;
+(void) munmap( (void *) web->map, web->maplen );
+free( (char *) web );
+}
+
+/***********************************************************************/
+/* Returns a pointer to the start of record i, or NULL if it is out of */
+/* bounds; on success *avail is the number of ints left in the file.   */
+/***********************************************************************/
+static int * bz_web_record( struct bz_web * web, int i, unsigned long * avail )
+{
+unsigned long offset;
+
+if ( i < 0 || i >= web->count )
+	return (int *) NULL;
+offset = ( ( (unsigned long) web->index[2*i] << 16 ) << 16 ) | (unsigned long) web->index[2*i+1];
+if ( offset % 4 != 0 || offset < BZ_WEB_HEADER_SIZE || offset >= web->maplen )
+	return (int *) NULL;
+*avail = ( web->maplen - offset ) / sizeof(int);
+return (int *) ( web->map + offset );
+}
+
+/***********************************************************************/
+/* Returns nonzero if a stored Web row holds values bz_comp() could    */
+/* have made for n minutiae: K and J are used as indices by bz_match() */
+/* and bz_match_score(), and the distance and Betas are narrowed to    */
+/* shorts by bz_edges_fill().                                          */
+/***********************************************************************/
+static int bz_web_row_ok( int * row, int n )
+{
+if ( row[0] < 0 || row[0] > SQUARED(DM) )
+	return 0;
+if ( row[1] <= -180 || row[1] > 180 || row[2] <= -180 || row[2] > 180 )
+	return 0;
+if ( row[3] < 1 || row[3] > n || row[4] < 1 || row[4] > n )
+	return 0;
+if ( ( row[5] < -180 || row[5] > 180 ) && ( row[5] < 220 || row[5] > 580 ) )
+	return 0;
+return 1;
+}
+
+/***********************************************************************/
+/* returns CNULL if the record is corrupt */
+char * bz_web_name( struct bz_web * web, int i )
+{
+int * rec;
+unsigned long avail;
+
+rec = bz_web_record( web, i, &avail );
+if ( rec == (int *) NULL || rec[0] <= 0 ||
+     (unsigned long) BZ_WEB_PAD4(rec[0]) / sizeof(int) >= avail ||
+     ((char *) &rec[1])[ rec[0] - 1 ] != '\0' )
+	return CNULL;
+return (char *) &rec[1];
+}
+
+/***********************************************************************/
+int bozorth_gallery_init_web( struct bz_web * web, int i, struct xyt_struct * gstruct )
+{
+return bozorth_gallery_init_web_ctx( &bz_gbl_ctx, web, i, gstruct );
+}
+
+/***********************************************************************/
+int bozorth_to_web( int probe_len, struct xyt_struct * pstruct, struct bz_web * web, int i )
+{
+return bozorth_to_web_ctx( &bz_gbl_ctx, probe_len, pstruct, web, i );
+}
+
+/***********************************************************************/
+/* Points the context's On-File pointer list at the stored Web rows  */
+/* and copies the stored minutiae into gstruct.  Returns the pruned  */
+/* length of the On-File pointer list, or -1 if the record is corrupt */
+/***********************************************************************/
+int bozorth_gallery_init_web_ctx(
+	struct bz_ctx * ctx,		/* OUTPUT: fcolpt[] and fedges are set */
+	struct bz_web * web,		/* INPUT:  mapped Web gallery */
+	int i,				/* INPUT:  record number */
+	struct xyt_struct * gstruct	/* OUTPUT: gallery minutiae */
+	)
+{
+int * rec;
+int * p;
+int n;
+int j;
+int mfim;
+unsigned long avail;
+unsigned long need;
+
+rec = bz_web_record( web, i, &avail );
+if ( rec == (int *) NULL || rec[0] <= 0 )
+	goto CORRUPT;
+
+need = 1 + BZ_WEB_PAD4(rec[0]) / sizeof(int) + 1;
+if ( need > avail )
+	goto CORRUPT;
+p = rec + need - 1;
+n = *p++;
+if ( n < 0 || n > MAX_BOZORTH_MINUTIAE )
+	goto CORRUPT;
+need += 3 * n + 1;
+if ( need > avail )
+	goto CORRUPT;
+
+gstruct->nrows = n;
+memcpy( (char *) gstruct->xcol,     (char *) p, n * sizeof(int) );	p += n;
+memcpy( (char *) gstruct->ycol,     (char *) p, n * sizeof(int) );	p += n;
+memcpy( (char *) gstruct->thetacol, (char *) p, n * sizeof(int) );	p += n;
+
+mfim = *p++;
+if ( mfim < 0 || mfim > FCOLPT_SIZE ||
+     (unsigned long) mfim * COLS_SIZE_2 > avail - need )
+	goto CORRUPT;
+
+for ( j = 0; j < mfim; j++ ) {
+	if ( ! bz_web_row_ok( p, n ) )
+		goto CORRUPT;
+	ctx->fcolpt[j] = p;
+	p += COLS_SIZE_2;
+}
+bz_edges_fill( ctx->fcolpt, mfim, ctx->fdist, ctx->fbeta1, ctx->fbeta2, ctx->finfo, &ctx->fedges );
+return mfim;
+
+CORRUPT:
+	fprintf( errorfp, "%s: ERROR: record %d of Web gallery file \"%s\" is corrupt\n",
+				get_progname(), i+1, web->filename );
+	return -1;
+}
+
+/***********************************************************************/
+/* Returns the match score, or -1 if the record is corrupt */
+/***********************************************************************/
+int bozorth_to_web_ctx(
+	struct bz_ctx * ctx,
+	int probe_len,			/* INPUT: value returned by bozorth_probe_init_ctx() */
+	struct xyt_struct * pstruct,	/* INPUT: probe minutiae */
+	struct bz_web * web,		/* INPUT: mapped Web gallery */
+	int i				/* INPUT: record number */
+	)
+{
+int np;
+int gallery_len;
+struct xyt_struct gstruct;
+
+gallery_len = bozorth_gallery_init_web_ctx( ctx, web, i, &gstruct );
+if ( gallery_len < 0 )
+	return -1;
+np = bz_match_ctx( ctx, probe_len, gallery_len );
+return bz_match_score_ctx( ctx, np, pstruct, &gstruct );
+}
+
+/***********************************************************************/
+/* Builds the Web of xyt in ctx and keeps a copy of its sorted edges,  */
+/* along with the minutiae, in wm.  Probe and gallery Webs are built   */
+/* identically, so wm may later be used on either side of a match.    */
+/* returns 0 on success, -1 on error                                   */
+/***********************************************************************/
+int bz_web_mem_build(
+	struct bz_ctx * ctx,		/* SCRATCH: matcher context used to build the Web */
+	struct xyt_struct * xyt,	/* INPUT:  minutiae as returned by bz_load() */
+	struct bz_web_mem * wm		/* OUTPUT: Web kept in memory */
+	)
+{
+int len;
+int n;
+char * buf;
+
+len = bozorth_gallery_init_ctx( ctx, xyt );
+
+/* The info column comes first so that it stays aligned */
+n = ( len > 0 ) ? len : 1;
+buf = malloc_or_return_error( (int) ( n * ( sizeof(int) + 3 * sizeof(short) ) ), "in-memory Web" );
+if ( buf == CNULL )
+	return -1;
+wm->edges.info  = (int *) buf;
+wm->edges.dist  = (short *) ( buf + n * sizeof(int) );
+wm->edges.beta1 = wm->edges.dist  + n;
+wm->edges.beta2 = wm->edges.beta1 + n;
+memcpy( (char *) wm->edges.info,  (char *) ctx->finfo,  len * sizeof(int) );
+memcpy( (char *) wm->edges.dist,  (char *) ctx->fdist,  len * sizeof(short) );
+memcpy( (char *) wm->edges.beta1, (char *) ctx->fbeta1, len * sizeof(short) );
+memcpy( (char *) wm->edges.beta2, (char *) ctx->fbeta2, len * sizeof(short) );
+wm->len = len;
+memcpy( (char *) &wm->xyt, (char *) xyt, sizeof(struct xyt_struct) );
+return 0;
+}
+
+/***********************************************************************/
+void bz_web_mem_free( struct bz_web_mem * wm )
+{
+if ( wm->edges.info != (int *) NULL )
+	free( (char *) wm->edges.info );
+wm->edges.info = (int *) NULL;
+wm->len = 0;
+}
+
+/***********************************************************************/
+/* Returns the match score of two Webs built by bz_web_mem_build() */
+/***********************************************************************/
+int bozorth_web_mem_ctx(
+	struct bz_ctx * ctx,
+	struct bz_web_mem * probe,	/* INPUT: probe Web */
+	struct bz_web_mem * gallery	/* INPUT: gallery Web */
+	)
+{
+int np;
+
+ctx->sedges = probe->edges;
+ctx->fedges = gallery->edges;
+
+np = bz_match_ctx( ctx, probe->len, gallery->len );
+return bz_match_score_ctx( ctx, np, &probe->xyt, &gallery->xyt );
+}
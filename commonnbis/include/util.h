@@ -85,6 +85,11 @@ extern int ticksPerSec(void);
 /* time.c */
 extern char *current_time(void);
 
+/* workpool.c */
+extern int work_pool_nthreads(const int, const int);
+extern int work_pool_run(int (*)(void *, const int, const int), void *,
+           const int, const int);
+
 /* fixup.c */
 /*
 #ifdef __MSYS__
@@ -0,0 +1,207 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+
+/***********************************************************************
+      LIBRARY: UTIL - General Purpose Utility Routines
+
+      FILE:    WORKPOOL.C
+
+      Contains a small worker pool that spreads independent work items,
+      such as the blocks of an image or the images of a batch, across
+      several threads.  Items are handed out one at a time, in
+      increasing order, to whichever worker is free, so a few slow
+      items do not leave the other threads idle.  Each call is
+      told which worker makes it, so per-worker scratch memory or
+      contexts may be indexed by it; calls from the same worker never
+      overlap.
+
+      ROUTINES:
+#cat: work_pool_nthreads - returns the number of worker threads to use
+#cat:                for a requested count, where 0 means one per online
+#cat:                processor, and a number of work items.
+#cat: work_pool_run - calls a function once for each item in [0,nitems)
+#cat:                using up to the given number of worker threads,
+#cat:                stopping at the first item that fails.
+
+***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <util.h>
+
+/* State shared by all workers of one work_pool_run() call. */
+typedef struct work_pool {
+   pthread_mutex_t lock;
+   int (*func)(void *, const int, const int);
+   void *arg;
+   int nitems;
+   int next;      /* next item to be handed out */
+   int ret;       /* first nonzero return code, or zero */
+} WORK_POOL;
+
+typedef struct work_pool_worker {
+   WORK_POOL *pool;
+   int id;
+   pthread_t thread;
+} WORK_POOL_WORKER;
+
+/*****************************************************************/
+/* Returns the number of threads to use for "requested" threads  */
+/* and "nitems" work items.  A request of zero means one thread  */
+/* per online processor.  The result is at least one and at most */
+/* nitems.                                                       */
+/*****************************************************************/
+int work_pool_nthreads(const int requested, const int nitems)
+{
+   long n;
+
+   if(requested > 0)
+      n = requested;
+   else{
+      n = sysconf(_SC_NPROCESSORS_ONLN);
+      if(n < 1)
+         n = 1;
+   }
+
+   if(n > nitems)
+      n = nitems;
+   if(n < 1)
+      n = 1;
+
+   return((int)n);
+}
+
+/*****************************************************************/
+/* Thread routine that takes the next work item and processes    */
+/* it, until there are no items left or an item has failed.      */
+/*****************************************************************/
+static void *work_pool_worker(void *varg)
+{
+   WORK_POOL_WORKER *worker = (WORK_POOL_WORKER *)varg;
+   WORK_POOL *pool = worker->pool;
+   int item, ret;
+
+   while(1){
+      pthread_mutex_lock(&pool->lock);
+      if(pool->ret != 0 || pool->next >= pool->nitems){
+         pthread_mutex_unlock(&pool->lock);
+         break;
+      }
+      item = pool->next++;
+      pthread_mutex_unlock(&pool->lock);
+
+      if((ret = pool->func(pool->arg, worker->id, item))){
+         pthread_mutex_lock(&pool->lock);
+         if(pool->ret == 0)
+            pool->ret = ret;
+         pthread_mutex_unlock(&pool->lock);
+         break;
+      }
+   }
+
+   return(NULL);
+}
+
+/*****************************************************************/
+/* Calls func(arg, worker, item) for each item in [0,nitems)     */
+/* using up to "nthreads" workers, the calling thread being      */
+/* worker 0; worker is in [0,nthreads).  Returns zero, or the    */
+/* return code of a failed item, in which case the items not yet */
+/* started are skipped.  If workers cannot be allocated or       */
+/* started, those running, or the calling thread alone, do their */
+/* share.                                                        */
+/*****************************************************************/
+int work_pool_run(int (*func)(void *, const int, const int), void *arg,
+                  const int nitems, const int nthreads)
+{
+   WORK_POOL pool;
+   WORK_POOL_WORKER *workers;
+   int i, ret, nstarted;
+
+   workers = (WORK_POOL_WORKER *)NULL;
+   if(nthreads > 1 && nitems > 1)
+      workers = (WORK_POOL_WORKER *)malloc(nthreads *
+                                           sizeof(WORK_POOL_WORKER));
+
+   /* Serial case runs each item directly in the calling thread. */
+   if(workers == (WORK_POOL_WORKER *)NULL){
+      for(i = 0; i < nitems; i++){
+         if((ret = func(arg, 0, i)))
+            return(ret);
+      }
+      return(0);
+   }
+
+   pthread_mutex_init(&pool.lock, NULL);
+   pool.func = func;
+   pool.arg = arg;
+   pool.nitems = nitems;
+   pool.next = 0;
+   pool.ret = 0;
+
+   /* Items are handed out on demand, so if a thread cannot be */
+   /* created, the workers already running do its share.       */
+   nstarted = 1;
+   for(i = 1; i < nthreads && i < nitems; i++){
+      workers[nstarted].pool = &pool;
+      workers[nstarted].id = nstarted;
+      if(pthread_create(&(workers[nstarted].thread), NULL,
+                        work_pool_worker, &workers[nstarted]) == 0)
+         nstarted++;
+   }
+
+   workers[0].pool = &pool;
+   workers[0].id = 0;
+   work_pool_worker(&workers[0]);
+
+   for(i = 1; i < nstarted; i++)
+      pthread_join(workers[i].thread, NULL);
+
+   pthread_mutex_destroy(&pool.lock);
+   free(workers);
+
+   return(pool.ret);
+}
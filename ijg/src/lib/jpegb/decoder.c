@@ -27,11 +27,29 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <setjmp.h>
 #include <sys/param.h>
 #include <jpegb.h>
 
 #define CM_PER_INCH 2.54
 
+/* Error manager that returns control to the decoder on a fatal    */
+/* error, instead of exiting the process, so that a corrupt image */
+/* is reported to the caller with a return code.                   */
+struct jpegb_error_mgr {
+  struct jpeg_error_mgr pub;
+  jmp_buf setjmp_buffer;
+};
+
+/*********************************************************************/
+/* Print the library's message and jump back to the decoder.         */
+/*********************************************************************/
+static void jpegb_error_exit(j_common_ptr cinfo)
+{
+  (*cinfo->err->output_message)(cinfo);
+  longjmp(((struct jpegb_error_mgr *)cinfo->err)->setjmp_buffer, 1);
+}
+
 /*********************************************************************/
 /* JPEGB Decoder routine.  Takes a Baseline JPEG compressed          */
 /* memory buffer and decodes it, returning the reconstructed pixmap. */
@@ -44,14 +62,26 @@ int jpegb_decode_mem(unsigned char **oout_buffer,
    * working space (which is allocated as needed by the JPEG library).
    */
   struct jpeg_decompress_struct cinfo;
-  struct jpeg_error_mgr jerr;
-  unsigned char *out_buffer;
+  struct jpegb_error_mgr jerr;
+  unsigned char * volatile out_buffer;
   unsigned char *bptr;
   unsigned char **tbuffer;	/* Output buffer */
   int row_stride;		/* physical row width in output buffer */
   int ret;
 
-  cinfo.err = jpeg_std_error(&jerr);
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = jpegb_error_exit;
+  out_buffer = (unsigned char *)NULL;
+
+  /* Return here if the library finds a fatal error. */
+  if(setjmp(jerr.setjmp_buffer)){
+    jpeg_destroy_decompress(&cinfo);
+    if(out_buffer != (unsigned char *)NULL)
+      free(out_buffer);
+    fprintf(stderr, "ERROR : jpegb_decode_mem : corrupt JPEGB datastream\n");
+    return(-3);
+  }
+
 
   /* Now we can initialize the JPEG decompression object. */
   jpeg_create_decompress(&cinfo);
@@ -162,14 +192,26 @@ int jpegb_decode_file(unsigned char **oout_buffer,
    * working space (which is allocated as needed by the JPEG library).
    */
   struct jpeg_decompress_struct cinfo;
-  struct jpeg_error_mgr jerr;
-  unsigned char *out_buffer;
+  struct jpegb_error_mgr jerr;
+  unsigned char * volatile out_buffer;
   unsigned char *bptr;
   unsigned char **tbuffer;	/* Output buffer */
   int row_stride;		/* physical row width in output buffer */
   int ret;
 
-  cinfo.err = jpeg_std_error(&jerr);
+  cinfo.err = jpeg_std_error(&jerr.pub);
+  jerr.pub.error_exit = jpegb_error_exit;
+  out_buffer = (unsigned char *)NULL;
+
+  /* Return here if the library finds a fatal error. */
+  if(setjmp(jerr.setjmp_buffer)){
+    jpeg_destroy_decompress(&cinfo);
+    if(out_buffer != (unsigned char *)NULL)
+      free(out_buffer);
+    fprintf(stderr, "ERROR : jpegb_decode_file : corrupt JPEGB datastream\n");
+    return(-3);
+  }
+
 
   /* Now we can initialize the JPEG decompression object. */
   jpeg_create_decompress(&cinfo);
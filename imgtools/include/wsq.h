@@ -184,6 +184,110 @@ typedef struct header_frm {
    unsigned short software;
 } FRM_HEADER_WSQ;
 
+/* The wavelet transform applies its filters to several rows or columns */
+/* at a time with SSE2 on x86-64.  Build with -DWSQ_NO_SIMD to use only  */
+/* the scalar code.                                                      */
+#if !defined(WSQ_NO_SIMD) && defined(__x86_64__) && defined(__SSE2__)
+#define WSQ_X86_SIMD
+#endif
+
+/* One filter operation of a subband split or join on a row or column. */
+typedef struct lets_op {
+   int kind;       /* assign, add, or zero */
+   int dst;        /* output sample */
+   int src;        /* input sample */
+   float coef;     /* filter coefficient */
+} LETS_OP;
+
+/* Scratch buffers of the wavelet transform, kept between images so */
+/* that they are only reallocated when an image is larger.          */
+typedef struct wsq_work {
+   float *fdata1;        /* temporary pixmap */
+   int fdata1_alloc;
+   LETS_OP *ops;         /* compiled filter operations */
+   int ops_alloc;
+   int nops;
+   float *tbuf;          /* transposed rows */
+   int tbuf_alloc;
+} WSQ_WORK;
+
+/* Largest reduction of a partial decode, which may give the image at */
+/* 1/2, 1/4, or 1/8 scale, as log2 of the reduction.                 */
+#define WSQ_MAX_DECODE_SCALE  3
+
+/* Huffman table modes of the encoder. */
+#define WSQ_HUFF_ADAPTIVE   0   /* tables built from each image's counts */
+#define WSQ_HUFF_FIXED      1   /* built-in tables, no counting pass */
+
+/* State of one WSQ encode, kept apart from the globals so that */
+/* separate contexts may encode concurrently.                   */
+typedef struct wsq_encoder_ctx {
+   QUANT_VALS quant_vals;
+   W_TREE w_tree[W_TREELEN];
+   Q_TREE q_tree[Q_TREELEN];
+   WSQ_WORK work;
+   int huff_mode;        /* WSQ_HUFF_ADAPTIVE or WSQ_HUFF_FIXED */
+   float *fdata;         /* floating point pixmap */
+   int fdata_alloc;
+   short *qdata;         /* quantized pixmap */
+   int qdata_alloc;
+   int num_threads;      /* threads coding the blocks, 1 = serial, */
+                         /* 0 = one per processor */
+   unsigned char *hdata; /* Huffman coded blocks 2 and 3 */
+   int hdata_alloc;
+} WSQ_ENCODER_CTX;
+
+/* State of one WSQ decode, kept apart from the globals so that */
+/* separate contexts may decode concurrently.                   */
+typedef struct wsq_decoder_ctx {
+   DTT_TABLE dtt_table;
+   DQT_TABLE dqt_table;
+   DHT_TABLE dht_table[MAX_DHT_TABLES];
+   FRM_HEADER_WSQ frm_header_wsq;
+   W_TREE w_tree[W_TREELEN];
+   Q_TREE q_tree[Q_TREELEN];
+   WSQ_WORK work;
+   int num_threads;      /* threads decoding the blocks, 1 = serial, */
+                         /* 0 = one per processor */
+} WSQ_DECODER_CTX;
+
+/* Huffman codes up to this length are resolved with one table lookup. */
+#define HUFF_LOOKUP_BITS_WSQ  10
+#define HUFF_LOOKUP_SIZE_WSQ  (1 << HUFF_LOOKUP_BITS_WSQ)
+
+/* Table-driven Huffman decoder for one block.  Each lookup entry is */
+/* indexed by the next HUFF_LOOKUP_BITS_WSQ bits of the data stream  */
+/* and holds (code length << 8) | huffvalue, or 0 if the code is     */
+/* longer than the table, in which case maxcode, mincode, and valptr */
+/* are walked one bit at a time.                                     */
+typedef struct huff_lookup_wsq {
+   unsigned short lookup[HUFF_LOOKUP_SIZE_WSQ];
+   int maxcode[MAX_HUFFBITS+1];
+   int mincode[MAX_HUFFBITS+1];
+   int valptr[MAX_HUFFBITS+1];
+   unsigned char *huffvalues;
+} HUFF_LOOKUP_WSQ;
+
+/* Bit buffer over a compressed data stream in memory or in a file.  */
+/* Stuffed zeros are removed as bytes are loaded, and loading stops  */
+/* at a marker, which is held until the bits before it are used up.  */
+typedef struct bit_buffer_wsq {
+   unsigned long bits;       /* loaded bits, next bit is bits[nbits-1] */
+   int nbits;                /* number of loaded bits not yet used */
+   unsigned short marker;    /* marker met while loading, or 0 */
+   unsigned char **cbufptr;  /* current byte in input buffer */
+   unsigned char *ebufptr;   /* end of input buffer */
+   FILE *infp;               /* input file, or NULL for a buffer */
+} BIT_BUFFER_WSQ;
+
+/* Running state of count_block() over a block that is counted in */
+/* pieces, such as one subband row at a time.                       */
+typedef struct huff_count_wsq {
+   int *counts;              /* count for each huffman category */
+   unsigned int rcnt;        /* length of current zero run */
+   unsigned int state;       /* COEFF_CODE or RUN_CODE */
+} HUFF_COUNT_WSQ;
+
 /* External global variables. */
 extern int debug;
 extern QUANT_VALS quant_vals;
@@ -195,6 +299,8 @@ extern DHT_TABLE dht_table[];
 extern FRM_HEADER_WSQ frm_header_wsq;
 extern float hifilt[];
 extern float lofilt[];
+extern int fixed_huffcounts1_wsq[];
+extern int fixed_huffcounts2_wsq[];
 
 
 /* External function definitions. */
@@ -203,6 +309,8 @@ extern void quant_block_sizes2(int *, int *, int *, const DQT_TABLE *,
                  W_TREE *, const int, Q_TREE *, const int);
 extern int wsq_crop_qdata(const DQT_TABLE *, Q_TREE *, Q_TREE *, Q_TREE *,
                  short *, int, int, int, int, short *);
+extern int wsq_crop_qdata_trees(const DQT_TABLE *, W_TREE *, Q_TREE *,
+                 Q_TREE *, Q_TREE *, short *, int, int, int, int, short *);
 extern int wsq_cropcoeff_mem(unsigned char **, int *, int *, int *, int, int,
                  int, int, int *, int *, unsigned char *, const int, short **,
                  int *, int *);
@@ -218,10 +326,28 @@ extern int wsq_decode_mem(unsigned char **, int *, int *, int *, int *, int *,
                  unsigned char *, const int);
 extern int wsq_decode_file(unsigned char **, int *, int *, int *, int *,
                  int *, FILE *);
+extern int wsq_decode_mem_ctx(unsigned char **, int *, int *, int *, int *,
+                 int *, unsigned char *, const int, WSQ_DECODER_CTX *);
+extern int wsq_decode_scaled_mem(unsigned char **, int *, int *, int *, int *,
+                 int *, const int, unsigned char *, const int);
+extern int wsq_decode_scaled_mem_ctx(unsigned char **, int *, int *, int *,
+                 int *, int *, const int, unsigned char *, const int,
+                 WSQ_DECODER_CTX *);
+extern int wsq_decode_crop_mem(unsigned char **, int *, int *, int *, int *,
+                 int *, const int, const int, const int, const int,
+                 const int, unsigned char *, const int);
+extern int wsq_decode_crop_mem_ctx(unsigned char **, int *, int *, int *,
+                 int *, int *, const int, const int, const int, const int,
+                 const int, unsigned char *, const int, WSQ_DECODER_CTX *);
+extern int wsq_decode_file_ctx(unsigned char **, int *, int *, int *, int *,
+                 int *, FILE *, WSQ_DECODER_CTX *);
 extern int huffman_decode_data_mem(short *, DTT_TABLE *, DQT_TABLE *,
                  DHT_TABLE *, unsigned char **, unsigned char *);
+extern int huffman_decode_data_mem_ctx(short *, unsigned char **,
+                 unsigned char *, WSQ_DECODER_CTX *);
 extern int huffman_decode_data_file(short *, DTT_TABLE *, DQT_TABLE *,
                  DHT_TABLE *, FILE *);
+extern int huffman_decode_data_file_ctx(short *, FILE *, WSQ_DECODER_CTX *);
 extern int decode_data_mem(int *, int *, int *, int *, unsigned char *,
                  unsigned char **, unsigned char *, int *, unsigned short *);
 extern int decode_data_file(int *, int *, int *, int *, unsigned char *, FILE *,
@@ -230,20 +356,52 @@ extern int nextbits_wsq(unsigned short *, unsigned short *, FILE *, int *,
                  const int);
 extern int getc_nextbits_wsq(unsigned short *, unsigned short *,
                  unsigned char **, unsigned char *, int *, const int);
+extern void gen_lookup_table_wsq(HUFF_LOOKUP_WSQ *, unsigned char *);
+extern void init_bit_buffer_wsq(BIT_BUFFER_WSQ *, unsigned char **,
+                 unsigned char *, FILE *);
+extern int decode_lookup_wsq(int *, unsigned short *, HUFF_LOOKUP_WSQ *,
+                 BIT_BUFFER_WSQ *);
+extern int get_bits_wsq(unsigned short *, BIT_BUFFER_WSQ *, const int);
+extern int alloc_wsq_decoder_ctx(WSQ_DECODER_CTX **);
+extern void free_wsq_decoder_ctx(WSQ_DECODER_CTX *);
 
 /* encoder.c */
 extern int wsq_encode_mem(unsigned char **, int *, const float, unsigned char *,
                  const int, const int, const int, const int, char *);
+extern int wsq_encode_mem_ctx(unsigned char **, int *, const float,
+                 unsigned char *, const int, const int, const int, const int,
+                 char *, WSQ_ENCODER_CTX *);
+extern int alloc_wsq_encoder_ctx(WSQ_ENCODER_CTX **);
+extern void free_wsq_encoder_ctx(WSQ_ENCODER_CTX *);
 extern int gen_hufftable_wsq(HUFFCODE **, unsigned char **, unsigned char **,
                  short *, const int *, const int);
+extern int gen_hufftable_counts_wsq(HUFFCODE **, unsigned char **,
+                 unsigned char **, int *);
 extern int compress_block(unsigned char *, int *, short *,
                  const int, const int, const int, HUFFCODE *);
+extern int compress_block_ex(unsigned char *, int *, const int, short *,
+                 const int, const int, const int, HUFFCODE *);
 extern int count_block(int **, const int, short *,
                  const int, const int, const int);
+extern void init_count_block(HUFF_COUNT_WSQ *, int *);
+extern int count_block_part(HUFF_COUNT_WSQ *, short *, const int,
+                 const int, const int);
+extern int end_count_block(HUFF_COUNT_WSQ *, const int);
 
 /* huff.c */
 extern int check_huffcodes_wsq(HUFFCODE *, int);
 
+/* lets.c */
+extern void init_wsq_work(WSQ_WORK *);
+extern void free_wsq_work(WSQ_WORK *);
+extern int alloc_wsq_work_fdata(WSQ_WORK *, const int);
+extern int get_lets_work(float *, float *, const int, const int, const int,
+                 const int, float *, const int, float *, const int, const int,
+                 WSQ_WORK *);
+extern int join_lets_work(float *, float *, const int, const int, const int,
+                 const int, float *, const int, float *, const int, const int,
+                 WSQ_WORK *);
+
 /* ppi.c */
 extern int read_ppi_wsq(int *, FILE *);
 extern int getc_ppi_wsq(int *, unsigned char *, const int);
@@ -315,6 +473,8 @@ extern void variance( QUANT_VALS *quant_vals, Q_TREE q_tree[], const int,
                  float *, const int, const int);
 extern int quantize(short **, int *, QUANT_VALS *, Q_TREE qtree[], const int,
                  float *, const int, const int);
+extern int quantize_count(short *, int *, QUANT_VALS *, Q_TREE qtree[],
+                 const int, float *, const int, const int, int *, int *);
 extern void quant_block_sizes(int *, int *, int *,
                  QUANT_VALS *, W_TREE w_tree[], const int,
                  Q_TREE q_tree[], const int);
@@ -323,10 +483,19 @@ extern int unquantize(float **, const DQT_TABLE *,
 extern int wsq_decompose(float *, const int, const int,
                  W_TREE w_tree[], const int, float *, const int,
                  float *, const int);
+extern int wsq_decompose_work(float *, const int, const int,
+                 W_TREE w_tree[], const int, float *, const int,
+                 float *, const int, WSQ_WORK *);
 extern void get_lets(float *, float *, const int, const int, const int,
                  const int, float *, const int, float *, const int, const int);
 extern int wsq_reconstruct(float *, const int, const int,
                  W_TREE w_tree[], const int, const DTT_TABLE *);
+extern int wsq_reconstruct_work(float *, const int, const int,
+                 W_TREE w_tree[], const int, const DTT_TABLE *, WSQ_WORK *);
+extern int wsq_scaled_node(const int);
+extern int wsq_reconstruct_scaled_work(float *, const int, const int,
+                 W_TREE w_tree[], const int, const DTT_TABLE *, const int,
+                 WSQ_WORK *);
 extern void  join_lets(float *, float *, const int, const int,
                  const int, const int, float *, const int,
                  float *, const int, const int);
@@ -0,0 +1,462 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/************************************************************************
+
+      PACKAGE:  IMAGE ENCODER/DECODER TOOLS
+
+      FILE:     WSQCHECK.C
+
+#cat: wsqcheck - Checks that the WSQ encoder codes the same images with
+#cat:            the built-in Huffman tables (WSQ_HUFF_FIXED) as with
+#cat:            tables made for each image, and that coding the blocks
+#cat:            on several threads gives the same bytes as coding them
+#cat:            on one.  Synthetic images from 32x32 to 512x512, with
+#cat:            ridges or noise, are coded at low to high bitrates, as
+#cat:            is any WSQ file given after it is decoded.  Every
+#cat:            coding must succeed, decode, and hold the quantized
+#cat:            coefficients exactly.  Images at least 256 pixels on
+#cat:            a side are also decoded at 1/2 to 1/8 scale and for a
+#cat:            crop region, which must match the whole decoding.
+#cat:            Exits with 1 if any check fails.
+
+*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <wsq.h>
+#include <dataio.h>
+#include <version.h>
+
+#define CHECK_THREADS  3     /* threads used for the multi-threaded codings */
+#define CHECK_MIN_DIM  256   /* smallest side of the images decoded at scale */
+
+#define IMG_RIDGES  0
+#define IMG_NOISE   1
+
+/* A synthetic image and the bitrate to code it at. */
+typedef struct check_case {
+   int w, h;
+   int kind;
+   float r_bitrate;
+} CHECK_CASE;
+
+/* The smallest and odd sizes give the headers the most weight, the */
+/* largest and noisiest the most coded coefficients.  With tables   */
+/* made for the image, the encoder refuses to code it to more bytes  */
+/* than it has pixels, which small noise images at high bitrates     */
+/* would need.                                                       */
+static CHECK_CASE check_cases[] = {
+   {  32,  32, IMG_RIDGES, 0.75}, {  32,  32, IMG_RIDGES, 2.25},
+   {  32,  32, IMG_RIDGES, 6.0 }, {  32,  32, IMG_NOISE,  0.75},
+   {  32,  32, IMG_NOISE,  2.25}, {  33,  37, IMG_RIDGES, 0.75},
+   {  33,  37, IMG_RIDGES, 2.25}, {  33,  37, IMG_RIDGES, 6.0 },
+   {  33,  37, IMG_NOISE,  0.75}, {  33,  37, IMG_NOISE,  2.25},
+   {  64,  48, IMG_RIDGES, 0.75}, {  64,  48, IMG_RIDGES, 2.25},
+   {  64,  48, IMG_RIDGES, 6.0 }, {  64,  48, IMG_NOISE,  2.25},
+   { 256, 256, IMG_RIDGES, 6.0 }, { 256, 256, IMG_NOISE,  6.0 },
+   { 512, 512, IMG_RIDGES, 0.75}, { 512, 512, IMG_RIDGES, 2.25},
+   { 512, 512, IMG_RIDGES, 6.0 }, { 512, 512, IMG_NOISE,  0.75},
+   { 512, 512, IMG_NOISE,  2.25}, { 512, 512, IMG_NOISE,  6.0 }
+};
+#define NUM_CHECK_CASES  ((int)(sizeof(check_cases) / sizeof(check_cases[0])))
+
+/* Bitrates the WSQ files given are coded at. */
+static float check_rates[] = { 0.75, 2.25, 6.0 };
+#define NUM_CHECK_RATES  ((int)(sizeof(check_rates) / sizeof(check_rates[0])))
+
+void make_image(unsigned char *, const int, const int, const int);
+int check_image(char *, unsigned char *, const int, const int,
+                const float, WSQ_ENCODER_CTX *);
+int encode_check(unsigned char **, int *, char *, const char *,
+                 const float, unsigned char *, const int, const int,
+                 WSQ_ENCODER_CTX *, const int, const int);
+int decode_check(char *, const float, unsigned char *, const int,
+                 const int, const int);
+int read_wsq_file(char *, unsigned char **, int *, int *);
+
+/* Contols globally, the level of debug reporting */
+/* in this application. */
+int debug = 0;
+
+/******************/
+/*Start of Program*/
+/******************/
+
+int main(int argc, char *argv[])
+{
+   WSQ_ENCODER_CTX *ctx;
+   unsigned char *idata;
+   char name[80];
+   CHECK_CASE *c;
+   int i, r, w, h, ret, ncases, nfailed;
+
+   if((argc == 2) && (strcmp(argv[1], "-version") == 0)){
+      getVersion();
+      exit(0);
+   }
+   if((argc > 1) && (argv[1][0] == '-')){
+      fprintf(stderr, "Usage: %s [file.wsq ...]\n", argv[0]);
+      exit(-1);
+   }
+
+   if((ret = alloc_wsq_encoder_ctx(&ctx)))
+      exit(ret);
+
+   ncases = 0;
+   nfailed = 0;
+
+   /* Synthetic images. */
+   for(i = 0; i < NUM_CHECK_CASES; i++){
+      c = &check_cases[i];
+      idata = (unsigned char *)malloc(c->w * c->h);
+      if(idata == (unsigned char *)NULL){
+         fprintf(stderr, "ERROR : main : malloc : idata\n");
+         exit(-2);
+      }
+      make_image(idata, c->w, c->h, c->kind);
+      sprintf(name, "%dx%d %s", c->w, c->h,
+              (c->kind == IMG_NOISE) ? "noise" : "ridges");
+      ncases++;
+      if(check_image(name, idata, c->w, c->h, c->r_bitrate, ctx))
+         nfailed++;
+      free(idata);
+   }
+
+   /* Any WSQ files given, decoded and coded again. */
+   for(i = 1; i < argc; i++){
+      if((ret = read_wsq_file(argv[i], &idata, &w, &h)))
+         exit(ret);
+      for(r = 0; r < NUM_CHECK_RATES; r++){
+         ncases++;
+         if(check_image(argv[i], idata, w, h, check_rates[r], ctx))
+            nfailed++;
+      }
+      free(idata);
+   }
+
+   free_wsq_encoder_ctx(ctx);
+
+   printf("%d images and bitrates checked, %d failed\n", ncases, nfailed);
+   exit(nfailed ? 1 : 0);
+}
+
+/*****************************************************************/
+/* Fills a w x h pixmap with ridges, which code much as a finger */
+/* does, or with uniform noise, which codes to the most bytes.   */
+/*****************************************************************/
+void make_image(unsigned char *idata, const int w, const int h,
+                const int kind)
+{
+   int x, y;
+   unsigned long seed = 12345;
+   double v;
+
+   for(y = 0; y < h; y++){
+      for(x = 0; x < w; x++){
+         if(kind == IMG_NOISE){
+            seed = seed * 1103515245 + 12345;
+            idata[y * w + x] = (unsigned char)((seed >> 16) & 0xFF);
+         }
+         else{
+            v = sin((x * 0.9 + y * 0.4) * 0.35 + 0.002 * x * y);
+            idata[y * w + x] = (unsigned char)(128.0 + 100.0 * v);
+         }
+      }
+   }
+}
+
+/*****************************************************************/
+/* Codes an image with each table mode, on one thread and on     */
+/* several, and checks that every coding succeeds and holds the  */
+/* quantized coefficients, and that the two codings in each mode */
+/* are the same.  Returns non-zero, after reporting why, if not. */
+/*****************************************************************/
+int check_image(char *name, unsigned char *idata, const int w,
+                const int h, const float r_bitrate, WSQ_ENCODER_CTX *ctx)
+{
+   unsigned char *odata[2][2];
+   int olen[2][2];
+   int mode, mt, failed;
+   static char *modes[2] = { "adaptive", "fixed" };
+
+   failed = 0;
+   for(mode = 0; mode < 2; mode++){
+      for(mt = 0; mt < 2; mt++){
+         odata[mode][mt] = (unsigned char *)NULL;
+         if(encode_check(&odata[mode][mt], &olen[mode][mt], name,
+                         modes[mode], r_bitrate, idata, w, h, ctx,
+                         mode ? WSQ_HUFF_FIXED : WSQ_HUFF_ADAPTIVE,
+                         mt ? CHECK_THREADS : 1))
+            failed = 1;
+      }
+   }
+
+   for(mode = 0; mode < 2 && !failed; mode++){
+      if((olen[mode][0] != olen[mode][1]) ||
+         memcmp(odata[mode][0], odata[mode][1], olen[mode][0])){
+         printf("%s @ %.2f : %s : %d threads coded other bytes than 1\n",
+                name, r_bitrate, modes[mode], CHECK_THREADS);
+         failed = 1;
+      }
+   }
+
+   /* Table mode and threads do not change how the image decodes.  */
+   /* Smaller images have subbands of 4 samples or fewer, which the */
+   /* reconstruction filter reads past, so their pixels depend on   */
+   /* scratch memory and cannot be compared between decodings.      */
+   if(!failed && (w >= CHECK_MIN_DIM) && (h >= CHECK_MIN_DIM) &&
+      decode_check(name, r_bitrate, odata[0][0], olen[0][0], w, h))
+      failed = 1;
+
+   if(debug > 0 && !failed)
+      printf("%s @ %.2f : adaptive %d bytes, fixed %d bytes\n",
+             name, r_bitrate, olen[0][0], olen[1][0]);
+
+   for(mode = 0; mode < 2; mode++){
+      for(mt = 0; mt < 2; mt++){
+         if(odata[mode][mt] != (unsigned char *)NULL)
+            free(odata[mode][mt]);
+      }
+   }
+
+   return(failed);
+}
+
+/*****************************************************************/
+/* Codes an image in the given table mode and on the given       */
+/* number of threads, then decodes the coded blocks and the      */
+/* image.  Returns non-zero, after reporting the error, if any   */
+/* step fails, if the blocks do not hold the coefficients the    */
+/* encoder quantized, or if the image is not the original size.  */
+/*****************************************************************/
+int encode_check(unsigned char **odata, int *olen, char *name,
+                 const char *mode_name, const float r_bitrate,
+                 unsigned char *idata, const int w, const int h,
+                 WSQ_ENCODER_CTX *ctx, const int huff_mode,
+                 const int num_threads)
+{
+   int ret, dw, dh, dd, dppi, lossy;
+   int qsize1, qsize2, qsize3, hgt_pos, huff_pos;
+   double scale, shift;
+   short *qdata;
+   unsigned char *ddata;
+
+   ctx->huff_mode = huff_mode;
+   ctx->num_threads = num_threads;
+   if((ret = wsq_encode_mem_ctx(odata, olen, r_bitrate, idata, w, h, 8, -1,
+                                (char *)NULL, ctx))){
+      *odata = (unsigned char *)NULL;
+      printf("%s @ %.2f : %s, %d threads : encode failed (%d)\n",
+             name, r_bitrate, mode_name, num_threads, ret);
+      return(1);
+   }
+
+   /* The Huffman coded blocks must give back what was quantized. */
+   if((ret = wsq_dehuff_mem(&qdata, &dw, &dh, &scale, &shift,
+                            &hgt_pos, &huff_pos, *odata, *olen))){
+      printf("%s @ %.2f : %s, %d threads : Huffman decode failed (%d)\n",
+             name, r_bitrate, mode_name, num_threads, ret);
+      return(1);
+   }
+   quant_block_sizes(&qsize1, &qsize2, &qsize3, &ctx->quant_vals,
+                     ctx->w_tree, W_TREELEN, ctx->q_tree, Q_TREELEN);
+   if(memcmp(qdata, ctx->qdata,
+             (qsize1 + qsize2 + qsize3) * sizeof(short))){
+      printf("%s @ %.2f : %s, %d threads : coefficients differ\n",
+             name, r_bitrate, mode_name, num_threads);
+      free(qdata);
+      return(1);
+   }
+   free(qdata);
+
+   if((ret = wsq_decode_mem(&ddata, &dw, &dh, &dd, &dppi, &lossy,
+                            *odata, *olen))){
+      printf("%s @ %.2f : %s, %d threads : decode failed (%d)\n",
+             name, r_bitrate, mode_name, num_threads, ret);
+      return(1);
+   }
+   free(ddata);
+   if((dw != w) || (dh != h) || (dd != 8)){
+      printf("%s @ %.2f : %s, %d threads : decoded %dx%dx%d\n",
+             name, r_bitrate, mode_name, num_threads, dw, dh, dd);
+      return(1);
+   }
+
+   return(0);
+}
+
+/*****************************************************************/
+/* Decodes a coded image at each scale from full size to 1/8,    */
+/* whole and for a region just below and right of its center,    */
+/* small enough that the decoder crops the coefficients of large */
+/* images.  Checks that the full size image is that of           */
+/* wsq_decode_mem(), that each image is the size of the original */
+/* reduced by the scale, and that each region holds the same     */
+/* pixels as the whole image at its scale.  Returns non-zero,    */
+/* after reporting why, if not.                                  */
+/*****************************************************************/
+int decode_check(char *name, const float r_bitrate,
+                 unsigned char *wsq_data, const int wsq_len,
+                 const int w, const int h)
+{
+   unsigned char *full, *sdata, *cdata;
+   int ret, scale, row, failed;
+   int fw, fh, sw, sh, cw, ch, d, ppi, lossy;
+   int ulx, uly, lrx, lry, sx, sy, ew, eh;
+
+   if((ret = wsq_decode_mem(&full, &fw, &fh, &d, &ppi, &lossy,
+                            wsq_data, wsq_len))){
+      printf("%s @ %.2f : decode failed (%d)\n", name, r_bitrate, ret);
+      return(1);
+   }
+
+   ulx = w / 2;
+   uly = h / 2;
+   lrx = ulx + (w / 8);
+   lry = uly + (h / 8);
+
+   failed = 0;
+   for(scale = 0; scale <= WSQ_MAX_DECODE_SCALE && !failed; scale++){
+      if((ret = wsq_decode_scaled_mem(&sdata, &sw, &sh, &d, &ppi, &lossy,
+                                      scale, wsq_data, wsq_len))){
+         printf("%s @ %.2f : 1/%d scale : decode failed (%d)\n",
+                name, r_bitrate, 1 << scale, ret);
+         failed = 1;
+         break;
+      }
+      ew = (w + (1 << scale) - 1) >> scale;
+      eh = (h + (1 << scale) - 1) >> scale;
+      if((sw != ew) || (sh != eh)){
+         printf("%s @ %.2f : 1/%d scale : decoded %dx%d, not %dx%d\n",
+                name, r_bitrate, 1 << scale, sw, sh, ew, eh);
+         failed = 1;
+      }
+      else if((scale == 0) && memcmp(sdata, full, w * h)){
+         printf("%s @ %.2f : full scale : pixels differ from ",
+                name, r_bitrate);
+         printf("wsq_decode_mem()\n");
+         failed = 1;
+      }
+
+      if(!failed){
+         if((ret = wsq_decode_crop_mem(&cdata, &cw, &ch, &d, &ppi, &lossy,
+                                       ulx, uly, lrx, lry, scale,
+                                       wsq_data, wsq_len))){
+            printf("%s @ %.2f : 1/%d scale : crop decode failed (%d)\n",
+                   name, r_bitrate, 1 << scale, ret);
+            failed = 1;
+         }
+         else{
+            sx = ulx >> scale;
+            sy = uly >> scale;
+            ew = ((lrx + (1 << scale) - 1) >> scale) - sx;
+            eh = ((lry + (1 << scale) - 1) >> scale) - sy;
+            if((cw != ew) || (ch != eh)){
+               printf("%s @ %.2f : 1/%d scale : cropped %dx%d, not %dx%d\n",
+                      name, r_bitrate, 1 << scale, cw, ch, ew, eh);
+               failed = 1;
+            }
+            for(row = 0; row < ch && !failed; row++){
+               if(memcmp(cdata + (row * cw),
+                         sdata + ((sy + row) * sw) + sx, cw)){
+                  printf("%s @ %.2f : 1/%d scale : crop row %d differs\n",
+                         name, r_bitrate, 1 << scale, row);
+                  failed = 1;
+               }
+            }
+            free(cdata);
+         }
+      }
+      free(sdata);
+   }
+
+   free(full);
+   return(failed);
+}
+
+/*****************************************************************/
+/* Reads and decodes a WSQ file.                                 */
+/*****************************************************************/
+int read_wsq_file(char *file, unsigned char **oidata, int *ow, int *oh)
+{
+   FILE *fp;
+   unsigned char *wsq_data;
+   long len;
+   int ret, d, ppi, lossy;
+
+   if((fp = fopen(file, "rb")) == (FILE *)NULL){
+      fprintf(stderr, "ERROR : read_wsq_file : fopen : %s\n", file);
+      return(-3);
+   }
+   fseek(fp, 0L, SEEK_END);
+   len = ftell(fp);
+   rewind(fp);
+   wsq_data = (unsigned char *)malloc(len);
+   if(wsq_data == (unsigned char *)NULL){
+      fprintf(stderr, "ERROR : read_wsq_file : malloc : wsq_data\n");
+      fclose(fp);
+      return(-4);
+   }
+   if(fread(wsq_data, 1, len, fp) != (size_t)len){
+      fprintf(stderr, "ERROR : read_wsq_file : fread : %s\n", file);
+      free(wsq_data);
+      fclose(fp);
+      return(-5);
+   }
+   fclose(fp);
+
+   ret = wsq_decode_mem(oidata, ow, oh, &d, &ppi, &lossy, wsq_data, len);
+   free(wsq_data);
+   if(ret)
+      return(ret);
+   if(d != 8){
+      fprintf(stderr, "ERROR : read_wsq_file : %s : depth %d != 8\n",
+              file, d);
+      free(*oidata);
+      return(-6);
+   }
+   return(0);
+}
@@ -43,6 +43,9 @@ http://www.mitre.org/work/tech_papers/tech_papers_08/08_0060/index.html
 #cat:                pointer rather than QUANT_VALS.
 #cat:                I.e. no rate control is performed in this version.
 #cat: wsq_crop_qdata - Crop quantized coeff structures.
+#cat: wsq_crop_qdata_trees - Same as wsq_crop_qdata, but builds the
+#cat:                cropped wavelet tree in the given w_tree rather
+#cat:                than in the global one.
 #cat: wsq_cropcoeff_mem - Crops input buffer of WSQ compressed bytes
 #cat:                into output WSQ buffer, by eliminating unneeded 
 #cat:                wavelet coefficients. First call (NULL output,
@@ -133,6 +136,28 @@ int wsq_crop_qdata(
    int width,            /* Crop region width */
    int height,           /* Crop region height */
    short *scp)           /* Cropped quantized data pointer       */
+{
+   return(wsq_crop_qdata_trees(dqt_table, w_tree, q_tree, q_tree2, q_tree3,
+                               sip, ulx, uly, width, height, scp));
+}
+
+/*****************************************************************/
+/* Same as wsq_crop_qdata(), but the wavelet tree of the crop    */
+/* region is left in the w_tree given, such as a decoder         */
+/* context's, rather than in the global w_tree.                  */
+/*****************************************************************/
+int wsq_crop_qdata_trees(
+   const DQT_TABLE *dqt_table, /* quantization table structure   */
+   W_TREE w_tree[],      /* Returned wavelet tree of crop region */
+   Q_TREE q_tree[], 
+   Q_TREE q_tree2[],
+   Q_TREE q_tree3[],
+   short *sip,           /* Original quantized data pointer      */
+   int ulx,              /* UL corner col */
+   int uly,              /* UL corner row */
+   int width,            /* Crop region width */
+   int height,           /* Crop region height */
+   short *scp)           /* Cropped quantized data pointer       */
 {
    int row, col;  /* cover counter and row/column counters */
    short *cptr;   /* image pointers */
@@ -61,10 +61,30 @@ of the software.
 #cat: wsq_decode_file - Decodes a datastream of WSQ compressed bytes
 #cat:                  from an open file, returning a lossy
 #cat:                  reconstructed pixmap.
+#cat: wsq_decode_mem_ctx - Same as wsq_decode_mem(), but keeps its
+#cat:                  tables in a decoder context, not in globals.
+#cat: wsq_decode_file_ctx - Same as wsq_decode_file(), but keeps its
+#cat:                  tables in a decoder context, not in globals.
+#cat: wsq_decode_scaled_mem - Decodes a WSQ datastream from a memory
+#cat:                  buffer to a 1/2, 1/4, or 1/8 scale pixmap.
+#cat: wsq_decode_scaled_mem_ctx - Same as wsq_decode_scaled_mem(), using
+#cat:                  a decoder context.
+#cat: wsq_decode_crop_mem - Decodes a region of a WSQ datastream from a
+#cat:                  memory buffer, optionally at a reduced scale.
+#cat: wsq_decode_crop_mem_ctx - Same as wsq_decode_crop_mem(), using
+#cat:                  a decoder context.
+#cat: alloc_wsq_decoder_ctx - Allocates and initializes a decoder context.
+#cat:
+#cat: free_wsq_decoder_ctx - Deallocates a decoder context.
+#cat:
 #cat: huffman_decode_data_mem - Decodes a block of huffman encoded
 #cat:                  data from a memory buffer.
+#cat: huffman_decode_data_mem_ctx - Decodes a block of huffman encoded
+#cat:                  data from a memory buffer using a decoder context.
 #cat: huffman_decode_data_file - Decodes a block of huffman encoded
 #cat:                  data from an open file.
+#cat: huffman_decode_data_file_ctx - Decodes a block of huffman encoded
+#cat:                  data from an open file using a decoder context.
 #cat: decode_data_mem - Decodes huffman encoded data from a memory buffer.
 #cat:
 #cat: decode_data_file - Decodes huffman encoded data from an open file.
@@ -73,12 +93,54 @@ of the software.
 #cat:                    an open file.
 #cat: getc_nextbits_wsq - Gets next sequence of bits for data decoding
 #cat:                    from a memory buffer.
+#cat: gen_lookup_table_wsq - Builds the table used to decode huffman
+#cat:                    codes several bits at a time.
+#cat: init_bit_buffer_wsq - Starts a bit buffer over a memory buffer or
+#cat:                    an open file.
+#cat: decode_lookup_wsq - Decodes the next huffman code from a bit buffer
+#cat:                    using a lookup table.
+#cat: get_bits_wsq - Gets next sequence of bits from a bit buffer.
 
 ***********************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include <wsq.h>
 #include <dataio.h>
+#include <util.h>
+
+/* Pixels of coefficients kept beyond each side of a cropped region, */
+/* enough that the filters' edge effects at the sides of the kept box */
+/* do not reach the region through the five levels of decomposition.  */
+#define WSQ_CROP_MARGIN  128
+
+/* A block of encoded data located by locate_blocks_mem(), to be */
+/* decoded by decode_block_job().                                  */
+typedef struct wsq_decode_job {
+   unsigned char *cbufptr;   /* first byte of the block's coded data */
+   unsigned char *ebufptr;   /* end of input buffer */
+   unsigned short marker;    /* marker that ends the block */
+   HUFF_LOOKUP_WSQ lut;      /* used in decoding the block */
+   unsigned char huffvalues[MAX_HUFFCOUNTS_WSQ+1];
+   short *ip;                /* where the block is decoded to */
+   int size;                 /* number of coefficients in the block */
+} WSQ_DECODE_JOB;
+
+static void free_decoder_ctx_filters(WSQ_DECODER_CTX *);
+static void set_decoder_globals(WSQ_DECODER_CTX *);
+static int read_header_mem_ctx(int *, unsigned char **, unsigned char *,
+                 unsigned char *, const int, WSQ_DECODER_CTX *);
+static int decode_region_mem_ctx(unsigned char **, int *, int *, int *,
+                 int *, int *, const int, int, int, int, int, const int,
+                 unsigned char *, const int, WSQ_DECODER_CTX *, const char *);
+static int huffman_decode_blocks_mem(short *, DTT_TABLE *, DQT_TABLE *,
+                 DHT_TABLE *, FRM_HEADER_WSQ *, Q_TREE [],
+                 unsigned char **, unsigned char *, const int);
+static int huffman_decode_blocks_mt(short *, unsigned char **,
+                 unsigned char *, WSQ_DECODER_CTX *, const int);
+static int locate_blocks_mem(WSQ_DECODE_JOB *, int *, unsigned char **,
+                 unsigned char *, WSQ_DECODER_CTX *);
+static int decode_block_job(void *, const int, const int);
 
 /************************************************************************/
 /*              This is an implementation based on the Crinimal         */
@@ -92,8 +154,30 @@ of the software.
 int wsq_decode_mem(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
                    int *lossyflag, unsigned char *idata, const int ilen)
 {
-   int ret, i;
-   unsigned short marker;         /* WSQ marker */
+   int ret;
+   WSQ_DECODER_CTX *ctx;
+
+   if((ret = alloc_wsq_decoder_ctx(&ctx)))
+      return(ret);
+
+   ret = wsq_decode_mem_ctx(odata, ow, oh, od, oppi, lossyflag,
+                            idata, ilen, ctx);
+
+   set_decoder_globals(ctx);
+   free_wsq_decoder_ctx(ctx);
+   return(ret);
+}
+
+/***************************************************************************/
+/* Same as wsq_decode_mem(), but keeps the tables, frame header, and trees */
+/* in a decoder context instead of the globals, so separate contexts may   */
+/* decode concurrently.                                                    */
+/***************************************************************************/
+int wsq_decode_mem_ctx(unsigned char **odata, int *ow, int *oh, int *od,
+                   int *oppi, int *lossyflag, unsigned char *idata,
+                   const int ilen, WSQ_DECODER_CTX *ctx)
+{
+   int ret;
    int num_pix;                   /* image size and counter */
    int width, height, ppi;        /* image parameters */
    unsigned char *cdata;          /* image pointer */
@@ -102,51 +186,138 @@ int wsq_decode_mem(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
    unsigned char *cbufptr;        /* points to current byte in buffer */
    unsigned char *ebufptr;        /* points to end of buffer */
 
-   /* Added by MDG on 02-24-05 */
-   init_wsq_decoder_resources();
-
    /* Set memory buffer pointers. */
    cbufptr = idata;
    ebufptr = idata + ilen;
 
+   /* Read the tables and frame header, and build the trees. */
+   if((ret = read_header_mem_ctx(&ppi, &cbufptr, ebufptr, idata, ilen, ctx)))
+      return(ret);
+   width = ctx->frm_header_wsq.width;
+   height = ctx->frm_header_wsq.height;
+   num_pix = width * height;
+
+   /* Allocate working memory. */
+   qdata = (short *) malloc(num_pix * sizeof(short));
+   if(qdata == (short *)NULL) {
+      fprintf(stderr,"ERROR: wsq_decode_mem : malloc : qdata1\n");
+      free_decoder_ctx_filters(ctx);
+      return(-20);
+   }
+   /* Decode the Huffman encoded data blocks. */
+   if((ret = huffman_decode_data_mem_ctx(qdata, &cbufptr, ebufptr, ctx))){
+      free(qdata);
+      free_decoder_ctx_filters(ctx);
+      return(ret);
+   }
+
+   if(debug > 0)
+      fprintf(stderr,
+         "Quantized WSQ subband data blocks read and Huffman decoded\n\n");
+
+   /* Decode the quantize wavelet subband data. */
+   if((ret = unquantize(&fdata, &ctx->dqt_table, ctx->q_tree, Q_TREELEN,
+                         qdata, width, height))){
+      free(qdata);
+      free_decoder_ctx_filters(ctx);
+      return(ret);
+   }
+
+   if(debug > 0)
+      fprintf(stderr, "WSQ subband data blocks unquantized\n\n");
+
+   /* Done with quantized wavelet subband data. */
+   free(qdata);
+
+   if((ret = wsq_reconstruct_work(fdata, width, height, ctx->w_tree,
+                              W_TREELEN, &ctx->dtt_table, &ctx->work))){
+      free(fdata);
+      free_decoder_ctx_filters(ctx);
+      return(ret);
+   }
+
+   if(debug > 0)
+      fprintf(stderr, "WSQ reconstruction of image finished\n\n");
+
+   cdata = (unsigned char *)malloc(num_pix * sizeof(unsigned char));
+   if(cdata == (unsigned char *)NULL) {
+      free(fdata);
+      free_decoder_ctx_filters(ctx);
+      fprintf(stderr,"ERROR: wsq_decode_mem : malloc : cdata\n");
+      return(-21);
+   }
+
+   /* Convert floating point pixels to unsigned char pixels. */
+   conv_img_2_uchar(cdata, fdata, width, height,
+                      ctx->frm_header_wsq.m_shift, ctx->frm_header_wsq.r_scale);
+
+   /* Done with floating point pixels. */
+   free(fdata);
+
+   free_decoder_ctx_filters(ctx);
+
+   if(debug > 0)
+      fprintf(stderr, "Doubleing point pixels converted to unsigned char\n\n");
+
+   /* Assign reconstructed pixmap and attributes to output pointers. */
+   *odata = cdata;
+   *ow = width;
+   *oh = height;
+   *od = 8;
+   *oppi = ppi;
+   *lossyflag = 1;
+
+   /* Return normally. */
+   return(0);
+}
+
+/***************************************************************************/
+/* Reads the SOI marker, the tables, and the frame header of a WSQ         */
+/* datastream in memory into a decoder context, and builds the context's   */
+/* decomposition trees.  On return, cbufptr points past the frame header.  */
+/***************************************************************************/
+static int read_header_mem_ctx(int *oppi, unsigned char **cbufptr,
+                   unsigned char *ebufptr, unsigned char *idata,
+                   const int ilen, WSQ_DECODER_CTX *ctx)
+{
+   int ret, i;
+   unsigned short marker;         /* WSQ marker */
+
    /* Init DHT Tables to 0. */
    for(i = 0; i < MAX_DHT_TABLES; i++)
-      (dht_table + i)->tabdef = 0;
+      (ctx->dht_table + i)->tabdef = 0;
 
    /* Read the SOI marker. */
-   if((ret = getc_marker_wsq(&marker, SOI_WSQ, &cbufptr, ebufptr))){
-      free_wsq_decoder_resources();
+   if((ret = getc_marker_wsq(&marker, SOI_WSQ, cbufptr, ebufptr))){
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
 
    /* Read in supporting tables up to the SOF marker. */
-   if((ret = getc_marker_wsq(&marker, TBLS_N_SOF, &cbufptr, ebufptr))){
-      free_wsq_decoder_resources();
+   if((ret = getc_marker_wsq(&marker, TBLS_N_SOF, cbufptr, ebufptr))){
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
    while(marker != SOF_WSQ) {
-      if((ret = getc_table_wsq(marker, &dtt_table, &dqt_table, dht_table,
-                          &cbufptr, ebufptr))){
-         free_wsq_decoder_resources();
+      if((ret = getc_table_wsq(marker, &ctx->dtt_table, &ctx->dqt_table, ctx->dht_table,
+                          cbufptr, ebufptr))){
+         free_decoder_ctx_filters(ctx);
          return(ret);
       }
-      if((ret = getc_marker_wsq(&marker, TBLS_N_SOF, &cbufptr, ebufptr))){
-         free_wsq_decoder_resources();
+      if((ret = getc_marker_wsq(&marker, TBLS_N_SOF, cbufptr, ebufptr))){
+         free_decoder_ctx_filters(ctx);
          return(ret);
       }
    }
 
    /* Read in the Frame Header. */
-   if((ret = getc_frame_header_wsq(&frm_header_wsq, &cbufptr, ebufptr))){
-      free_wsq_decoder_resources();
+   if((ret = getc_frame_header_wsq(&ctx->frm_header_wsq, cbufptr, ebufptr))){
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
-   width = frm_header_wsq.width;
-   height = frm_header_wsq.height;
-   num_pix = width * height;
 
-   if((ret = getc_ppi_wsq(&ppi, idata, ilen))){
-      free_wsq_decoder_resources();
+   if((ret = getc_ppi_wsq(oppi, idata, ilen))){
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
 
@@ -154,81 +325,271 @@ int wsq_decode_mem(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
       fprintf(stderr, "SOI, tables, and frame header read\n\n");
 
    /* Build WSQ decomposition trees. */
-   build_wsq_trees(w_tree, W_TREELEN, q_tree, Q_TREELEN, width, height);
+   build_wsq_trees(ctx->w_tree, W_TREELEN, ctx->q_tree, Q_TREELEN,
+                   ctx->frm_header_wsq.width, ctx->frm_header_wsq.height);
 
    if(debug > 0)
       fprintf(stderr, "Tables for wavelet decomposition finished\n\n");
 
-   /* Allocate working memory. */
-   qdata = (short *) malloc(num_pix * sizeof(short));
+   return(0);
+}
+
+/***************************************************************************/
+/* Same as wsq_decode_mem_ctx(), but stops the wavelet reconstruction     */
+/* early, returning the image reduced by 2^scale in each direction, for   */
+/* a scale of 0 (full size) up to WSQ_MAX_DECODE_SCALE (1/8 size).  Only  */
+/* the blocks of encoded data that hold the subbands needed at that scale */
+/* are Huffman decoded.  The ppi returned is reduced to match.            */
+/***************************************************************************/
+int wsq_decode_scaled_mem_ctx(unsigned char **odata, int *ow, int *oh,
+                   int *od, int *oppi, int *lossyflag, const int scale,
+                   unsigned char *idata, const int ilen, WSQ_DECODER_CTX *ctx)
+{
+   return(decode_region_mem_ctx(odata, ow, oh, od, oppi, lossyflag,
+                                0, 0, 0, 0, 0, scale, idata, ilen, ctx,
+                                "wsq_decode_scaled_mem"));
+}
+
+/***************************************************************************/
+/* Same as wsq_decode_scaled_mem_ctx(), but returns only the pixels of    */
+/* the full size image from (ulx,uly) up to, but not including, the lower */
+/* right corner (lrx,lry), reduced by 2^scale.  The box is clipped to the */
+/* image.  The quantized coefficients are cropped to a box around the     */
+/* region before they are unquantized and joined, so the cost of the      */
+/* reconstruction follows the size of the region, not of the image.       */
+/***************************************************************************/
+int wsq_decode_crop_mem_ctx(unsigned char **odata, int *ow, int *oh,
+                   int *od, int *oppi, int *lossyflag,
+                   const int ulx, const int uly, const int lrx, const int lry,
+                   const int scale, unsigned char *idata, const int ilen,
+                   WSQ_DECODER_CTX *ctx)
+{
+   return(decode_region_mem_ctx(odata, ow, oh, od, oppi, lossyflag,
+                                1, ulx, uly, lrx, lry, scale, idata, ilen, ctx,
+                                "wsq_decode_crop_mem"));
+}
+
+/***************************************************************************/
+/* Same as wsq_decode_scaled_mem_ctx(), using the global tables.           */
+/***************************************************************************/
+int wsq_decode_scaled_mem(unsigned char **odata, int *ow, int *oh, int *od,
+                   int *oppi, int *lossyflag, const int scale,
+                   unsigned char *idata, const int ilen)
+{
+   int ret;
+   WSQ_DECODER_CTX *ctx;
+
+   if((ret = alloc_wsq_decoder_ctx(&ctx)))
+      return(ret);
+
+   ret = wsq_decode_scaled_mem_ctx(odata, ow, oh, od, oppi, lossyflag,
+                                   scale, idata, ilen, ctx);
+
+   set_decoder_globals(ctx);
+   free_wsq_decoder_ctx(ctx);
+   return(ret);
+}
+
+/***************************************************************************/
+/* Same as wsq_decode_crop_mem_ctx(), using the global tables.             */
+/***************************************************************************/
+int wsq_decode_crop_mem(unsigned char **odata, int *ow, int *oh, int *od,
+                   int *oppi, int *lossyflag,
+                   const int ulx, const int uly, const int lrx, const int lry,
+                   const int scale, unsigned char *idata, const int ilen)
+{
+   int ret;
+   WSQ_DECODER_CTX *ctx;
+
+   if((ret = alloc_wsq_decoder_ctx(&ctx)))
+      return(ret);
+
+   ret = wsq_decode_crop_mem_ctx(odata, ow, oh, od, oppi, lossyflag,
+                                 ulx, uly, lrx, lry, scale, idata, ilen, ctx);
+
+   set_decoder_globals(ctx);
+   free_wsq_decoder_ctx(ctx);
+   return(ret);
+}
+
+/***************************************************************************/
+/* Decodes a region of a WSQ datastream in memory at a reduced scale.  If */
+/* crop is zero, the region is the whole image.  Error messages name the  */
+/* public routine given by caller.                                        */
+/***************************************************************************/
+static int decode_region_mem_ctx(unsigned char **odata, int *ow, int *oh,
+                   int *od, int *oppi, int *lossyflag, const int crop,
+                   int ulx, int uly, int lrx, int lry, const int scale,
+                   unsigned char *idata, const int ilen, WSQ_DECODER_CTX *ctx,
+                   const char *caller)
+{
+   int ret, i, row;
+   int width, height, ppi;        /* image parameters */
+   int cx, cy, cw, ch;            /* box of coefficients kept */
+   int node, nblk;                /* scaled image node, blocks needed */
+   int sx, sy, sw, sh;            /* region in scaled image */
+   double dc, gain;               /* lowpass gain of scaled image */
+   unsigned char *cdata;          /* image pointer */
+   float *fdata;                  /* image pointers */
+   short *qdata, *qdata2;         /* image pointers */
+   Q_TREE q_tree2[Q_TREELEN];     /* trees of cropped coefficients */
+   Q_TREE q_tree3[Q_TREELEN];
+   unsigned char *cbufptr;        /* points to current byte in buffer */
+   unsigned char *ebufptr;        /* points to end of buffer */
+
+   if((node = wsq_scaled_node(scale)) < 0){
+      fprintf(stderr, "ERROR: %s : invalid scale %d\n", caller, scale);
+      return(-24);
+   }
+
+   /* Set memory buffer pointers. */
+   cbufptr = idata;
+   ebufptr = idata + ilen;
+
+   if((ret = read_header_mem_ctx(&ppi, &cbufptr, ebufptr, idata, ilen, ctx)))
+      return(ret);
+   width = ctx->frm_header_wsq.width;
+   height = ctx->frm_header_wsq.height;
+
+   /* Clip the region to the image. */
+   if(!crop){
+      ulx = 0;
+      uly = 0;
+      lrx = width;
+      lry = height;
+   }
+   if(ulx < 0)
+      ulx = 0;
+   if(uly < 0)
+      uly = 0;
+   if(lrx > width)
+      lrx = width;
+   if(lry > height)
+      lry = height;
+   if(lrx <= ulx || lry <= uly){
+      fprintf(stderr, "ERROR: %s : ", caller);
+      fprintf(stderr, "region is outside the %d x %d image\n", width, height);
+      free_decoder_ctx_filters(ctx);
+      return(-25);
+   }
+
+   /* Only the blocks holding the subbands below the scaled image's node */
+   /* are needed; block 1 holds those of the 1/4 and 1/8 scale images.   */
+   qdata = (short *)calloc(width * height, sizeof(short));
    if(qdata == (short *)NULL) {
-      fprintf(stderr,"ERROR: wsq_decode_mem : malloc : qdata1\n");
-      free_wsq_decoder_resources();
+      fprintf(stderr,"ERROR: %s : calloc : qdata\n", caller);
+      free_decoder_ctx_filters(ctx);
       return(-20);
    }
-   /* Decode the Huffman encoded data blocks. */
-   if((ret = huffman_decode_data_mem(qdata, &dtt_table, &dqt_table, dht_table,
-                                    &cbufptr, ebufptr))){
+   nblk = (scale == 0) ? 0 : ((scale == 1) ? 2 : 1);
+   if(nblk == 0)
+      ret = huffman_decode_data_mem_ctx(qdata, &cbufptr, ebufptr, ctx);
+   else
+      ret = huffman_decode_blocks_mem(qdata, &ctx->dtt_table,
+                       &ctx->dqt_table, ctx->dht_table, &ctx->frm_header_wsq,
+                       ctx->q_tree, &cbufptr, ebufptr, nblk);
+   if(ret){
       free(qdata);
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
 
+   /* Keep the coefficients of a box around the region, widened so the */
+   /* region is clear of the filters' edge effects at the box's sides.  */
+   /* The upper left corner must fall on a multiple of 32 pixels so the */
+   /* box is aligned with all five levels of the decomposition.         */
+   cx = ulx - WSQ_CROP_MARGIN;
+   cx = (cx < 0) ? 0 : cx - (cx % 32);
+   cy = uly - WSQ_CROP_MARGIN;
+   cy = (cy < 0) ? 0 : cy - (cy % 32);
+   cw = lrx + WSQ_CROP_MARGIN;
+   cw = ((cw > width) ? width : cw) - cx;
+   ch = lry + WSQ_CROP_MARGIN;
+   ch = ((ch > height) ? height : ch) - cy;
+   if(cw < width || ch < height){
+      qdata2 = (short *)malloc(cw * ch * sizeof(short));
+      if(qdata2 == (short *)NULL) {
+         fprintf(stderr,"ERROR: %s : malloc : qdata2\n", caller);
+         free(qdata);
+         free_decoder_ctx_filters(ctx);
+         return(-20);
+      }
+      if((ret = wsq_crop_qdata_trees(&ctx->dqt_table, ctx->w_tree,
+                          ctx->q_tree, q_tree2, q_tree3, qdata, cx, cy,
+                          cw, ch, qdata2))){
+         free(qdata);
+         free(qdata2);
+         free_decoder_ctx_filters(ctx);
+         return(ret);
+      }
+      free(qdata);
+      qdata = qdata2;
+      for(i = 0; i < Q_TREELEN; i++)
+         ctx->q_tree[i] = q_tree2[i];
+   }
+
    if(debug > 0)
-      fprintf(stderr,
-         "Quantized WSQ subband data blocks read and Huffman decoded\n\n");
+      fprintf(stderr, "Coefficients of (%d,%d) %d x %d kept at scale %d\n\n",
+              cx, cy, cw, ch, scale);
 
    /* Decode the quantize wavelet subband data. */
-   if((ret = unquantize(&fdata, &dqt_table, q_tree, Q_TREELEN,
-                         qdata, width, height))){
+   if((ret = unquantize(&fdata, &ctx->dqt_table, ctx->q_tree, Q_TREELEN,
+                         qdata, cw, ch))){
       free(qdata);
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
-
-   if(debug > 0)
-      fprintf(stderr, "WSQ subband data blocks unquantized\n\n");
-
-   /* Done with quantized wavelet subband data. */
    free(qdata);
 
-   if((ret = wsq_reconstruct(fdata, width, height, w_tree, W_TREELEN,
-                              &dtt_table))){
+   if((ret = wsq_reconstruct_scaled_work(fdata, cw, ch, ctx->w_tree,
+                  W_TREELEN, &ctx->dtt_table, scale, &ctx->work))){
       free(fdata);
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
 
-   if(debug > 0)
-      fprintf(stderr, "WSQ reconstruction of image finished\n\n");
-
-   cdata = (unsigned char *)malloc(num_pix * sizeof(unsigned char));
+   /* Locate the region in the scaled image of the box. */
+   sx = (ulx >> scale) - (cx >> scale);
+   sy = (uly >> scale) - (cy >> scale);
+   sw = ((lrx + (1 << scale) - 1) >> scale) - (ulx >> scale);
+   sh = ((lry + (1 << scale) - 1) >> scale) - (uly >> scale);
+   if(sx + sw > ctx->w_tree[node].lenx)
+      sw = ctx->w_tree[node].lenx - sx;
+   if(sy + sh > ctx->w_tree[node].leny)
+      sh = ctx->w_tree[node].leny - sy;
+
+   /* Each level of lowpass filtering scales the pixels by the square */
+   /* of the filter's DC gain.                                        */
+   dc = 0.0;
+   for(i = 0; i < ctx->dtt_table.losz; i++)
+      dc += ctx->dtt_table.lofilt[i];
+   gain = 1.0;
+   for(i = 0; i < scale; i++)
+      gain *= dc * dc;
+
+   cdata = (unsigned char *)malloc(sw * sh * sizeof(unsigned char));
    if(cdata == (unsigned char *)NULL) {
       free(fdata);
-      free_wsq_decoder_resources();
-      fprintf(stderr,"ERROR: wsq_decode_mem : malloc : cdata\n");
+      free_decoder_ctx_filters(ctx);
+      fprintf(stderr,"ERROR: %s : malloc : cdata\n", caller);
       return(-21);
    }
 
    /* Convert floating point pixels to unsigned char pixels. */
-   conv_img_2_uchar(cdata, fdata, width, height,
-                      frm_header_wsq.m_shift, frm_header_wsq.r_scale);
+   for(row = 0; row < sh; row++)
+      conv_img_2_uchar(cdata + (row * sw), fdata + ((sy + row) * cw) + sx,
+                       sw, 1, ctx->frm_header_wsq.m_shift,
+                       (float)(ctx->frm_header_wsq.r_scale / gain));
 
-   /* Done with floating point pixels. */
    free(fdata);
-
-   /* Added by MDG on 02-24-05 */
-   free_wsq_decoder_resources();
-
-   if(debug > 0)
-      fprintf(stderr, "Doubleing point pixels converted to unsigned char\n\n");
+   free_decoder_ctx_filters(ctx);
 
    /* Assign reconstructed pixmap and attributes to output pointers. */
    *odata = cdata;
-   *ow = width;
-   *oh = height;
+   *ow = sw;
+   *oh = sh;
    *od = 8;
-   *oppi = ppi;
+   *oppi = (ppi > 0) ? (ppi >> scale) : ppi;
    *lossyflag = 1;
 
    /* Return normally. */
@@ -241,6 +602,27 @@ int wsq_decode_mem(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
 /**************************************************************************/
 int wsq_decode_file(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
                     int *lossyflag, FILE *infp)
+{
+   int ret;
+   WSQ_DECODER_CTX *ctx;
+
+   if((ret = alloc_wsq_decoder_ctx(&ctx)))
+      return(ret);
+
+   ret = wsq_decode_file_ctx(odata, ow, oh, od, oppi, lossyflag, infp, ctx);
+
+   set_decoder_globals(ctx);
+   free_wsq_decoder_ctx(ctx);
+   return(ret);
+}
+
+/**************************************************************************/
+/* Same as wsq_decode_file(), but keeps the tables, frame header, and     */
+/* trees in a decoder context instead of the globals.                     */
+/**************************************************************************/
+int wsq_decode_file_ctx(unsigned char **odata, int *ow, int *oh, int *od,
+                    int *oppi, int *lossyflag, FILE *infp,
+                    WSQ_DECODER_CTX *ctx)
 {
    int ret;
    unsigned short marker;         /* WSQ marker */
@@ -250,42 +632,39 @@ int wsq_decode_file(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
    float *fdata;                  /* image pointers */
    short *qdata;                  /* image pointers */
 
-   /* Added by MDG on 02-24-05 */
-   init_wsq_decoder_resources();
-
    /* Read the SOI marker. */
    if((ret = read_marker_wsq(&marker, SOI_WSQ, infp))){
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
 
    /* Read in supporting tables up to the SOF marker. */
    if((ret = read_marker_wsq(&marker, TBLS_N_SOF, infp))){
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
    while(marker != SOF_WSQ) {
-      if((ret = read_table_wsq(marker, &dtt_table, &dqt_table, dht_table, infp))){
-         free_wsq_decoder_resources();
+      if((ret = read_table_wsq(marker, &ctx->dtt_table, &ctx->dqt_table, ctx->dht_table, infp))){
+         free_decoder_ctx_filters(ctx);
          return(ret);
       }
       if((ret = read_marker_wsq(&marker, TBLS_N_SOF, infp))){
-         free_wsq_decoder_resources();
+         free_decoder_ctx_filters(ctx);
          return(ret);
       }
    }
 
    /* Read in the Frame Header. */
-   if((ret = read_frame_header_wsq(&frm_header_wsq, infp))){
-      free_wsq_decoder_resources();
+   if((ret = read_frame_header_wsq(&ctx->frm_header_wsq, infp))){
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
-   width = frm_header_wsq.width;
-   height = frm_header_wsq.height;
+   width = ctx->frm_header_wsq.width;
+   height = ctx->frm_header_wsq.height;
    num_pix = width * height;
 
    if((ret = read_ppi_wsq(&ppi, infp))){
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
 
@@ -293,7 +672,7 @@ int wsq_decode_file(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
       fprintf(stderr, "SOI, tables, and frame header read\n\n");
 
    /* Build WSQ decomposition trees. */
-   build_wsq_trees(w_tree, W_TREELEN, q_tree, Q_TREELEN, width, height);
+   build_wsq_trees(ctx->w_tree, W_TREELEN, ctx->q_tree, Q_TREELEN, width, height);
 
    if(debug > 0)
       fprintf(stderr, "Tables for wavelet decomposition finished\n\n");
@@ -301,16 +680,15 @@ int wsq_decode_file(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
    /* Allocate working memory. */
    qdata = (short *) malloc(num_pix * sizeof(short));
    if(qdata == (short *)NULL) {
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       fprintf(stderr,"ERROR: wsq_decode_file : malloc : qdata1\n");
       return(-20);
    }
 
    /* Decode the Huffman encoded data blocks. */
-   if((ret = huffman_decode_data_file(qdata, &dtt_table, &dqt_table, dht_table,
-                                     infp))){
+   if((ret = huffman_decode_data_file_ctx(qdata, infp, ctx))){
       free(qdata);
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
 
@@ -319,10 +697,10 @@ int wsq_decode_file(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
          "Quantized WSQ subband data blocks read and Huffman decoded\n\n");
 
    /* Decode the quantize wavelet subband data. */
-   if((ret = unquantize(&fdata, &dqt_table, q_tree, Q_TREELEN,
+   if((ret = unquantize(&fdata, &ctx->dqt_table, ctx->q_tree, Q_TREELEN,
                          qdata, width, height))){
       free(qdata);
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
 
@@ -332,10 +710,10 @@ int wsq_decode_file(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
    /* Done with quantized wavelet subband data. */
    free(qdata);
 
-   if((ret = wsq_reconstruct(fdata, width, height, w_tree, W_TREELEN,
-                              &dtt_table))){
+   if((ret = wsq_reconstruct_work(fdata, width, height, ctx->w_tree,
+                              W_TREELEN, &ctx->dtt_table, &ctx->work))){
       free(fdata);
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       return(ret);
    }
 
@@ -345,20 +723,19 @@ int wsq_decode_file(unsigned char **odata, int *ow, int *oh, int *od, int *oppi,
    cdata = (unsigned char *)malloc(num_pix * sizeof(unsigned char));
    if(cdata == (unsigned char *)NULL) {
       free(fdata);
-      free_wsq_decoder_resources();
+      free_decoder_ctx_filters(ctx);
       fprintf(stderr,"ERROR: wsq_decode_file : malloc : cdata\n");
       return(-21);
    }
 
    /* Convert floating point pixels to unsigned char pixels. */
    conv_img_2_uchar(cdata, fdata, width, height,
-                      frm_header_wsq.m_shift, frm_header_wsq.r_scale);
+                      ctx->frm_header_wsq.m_shift, ctx->frm_header_wsq.r_scale);
 
    /* Done with floating point pixels. */
    free(fdata);
 
-   /* Added by MDG on 02-24-05 */
-   free_wsq_decoder_resources();
+   free_decoder_ctx_filters(ctx);
 
    if(debug > 0)
       fprintf(stderr, "Doubleing point pixels converted to unsigned char\n\n");
@@ -386,19 +763,67 @@ int huffman_decode_data_mem(
    DHT_TABLE *dht_table,    /* huffman table */
    unsigned char **cbufptr, /* points to current byte in input buffer */
    unsigned char *ebufptr)  /* points to end of input buffer */
+{
+   return(huffman_decode_blocks_mem(ip, dtt_table, dqt_table, dht_table,
+                                    &frm_header_wsq, q_tree,
+                                    cbufptr, ebufptr, 0));
+}
+
+/***************************************************************************/
+/* Same as huffman_decode_data_mem(), but takes the tables, frame header,  */
+/* and quantization tree from a decoder context.  If the context's         */
+/* num_threads allows more than one thread, the three blocks are decoded   */
+/* at the same time when they can be located, giving the same data.        */
+/***************************************************************************/
+int huffman_decode_data_mem_ctx(
+   short *ip,               /* image pointer */
+   unsigned char **cbufptr, /* points to current byte in input buffer */
+   unsigned char *ebufptr,  /* points to end of input buffer */
+   WSQ_DECODER_CTX *ctx)    /* decoder context */
+{
+   int nthreads;
+   unsigned char *sbufptr;  /* start of the blocks in input buffer */
+
+   nthreads = work_pool_nthreads(ctx->num_threads, 3);
+   if(nthreads > 1){
+      sbufptr = *cbufptr;
+      if(huffman_decode_blocks_mt(ip, cbufptr, ebufptr, ctx, nthreads) == 0)
+         return(0);
+      /* Otherwise decode the blocks one after another. */
+      *cbufptr = sbufptr;
+   }
+
+   return(huffman_decode_blocks_mem(ip, &ctx->dtt_table, &ctx->dqt_table,
+                                    ctx->dht_table, &ctx->frm_header_wsq,
+                                    ctx->q_tree, cbufptr, ebufptr, 0));
+}
+
+/***************************************************************************/
+/* Decodes the blocks of encoded data from a memory buffer, using the      */
+/* frame header and quantization tree given to bound the decoded data.     */
+/* If maxblk is not zero, decoding stops after that many blocks.           */
+/***************************************************************************/
+static int huffman_decode_blocks_mem(
+   short *ip,               /* image pointer */
+   DTT_TABLE *dtt_table,    /*transform table pointer */
+   DQT_TABLE *dqt_table,    /* quantization table */
+   DHT_TABLE *dht_table,    /* huffman table */
+   FRM_HEADER_WSQ *frm_header, /* frame header */
+   Q_TREE q_tree[],         /* quantization "tree" */
+   unsigned char **cbufptr, /* points to current byte in input buffer */
+   unsigned char *ebufptr,  /* points to end of input buffer */
+   const int maxblk)        /* number of blocks to decode, 0 = all */
 {
    int ret;
    int blk = 0;           /* block number */
    unsigned short marker; /* WSQ markers */
-   int bit_count;         /* bit count for getc_nextbits_wsq routine */
+   BIT_BUFFER_WSQ bitbuf; /* bits of the compressed data stream */
    int n;                 /* zero run count */
    int nodeptr;           /* pointers for decoding */
    int last_size;         /* last huffvalue */
    unsigned char hufftable_id;    /* huffman table number */
    HUFFCODE *hufftable;   /* huffman code structure */
-   int maxcode[MAX_HUFFBITS+1]; /* used in decoding data */
-   int mincode[MAX_HUFFBITS+1]; /* used in decoding data */
-   int valptr[MAX_HUFFBITS+1];  /* used in decoding data */
+   HUFF_LOOKUP_WSQ lut;   /* used in decoding data */
    unsigned short tbits;
    int ipc, ipc_mx, ipc_q;   /* image byte count adjustment parameters */
 
@@ -406,14 +831,16 @@ int huffman_decode_data_mem(
    if((ret = getc_marker_wsq(&marker, TBLS_N_SOB, cbufptr, ebufptr)))
       return(ret);
 
-   bit_count = 0;
+   init_bit_buffer_wsq(&bitbuf, cbufptr, ebufptr, (FILE *)NULL);
    ipc = 0;
    ipc_q = 0;
-   ipc_mx = frm_header_wsq.width * frm_header_wsq.height;
+   ipc_mx = frm_header->width * frm_header->height;
 
    while(marker != EOI_WSQ) {
 
       if(marker != 0) {
+         if(blk == maxblk && maxblk > 0)
+            break;
          blk++;
          while(marker != SOB_WSQ) {
             if((ret = getc_table_wsq(marker, dtt_table, dqt_table,
@@ -432,7 +859,8 @@ int huffman_decode_data_mem(
          if((ret = getc_block_header(&hufftable_id, cbufptr, ebufptr)))
             return(ret);
 
-         if((dht_table+hufftable_id)->tabdef != 1) {
+         if(hufftable_id >= MAX_DHT_TABLES ||
+            (dht_table+hufftable_id)->tabdef != 1) {
             fprintf(stderr, "ERROR : huffman_decode_data_mem : ");
             fprintf(stderr, "huffman table {%d} undefined.\n", hufftable_id);
             return(-51);
@@ -448,19 +876,18 @@ int huffman_decode_data_mem(
          if((ret = check_huffcodes_wsq(hufftable, last_size)))
             fprintf(stderr, "         hufftable_id = %d\n", hufftable_id);
 
-         /* this routine builds a set of three tables used in decoding */
+         /* these routines build the tables used in decoding */
          /* the compressed data*/
-         gen_decode_table(hufftable, maxcode, mincode, valptr,
+         gen_decode_table(hufftable, lut.maxcode, lut.mincode, lut.valptr,
                           (dht_table+hufftable_id)->huffbits);
          free(hufftable);
-         bit_count = 0;
+         gen_lookup_table_wsq(&lut, (dht_table+hufftable_id)->huffvalues);
+         init_bit_buffer_wsq(&bitbuf, cbufptr, ebufptr, (FILE *)NULL);
          marker = 0;
       }
 
       /* get next huffman category code from compressed input data stream */
-      if((ret = decode_data_mem(&nodeptr, mincode, maxcode, valptr,
-                            (dht_table+hufftable_id)->huffvalues,
-                            cbufptr, ebufptr, &bit_count, &marker)))
+      if((ret = decode_lookup_wsq(&nodeptr, &marker, &lut, &bitbuf)))
          return(ret);
 
       if(nodeptr == -1) {
@@ -499,36 +926,31 @@ int huffman_decode_data_mem(
          ipc++;
       }
       else if(nodeptr == 101){
-         if((ret = getc_nextbits_wsq(&tbits, &marker, cbufptr, ebufptr,
-                                &bit_count, 8)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 8)))
             return(ret);
          *ip++ = tbits;
          ipc++;
       }
       else if(nodeptr == 102){
-         if((ret = getc_nextbits_wsq(&tbits, &marker, cbufptr, ebufptr,
-                                &bit_count, 8)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 8)))
             return(ret);
          *ip++ = -tbits;
          ipc++;
       }
       else if(nodeptr == 103){
-         if((ret = getc_nextbits_wsq(&tbits, &marker, cbufptr, ebufptr,
-                                &bit_count, 16)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 16)))
             return(ret);
          *ip++ = tbits;
          ipc++;
       }
       else if(nodeptr == 104){
-         if((ret = getc_nextbits_wsq(&tbits, &marker, cbufptr, ebufptr,
-                                &bit_count, 16)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 16)))
             return(ret);
          *ip++ = -tbits;
          ipc++;
       }
       else if(nodeptr == 105) {
-         if((ret = getc_nextbits_wsq(&tbits, &marker, cbufptr, ebufptr,
-                                &bit_count, 8)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 8)))
             return(ret);
          ipc += tbits;
          if(ipc > ipc_mx) {
@@ -543,8 +965,7 @@ int huffman_decode_data_mem(
             *ip++ = 0;
       }
       else if(nodeptr == 106) {
-         if((ret = getc_nextbits_wsq(&tbits, &marker, cbufptr, ebufptr,
-                                &bit_count, 16)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 16)))
             return(ret);
          ipc += tbits;
          if(ipc > ipc_mx) {
@@ -569,6 +990,246 @@ int huffman_decode_data_mem(
    return(0);
 }
 
+/***************************************************************************/
+/* Decodes the three blocks of encoded data from a memory buffer on        */
+/* separate threads.  The blocks are first located by reading the tables   */
+/* and block headers between them and skipping each block's coded data to  */
+/* the marker that ends it.  Each block is decoded to where it would be    */
+/* after the blocks before it, if it has the number of coefficients that   */
+/* the quantization table and tree give it.  A nonzero return means the    */
+/* data is not decoded this way, as when there are not three blocks, a     */
+/* block has a different number of coefficients, or the data is corrupt;   */
+/* the tables are then as they were before the call, so that the data may */
+/* be decoded by huffman_decode_blocks_mem(), which reports any errors.   */
+/***************************************************************************/
+static int huffman_decode_blocks_mt(
+   short *ip,               /* image pointer */
+   unsigned char **cbufptr, /* points to current byte in input buffer */
+   unsigned char *ebufptr,  /* points to end of input buffer */
+   WSQ_DECODER_CTX *ctx,    /* decoder context */
+   const int nthreads)      /* number of threads */
+{
+   int ret, i, nblk;
+   int qsize[3];           /* quantized block sizes */
+   WSQ_DECODE_JOB *blocks; /* blocks located in the buffer */
+   DQT_TABLE dqt_save;     /* tables to be restored on failure */
+   DHT_TABLE dht_save[MAX_DHT_TABLES];
+
+   blocks = (WSQ_DECODE_JOB *)malloc(3 * sizeof(WSQ_DECODE_JOB));
+   if(blocks == (WSQ_DECODE_JOB *)NULL)
+      return(1);
+
+   dqt_save = ctx->dqt_table;
+   memcpy(dht_save, ctx->dht_table, sizeof(dht_save));
+
+   if((ret = locate_blocks_mem(blocks, &nblk, cbufptr, ebufptr, ctx)) == 0){
+      if(nblk == 3){
+         quant_block_sizes2(&qsize[0], &qsize[1], &qsize[2], &ctx->dqt_table,
+                            ctx->w_tree, W_TREELEN, ctx->q_tree, Q_TREELEN);
+         for(i = 0; i < 3; i++){
+            blocks[i].ip = ip;
+            blocks[i].size = qsize[i];
+            ip += qsize[i];
+         }
+         ret = work_pool_run(decode_block_job, blocks, 3, nthreads);
+      }
+      else
+         ret = 1;
+   }
+
+   free(blocks);
+
+   if(ret){
+      ctx->dqt_table = dqt_save;
+      memcpy(ctx->dht_table, dht_save, sizeof(dht_save));
+      return(ret);
+   }
+
+   return(0);
+}
+
+/***************************************************************************/
+/* Locates up to three blocks of encoded data in a memory buffer, reading  */
+/* the tables and block headers before each block as                       */
+/* huffman_decode_blocks_mem() does and building each block's lookup       */
+/* table.  The coded data of a block runs up to the next marker, stuffed   */
+/* zeros aside.  Returns nonzero if the blocks cannot be located, leaving  */
+/* transform tables, and any errors, to huffman_decode_blocks_mem().       */
+/***************************************************************************/
+static int locate_blocks_mem(
+   WSQ_DECODE_JOB *blocks,  /* located blocks, at least 3 */
+   int *onblk,              /* number of blocks located */
+   unsigned char **cbufptr, /* points to current byte in input buffer */
+   unsigned char *ebufptr,  /* points to end of input buffer */
+   WSQ_DECODER_CTX *ctx)    /* decoder context */
+{
+   int ret, nblk;
+   unsigned short marker; /* WSQ markers */
+   int last_size;         /* last huffvalue */
+   unsigned char hufftable_id;    /* huffman table number */
+   HUFFCODE *hufftable;   /* huffman code structure */
+   DHT_TABLE *dht;        /* huffman table of the block */
+   WSQ_DECODE_JOB *block;
+   unsigned char *bptr;   /* scans a block's coded data */
+
+   if((ret = getc_marker_wsq(&marker, TBLS_N_SOB, cbufptr, ebufptr)))
+      return(ret);
+
+   nblk = 0;
+   while(marker != EOI_WSQ) {
+      if(nblk == 3)
+         return(1);
+      block = blocks + nblk;
+      nblk++;
+
+      while(marker != SOB_WSQ) {
+         if(marker == DTT_WSQ)
+            return(1);
+         if((ret = getc_table_wsq(marker, &ctx->dtt_table, &ctx->dqt_table,
+                                  ctx->dht_table, cbufptr, ebufptr)))
+            return(ret);
+         if((ret = getc_marker_wsq(&marker, TBLS_N_SOB, cbufptr, ebufptr)))
+            return(ret);
+      }
+      if((ret = getc_block_header(&hufftable_id, cbufptr, ebufptr)))
+         return(ret);
+
+      if(hufftable_id >= MAX_DHT_TABLES)
+         return(1);
+      dht = ctx->dht_table + hufftable_id;
+      if(dht->tabdef != 1)
+         return(1);
+
+      /* Build the block's decoding tables from a copy of its huffman */
+      /* values, as a later table may take the same number.           */
+      if((ret = build_huffsizes(&hufftable, &last_size, dht->huffbits,
+                                MAX_HUFFCOUNTS_WSQ)))
+         return(ret);
+
+      build_huffcodes(hufftable);
+      if((ret = check_huffcodes_wsq(hufftable, last_size)))
+         fprintf(stderr, "         hufftable_id = %d\n", hufftable_id);
+
+      gen_decode_table(hufftable, block->lut.maxcode, block->lut.mincode,
+                       block->lut.valptr, dht->huffbits);
+      free(hufftable);
+      memcpy(block->huffvalues, dht->huffvalues, sizeof(block->huffvalues));
+      gen_lookup_table_wsq(&block->lut, block->huffvalues);
+      block->cbufptr = *cbufptr;
+      block->ebufptr = ebufptr;
+
+      /* Skip the coded data to the marker that ends it. */
+      bptr = *cbufptr;
+      marker = 0;
+      while(marker == 0) {
+         if(bptr + 1 >= ebufptr)
+            return(1);
+         if(*bptr != 0xFF)
+            bptr++;
+         else if(*(bptr + 1) == 0x00)
+            bptr += 2;
+         else{
+            marker = (*bptr << 8) | *(bptr + 1);
+            bptr += 2;
+         }
+      }
+      *cbufptr = bptr;
+      block->marker = marker;
+
+      while(marker == COM_WSQ && nblk == 3) {
+         if((ret = getc_table_wsq(marker, &ctx->dtt_table, &ctx->dqt_table,
+                                  ctx->dht_table, cbufptr, ebufptr)))
+            return(ret);
+         if((ret = getc_marker_wsq(&marker, ANY_WSQ, cbufptr, ebufptr)))
+            return(ret);
+      }
+   }
+
+   *onblk = nblk;
+   return(0);
+}
+
+/***************************************************************************/
+/* Decodes one of an array of blocks located by locate_blocks_mem().  The  */
+/* block must decode to exactly its expected number of coefficients and   */
+/* end at the marker found when it was located.  Called by                */
+/* work_pool_run().                                                        */
+/***************************************************************************/
+static int decode_block_job(void *arg, const int worker, const int item)
+{
+   WSQ_DECODE_JOB *block = (WSQ_DECODE_JOB *)arg + item;
+   unsigned char *cbufptr;  /* points to current byte in input buffer */
+   BIT_BUFFER_WSQ bitbuf;   /* bits of the compressed data stream */
+   unsigned short marker;   /* WSQ marker ending the block */
+   unsigned short tbits;
+   int nodeptr;             /* huffman category */
+   int n;                   /* zero run count */
+   short *ip;               /* next coefficient */
+   int left;                /* coefficients left in the block */
+
+   (void)worker;
+   cbufptr = block->cbufptr;
+   init_bit_buffer_wsq(&bitbuf, &cbufptr, block->ebufptr, (FILE *)NULL);
+   ip = block->ip;
+   left = block->size;
+   marker = 0;
+
+   while(1) {
+      if(decode_lookup_wsq(&nodeptr, &marker, &block->lut, &bitbuf))
+         return(1);
+      if(nodeptr == -1)
+         break;
+
+      if(nodeptr > 0 && nodeptr <= 100)
+         n = nodeptr;
+      else if(nodeptr == 105 || nodeptr == 106) {
+         if(get_bits_wsq(&tbits, &bitbuf, (nodeptr == 105) ? 8 : 16))
+            return(1);
+         n = tbits;
+      }
+      else {
+         if(left < 1)
+            return(1);
+         if(nodeptr > 106 && nodeptr < 0xff)
+            *ip++ = nodeptr - 180;
+         else if(nodeptr >= 101 && nodeptr <= 104){
+            if(get_bits_wsq(&tbits, &bitbuf, (nodeptr <= 102) ? 8 : 16))
+               return(1);
+            *ip++ = (nodeptr & 1) ? tbits : -tbits;
+         }
+         else
+            return(1);
+         left--;
+         continue;
+      }
+
+      /* zero run */
+      if(n > left)
+         return(1);
+      left -= n;
+      while(n--)
+         *ip++ = 0;
+   }
+
+   if(left != 0 || marker != block->marker)
+      return(1);
+
+   return(0);
+}
+
+/********************************************************************/
+/* Same as huffman_decode_data_file(), but takes the tables from a  */
+/* decoder context.                                                 */
+/********************************************************************/
+int huffman_decode_data_file_ctx(
+   short *ip,             /* image pointer */
+   FILE *infp,            /* input file */
+   WSQ_DECODER_CTX *ctx)  /* decoder context */
+{
+   return(huffman_decode_data_file(ip, &ctx->dtt_table, &ctx->dqt_table,
+                                   ctx->dht_table, infp));
+}
+
 /********************************************************************/
 /* Routine to decode an entire "block" of encoded data from a file. */
 /********************************************************************/
@@ -582,22 +1243,21 @@ int huffman_decode_data_file(
    int ret;
    int blk = 0;           /* block number */
    unsigned short marker; /* WSQ markers */
-   int bit_count;         /* bit count for nextbits_wsq routine */
+   BIT_BUFFER_WSQ bitbuf; /* bits of the compressed data stream */
    int n;                 /* zero run count */
    int nodeptr;           /* pointers for decoding */
    int last_size;         /* last huffvalue */
    unsigned char hufftable_id;    /* huffman table number */
    HUFFCODE *hufftable;   /* huffman code structure */
-   int maxcode[MAX_HUFFBITS+1]; /* used in decoding data */
-   int mincode[MAX_HUFFBITS+1]; /* used in decoding data */
-   int valptr[MAX_HUFFBITS+1];  /* used in decoding data */
+   HUFF_LOOKUP_WSQ lut;   /* used in decoding data */
    unsigned short tbits;
 
 
    if((ret = read_marker_wsq(&marker, TBLS_N_SOB, infp)))
       return(ret);
 
-   bit_count = 0;
+   init_bit_buffer_wsq(&bitbuf, (unsigned char **)NULL,
+                       (unsigned char *)NULL, infp);
 
    while(marker != EOI_WSQ) {
 
@@ -613,7 +1273,8 @@ int huffman_decode_data_file(
          if((ret = read_block_header(&hufftable_id, infp)))
             return(ret);
 
-         if((dht_table+hufftable_id)->tabdef != 1) {
+         if(hufftable_id >= MAX_DHT_TABLES ||
+            (dht_table+hufftable_id)->tabdef != 1) {
             fprintf(stderr, "ERROR : huffman_decode_data_file : ");
             fprintf(stderr, "huffman table {%d} undefined.\n", hufftable_id);
             return(-53);
@@ -627,19 +1288,19 @@ int huffman_decode_data_file(
          if((ret = check_huffcodes_wsq(hufftable, last_size)))
             fprintf(stderr, "         hufftable_id = %d\n", hufftable_id);
 
-         /* this routine builds a set of three tables used in decoding */
+         /* these routines build the tables used in decoding */
          /* the compressed data*/
-         gen_decode_table(hufftable, maxcode, mincode, valptr,
+         gen_decode_table(hufftable, lut.maxcode, lut.mincode, lut.valptr,
                           (dht_table+hufftable_id)->huffbits);
          free(hufftable);
-         bit_count = 0;
+         gen_lookup_table_wsq(&lut, (dht_table+hufftable_id)->huffvalues);
+         init_bit_buffer_wsq(&bitbuf, (unsigned char **)NULL,
+                             (unsigned char *)NULL, infp);
          marker = 0;
       }
 
       /* get next huffman category code from compressed input data stream */
-      if((ret = decode_data_file(&nodeptr, mincode, maxcode, valptr,
-                            (dht_table+hufftable_id)->huffvalues,
-                            infp, &bit_count, &marker)))
+      if((ret = decode_lookup_wsq(&nodeptr, &marker, &lut, &bitbuf)))
          return(ret);
 
       if(nodeptr == -1) {
@@ -658,34 +1319,34 @@ int huffman_decode_data_file(
             *ip++ = 0; /* z run */
          }
       else if(nodeptr == 101){
-         if((ret = nextbits_wsq(&tbits, &marker, infp, &bit_count, 8)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 8)))
             return(ret);
          *ip++ = tbits;
       }
       else if(nodeptr == 102){
-         if((ret = nextbits_wsq(&tbits, &marker, infp, &bit_count, 8)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 8)))
             return(ret);
          *ip++ = -tbits;
       }
       else if(nodeptr == 103){
-         if((ret = nextbits_wsq(&tbits, &marker, infp, &bit_count, 16)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 16)))
             return(ret);
          *ip++ = tbits;
       }
       else if(nodeptr == 104){
-         if((ret = nextbits_wsq(&tbits, &marker, infp, &bit_count, 16)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 16)))
             return(ret);
          *ip++ = -tbits;
       }
       else if(nodeptr == 105) {
-         if((ret = nextbits_wsq(&tbits, &marker, infp, &bit_count, 8)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 8)))
             return(ret);
          n = tbits;
          while(n--)
             *ip++ = 0;
       }
       else if(nodeptr == 106) {
-         if((ret = nextbits_wsq(&tbits, &marker, infp, &bit_count, 16)))
+         if((ret = get_bits_wsq(&tbits, &bitbuf, 16)))
             return(ret);
          n = tbits;
          while(n--)
@@ -913,3 +1574,279 @@ int getc_nextbits_wsq(
    *obits = bits;
    return(0);
 }
+
+/************************************************************************/
+/* Routine to build the lookup table used to decode huffman codes of up */
+/* to HUFF_LOOKUP_BITS_WSQ bits at a time.  The maxcode, mincode, and   */
+/* valptr tables in the lookup must already be set by gen_decode_table. */
+/* Each entry gives the same code length and huffvalue that walking    */
+/* maxcode one bit at a time would give for the leading bits of its    */
+/* index.                                                               */
+/************************************************************************/
+void gen_lookup_table_wsq(
+   HUFF_LOOKUP_WSQ *lut,        /* lookup table to be built */
+   unsigned char *huffvalues)   /* defines order of huffman code         */
+                                /*    lengths in relation to code sizes  */
+{
+   int i, inx, inx2;
+   int code;
+
+   lut->huffvalues = huffvalues;
+
+   for(i = 0; i < HUFF_LOOKUP_SIZE_WSQ; i++){
+      inx = 1;
+      code = i >> (HUFF_LOOKUP_BITS_WSQ - 1);
+      while(code > lut->maxcode[inx] && inx < HUFF_LOOKUP_BITS_WSQ){
+         inx++;
+         code = i >> (HUFF_LOOKUP_BITS_WSQ - inx);
+      }
+
+      /* Codes longer than the table are left to decode_lookup_wsq. */
+      lut->lookup[i] = 0;
+      if(code > lut->maxcode[inx])
+         continue;
+
+      inx2 = lut->valptr[inx] + code - lut->mincode[inx];
+      if(inx2 < 0 || inx2 > MAX_HUFFCOUNTS_WSQ)
+         continue;
+
+      lut->lookup[i] = (unsigned short)((inx << 8) | huffvalues[inx2]);
+   }
+}
+
+/**********************************************************************/
+/* Routine to start a bit buffer at the current position of a memory  */
+/* buffer, or of an open file if infp is not NULL.                    */
+/**********************************************************************/
+void init_bit_buffer_wsq(
+   BIT_BUFFER_WSQ *bitbuf,      /* bit buffer to be started */
+   unsigned char **cbufptr,     /* points to current byte in input buffer */
+   unsigned char *ebufptr,      /* points to end of input buffer */
+   FILE *infp)                  /* input file, or NULL */
+{
+   bitbuf->bits = 0;
+   bitbuf->nbits = 0;
+   bitbuf->marker = 0;
+   bitbuf->cbufptr = cbufptr;
+   bitbuf->ebufptr = ebufptr;
+   bitbuf->infp = infp;
+}
+
+/**********************************************************************/
+/* Routine to load whole bytes into a bit buffer until it holds more  */
+/* than 24 bits, removing stuffed zeros.  Loading stops at a marker,  */
+/* which is read and held in the buffer, and at the end of a memory   */
+/* buffer.  As with getc(), a file read past its end gives 0xFF.      */
+/**********************************************************************/
+static void load_bits_wsq(BIT_BUFFER_WSQ *bitbuf)
+{
+   unsigned char code, code2;
+
+   while(bitbuf->nbits <= 24 && bitbuf->marker == 0){
+      if(bitbuf->infp != (FILE *)NULL){
+         code = (unsigned char)getc(bitbuf->infp);
+         if(code == 0xFF){
+            code2 = (unsigned char)getc(bitbuf->infp);
+            if(code2 != 0x00){
+               bitbuf->marker = (code << 8) | code2;
+               return;
+            }
+         }
+      }
+      else{
+         if(*(bitbuf->cbufptr) >= bitbuf->ebufptr)
+            return;
+         code = **(bitbuf->cbufptr);
+         if(code == 0xFF){
+            /* Leave a trailing 0xFF for the end of buffer error. */
+            if(*(bitbuf->cbufptr) + 1 >= bitbuf->ebufptr)
+               return;
+            code2 = *(*(bitbuf->cbufptr) + 1);
+            *(bitbuf->cbufptr) += 2;
+            if(code2 != 0x00){
+               bitbuf->marker = (code << 8) | code2;
+               return;
+            }
+         }
+         else
+            (*(bitbuf->cbufptr))++;
+      }
+
+      bitbuf->bits = (bitbuf->bits << 8) | code;
+      bitbuf->nbits += 8;
+   }
+}
+
+/************************************************************************/
+/* Routine to decode the next huffman code from a bit buffer.  Codes of */
+/* up to HUFF_LOOKUP_BITS_WSQ bits take one table lookup; longer codes, */
+/* and codes cut short by a marker, are decoded one bit at a time as in */
+/* decode_data_mem.  If a marker is met, it is returned with a nodeptr  */
+/* of -1.                                                               */
+/************************************************************************/
+int decode_lookup_wsq(
+   int *onodeptr,               /* returned huffman code category        */
+   unsigned short *marker,      /* returned marker                       */
+   HUFF_LOOKUP_WSQ *lut,        /* lookup table for the current block    */
+   BIT_BUFFER_WSQ *bitbuf)      /* bits of the compressed data stream    */
+{
+   int inx, inx2;               /*increment variables*/
+   int code, entry, len;
+
+   if(bitbuf->nbits < HUFF_LOOKUP_BITS_WSQ)
+      load_bits_wsq(bitbuf);
+
+   /* Look up the next bits, padding with zeros near a marker. */
+   if(bitbuf->nbits >= HUFF_LOOKUP_BITS_WSQ)
+      code = (int)(bitbuf->bits >> (bitbuf->nbits - HUFF_LOOKUP_BITS_WSQ));
+   else
+      code = (int)(bitbuf->bits << (HUFF_LOOKUP_BITS_WSQ - bitbuf->nbits));
+   entry = lut->lookup[code & (HUFF_LOOKUP_SIZE_WSQ - 1)];
+   len = entry >> 8;
+   if(entry != 0 && len <= bitbuf->nbits){
+      bitbuf->nbits -= len;
+      *onodeptr = entry & 0xFF;
+      return(0);
+   }
+
+   code = 0;
+   inx = 0;
+   do{
+      if(bitbuf->nbits == 0){
+         load_bits_wsq(bitbuf);
+         if(bitbuf->nbits == 0){
+            if(bitbuf->marker != 0){
+               *marker = bitbuf->marker;
+               bitbuf->marker = 0;
+               *onodeptr = -1;
+               return(0);
+            }
+            fprintf(stderr, "ERROR : decode_lookup_wsq : ");
+            fprintf(stderr, "premature End Of Buffer\n");
+            return(-39);
+         }
+      }
+      if(++inx > MAX_HUFFBITS){
+         fprintf(stderr, "ERROR : decode_lookup_wsq : invalid huffman code\n");
+         return(-55);
+      }
+      bitbuf->nbits--;
+      code = (code << 1) | (int)((bitbuf->bits >> bitbuf->nbits) & 1);
+   } while(code > lut->maxcode[inx]);
+
+   inx2 = lut->valptr[inx] + code - lut->mincode[inx];
+   if(inx2 < 0 || inx2 > MAX_HUFFCOUNTS_WSQ){
+      fprintf(stderr, "ERROR : decode_lookup_wsq : invalid huffman code\n");
+      return(-55);
+   }
+
+   *onodeptr = lut->huffvalues[inx2];
+   return(0);
+}
+
+/**********************************************************************/
+/* Routine to get the next bits_req (at most 16) bits from a bit      */
+/* buffer.  A marker among the bits requested is an error, as it is   */
+/* in getc_nextbits_wsq and nextbits_wsq.                             */
+/**********************************************************************/
+int get_bits_wsq(
+   unsigned short *obits,       /* returned bits */
+   BIT_BUFFER_WSQ *bitbuf,      /* bits of the compressed data stream */
+   const int bits_req)          /* number of bits requested */
+{
+   if(bitbuf->nbits < bits_req){
+      load_bits_wsq(bitbuf);
+      if(bitbuf->nbits < bits_req){
+         if(bitbuf->marker != 0){
+            if(bitbuf->infp != (FILE *)NULL){
+               fprintf(stderr, "ERROR: nextbits_wsq : No stuffed zeros\n");
+               return(-38);
+            }
+            fprintf(stderr, "ERROR: getc_nextbits_wsq : No stuffed zeros\n");
+            return(-41);
+         }
+         fprintf(stderr, "ERROR : get_bits_wsq : premature End Of Buffer\n");
+         return(-39);
+      }
+   }
+
+   bitbuf->nbits -= bits_req;
+   *obits = (unsigned short)((bitbuf->bits >> bitbuf->nbits) &
+                             ((1L << bits_req) - 1));
+   return(0);
+}
+
+/*************************************************************/
+/* Allocates a WSQ decoder context.  A context holds all the */
+/* tables, the frame header, and the decomposition trees of  */
+/* one decode, so images may be decoded concurrently, each   */
+/* with its own context.  A context may be reused for any    */
+/* number of images, but by only one thread at a time; its   */
+/* wavelet scratch buffers are kept from image to image.     */
+/* Its blocks are decoded by one thread unless num_threads   */
+/* is set to more than 1, or to 0 for one per processor.     */
+/*************************************************************/
+int alloc_wsq_decoder_ctx(WSQ_DECODER_CTX **octx)
+{
+   WSQ_DECODER_CTX *ctx;
+
+   ctx = (WSQ_DECODER_CTX *)calloc(1, sizeof(WSQ_DECODER_CTX));
+   if(ctx == (WSQ_DECODER_CTX *)NULL){
+      fprintf(stderr, "ERROR : alloc_wsq_decoder_ctx : calloc : ctx\n");
+      return(-22);
+   }
+
+   /* Filter taps are allocated as the transform table is read. */
+   ctx->dtt_table.lofilt = (float *)NULL;
+   ctx->dtt_table.hifilt = (float *)NULL;
+   init_wsq_work(&ctx->work);
+   ctx->num_threads = 1;
+
+   *octx = ctx;
+   return(0);
+}
+
+/*************************************************************/
+/* Deallocates a WSQ decoder context.                        */
+/*************************************************************/
+void free_wsq_decoder_ctx(WSQ_DECODER_CTX *ctx)
+{
+   free_decoder_ctx_filters(ctx);
+   free_wsq_work(&ctx->work);
+   free(ctx);
+}
+
+/*************************************************************/
+/* Deallocates the filter taps read into a decoder context,  */
+/* as free_wsq_decoder_resources() does for the globals.     */
+/*************************************************************/
+static void free_decoder_ctx_filters(WSQ_DECODER_CTX *ctx)
+{
+   if(ctx->dtt_table.lofilt != (float *)NULL){
+      free(ctx->dtt_table.lofilt);
+      ctx->dtt_table.lofilt = (float *)NULL;
+   }
+
+   if(ctx->dtt_table.hifilt != (float *)NULL){
+      free(ctx->dtt_table.hifilt);
+      ctx->dtt_table.hifilt = (float *)NULL;
+   }
+}
+
+/*************************************************************/
+/* Copies the state of a decode from a context to the        */
+/* globals, where wsq_decode_mem() and wsq_decode_file()     */
+/* have always left it.  The filter taps are not copied, as  */
+/* they are freed with the context.                          */
+/*************************************************************/
+static void set_decoder_globals(WSQ_DECODER_CTX *ctx)
+{
+   dtt_table = ctx->dtt_table;
+   dtt_table.lofilt = (float *)NULL;
+   dtt_table.hifilt = (float *)NULL;
+   dqt_table = ctx->dqt_table;
+   memcpy(dht_table, ctx->dht_table, sizeof(ctx->dht_table));
+   frm_header_wsq = ctx->frm_header_wsq;
+   memcpy(w_tree, ctx->w_tree, sizeof(ctx->w_tree));
+   memcpy(q_tree, ctx->q_tree, sizeof(ctx->q_tree));
+}
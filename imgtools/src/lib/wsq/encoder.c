@@ -58,18 +58,88 @@ of the software.
       ROUTINES:
 #cat: wsq_encode_mem - WSQ encodes image data storing the compressed
 #cat:                   bytes to a memory buffer.
+#cat: wsq_encode_mem_ctx - Same as wsq_encode_mem(), but keeps its
+#cat:                   tables in an encoder context, not in globals.
+#cat: alloc_wsq_encoder_ctx - Allocates an encoder context.
+#cat:
+#cat: free_wsq_encoder_ctx - Deallocates an encoder context.
+#cat:
 #cat: gen_hufftable_wsq - Generates a huffman table for a quantized
 #cat:                   data block.
+#cat: gen_hufftable_counts_wsq - Generates a huffman table from the
+#cat:                   category counts of a quantized data block.
 #cat: compress_block - Codes a quantized image using huffman tables.
 #cat:
+#cat: compress_block_ex - Codes a quantized image using huffman tables
+#cat:                   into a buffer of given size.
 #cat: count_block - Counts the number of occurrences of each category
 #cat:                   in a huffman table.
+#cat: init_count_block - Starts counting the categories of a block that
+#cat:                   is counted in pieces.
+#cat: count_block_part - Counts the categories of the next piece of a
+#cat:                   block.
+#cat: end_count_block - Finishes counting the categories of a block.
 
 ***********************************************************************/
 
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 #include <wsq.h>
 #include <dataio.h>
+#include <util.h>
+
+/* Bit writer of the Huffman encoder.  Bits are packed a byte at a */
+/* time, as write_bits() and flush_bits() pack them, but writing   */
+/* stops, setting full, at the end of the output buffer.           */
+typedef struct bit_writer_wsq {
+   unsigned long bits;       /* bits not yet written, last bit is bit 0 */
+   int nbits;                /* number of bits not yet written */
+   unsigned char *optr;      /* next byte in output buffer */
+   unsigned char *eptr;      /* end of output buffer, or NULL if none */
+   int bytes;                /* number of bytes written */
+   int full;                 /* set if output buffer ran out */
+} BIT_WRITER_WSQ;
+
+/* Most bytes the coding of one coefficient or zero run may take: a */
+/* code of up to 16 bits and up to 16 extra bits, each byte of      */
+/* which may be 0xFF and need a zero stuffed after it.              */
+#define WSQ_MAX_CODE_BYTES  8
+
+/* Most bytes of a WSQ file besides the coded blocks and comment    */
+/* text: markers, the NISTCOM comment, the filter, quantization,    */
+/* frame and block headers, the two Huffman tables, and the last    */
+/* byte of each block.                                              */
+#define WSQ_HEADER_BYTES    4096
+
+/* A quantized block to be Huffman coded, and where it was coded to. */
+typedef struct wsq_block_job {
+   short *sip;               /* quantized block */
+   int sip_siz;              /* size of quantized block */
+   HUFFCODE *codes;          /* huffman code table */
+   unsigned char *outbuf;    /* coded block, or NULL if not yet coded */
+   int outalloc;             /* size of outbuf */
+   int bytes;                /* number of coded bytes */
+} WSQ_BLOCK_JOB;
+
+static int alloc_encoder_ctx_buffers(WSQ_ENCODER_CTX *, const int);
+static int fixed_wsq_alloc(int *, const int, char *);
+static int block_code_alloc(const int, const int);
+static void init_block_job(WSQ_BLOCK_JOB *, short *, const int, HUFFCODE *);
+static int compress_block_job(void *, const int, const int);
+static int compress_blocks_mt(WSQ_BLOCK_JOB *, unsigned char *, const int,
+                 const int, WSQ_ENCODER_CTX *);
+static int put_block_job(WSQ_BLOCK_JOB *, unsigned char *, const int, int *);
+static int gen_fixed_hufftable_wsq(HUFFCODE **, unsigned char **,
+                 unsigned char **, const int *);
+static void put_byte_wsq(BIT_WRITER_WSQ *, const unsigned char);
+static void put_bits_wsq(BIT_WRITER_WSQ *, const unsigned short, const int);
+static void flush_bit_writer_wsq(BIT_WRITER_WSQ *);
+static void put_coeff_wsq(BIT_WRITER_WSQ *, const short, const int,
+                 const int, HUFFCODE *);
+static int put_zrun_wsq(BIT_WRITER_WSQ *, const unsigned int, const int,
+                 HUFFCODE *);
+static void count_coeff_wsq(int *, const short, const int, const int);
 
 /************************************************************************/
 /*              This is an implementation based on the Crinimal         */
@@ -82,6 +152,42 @@ of the software.
 int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
                    unsigned char *idata, const int w, const int h,
                    const int d, const int ppi, char *comment_text)
+{
+   int ret;
+   WSQ_ENCODER_CTX *ctx;
+
+   if((ret = alloc_wsq_encoder_ctx(&ctx)))
+      return(ret);
+
+   ret = wsq_encode_mem_ctx(odata, olen, r_bitrate, idata, w, h, d, ppi,
+                            comment_text, ctx);
+
+   /* Leave the quantization values and trees in the globals. */
+   quant_vals = ctx->quant_vals;
+   memcpy(w_tree, ctx->w_tree, sizeof(ctx->w_tree));
+   memcpy(q_tree, ctx->q_tree, sizeof(ctx->q_tree));
+
+   free_wsq_encoder_ctx(ctx);
+   return(ret);
+}
+
+/************************************************************************/
+/* Same as wsq_encode_mem(), but keeps the quantization values and the  */
+/* decomposition trees in an encoder context instead of the globals, so */
+/* separate contexts may encode concurrently.  The floating point and   */
+/* quantized pixmaps are kept in the context from image to image.  The  */
+/* Huffman category counts are gathered as the subbands are quantized,  */
+/* or, if the context's huff_mode is WSQ_HUFF_FIXED, not at all, the    */
+/* built-in tables being used instead.  Each block is coded straight    */
+/* into the output buffer, unless the context's num_threads allows more */
+/* than one thread, in which case the three blocks are coded at the     */
+/* same time, Blocks 2 & 3 into a buffer kept in the context, and then  */
+/* copied into place.  The output is the same either way.              */
+/************************************************************************/
+int wsq_encode_mem_ctx(unsigned char **odata, int *olen, const float r_bitrate,
+                   unsigned char *idata, const int w, const int h,
+                   const int d, const int ppi, char *comment_text,
+                   WSQ_ENCODER_CTX *ctx)
 {
    int ret, num_pix;
    float *fdata;                 /* floating point pixel image  */
@@ -89,74 +195,73 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
    short *qdata;                 /* quantized image pointer     */
    int qsize, qsize1, qsize2, qsize3;  /* quantized block sizes */
    unsigned char *huffbits, *huffvalues; /* huffman code parameters     */
-   HUFFCODE *hufftable;          /* huffcode table              */
-   unsigned char *huff_buf;      /* huffman encoded buffer      */
+   HUFFCODE *hufftable1, *hufftable2; /* huffcode tables        */
+   WSQ_BLOCK_JOB blocks[3];      /* blocks to be Huffman coded  */
+   int nthreads;                 /* threads coding the blocks   */
    int hsize, hsize1, hsize2, hsize3; /* Huffman coded blocks sizes */
    unsigned char *wsq_data;      /* compressed data buffer      */
    int wsq_alloc, wsq_len;       /* number of bytes in buffer   */
-   int block_sizes[2];
+   int counts1[MAX_HUFFCOUNTS_WSQ+1];  /* Block 1 category counts  */
+   int counts2[MAX_HUFFCOUNTS_WSQ+1];  /* Blocks 2 & 3 category counts */
+   int fixed;                    /* use the built-in tables?    */
 
    /* Compute the total number of pixels in image. */
    num_pix = w * h;
+   fixed = (ctx->huff_mode == WSQ_HUFF_FIXED);
 
-   /* Allocate floating point pixmap. */
-   if((fdata = (float *) malloc(num_pix*sizeof(float))) == NULL) {
-      fprintf(stderr,"ERROR : wsq_encode_1 : malloc : fdata\n");
-      return(-10);
-   }
+   /* Make sure the floating point and quantized pixmaps hold the image. */
+   if((ret = alloc_encoder_ctx_buffers(ctx, num_pix)))
+      return(ret);
+   fdata = ctx->fdata;
+   qdata = ctx->qdata;
 
    /* Convert image pixels to floating point. */
-   if((ret = conv_img_2_flt_ret(fdata, &m_shift, &r_scale, idata, num_pix))) {
-      free(fdata);
+   if((ret = conv_img_2_flt_ret(fdata, &m_shift, &r_scale, idata, num_pix)))
       return(ret);
-   }
 
    if(debug > 0)
       fprintf(stderr, "Input image pixels converted to floating point\n\n");
 
    /* Build WSQ decomposition trees */
-   build_wsq_trees(w_tree, W_TREELEN, q_tree, Q_TREELEN, w, h);
+   build_wsq_trees(ctx->w_tree, W_TREELEN, ctx->q_tree, Q_TREELEN, w, h);
 
    if(debug > 0)
       fprintf(stderr, "Tables for wavelet decomposition finished\n\n");
 
    /* WSQ decompose the image */
-   if((ret = wsq_decompose(fdata, w, h, w_tree, W_TREELEN,
-                            hifilt, MAX_HIFILT, lofilt, MAX_LOFILT))){
-      free(fdata);
+   if((ret = wsq_decompose_work(fdata, w, h, ctx->w_tree, W_TREELEN,
+                            hifilt, MAX_HIFILT, lofilt, MAX_LOFILT,
+                            &ctx->work)))
       return(ret);
-   }
 
    if(debug > 0)
       fprintf(stderr, "WSQ decomposition of image finished\n\n");
 
    /* Set compression ratio and 'q' to zero. */
-   quant_vals.cr = 0;
-   quant_vals.q = 0.0;
+   ctx->quant_vals.cr = 0;
+   ctx->quant_vals.q = 0.0;
    /* Assign specified r-bitrate into quantization structure. */
-   quant_vals.r = r_bitrate;
+   ctx->quant_vals.r = r_bitrate;
    /* Compute subband variances. */
-   variance(&quant_vals, q_tree, Q_TREELEN, fdata, w, h);
+   variance(&ctx->quant_vals, ctx->q_tree, Q_TREELEN, fdata, w, h);
 
    if(debug > 0)
       fprintf(stderr, "Subband variances computed\n\n");
 
-   /* Quantize the floating point pixmap. */
-   if((ret = quantize(&qdata, &qsize, &quant_vals, q_tree, Q_TREELEN,
-                      fdata, w, h))){
-      free(fdata);
+   /* Quantize the floating point pixmap, counting the Huffman */
+   /* categories of each block unless the fixed tables are used. */
+   if((ret = quantize_count(qdata, &qsize, &ctx->quant_vals,
+                            ctx->q_tree, Q_TREELEN, fdata, w, h,
+                            fixed ? (int *)NULL : counts1,
+                            fixed ? (int *)NULL : counts2)))
       return(ret);
-   }
-
-   /* Done with floating point wsq subband data. */
-   free(fdata);
 
    if(debug > 0)
       fprintf(stderr, "WSQ subband decomposition data quantized\n\n");
 
    /* Compute quantized WSQ subband block sizes */
-   quant_block_sizes(&qsize1, &qsize2, &qsize3, &quant_vals,
-                           w_tree, W_TREELEN, q_tree, Q_TREELEN);
+   quant_block_sizes(&qsize1, &qsize2, &qsize3, &ctx->quant_vals,
+                           ctx->w_tree, W_TREELEN, ctx->q_tree, Q_TREELEN);
 
    if(qsize != qsize1+qsize2+qsize3){
       fprintf(stderr,
@@ -168,26 +273,27 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
    /* to be the size of the original pixmap.  If the encoded data */
    /* exceeds this buffer size, then throw an error because we do */
    /* not want our compressed data to be larger than the original */
-   /* image data.                                                 */
-   wsq_data = (unsigned char *)malloc(num_pix);
+   /* image data.  The built-in tables are not made for the image, */
+   /* so they may need more; with them the buffer is made to hold  */
+   /* the longest coding of every coefficient.                      */
+   wsq_alloc = num_pix;
+   if(fixed && (ret = fixed_wsq_alloc(&wsq_alloc, qsize, comment_text)))
+      return(ret);
+   wsq_data = (unsigned char *)malloc(wsq_alloc);
    if(wsq_data == (unsigned char *)NULL){
-      free(qdata);
       fprintf(stderr, "ERROR : wsq_encode_1 : malloc : wsq_data\n");
       return(-12);
    }
-   wsq_alloc = num_pix;
    wsq_len = 0;
 
    /* Add a Start Of Image (SOI) marker to the WSQ buffer. */
    if((ret = putc_ushort(SOI_WSQ, wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
       free(wsq_data);
       return(ret);
    }
 
    if((ret = putc_nistcom_wsq(comment_text, w, h, d, ppi, 1 /* lossy */,
                              r_bitrate, wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
       free(wsq_data);
       return(ret);
    }
@@ -196,15 +302,13 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
    if((ret = putc_transform_table(lofilt, MAX_LOFILT,
                                  hifilt, MAX_HIFILT,
                                  wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
       free(wsq_data);
       return(ret);
    }
 
    /* Store the quantization parameters to the WSQ buffer. */
-   if((ret = putc_quantization_table(&quant_vals,
+   if((ret = putc_quantization_table(&ctx->quant_vals,
                                     wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
       free(wsq_data);
       return(ret);
    }
@@ -212,7 +316,6 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
    /* Store a frame header to the WSQ buffer. */
    if((ret = putc_frame_header_wsq(w, h, m_shift, r_scale,
                               wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
       free(wsq_data);
       return(ret);
    }
@@ -220,39 +323,28 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
    if(debug > 0)
       fprintf(stderr, "SOI, tables, and frame header written\n\n");
 
-   /* Allocate a temporary buffer for holding compressed block data.    */
-   /* This buffer is allocated to the size of the original input image, */
-   /* and it is "assumed" that the compressed blocks will not exceed    */
-   /* this buffer size.                                                 */
-   huff_buf = (unsigned char *)malloc(num_pix);
-   if(huff_buf == (unsigned char *)NULL) {
-      free(qdata);
-      free(wsq_data);
-      fprintf(stderr, "ERROR : wsq_encode_1 : malloc : huff_buf\n");
-      return(-13);
-   }
-
-   /******************/
-   /* ENCODE Block 1 */
-   /******************/
+   /*************************/
+   /* Huffman Tables 1 & 2  */
+   /*************************/
    /* Compute Huffman table for Block 1. */
-   if((ret = gen_hufftable_wsq(&hufftable, &huffbits, &huffvalues,
-                              qdata, &qsize1, 1))){
-      free(qdata);
+   if(fixed)
+      ret = gen_fixed_hufftable_wsq(&hufftable1, &huffbits, &huffvalues,
+                                    fixed_huffcounts1_wsq);
+   else
+      ret = gen_hufftable_counts_wsq(&hufftable1, &huffbits, &huffvalues,
+                                     counts1);
+   if(ret){
       free(wsq_data);
-      free(huff_buf);
       return(ret);
    }
 
    /* Store Huffman table for Block 1 to WSQ buffer. */
    if((ret = putc_huffman_table(DHT_WSQ, 0, huffbits, huffvalues,
                                wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
       free(wsq_data);
-      free(huff_buf);
       free(huffbits);
       free(huffvalues);
-      free(hufftable);
+      free(hufftable1);
       return(ret);
    }
    free(huffbits);
@@ -261,36 +353,66 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
    if(debug > 0)
       fprintf(stderr, "Huffman code Table 1 generated and written\n\n");
 
-   /* Compress Block 1 data. */
-   if((ret = compress_block(huff_buf, &hsize1, qdata, qsize1,
-                           MAX_HUFFCOEFF, MAX_HUFFZRUN, hufftable))){
-      free(qdata);
+   /* Compute Huffman table for Blocks 2 & 3, which is stored */
+   /* after Block 1.                                         */
+   if(fixed)
+      ret = gen_fixed_hufftable_wsq(&hufftable2, &huffbits, &huffvalues,
+                                    fixed_huffcounts2_wsq);
+   else
+      ret = gen_hufftable_counts_wsq(&hufftable2, &huffbits, &huffvalues,
+                                     counts2);
+   if(ret){
       free(wsq_data);
-      free(huff_buf);
-      free(hufftable);
+      free(hufftable1);
       return(ret);
    }
-   /* Done with current Huffman table. */
-   free(hufftable);
 
-   /* Accumulate number of bytes compressed. */
-   hsize = hsize1;
+   if(debug > 0)
+      fprintf(stderr, "Huffman code Table 2 generated\n\n");
+
+   init_block_job(&blocks[0], qdata, qsize1, hufftable1);
+   init_block_job(&blocks[1], qdata+qsize1, qsize2, hufftable2);
+   init_block_job(&blocks[2], qdata+qsize1+qsize2, qsize3, hufftable2);
 
    /* Store Block 1's header to WSQ buffer. */
    if((ret = putc_block_header(0, wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
       free(wsq_data);
-      free(huff_buf);
+      free(huffbits);
+      free(huffvalues);
+      free(hufftable1);
+      free(hufftable2);
       return(ret);
    }
 
-   /* Store Block 1's compressed data to WSQ buffer. */
-   if((ret = putc_bytes(huff_buf, hsize1, wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
+   /* With more than one thread, code Block 1 in place and Blocks 2 */
+   /* & 3 into the context's buffer, all at the same time.          */
+   nthreads = work_pool_nthreads(ctx->num_threads, 3);
+   if(nthreads > 1){
+      if((ret = compress_blocks_mt(blocks, wsq_data+wsq_len,
+                                   wsq_alloc-wsq_len, nthreads, ctx))){
+         free(wsq_data);
+         free(huffbits);
+         free(huffvalues);
+         free(hufftable1);
+         free(hufftable2);
+         return(ret);
+      }
+   }
+
+   /******************/
+   /* ENCODE Block 1 */
+   /******************/
+   /* Compress Block 1 data into the WSQ buffer. */
+   if((ret = put_block_job(&blocks[0], wsq_data, wsq_alloc, &wsq_len))){
       free(wsq_data);
-      free(huff_buf);
+      free(huffbits);
+      free(huffvalues);
+      free(hufftable1);
+      free(hufftable2);
       return(ret);
    }
+   /* Done with Block 1's Huffman table. */
+   free(hufftable1);
 
    if(debug > 0)
       fprintf(stderr, "Block 1 compressed and written\n\n");
@@ -298,62 +420,32 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
    /******************/
    /* ENCODE Block 2 */
    /******************/
-   /* Compute  Huffman table for Blocks 2 & 3. */
-   block_sizes[0] = qsize2;
-   block_sizes[1] = qsize3;
-   if((ret = gen_hufftable_wsq(&hufftable, &huffbits, &huffvalues,
-                          qdata+qsize1, block_sizes, 2))){
-      free(qdata);
-      free(wsq_data);
-      free(huff_buf);
-      return(ret);
-   }
-
    /* Store Huffman table for Blocks 2 & 3 to WSQ buffer. */
    if((ret = putc_huffman_table(DHT_WSQ, 1, huffbits, huffvalues,
                                wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
       free(wsq_data);
-      free(huff_buf);
       free(huffbits);
       free(huffvalues);
-      free(hufftable);
+      free(hufftable2);
       return(ret);
    }
    free(huffbits);
    free(huffvalues);
 
    if(debug > 0)
-      fprintf(stderr, "Huffman code Table 2 generated and written\n\n");
-
-   /* Compress Block 2 data. */
-   if((ret = compress_block(huff_buf, &hsize2, qdata+qsize1, qsize2,
-                           MAX_HUFFCOEFF, MAX_HUFFZRUN, hufftable))){
-      free(qdata);
-      free(wsq_data);
-      free(huff_buf);
-      free(hufftable);
-      return(ret);
-   }
-
-   /* Accumulate number of bytes compressed. */
-   hsize += hsize2;
+      fprintf(stderr, "Huffman code Table 2 written\n\n");
 
    /* Store Block 2's header to WSQ buffer. */
    if((ret = putc_block_header(1, wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
       free(wsq_data);
-      free(huff_buf);
-      free(hufftable);
+      free(hufftable2);
       return(ret);
    }
 
-   /* Store Block 2's compressed data to WSQ buffer. */
-   if((ret = putc_bytes(huff_buf, hsize2, wsq_data, wsq_alloc, &wsq_len))){
-      free(qdata);
+   /* Compress Block 2 data into the WSQ buffer. */
+   if((ret = put_block_job(&blocks[1], wsq_data, wsq_alloc, &wsq_len))){
       free(wsq_data);
-      free(huff_buf);
-      free(hufftable);
+      free(hufftable2);
       return(ret);
    }
 
@@ -363,44 +455,31 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
    /******************/
    /* ENCODE Block 3 */
    /******************/
-   /* Compress Block 3 data. */
-   if((ret = compress_block(huff_buf, &hsize3, qdata+qsize1+qsize2, qsize3,
-                           MAX_HUFFCOEFF, MAX_HUFFZRUN, hufftable))){
-      free(qdata);
-      free(wsq_data);
-      free(huff_buf);
-      free(hufftable);
-      return(ret);
-   }
-   /* Done with current Huffman table. */
-   free(hufftable);
-
-   /* Done with quantized image buffer. */
-   free(qdata);
-
-   /* Accumulate number of bytes compressed. */
-   hsize += hsize3;
-
    /* Store Block 3's header to WSQ buffer. */
    if((ret = putc_block_header(1, wsq_data, wsq_alloc, &wsq_len))){
       free(wsq_data);
-      free(huff_buf);
+      free(hufftable2);
       return(ret);
    }
 
-   /* Store Block 3's compressed data to WSQ buffer. */
-   if((ret = putc_bytes(huff_buf, hsize3, wsq_data, wsq_alloc, &wsq_len))){
+   /* Compress Block 3 data into the WSQ buffer. */
+   if((ret = put_block_job(&blocks[2], wsq_data, wsq_alloc, &wsq_len))){
       free(wsq_data);
-      free(huff_buf);
+      free(hufftable2);
       return(ret);
    }
+   /* Done with current Huffman table. */
+   free(hufftable2);
+
+   /* Accumulate number of bytes compressed. */
+   hsize1 = blocks[0].bytes;
+   hsize2 = blocks[1].bytes;
+   hsize3 = blocks[2].bytes;
+   hsize = hsize1 + hsize2 + hsize3;
 
    if(debug > 0)
       fprintf(stderr, "Block 3 compressed and written\n\n");
 
-   /* Done with huffman compressing blocks, so done with buffer. */
-   free(huff_buf);
-
    /* Add a End Of Image (EOI) marker to the WSQ buffer. */
    if((ret = putc_ushort(EOI_WSQ, wsq_data, wsq_alloc, &wsq_len))){
       free(wsq_data);
@@ -414,6 +493,14 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
               r_bitrate, hsize, (float)(num_pix)/(float)hsize);
    }
 
+   /* Give back what the longest codings did not need. */
+   if(wsq_alloc > num_pix){
+      unsigned char *shrunk;
+      shrunk = (unsigned char *)realloc(wsq_data, wsq_len);
+      if(shrunk != (unsigned char *)NULL)
+         wsq_data = shrunk;
+   }
+
    *odata = wsq_data;
    *olen = wsq_len;
 
@@ -421,6 +508,219 @@ int wsq_encode_mem(unsigned char **odata, int *olen, const float r_bitrate,
    return(0);
 }
 
+/*************************************************************/
+/* Raises the size of the WSQ buffer to what an image of     */
+/* qsize quantized coefficients and the given comment text   */
+/* may need with the built-in Huffman tables.                */
+/*************************************************************/
+static int fixed_wsq_alloc(int *wsq_alloc, const int qsize,
+                           char *comment_text)
+{
+   int head;
+
+   head = WSQ_HEADER_BYTES;
+   if(comment_text != (char *)NULL)
+      head += strlen(comment_text);
+
+   if(qsize > (INT_MAX - head) / WSQ_MAX_CODE_BYTES){
+      fprintf(stderr,
+              "ERROR : wsq_encode_1 : %d coefficients too many to code\n",
+              qsize);
+      return(-19);
+   }
+   if(*wsq_alloc < head + (qsize * WSQ_MAX_CODE_BYTES))
+      *wsq_alloc = head + (qsize * WSQ_MAX_CODE_BYTES);
+
+   return(0);
+}
+
+/*************************************************************/
+/* Returns the size of buffer a block of sip_siz quantized   */
+/* coefficients is given, the most it may code to but no     */
+/* more than the room left, outalloc.                        */
+/*************************************************************/
+static int block_code_alloc(const int sip_siz, const int outalloc)
+{
+   /* Each coefficient, and the last byte, stuffed. */
+   if(sip_siz >= (outalloc - 2) / WSQ_MAX_CODE_BYTES)
+      return(outalloc);
+   return((sip_siz * WSQ_MAX_CODE_BYTES) + 2);
+}
+
+/*************************************************************/
+/* Makes sure the floating point and quantized pixmaps of an */
+/* encoder context hold num_pix pixels.                      */
+/*************************************************************/
+static int alloc_encoder_ctx_buffers(WSQ_ENCODER_CTX *ctx, const int num_pix)
+{
+   if(ctx->fdata_alloc < num_pix){
+      if(ctx->fdata != (float *)NULL)
+         free(ctx->fdata);
+      ctx->fdata = (float *)malloc(num_pix * sizeof(float));
+      if(ctx->fdata == (float *)NULL){
+         ctx->fdata_alloc = 0;
+         fprintf(stderr,"ERROR : wsq_encode_1 : malloc : fdata\n");
+         return(-10);
+      }
+      ctx->fdata_alloc = num_pix;
+   }
+
+   if(ctx->qdata_alloc < num_pix){
+      if(ctx->qdata != (short *)NULL)
+         free(ctx->qdata);
+      ctx->qdata = (short *)malloc(num_pix * sizeof(short));
+      if(ctx->qdata == (short *)NULL){
+         ctx->qdata_alloc = 0;
+         fprintf(stderr,"ERROR : wsq_encode_1 : malloc : qdata\n");
+         return(-15);
+      }
+      ctx->qdata_alloc = num_pix;
+   }
+
+   return(0);
+}
+
+/*************************************************************/
+/* Sets up a quantized block to be Huffman coded.            */
+/*************************************************************/
+static void init_block_job(WSQ_BLOCK_JOB *block, short *sip,
+                           const int sip_siz, HUFFCODE *codes)
+{
+   block->sip = sip;
+   block->sip_siz = sip_siz;
+   block->codes = codes;
+   block->outbuf = (unsigned char *)NULL;
+   block->outalloc = 0;
+   block->bytes = 0;
+}
+
+/*************************************************************/
+/* Huffman codes one of an array of blocks into its outbuf.  */
+/* Called by work_pool_run().                                */
+/*************************************************************/
+static int compress_block_job(void *arg, const int worker, const int item)
+{
+   WSQ_BLOCK_JOB *block = (WSQ_BLOCK_JOB *)arg + item;
+
+   (void)worker;
+   return(compress_block_ex(block->outbuf, &block->bytes, block->outalloc,
+                            block->sip, block->sip_siz,
+                            MAX_HUFFCOEFF, MAX_HUFFZRUN, block->codes));
+}
+
+/*************************************************************/
+/* Huffman codes the three blocks of an image at the same    */
+/* time: Block 1 into place in the WSQ buffer, and Blocks 2  */
+/* & 3 into the context's buffer, each with room for all    */
+/* that is left of the WSQ buffer or all it may code to,    */
+/* whichever is less.                                        */
+/*************************************************************/
+static int compress_blocks_mt(WSQ_BLOCK_JOB *blocks, unsigned char *outbuf,
+                              const int outalloc, const int nthreads,
+                              WSQ_ENCODER_CTX *ctx)
+{
+   int alloc2, alloc3;
+
+   alloc2 = block_code_alloc(blocks[1].sip_siz, outalloc);
+   alloc3 = block_code_alloc(blocks[2].sip_siz, outalloc);
+   if(ctx->hdata_alloc < alloc2 + alloc3){
+      if(ctx->hdata != (unsigned char *)NULL)
+         free(ctx->hdata);
+      ctx->hdata = (unsigned char *)malloc(alloc2 + alloc3);
+      if(ctx->hdata == (unsigned char *)NULL){
+         ctx->hdata_alloc = 0;
+         fprintf(stderr,"ERROR : wsq_encode_1 : malloc : hdata\n");
+         return(-18);
+      }
+      ctx->hdata_alloc = alloc2 + alloc3;
+   }
+
+   blocks[0].outbuf = outbuf;
+   blocks[1].outbuf = ctx->hdata;
+   blocks[2].outbuf = ctx->hdata + alloc2;
+   blocks[0].outalloc = outalloc;
+   blocks[1].outalloc = alloc2;
+   blocks[2].outalloc = alloc3;
+
+   return(work_pool_run(compress_block_job, blocks, 3, nthreads));
+}
+
+/*************************************************************/
+/* Puts a block's Huffman coded bytes at the end of the WSQ  */
+/* buffer, coding the block there if it has not been coded.  */
+/*************************************************************/
+static int put_block_job(WSQ_BLOCK_JOB *block, unsigned char *wsq_data,
+                         const int wsq_alloc, int *wsq_len)
+{
+   int ret;
+
+   if(block->outbuf == (unsigned char *)NULL){
+      block->outbuf = wsq_data + *wsq_len;
+      block->outalloc = wsq_alloc - *wsq_len;
+      if((ret = compress_block_job(block, 0, 0)))
+         return(ret);
+   }
+   else if(block->outbuf != wsq_data + *wsq_len){
+      if(block->bytes > wsq_alloc - *wsq_len){
+         fprintf(stderr,
+                 "ERROR : compress_block_ex : buffer overflow : alloc = %d\n",
+                 wsq_alloc - *wsq_len);
+         return(-16);
+      }
+      memcpy(wsq_data + *wsq_len, block->outbuf, block->bytes);
+   }
+
+   *wsq_len += block->bytes;
+   return(0);
+}
+
+/*************************************************************/
+/* Allocates a WSQ encoder context.  A context may be reused */
+/* for any number of images, but by only one thread at a     */
+/* time; its pixmaps and wavelet scratch buffers are kept    */
+/* from image to image.  Its Huffman tables are built from   */
+/* each image unless huff_mode is set to WSQ_HUFF_FIXED.     */
+/* Its blocks are coded by one thread unless num_threads is  */
+/* set to more than 1, or to 0 for one per processor.        */
+/*************************************************************/
+int alloc_wsq_encoder_ctx(WSQ_ENCODER_CTX **octx)
+{
+   WSQ_ENCODER_CTX *ctx;
+
+   ctx = (WSQ_ENCODER_CTX *)calloc(1, sizeof(WSQ_ENCODER_CTX));
+   if(ctx == (WSQ_ENCODER_CTX *)NULL){
+      fprintf(stderr, "ERROR : alloc_wsq_encoder_ctx : calloc : ctx\n");
+      return(-14);
+   }
+   init_wsq_work(&ctx->work);
+   ctx->huff_mode = WSQ_HUFF_ADAPTIVE;
+   ctx->fdata = (float *)NULL;
+   ctx->fdata_alloc = 0;
+   ctx->qdata = (short *)NULL;
+   ctx->qdata_alloc = 0;
+   ctx->num_threads = 1;
+   ctx->hdata = (unsigned char *)NULL;
+   ctx->hdata_alloc = 0;
+
+   *octx = ctx;
+   return(0);
+}
+
+/*************************************************************/
+/* Deallocates a WSQ encoder context.                        */
+/*************************************************************/
+void free_wsq_encoder_ctx(WSQ_ENCODER_CTX *ctx)
+{
+   free_wsq_work(&ctx->work);
+   if(ctx->fdata != (float *)NULL)
+      free(ctx->fdata);
+   if(ctx->qdata != (short *)NULL)
+      free(ctx->qdata);
+   if(ctx->hdata != (unsigned char *)NULL)
+      free(ctx->hdata);
+   free(ctx);
+}
+
 /*************************************************************/
 /* Generate a Huffman code table for a quantized data block. */
 /*************************************************************/
@@ -430,14 +730,8 @@ int gen_hufftable_wsq(HUFFCODE **ohufftable, unsigned char **ohuffbits,
 {
    int i, j;
    int ret;
-   int adjust;          /* tells if codesize is greater than MAX_HUFFBITS */
-   int *codesize;       /* code sizes to use */
-   int last_size;       /* last huffvalue */
-   unsigned char *huffbits;     /* huffbits values */
-   unsigned char *huffvalues;   /* huffvalues */
    int *huffcounts;     /* counts for each huffman category */
    int *huffcounts2;    /* counts for each huffman category */
-   HUFFCODE *hufftable1, *hufftable2;  /* hufftables */
 
    if((ret = count_block(&huffcounts, MAX_HUFFCOUNTS_WSQ,
 			 sip, block_sizes[0], MAX_HUFFCOEFF, MAX_HUFFZRUN)))
@@ -455,11 +749,30 @@ int gen_hufftable_wsq(HUFFCODE **ohufftable, unsigned char **ohuffbits,
       free(huffcounts2);
    }
 
-   if((ret = find_huff_sizes(&codesize, huffcounts, MAX_HUFFCOUNTS_WSQ))){
-      free(huffcounts);
-      return(ret);
-   }
+   ret = gen_hufftable_counts_wsq(ohufftable, ohuffbits, ohuffvalues,
+                                  huffcounts);
    free(huffcounts);
+   return(ret);
+}
+
+/*************************************************************/
+/* Generate a Huffman code table from the category counts of */
+/* a quantized data block, as count_block() computes them.   */
+/* NOTE: the counts are modified.                            */
+/*************************************************************/
+int gen_hufftable_counts_wsq(HUFFCODE **ohufftable, unsigned char **ohuffbits,
+               unsigned char **ohuffvalues, int *huffcounts)
+{
+   int ret;
+   int adjust;          /* tells if codesize is greater than MAX_HUFFBITS */
+   int *codesize;       /* code sizes to use */
+   int last_size;       /* last huffvalue */
+   unsigned char *huffbits;     /* huffbits values */
+   unsigned char *huffvalues;   /* huffvalues */
+   HUFFCODE *hufftable1, *hufftable2;  /* hufftables */
+
+   if((ret = find_huff_sizes(&codesize, huffcounts, MAX_HUFFCOUNTS_WSQ)))
+      return(ret);
 
    if((ret = find_num_huff_sizes(&huffbits, &adjust, codesize,
                                 MAX_HUFFCOUNTS_WSQ))){
@@ -516,6 +829,24 @@ int gen_hufftable_wsq(HUFFCODE **ohufftable, unsigned char **ohuffbits,
    return(0);
 }
 
+/*************************************************************/
+/* Generate one of the built-in Huffman code tables from its */
+/* fixed category counts, which give every category that may */
+/* occur a code.                                             */
+/*************************************************************/
+static int gen_fixed_hufftable_wsq(HUFFCODE **ohufftable,
+               unsigned char **ohuffbits, unsigned char **ohuffvalues,
+               const int *fixed_counts)
+{
+   int huffcounts[MAX_HUFFCOUNTS_WSQ+1];
+
+   memcpy(huffcounts, fixed_counts, MAX_HUFFCOUNTS_WSQ * sizeof(int));
+   huffcounts[MAX_HUFFCOUNTS_WSQ] = 1;
+
+   return(gen_hufftable_counts_wsq(ohufftable, ohuffbits, ohuffvalues,
+                                   huffcounts));
+}
+
 /*****************************************************************/
 /* Routine "codes" the quantized image using the huffman tables. */
 /*****************************************************************/
@@ -528,21 +859,38 @@ int compress_block(
    const int MaxZRun,   /* Maximum zero runs                   */
    HUFFCODE *codes)     /* huffman code table                  */
 {
-   unsigned char *optr;
+   return(compress_block_ex(outbuf, obytes, -1, sip, sip_siz,
+                            MaxCoeff, MaxZRun, codes));
+}
+
+/*****************************************************************/
+/* Same as compress_block(), but stops with an error rather than */
+/* write past "outalloc" bytes, unless "outalloc" is negative.   */
+/*****************************************************************/
+int compress_block_ex(
+   unsigned char *outbuf,       /* compressed output buffer            */
+   int   *obytes,       /* number of compressed bytes          */
+   const int outalloc,  /* size of output buffer, or -1        */
+   short *sip,          /* quantized image                     */
+   const int sip_siz,   /* size of quantized image to compress */
+   const int MaxCoeff,  /* Maximum values for coefficients     */
+   const int MaxZRun,   /* Maximum zero runs                   */
+   HUFFCODE *codes)     /* huffman code table                  */
+{
+   BIT_WRITER_WSQ bw;     /* packs the "coded" image into outbuf */
    int LoMaxCoeff;        /* lower (negative) MaxCoeff limit */
    short pix;             /* temp pixel pointer */
    unsigned int rcnt = 0, state;  /* zero run count and if current pixel
                              is in a zero run or just a coefficient */
    int cnt;               /* pixel counter */
-   int outbit, bytes;     /* parameters used by write_bits to */
-   unsigned char bits;            /* output the "coded" image to the  */
-                          /* output buffer                    */
 
    LoMaxCoeff = 1 - MaxCoeff;
-   optr = outbuf;
-   outbit = 7;
-   bytes = 0;
-   bits = 0;
+   bw.bits = 0;
+   bw.nbits = 0;
+   bw.optr = outbuf;
+   bw.eptr = (outalloc < 0) ? (unsigned char *)NULL : outbuf + outalloc;
+   bw.bytes = 0;
+   bw.full = 0;
    state = COEFF_CODE;
    for (cnt = 0; cnt < sip_siz; cnt++) {
       pix = *(sip + cnt);
@@ -555,43 +903,7 @@ int compress_block(
                rcnt = 1;
                break;
             }
-            if (pix > MaxCoeff) { 
-               if (pix > 255) {
-                  /* 16bit pos esc */
-                  write_bits( &optr, (unsigned short) codes[103].code,
-                              codes[103].size, &outbit, &bits, &bytes );
-                  write_bits( &optr, (unsigned short) pix, 16,
-                              &outbit, &bits, &bytes);
-               }
-               else {
-                  /* 8bit pos esc */
-                  write_bits( &optr, (unsigned short) codes[101].code,
-                              codes[101].size, &outbit, &bits, &bytes );
-                  write_bits( &optr, (unsigned short) pix, 8,
-                              &outbit, &bits, &bytes);
-               }
-            }
-            else if (pix < LoMaxCoeff) {
-               if (pix < -255) {
-                  /* 16bit neg esc */
-                  write_bits( &optr, (unsigned short) codes[104].code,
-                              codes[104].size, &outbit, &bits, &bytes );
-                  write_bits( &optr, (unsigned short) -pix, 16,
-                              &outbit, &bits, &bytes);
-               }
-               else {
-                  /* 8bit neg esc */
-                  write_bits( &optr, (unsigned short) codes[102].code,
-                              codes[102].size, &outbit, &bits, &bytes );
-                  write_bits( &optr, (unsigned short) -pix, 8,
-                              &outbit, &bits, &bytes);
-               }
-            }
-            else {
-               /* within table */
-               write_bits( &optr, (unsigned short) codes[pix+180].code,
-                           codes[pix+180].size, &outbit, &bits, &bytes);
-            }
+            put_coeff_wsq(&bw, pix, MaxCoeff, LoMaxCoeff, codes);
             break;
 
          case RUN_CODE:
@@ -599,70 +911,16 @@ int compress_block(
                ++rcnt;
                break;
             }
-            if (rcnt <= MaxZRun) {
-               /* log zero run length */
-               write_bits( &optr, (unsigned short) codes[rcnt].code,
-                           codes[rcnt].size, &outbit, &bits, &bytes );
-            }
-            else if (rcnt <= 0xFF) {
-               /* 8bit zrun esc */
-               write_bits( &optr, (unsigned short) codes[105].code,
-                           codes[105].size, &outbit, &bits, &bytes );
-               write_bits( &optr, (unsigned short) rcnt, 8,
-                           &outbit, &bits, &bytes);
-            }
-            else if (rcnt <= 0xFFFF) {
-               /* 16bit zrun esc */
-               write_bits( &optr, (unsigned short) codes[106].code,
-                           codes[106].size, &outbit, &bits, &bytes );
-               write_bits( &optr, (unsigned short) rcnt, 16,
-                           &outbit, &bits, &bytes);
-            }
-            else {
+            /* log zero run length */
+            if(put_zrun_wsq(&bw, rcnt, MaxZRun, codes)) {
                fprintf(stderr,
                       "ERROR : compress_block : zrun too large.\n");
                return(-47);
             }
 
             if(pix != 0) {
-               if (pix > MaxCoeff) {
-                  /** log current pix **/
-                  if (pix > 255) {
-                     /* 16bit pos esc */
-                     write_bits( &optr, (unsigned short) codes[103].code,
-                                 codes[103].size, &outbit, &bits, &bytes );
-                     write_bits( &optr, (unsigned short) pix, 16,
-                                 &outbit, &bits, &bytes);
-                  }
-                  else {
-                     /* 8bit pos esc */
-                     write_bits( &optr, (unsigned short) codes[101].code,
-                                 codes[101].size, &outbit, &bits, &bytes );
-                     write_bits( &optr, (unsigned short) pix, 8,
-                                 &outbit, &bits, &bytes);
-                  }
-               }
-               else if (pix < LoMaxCoeff) {
-                  if (pix < -255) {
-                     /* 16bit neg esc */
-                     write_bits( &optr, (unsigned short) codes[104].code,
-                                 codes[104].size, &outbit, &bits, &bytes );
-                     write_bits( &optr, (unsigned short) -pix, 16,
-                                 &outbit, &bits, &bytes);
-                  }
-                  else {
-                     /* 8bit neg esc */
-                     write_bits( &optr, (unsigned short) codes[102].code,
-                                 codes[102].size, &outbit, &bits, &bytes );
-                     write_bits( &optr, (unsigned short) -pix, 8,
-                                 &outbit, &bits, &bytes);
-                  }
-               }
-               else {
-                  /* within table */
-                  write_bits( &optr, (unsigned short) codes[pix+180].code,
-                              codes[pix+180].size, &outbit, &bits, &bytes);
-               }
+               /** log current pix **/
+               put_coeff_wsq(&bw, pix, MaxCoeff, LoMaxCoeff, codes);
                state = COEFF_CODE;
             }
             else {
@@ -673,31 +931,135 @@ int compress_block(
       }
    }
    if (state == RUN_CODE) {
-      if (rcnt <= MaxZRun) {
-         write_bits( &optr, (unsigned short) codes[rcnt].code,
-                     codes[rcnt].size, &outbit, &bits, &bytes );
+      if(put_zrun_wsq(&bw, rcnt, MaxZRun, codes)) {
+         fprintf(stderr, "ERROR : compress_block : zrun2 too large.\n");
+         return(-48);
+      }
+   }
+
+   flush_bit_writer_wsq(&bw);
+
+   if(bw.full){
+      fprintf(stderr,
+              "ERROR : compress_block_ex : buffer overflow : alloc = %d\n",
+              outalloc);
+      return(-16);
+   }
+
+   *obytes = bw.bytes;
+   return(0);
+}
+
+/*****************************************************************/
+/* Writes a byte to the output buffer, stuffing a zero after a   */
+/* byte of 0xFF.                                                 */
+/*****************************************************************/
+static void put_byte_wsq(BIT_WRITER_WSQ *bw, const unsigned char byte)
+{
+   if(bw->full)
+      return;
+   if(bw->eptr != (unsigned char *)NULL &&
+      bw->optr + ((byte == 0xFF) ? 2 : 1) > bw->eptr){
+      bw->full = 1;
+      return;
+   }
+
+   *(bw->optr)++ = byte;
+   bw->bytes++;
+   if(byte == 0xFF){
+      *(bw->optr)++ = 0;
+      bw->bytes++;
+   }
+}
+
+/*****************************************************************/
+/* Writes the low "size" bits of "code", first bit first.        */
+/*****************************************************************/
+static void put_bits_wsq(BIT_WRITER_WSQ *bw, const unsigned short code,
+                         const int size)
+{
+   bw->bits = (bw->bits << size) | (code & ((1UL << size) - 1));
+   bw->nbits += size;
+   while(bw->nbits >= 8){
+      bw->nbits -= 8;
+      put_byte_wsq(bw, (unsigned char)(bw->bits >> bw->nbits));
+   }
+   bw->bits &= (1UL << bw->nbits) - 1;
+}
+
+/*****************************************************************/
+/* Writes the bits left over in the last byte, padded with ones. */
+/*****************************************************************/
+static void flush_bit_writer_wsq(BIT_WRITER_WSQ *bw)
+{
+   if(bw->nbits > 0){
+      put_byte_wsq(bw, (unsigned char)((bw->bits << (8 - bw->nbits)) |
+                                       ((1 << (8 - bw->nbits)) - 1)));
+      bw->nbits = 0;
+      bw->bits = 0;
+   }
+}
+
+/*****************************************************************/
+/* Codes one nonzero coefficient.                                */
+/*****************************************************************/
+static void put_coeff_wsq(BIT_WRITER_WSQ *bw, const short pix,
+                          const int MaxCoeff, const int LoMaxCoeff,
+                          HUFFCODE *codes)
+{
+   if (pix > MaxCoeff) {
+      if (pix > 255) {
+         /* 16bit pos esc */
+         put_bits_wsq(bw, (unsigned short) codes[103].code, codes[103].size);
+         put_bits_wsq(bw, (unsigned short) pix, 16);
       }
-      else if (rcnt <= 0xFF) {
-         write_bits( &optr, (unsigned short) codes[105].code,
-                     codes[105].size, &outbit, &bits, &bytes );
-         write_bits( &optr, (unsigned short) rcnt, 8,
-                     &outbit, &bits, &bytes);
+      else {
+         /* 8bit pos esc */
+         put_bits_wsq(bw, (unsigned short) codes[101].code, codes[101].size);
+         put_bits_wsq(bw, (unsigned short) pix, 8);
       }
-      else if (rcnt <= 0xFFFF) {
-         write_bits( &optr, (unsigned short) codes[106].code,
-                     codes[106].size, &outbit, &bits, &bytes );
-         write_bits( &optr, (unsigned short) rcnt, 16,
-                     &outbit, &bits, &bytes);
+   }
+   else if (pix < LoMaxCoeff) {
+      if (pix < -255) {
+         /* 16bit neg esc */
+         put_bits_wsq(bw, (unsigned short) codes[104].code, codes[104].size);
+         put_bits_wsq(bw, (unsigned short) -pix, 16);
       }
       else {
-         fprintf(stderr, "ERROR : compress_block : zrun2 too large.\n");
-         return(-48);
+         /* 8bit neg esc */
+         put_bits_wsq(bw, (unsigned short) codes[102].code, codes[102].size);
+         put_bits_wsq(bw, (unsigned short) -pix, 8);
       }
    }
+   else {
+      /* within table */
+      put_bits_wsq(bw, (unsigned short) codes[pix+180].code,
+                   codes[pix+180].size);
+   }
+}
 
-   flush_bits( &optr, &outbit, &bits, &bytes);
+/*****************************************************************/
+/* Codes one run of zeros.  Returns 1 if the run is too long.    */
+/*****************************************************************/
+static int put_zrun_wsq(BIT_WRITER_WSQ *bw, const unsigned int rcnt,
+                        const int MaxZRun, HUFFCODE *codes)
+{
+   if (rcnt <= MaxZRun) {
+      put_bits_wsq(bw, (unsigned short) codes[rcnt].code, codes[rcnt].size);
+   }
+   else if (rcnt <= 0xFF) {
+      /* 8bit zrun esc */
+      put_bits_wsq(bw, (unsigned short) codes[105].code, codes[105].size);
+      put_bits_wsq(bw, (unsigned short) rcnt, 8);
+   }
+   else if (rcnt <= 0xFFFF) {
+      /* 16bit zrun esc */
+      put_bits_wsq(bw, (unsigned short) codes[106].code, codes[106].size);
+      put_bits_wsq(bw, (unsigned short) rcnt, 16);
+   }
+   else
+      return(1);
 
-   *obytes = bytes;
    return(0);
 }
 
@@ -713,12 +1075,9 @@ int count_block(
    const int MaxCoeff,  /* maximum values for coefficients */
    const int MaxZRun)   /* maximum zero runs */
 {
+   int ret;
    int *counts;         /* count for each huffman category */
-   int LoMaxCoeff;        /* lower (negative) MaxCoeff limit */
-   short pix;             /* temp pixel pointer */
-   unsigned int rcnt = 0, state;  /* zero run count and if current pixel
-                             is in a zero run or just a coefficient */
-   int cnt;               /* pixel counter */
+   HUFF_COUNT_WSQ hc;   /* running state of the count */
 
    /* Ininitalize vector of counts to 0. */
    counts = (int *)calloc(max_huffcounts+1, sizeof(int));
@@ -730,8 +1089,51 @@ int count_block(
    /* Set last count to 1. */
    counts[max_huffcounts] = 1;
 
+   init_count_block(&hc, counts);
+   if((ret = count_block_part(&hc, sip, sip_siz, MaxCoeff, MaxZRun)) ||
+      (ret = end_count_block(&hc, MaxZRun))){
+      free(counts);
+      return(ret);
+   }
+
+   *ocounts = counts;
+   return(0);
+}
+
+/*****************************************************************/
+/* Starts counting the categories of a block that is passed to   */
+/* count_block_part() in pieces.  The counts are added to those  */
+/* already in "counts".                                          */
+/*****************************************************************/
+void init_count_block(HUFF_COUNT_WSQ *hc, int *counts)
+{
+   hc->counts = counts;
+   hc->rcnt = 0;
+   hc->state = COEFF_CODE;
+}
+
+/*****************************************************************/
+/* Counts the categories of the next "sip_siz" quantized values  */
+/* of a block, carrying any zero run over to the next piece.     */
+/*****************************************************************/
+int count_block_part(
+   HUFF_COUNT_WSQ *hc,  /* running state of the count */
+   short *sip,          /* quantized data */
+   const int sip_siz,   /* size of this piece of the block */
+   const int MaxCoeff,  /* maximum values for coefficients */
+   const int MaxZRun)   /* maximum zero runs */
+{
+   int *counts;         /* count for each huffman category */
+   int LoMaxCoeff;        /* lower (negative) MaxCoeff limit */
+   short pix;             /* temp pixel pointer */
+   unsigned int rcnt, state;  /* zero run count and if current pixel
+                             is in a zero run or just a coefficient */
+   int cnt;               /* pixel counter */
+
+   counts = hc->counts;
+   rcnt = hc->rcnt;
+   state = hc->state;
    LoMaxCoeff = 1 - MaxCoeff;
-   state = COEFF_CODE;
    for(cnt = 0; cnt < sip_siz; cnt++) {
       pix = *(sip + cnt);
       switch(state) {
@@ -742,20 +1144,7 @@ int count_block(
                rcnt = 1;
                break;
             }
-            if(pix > MaxCoeff) { 
-               if(pix > 255)
-                  counts[103]++; /* 16bit pos esc */
-               else
-                  counts[101]++; /* 8bit pos esc */
-            }
-            else if (pix < LoMaxCoeff) {
-               if(pix < -255)
-                  counts[104]++; /* 16bit neg esc */
-               else
-                  counts[102]++; /* 8bit neg esc */
-            }
-            else
-               counts[pix+180]++; /* within table */
+            count_coeff_wsq(counts, pix, MaxCoeff, LoMaxCoeff);
             break;
 
          case RUN_CODE:  /* get length of zero run */
@@ -777,20 +1166,8 @@ int count_block(
             }
 
             if(pix != 0) {
-               if(pix > MaxCoeff) { /** log current pix **/
-                  if(pix > 255)
-                     counts[103]++; /* 16bit pos esc */
-                  else
-                     counts[101]++; /* 8bit pos esc */
-               }
-               else if(pix < LoMaxCoeff) {
-                  if(pix < -255)
-                     counts[104]++; /* 16bit neg esc */
-                  else
-                     counts[102]++; /* 8bit neg esc */
-               }
-               else
-                  counts[pix+180]++; /* within table */
+               /** log current pix **/
+               count_coeff_wsq(counts, pix, MaxCoeff, LoMaxCoeff);
                state = COEFF_CODE;
             }
             else {
@@ -800,13 +1177,24 @@ int count_block(
             break;
       }
    }
-   if(state == RUN_CODE){ /** log zero run length **/
-      if(rcnt <= MaxZRun)
-         counts[rcnt]++;
-      else if(rcnt <= 0xFF)
-         counts[105]++;
-      else if(rcnt <= 0xFFFF)
-         counts[106]++; /* 16bit zrun esc */
+
+   hc->rcnt = rcnt;
+   hc->state = state;
+   return(0);
+}
+
+/*****************************************************************/
+/* Finishes counting a block, counting its last zero run.        */
+/*****************************************************************/
+int end_count_block(HUFF_COUNT_WSQ *hc, const int MaxZRun)
+{
+   if(hc->state == RUN_CODE){ /** log zero run length **/
+      if(hc->rcnt <= MaxZRun)
+         hc->counts[hc->rcnt]++;
+      else if(hc->rcnt <= 0xFF)
+         hc->counts[105]++;
+      else if(hc->rcnt <= 0xFFFF)
+         hc->counts[106]++; /* 16bit zrun esc */
       else {
          fprintf(stderr,
          "ERROR: count_block : Zrun to long in count block.\n");
@@ -814,6 +1202,28 @@ int count_block(
       }
    }
 
-   *ocounts = counts;
+   hc->state = COEFF_CODE;
    return(0);
 }
+
+/*****************************************************************/
+/* Counts the category of one nonzero coefficient.               */
+/*****************************************************************/
+static void count_coeff_wsq(int *counts, const short pix,
+                            const int MaxCoeff, const int LoMaxCoeff)
+{
+   if(pix > MaxCoeff) {
+      if(pix > 255)
+         counts[103]++; /* 16bit pos esc */
+      else
+         counts[101]++; /* 8bit pos esc */
+   }
+   else if (pix < LoMaxCoeff) {
+      if(pix < -255)
+         counts[104]++; /* 16bit neg esc */
+      else
+         counts[102]++; /* 8bit neg esc */
+   }
+   else
+      counts[pix+180]++; /* within table */
+}
@@ -130,3 +130,64 @@ float lofilt[MAX_LOFILT] =  { 0.03782845550699546,
                               -0.02384946501938000,
                                0.03782845550699546 };
 #endif
+
+/* Category counts from which the encoder builds its fixed Huffman    */
+/* tables (see WSQ_HUFF_FIXED): the counts of block 1 and of blocks 2 */
+/* and 3 of fingerprint images coded at 0.75 bits per pixel, scaled   */
+/* to a total of 100000, with every category that may occur counted   */
+/* at least once so that it is given a code.                          */
+int fixed_huffcounts1_wsq[MAX_HUFFCOUNTS_WSQ] = {
+   0, 7260, 3564, 2382, 1909, 1377, 1123, 924, 765, 622,
+   497, 404, 317, 263, 192, 156, 165, 120, 114, 77,
+   79, 84, 42, 41, 38, 27, 13, 7, 5, 3,
+   2, 2, 1, 1, 2, 2, 1, 1, 1, 1,
+   4, 3, 5, 1, 3, 3, 7, 5, 7, 3,
+   6, 7, 3, 2, 2, 1, 2, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 2, 3,
+   2, 7, 3, 2, 2, 1, 1, 2, 3, 1,
+   2, 1, 1, 2, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 2, 1, 1, 2, 1, 1, 1,
+   1, 522, 1, 1, 1, 5, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 11, 27, 28, 44, 154, 124, 176,
+   242, 207, 101, 119, 121, 108, 65, 94, 128, 202,
+   122, 130, 121, 130, 137, 161, 202, 153, 236, 202,
+   256, 273, 281, 345, 344, 438, 418, 498, 521, 580,
+   730, 689, 1015, 1391, 1283, 1196, 3037, 5472, 6235, 10449,
+   0, 10340, 6098, 5382, 3025, 1273, 1403, 1440, 1049, 757,
+   737, 613, 541, 518, 403, 414, 361, 359, 273, 260,
+   231, 200, 206, 148, 174, 144, 124, 103, 130, 109,
+   81, 73, 69, 57, 43, 63, 46, 31, 35, 34,
+   17, 17, 15, 12, 17, 11, 7, 7, 5, 3,
+   6, 11, 5, 9, 9, 11, 13, 12, 13, 22,
+   23, 25, 29, 11, 4, 4, 6, 5, 11, 18,
+   18, 5, 13, 33, 13, 0 };
+
+int fixed_huffcounts2_wsq[MAX_HUFFCOUNTS_WSQ] = {
+   0, 4540, 2649, 2033, 1697, 1458, 1285, 1151, 1066, 1016,
+   949, 859, 866, 802, 758, 660, 682, 615, 561, 556,
+   538, 544, 524, 510, 499, 423, 336, 320, 292, 278,
+   256, 253, 244, 230, 211, 204, 214, 208, 184, 189,
+   185, 199, 178, 176, 173, 183, 173, 170, 158, 145,
+   155, 149, 152, 127, 135, 124, 120, 110, 120, 102,
+   109, 124, 114, 109, 114, 110, 95, 103, 103, 95,
+   113, 102, 95, 104, 79, 93, 100, 95, 86, 91,
+   81, 86, 82, 78, 85, 64, 68, 66, 78, 65,
+   65, 68, 61, 62, 64, 58, 56, 56, 55, 70,
+   64, 1, 1, 1, 1, 1878, 335, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 2, 1, 3, 3, 3,
+   5, 7, 11, 11, 15, 12, 19, 18, 23, 24,
+   37, 38, 43, 59, 62, 69, 87, 108, 105, 99,
+   178, 150, 218, 298, 348, 328, 928, 2394, 3866, 20848,
+   0, 20727, 3874, 2322, 915, 305, 352, 326, 209, 148,
+   155, 104, 111, 111, 90, 70, 60, 51, 42, 39,
+   34, 21, 31, 17, 16, 17, 19, 9, 7, 9,
+   8, 4, 1, 2, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+   1, 1, 1, 1, 1, 0 };
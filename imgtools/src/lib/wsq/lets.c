@@ -0,0 +1,1077 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+
+/***********************************************************************
+      LIBRARY: WSQ - Grayscale Image Compression
+
+      FILE:    LETS.C
+
+      Contains the wavelet subband split and join used by
+      wsq_decompose_work() and wsq_reconstruct_work().
+
+      The boundary handling of get_lets() and join_lets() depends
+      only on the length of a row or column and on the filters, so
+      it is run once per call to compile a list of filter operations
+      that is then applied to every row or column.  Each output
+      sample receives the same products, summed in the same order,
+      as in get_lets() and join_lets(), so the results are identical.
+      On x86-64 the operations are applied with SSE2 to 16 rows or
+      columns at a time (4 vectors of 4), falling back to 4 at a time
+      near the end; rows are first transposed so that neighboring
+      rows sit side by side.
+
+      ROUTINES:
+#cat: init_wsq_work - Initializes the scratch buffers of the wavelet
+#cat:                 transform.
+#cat: free_wsq_work - Deallocates the scratch buffers of the wavelet
+#cat:                 transform.
+#cat: alloc_wsq_work_fdata - Makes sure the temporary pixmap of a set
+#cat:                 of scratch buffers holds a given number of pixels.
+#cat: get_lets_work - Same as get_lets(), using scratch buffers and
+#cat:                 applying the filters to several rows or columns
+#cat:                 at a time.
+#cat: join_lets_work - Same as join_lets(), using scratch buffers and
+#cat:                 applying the filters to several rows or columns
+#cat:                 at a time.
+
+***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wsq.h>
+
+#ifdef WSQ_X86_SIMD
+#include <emmintrin.h>
+#endif
+
+/* Kinds of filter operation. */
+#define LETS_ASSIGN  0   /* out[dst] = in[src] * coef  */
+#define LETS_ADD     1   /* out[dst] += in[src] * coef */
+#define LETS_ZERO    2   /* out[dst] = 0.0             */
+
+/* Rows or columns filtered together in one pass: 4 per SSE2 vector, */
+/* 4 vectors, so that each pass uses whole 64-byte cache lines.       */
+#define LETS_VEC_LINES   4
+#define LETS_PASS_LINES  16
+
+/* Operations are compiled into a list that holds at most this many */
+/* per sample, enough for every filter in wsq_decompose() and        */
+/* wsq_reconstruct().                                                */
+#define LETS_OPS_PER_SAMPLE(_lsz_, _hsz_)  ((_lsz_) + (_hsz_))
+
+static int alloc_lets_ops(WSQ_WORK *, const int, const int, const int);
+static int alloc_lets_tbuf(WSQ_WORK *, const int);
+static int emit_lets_op(WSQ_WORK *, const int, const int, const int,
+                        const float, const int);
+static int get_lets_ops(WSQ_WORK *, const int, float *, const int,
+                        float *, const int, const int);
+static int join_lets_ops(WSQ_WORK *, const int, float *, const int,
+                         float *, const int, const int);
+static void apply_lets(float *, float *, const int, const int, const int,
+                       const int, WSQ_WORK *);
+static void apply_lets_ops(float *, const int, const float *, const int,
+                           const LETS_OP *, const int);
+#ifdef WSQ_X86_SIMD
+static void apply_lets_ops_sse2(float *, const int, const float *,
+                                const int, const LETS_OP *, const int,
+                                const int);
+static void transpose_lets_in(float *, const float *, const int,
+                              const int, const int);
+static void transpose_lets_out(float *, const int, const float *,
+                               const int, const int);
+#endif
+static int lets_ops_cover(WSQ_WORK *, const int);
+
+/*************************************************************/
+/* Initializes a set of scratch buffers as empty.            */
+/*************************************************************/
+void init_wsq_work(WSQ_WORK *work)
+{
+   work->fdata1 = (float *)NULL;
+   work->fdata1_alloc = 0;
+   work->ops = (LETS_OP *)NULL;
+   work->ops_alloc = 0;
+   work->nops = 0;
+   work->tbuf = (float *)NULL;
+   work->tbuf_alloc = 0;
+}
+
+/*************************************************************/
+/* Deallocates a set of scratch buffers, leaving it empty.   */
+/*************************************************************/
+void free_wsq_work(WSQ_WORK *work)
+{
+   if(work->fdata1 != (float *)NULL)
+      free(work->fdata1);
+   if(work->ops != (LETS_OP *)NULL)
+      free(work->ops);
+   if(work->tbuf != (float *)NULL)
+      free(work->tbuf);
+   init_wsq_work(work);
+}
+
+/*************************************************************/
+/* Makes sure the temporary pixmap holds num_pix pixels.     */
+/*************************************************************/
+int alloc_wsq_work_fdata(WSQ_WORK *work, const int num_pix)
+{
+   if(work->fdata1_alloc >= num_pix)
+      return(0);
+
+   if(work->fdata1 != (float *)NULL)
+      free(work->fdata1);
+   work->fdata1 = (float *)malloc(num_pix * sizeof(float));
+   if(work->fdata1 == (float *)NULL){
+      work->fdata1_alloc = 0;
+      fprintf(stderr, "ERROR : alloc_wsq_work_fdata : malloc : fdata1\n");
+      return(-98);
+   }
+   work->fdata1_alloc = num_pix;
+
+   return(0);
+}
+
+/*************************************************************/
+/* Makes sure the operation list holds the operations for a  */
+/* row or column of len2 samples.                            */
+/*************************************************************/
+static int alloc_lets_ops(WSQ_WORK *work, const int len2,
+                          const int hsz, const int lsz)
+{
+   int nalloc;
+
+   nalloc = ((len2 + 2) * LETS_OPS_PER_SAMPLE(lsz, hsz)) + 2;
+   work->nops = 0;
+   if(work->ops_alloc >= nalloc)
+      return(0);
+
+   if(work->ops != (LETS_OP *)NULL)
+      free(work->ops);
+   work->ops = (LETS_OP *)malloc(nalloc * sizeof(LETS_OP));
+   if(work->ops == (LETS_OP *)NULL){
+      work->ops_alloc = 0;
+      fprintf(stderr, "ERROR : alloc_lets_ops : malloc : ops\n");
+      return(-99);
+   }
+   work->ops_alloc = nalloc;
+
+   return(0);
+}
+
+/*************************************************************/
+/* Makes sure the transpose buffers hold LETS_PASS_LINES     */
+/* rows of len2 samples each, in and out.                    */
+/*************************************************************/
+static int alloc_lets_tbuf(WSQ_WORK *work, const int len2)
+{
+   if(work->tbuf_alloc >= 2 * LETS_PASS_LINES * len2)
+      return(0);
+
+   if(work->tbuf != (float *)NULL)
+      free(work->tbuf);
+   work->tbuf = (float *)malloc(2 * LETS_PASS_LINES * len2 * sizeof(float));
+   if(work->tbuf == (float *)NULL){
+      work->tbuf_alloc = 0;
+      fprintf(stderr, "ERROR : alloc_lets_tbuf : malloc : tbuf\n");
+      return(-99);
+   }
+   work->tbuf_alloc = 2 * LETS_PASS_LINES * len2;
+
+   return(0);
+}
+
+/*************************************************************/
+/* Appends an operation to the list.  Returns 1 if a sample  */
+/* lies outside the row or column, which get_lets() and      */
+/* join_lets() would reach past, or if the list is full.     */
+/*************************************************************/
+static int emit_lets_op(WSQ_WORK *work, const int kind, const int dst,
+                        const int src, const float coef, const int len2)
+{
+   LETS_OP *op;
+
+   if(dst < 0 || dst >= len2 || work->nops >= work->ops_alloc)
+      return(1);
+   if(kind != LETS_ZERO && (src < 0 || src >= len2))
+      return(1);
+
+   op = work->ops + work->nops++;
+   op->kind = kind;
+   op->dst = dst;
+   op->src = kind == LETS_ZERO ? 0 : src;
+   op->coef = coef;
+   return(0);
+}
+
+/************************************************************************/
+/* Compiles the operations of get_lets() on one row or column of len2   */
+/* samples.  The walk over the samples is that of get_lets(), with      */
+/* sample indices in place of pointers.  Returns 1 if the operations    */
+/* could not be compiled.                                               */
+/************************************************************************/
+static int get_lets_ops(WSQ_WORK *work, const int len2,
+                        float *hi, const int hsz, float *lo, const int lsz,
+                        const int inv)
+{
+   int lopass, hipass;  /* where to put lopass and hipass outputs */
+   int p0, p1;          /* first and last samples */
+   int pix, i, da_ev, fi_ev;
+   int loc, hoc, nstr, pstr;
+   int llen, hlen;
+   int lpxstr, lspxstr, lpx, lspx;
+   int hpxstr, hspxstr, hpx, hspx;
+   int olle, ohle, olre, ohre;
+   int lle, lle2, lre, lre2;
+   int hle, hle2, hre, hre2;
+   float hsign;
+
+   da_ev = len2 % 2;
+   fi_ev = lsz % 2;
+
+   if(fi_ev) {
+      loc = (lsz-1)/2;
+      hoc = (hsz-1)/2 - 1;
+      olle = 0;
+      ohle = 0;
+      olre = 0;
+      ohre = 0;
+      hsign = 1.0;
+   }
+   else {
+      loc = lsz/2 - 2;
+      hoc = hsz/2 - 2;
+      olle = 1;
+      ohle = 1;
+      olre = 1;
+      ohre = 1;
+
+      if(loc == -1) {
+         loc = 0;
+         olle = 0;
+      }
+      if(hoc == -1) {
+         hoc = 0;
+         ohle = 0;
+      }
+
+      /* get_lets() negates the hipass filter for even length filters. */
+      hsign = -1.0;
+   }
+
+   pstr = 1;
+   nstr = -1;
+
+   if(da_ev) {
+      llen = (len2+1)/2;
+      hlen = llen - 1;
+   }
+   else {
+      llen = len2/2;
+      hlen = llen;
+   }
+
+   if(inv) {
+      hipass = 0;
+      lopass = hlen;
+   }
+   else {
+      lopass = 0;
+      hipass = llen;
+   }
+
+   p0 = 0;
+   p1 = len2-1;
+
+   lspx = loc;
+   lspxstr = nstr;
+   lle2 = olle;
+   lre2 = olre;
+   hspx = hoc;
+   hspxstr = nstr;
+   hle2 = ohle;
+   hre2 = ohre;
+   for(pix = 0; pix < hlen; pix++) {
+      lpxstr = lspxstr;
+      lpx = lspx;
+      lle = lle2;
+      lre = lre2;
+      if(emit_lets_op(work, LETS_ASSIGN, lopass, lpx, lo[0], len2))
+         return(1);
+      for(i = 1; i < lsz; i++) {
+         if(lpx == p0){
+            if(lle) {
+               lpxstr = 0;
+               lle = 0;
+            }
+            else
+               lpxstr = pstr;
+         }
+         if(lpx == p1){
+            if(lre) {
+               lpxstr = 0;
+               lre = 0;
+            }
+            else
+               lpxstr = nstr;
+         }
+         lpx += lpxstr;
+         if(emit_lets_op(work, LETS_ADD, lopass, lpx, lo[i], len2))
+            return(1);
+      }
+      lopass++;
+
+      hpxstr = hspxstr;
+      hpx = hspx;
+      hle = hle2;
+      hre = hre2;
+      if(emit_lets_op(work, LETS_ASSIGN, hipass, hpx, hi[0] * hsign, len2))
+         return(1);
+      for(i = 1; i < hsz; i++) {
+         if(hpx == p0){
+            if(hle) {
+               hpxstr = 0;
+               hle = 0;
+            }
+            else
+               hpxstr = pstr;
+         }
+         if(hpx == p1){
+            if(hre) {
+               hpxstr = 0;
+               hre = 0;
+            }
+            else
+               hpxstr = nstr;
+         }
+         hpx += hpxstr;
+         if(emit_lets_op(work, LETS_ADD, hipass, hpx, hi[i] * hsign, len2))
+            return(1);
+      }
+      hipass++;
+
+      for(i = 0; i < 2; i++) {
+         if(lspx == p0){
+            if(lle2) {
+               lspxstr = 0;
+               lle2 = 0;
+            }
+            else
+               lspxstr = pstr;
+         }
+         lspx += lspxstr;
+         if(hspx == p0){
+            if(hle2) {
+               hspxstr = 0;
+               hle2 = 0;
+            }
+            else
+               hspxstr = pstr;
+         }
+         hspx += hspxstr;
+      }
+   }
+   if(da_ev) {
+      lpxstr = lspxstr;
+      lpx = lspx;
+      lle = lle2;
+      lre = lre2;
+      if(emit_lets_op(work, LETS_ASSIGN, lopass, lpx, lo[0], len2))
+         return(1);
+      for(i = 1; i < lsz; i++) {
+         if(lpx == p0){
+            if(lle) {
+               lpxstr = 0;
+               lle = 0;
+            }
+            else
+               lpxstr = pstr;
+         }
+         if(lpx == p1){
+            if(lre) {
+               lpxstr = 0;
+               lre = 0;
+            }
+            else
+               lpxstr = nstr;
+         }
+         lpx += lpxstr;
+         if(emit_lets_op(work, LETS_ADD, lopass, lpx, lo[i], len2))
+            return(1);
+      }
+   }
+
+   return(0);
+}
+
+/************************************************************************/
+/* Compiles the operations of join_lets() on one row or column of len2  */
+/* samples.  The walk over the subband samples is that of join_lets(),  */
+/* with sample indices in place of pointers.  Each hipass product is    */
+/* scaled by a factor of 1, -1 or 0, which is folded into the filter    */
+/* coefficient without changing the product.  Returns 1 if the          */
+/* operations could not be compiled.                                    */
+/************************************************************************/
+static int join_lets_ops(WSQ_WORK *work, const int len2,
+                         float *hi, const int hsz, float *lo, const int lsz,
+                         const int inv)
+{
+   int lp0, lp1;
+   int hp0, hp1;
+   int lopass, hipass;  /* lo/hi pass subband starts */
+   int limg, himg;
+   int pix;             /* pixel counter */
+   int i, da_ev;        /* if "scanline" is even or odd and */
+   int loc, hoc;
+   int hlen, llen;
+   int nstr, pstr;
+   int tap;
+   int fi_ev;
+   int olle, ohle, olre, ohre;
+   int lle, lle2, lre, lre2;
+   int hle, hle2, hre, hre2;
+   int lpx, lspx;
+   int lpxstr, lspxstr;
+   int lstap, lotap;
+   int hpx, hspx;
+   int hpxstr, hspxstr;
+   int hstap, hotap;
+   int asym, fhre = 0, ofhre;
+   float ssfac, osfac, sfac;
+   float hsign;
+
+   da_ev = len2 % 2;
+   fi_ev = lsz % 2;
+   pstr = 1;
+   nstr = -1;
+   if(da_ev) {
+      llen = (len2+1)/2;
+      hlen = llen - 1;
+   }
+   else {
+      llen = len2/2;
+      hlen = llen;
+   }
+
+   if(fi_ev) {
+      asym = 0;
+      ssfac = 1.0;
+      ofhre = 0;
+      loc = (lsz-1)/4;
+      hoc = (hsz+1)/4 - 1;
+      lotap = ((lsz-1)/2) % 2;
+      hotap = ((hsz+1)/2) % 2;
+      if(da_ev) {
+         olle = 0;
+         olre = 0;
+         ohle = 1;
+         ohre = 1;
+      }
+      else {
+         olle = 0;
+         olre = 1;
+         ohle = 1;
+         ohre = 0;
+      }
+      hsign = 1.0;
+   }
+   else {
+      asym = 1;
+      ssfac = -1.0;
+      ofhre = 2;
+      loc = lsz/4 - 1;
+      hoc = hsz/4 - 1;
+      lotap = (lsz/2) % 2;
+      hotap = (hsz/2) % 2;
+      if(da_ev) {
+         olle = 1;
+         olre = 0;
+         ohle = 1;
+         ohre = 1;
+      }
+      else {
+         olle = 1;
+         olre = 1;
+         ohle = 1;
+         ohre = 1;
+      }
+
+      if(loc == -1) {
+         loc = 0;
+         olle = 0;
+      }
+      if(hoc == -1) {
+         hoc = 0;
+         ohle = 0;
+      }
+
+      /* join_lets() negates the hipass filter for even length filters. */
+      hsign = -1.0;
+   }
+
+   limg = 0;
+   himg = limg;
+   if(emit_lets_op(work, LETS_ZERO, himg, 0, 0.0, len2) ||
+      emit_lets_op(work, LETS_ZERO, himg + 1, 0, 0.0, len2))
+      return(1);
+   if(inv) {
+      hipass = 0;
+      lopass = hipass + hlen;
+   }
+   else {
+      lopass = 0;
+      hipass = lopass + llen;
+   }
+
+   lp0 = lopass;
+   lp1 = lp0 + (llen-1);
+   lspx = lp0 + loc;
+   lspxstr = nstr;
+   lstap = lotap;
+   lle2 = olle;
+   lre2 = olre;
+
+   hp0 = hipass;
+   hp1 = hp0 + (hlen-1);
+   hspx = hp0 + hoc;
+   hspxstr = nstr;
+   hstap = hotap;
+   hle2 = ohle;
+   hre2 = ohre;
+   osfac = ssfac;
+
+   for(pix = 0; pix < hlen; pix++) {
+      for(tap = lstap; tap >=0; tap--) {
+         lle = lle2;
+         lre = lre2;
+         lpx = lspx;
+         lpxstr = lspxstr;
+
+         if(emit_lets_op(work, LETS_ASSIGN, limg, lpx, lo[tap], len2))
+            return(1);
+         for(i = tap+2; i < lsz; i += 2) {
+            if(lpx == lp0){
+               if(lle) {
+                  lpxstr = 0;
+                  lle = 0;
+               }
+               else
+                  lpxstr = pstr;
+            }
+            if(lpx == lp1) {
+               if(lre) {
+                  lpxstr = 0;
+                  lre = 0;
+               }
+               else
+                  lpxstr = nstr;
+            }
+            lpx += lpxstr;
+            if(emit_lets_op(work, LETS_ADD, limg, lpx, lo[i], len2))
+               return(1);
+         }
+         limg++;
+      }
+      if(lspx == lp0){
+         if(lle2) {
+            lspxstr = 0;
+            lle2 = 0;
+         }
+         else
+            lspxstr = pstr;
+      }
+      lspx += lspxstr;
+      lstap = 1;
+
+      for(tap = hstap; tap >=0; tap--) {
+         hle = hle2;
+         hre = hre2;
+         hpx = hspx;
+         hpxstr = hspxstr;
+         fhre = ofhre;
+         sfac = osfac;
+
+         for(i = tap; i < hsz; i += 2) {
+            if(hpx == hp0) {
+               if(hle) {
+                  hpxstr = 0;
+                  hle = 0;
+               }
+               else {
+                  hpxstr = pstr;
+                  sfac = 1.0;
+               }
+            }
+            if(hpx == hp1) {
+               if(hre) {
+                  hpxstr = 0;
+                  hre = 0;
+                  if(asym && da_ev) {
+                     hre = 1;
+                     fhre--;
+                     sfac = (float)fhre;
+                     if(sfac == 0.0)
+                        hre = 0;
+                  }
+               }
+               else {
+                  hpxstr = nstr;
+                  if(asym)
+                     sfac = -1.0;
+               }
+            }
+            if(sfac != 1.0 && sfac != -1.0 && sfac != 0.0)
+               return(1);
+            if(emit_lets_op(work, LETS_ADD, himg, hpx,
+                            hi[i] * hsign * sfac, len2))
+               return(1);
+            hpx += hpxstr;
+         }
+         himg++;
+      }
+      if(hspx == hp0) {
+         if(hle2) {
+            hspxstr = 0;
+            hle2 = 0;
+         }
+         else {
+            hspxstr = pstr;
+            osfac = 1.0;
+         }
+      }
+      hspx += hspxstr;
+      hstap = 1;
+   }
+
+
+   if(da_ev)
+      if(lotap)
+         lstap = 1;
+      else
+         lstap = 0;
+   else
+      if(lotap)
+         lstap = 2;
+      else
+         lstap = 1;
+
+   for(tap = 1; tap >= lstap; tap--) {
+      lle = lle2;
+      lre = lre2;
+      lpx = lspx;
+      lpxstr = lspxstr;
+
+      if(emit_lets_op(work, LETS_ASSIGN, limg, lpx, lo[tap], len2))
+         return(1);
+      for(i = tap+2; i < lsz; i += 2) {
+         if(lpx == lp0){
+            if(lle) {
+               lpxstr = 0;
+               lle = 0;
+            }
+            else
+               lpxstr = pstr;
+         }
+         if(lpx == lp1) {
+            if(lre) {
+               lpxstr = 0;
+               lre = 0;
+            }
+            else
+               lpxstr = nstr;
+         }
+         lpx += lpxstr;
+         if(emit_lets_op(work, LETS_ADD, limg, lpx, lo[i], len2))
+            return(1);
+      }
+      limg++;
+   }
+
+
+   if(da_ev) {
+      if(hotap)
+         hstap = 1;
+      else
+         hstap = 0;
+
+      if(hsz == 2) {
+         hspx -= hspxstr;
+         fhre = 1;
+      }
+   }
+   else
+      if(hotap)
+         hstap = 2;
+      else
+         hstap = 1;
+
+
+   for(tap = 1; tap >= hstap; tap--) {
+      hle = hle2;
+      hre = hre2;
+      hpx = hspx;
+      hpxstr = hspxstr;
+      sfac = osfac;
+      if(hsz != 2)
+         fhre = ofhre;
+
+      for(i = tap; i < hsz; i += 2) {
+         if(hpx == hp0) {
+            if(hle) {
+               hpxstr = 0;
+               hle = 0;
+            }
+            else {
+               hpxstr = pstr;
+               sfac = 1.0;
+            }
+         }
+         if(hpx == hp1) {
+            if(hre) {
+               hpxstr = 0;
+               hre = 0;
+               if(asym && da_ev) {
+                  hre = 1;
+                  fhre--;
+                  sfac = (float)fhre;
+                  if(sfac == 0.0)
+                     hre = 0;
+               }
+            }
+            else {
+               hpxstr = nstr;
+               if(asym)
+                  sfac = -1.0;
+            }
+         }
+         if(sfac != 1.0 && sfac != -1.0 && sfac != 0.0)
+            return(1);
+         if(emit_lets_op(work, LETS_ADD, himg, hpx,
+                         hi[i] * hsign * sfac, len2))
+            return(1);
+         hpx += hpxstr;
+      }
+      himg++;
+   }
+
+   return(0);
+}
+
+/*************************************************************/
+/* Returns 1 if every sample of the row or column is written */
+/* by the operation list, using the transpose buffer to mark */
+/* the samples.                                              */
+/*************************************************************/
+static int lets_ops_cover(WSQ_WORK *work, const int len2)
+{
+   int i, n;
+
+   for(i = 0; i < len2; i++)
+      work->tbuf[i] = 0.0;
+   n = 0;
+   for(i = 0; i < work->nops; i++){
+      if(work->tbuf[work->ops[i].dst] == 0.0){
+         work->tbuf[work->ops[i].dst] = 1.0;
+         n++;
+      }
+   }
+
+   return(n == len2);
+}
+
+/*************************************************************/
+/* Applies the operation list to one row or column.  dstr    */
+/* and sstr give the next sample in dst and src.             */
+/*************************************************************/
+static void apply_lets_ops(float *dst, const int dstr,
+                           const float *src, const int sstr,
+                           const LETS_OP *ops, const int nops)
+{
+   const LETS_OP *op, *end;
+
+   end = ops + nops;
+   for(op = ops; op < end; op++){
+      switch(op->kind){
+      case LETS_ASSIGN:
+         dst[op->dst * dstr] = src[op->src * sstr] * op->coef;
+         break;
+      case LETS_ADD:
+         dst[op->dst * dstr] += src[op->src * sstr] * op->coef;
+         break;
+      default:
+         dst[op->dst * dstr] = 0.0;
+         break;
+      }
+   }
+}
+
+#ifdef WSQ_X86_SIMD
+/*************************************************************/
+/* Applies the operation list to nvec * 4 neighboring rows   */
+/* or columns, whose samples sit side by side in memory.     */
+/* The running sum of the current output sample is kept in   */
+/* registers until the list moves on to another sample.      */
+/*************************************************************/
+static void apply_lets_ops_sse2(float *dst, const int dstr,
+                                const float *src, const int sstr,
+                                const LETS_OP *ops, const int nops,
+                                const int nvec)
+{
+   const LETS_OP *op, *end;
+   __m128 acc[LETS_PASS_LINES / LETS_VEC_LINES];
+   __m128 coef;
+   float *dp;
+   const float *sp;
+   int cur, v;
+
+   end = ops + nops;
+   cur = -1;
+   dp = dst;
+   for(op = ops; op < end; op++){
+      if(op->dst != cur){
+         if(cur >= 0)
+            for(v = 0; v < nvec; v++)
+               _mm_storeu_ps(dp + v * LETS_VEC_LINES, acc[v]);
+         cur = op->dst;
+         dp = dst + cur * dstr;
+         if(op->kind == LETS_ADD)
+            for(v = 0; v < nvec; v++)
+               acc[v] = _mm_loadu_ps(dp + v * LETS_VEC_LINES);
+      }
+      sp = src + op->src * sstr;
+      coef = _mm_set1_ps(op->coef);
+      switch(op->kind){
+      case LETS_ASSIGN:
+         for(v = 0; v < nvec; v++)
+            acc[v] = _mm_mul_ps(_mm_loadu_ps(sp + v * LETS_VEC_LINES), coef);
+         break;
+      case LETS_ADD:
+         for(v = 0; v < nvec; v++)
+            acc[v] = _mm_add_ps(acc[v],
+                     _mm_mul_ps(_mm_loadu_ps(sp + v * LETS_VEC_LINES), coef));
+         break;
+      default:
+         for(v = 0; v < nvec; v++)
+            acc[v] = _mm_setzero_ps();
+         break;
+      }
+   }
+   if(cur >= 0)
+      for(v = 0; v < nvec; v++)
+         _mm_storeu_ps(dp + v * LETS_VEC_LINES, acc[v]);
+}
+
+/*************************************************************/
+/* Copies nlines rows of len2 samples, pitch apart, into     */
+/* tbuf so that sample j of row k is at tbuf[j*nlines + k].  */
+/*************************************************************/
+static void transpose_lets_in(float *tbuf, const float *rows,
+                              const int pitch, const int len2,
+                              const int nlines)
+{
+   __m128 r0, r1, r2, r3;
+   const float *rp;
+   float *tp;
+   int j, k;
+
+   for(k = 0; k < nlines; k += LETS_VEC_LINES){
+      rp = rows + k * pitch;
+      tp = tbuf + k;
+      for(j = 0; j + 4 <= len2; j += 4){
+         r0 = _mm_loadu_ps(rp + j);
+         r1 = _mm_loadu_ps(rp + pitch + j);
+         r2 = _mm_loadu_ps(rp + 2 * pitch + j);
+         r3 = _mm_loadu_ps(rp + 3 * pitch + j);
+         _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+         _mm_storeu_ps(tp + j * nlines, r0);
+         _mm_storeu_ps(tp + (j+1) * nlines, r1);
+         _mm_storeu_ps(tp + (j+2) * nlines, r2);
+         _mm_storeu_ps(tp + (j+3) * nlines, r3);
+      }
+      for(; j < len2; j++){
+         tp[j * nlines] = rp[j];
+         tp[j * nlines + 1] = rp[pitch + j];
+         tp[j * nlines + 2] = rp[2 * pitch + j];
+         tp[j * nlines + 3] = rp[3 * pitch + j];
+      }
+   }
+}
+
+/*************************************************************/
+/* Reverses transpose_lets_in(), copying tbuf back into      */
+/* nlines rows of len2 samples, pitch apart.                 */
+/*************************************************************/
+static void transpose_lets_out(float *rows, const int pitch,
+                               const float *tbuf, const int len2,
+                               const int nlines)
+{
+   __m128 r0, r1, r2, r3;
+   const float *tp;
+   float *rp;
+   int j, k;
+
+   for(k = 0; k < nlines; k += LETS_VEC_LINES){
+      rp = rows + k * pitch;
+      tp = tbuf + k;
+      for(j = 0; j + 4 <= len2; j += 4){
+         r0 = _mm_loadu_ps(tp + j * nlines);
+         r1 = _mm_loadu_ps(tp + (j+1) * nlines);
+         r2 = _mm_loadu_ps(tp + (j+2) * nlines);
+         r3 = _mm_loadu_ps(tp + (j+3) * nlines);
+         _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+         _mm_storeu_ps(rp + j, r0);
+         _mm_storeu_ps(rp + pitch + j, r1);
+         _mm_storeu_ps(rp + 2 * pitch + j, r2);
+         _mm_storeu_ps(rp + 3 * pitch + j, r3);
+      }
+      for(; j < len2; j++){
+         rp[j] = tp[j * nlines];
+         rp[pitch + j] = tp[j * nlines + 1];
+         rp[2 * pitch + j] = tp[j * nlines + 2];
+         rp[3 * pitch + j] = tp[j * nlines + 3];
+      }
+   }
+}
+#endif
+
+/*************************************************************/
+/* Applies the compiled operation list to the len1 rows or   */
+/* columns of a subband split or join.  Neighboring columns  */
+/* (pitch 1) are filtered in place LETS_PASS_LINES at a      */
+/* time; neighboring rows (stride 1) are transposed into the */
+/* scratch buffer, filtered, and transposed back.            */
+/*************************************************************/
+static void apply_lets(float *new, float *old, const int len1,
+                       const int len2, const int pitch, const int stride,
+                       WSQ_WORK *work)
+{
+   int line;
+#ifdef WSQ_X86_SIMD
+   int nlines;
+   float *tin, *tout;
+#endif
+
+   line = 0;
+#ifdef WSQ_X86_SIMD
+   if(pitch == 1){
+      for(; line + LETS_VEC_LINES <= len1; line += nlines){
+         nlines = (len1 - line >= LETS_PASS_LINES) ?
+                  LETS_PASS_LINES : LETS_VEC_LINES;
+         apply_lets_ops_sse2(new + line, stride, old + line, stride,
+                             work->ops, work->nops, nlines / LETS_VEC_LINES);
+      }
+   }
+   else if(stride == 1 && lets_ops_cover(work, len2)){
+      tin = work->tbuf;
+      tout = work->tbuf + (LETS_PASS_LINES * len2);
+      for(; line + LETS_VEC_LINES <= len1; line += nlines){
+         nlines = (len1 - line >= LETS_PASS_LINES) ?
+                  LETS_PASS_LINES : LETS_VEC_LINES;
+         transpose_lets_in(tin, old + line * pitch, pitch, len2, nlines);
+         apply_lets_ops_sse2(tout, nlines, tin, nlines,
+                             work->ops, work->nops, nlines / LETS_VEC_LINES);
+         transpose_lets_out(new + line * pitch, pitch, tout, len2, nlines);
+      }
+   }
+#endif
+
+   for(; line < len1; line++)
+      apply_lets_ops(new + line * pitch, stride, old + line * pitch, stride,
+                     work->ops, work->nops);
+}
+
+/************************************************************************/
+/* Splits the len1 rows or columns of a region into lowpass and         */
+/* hipass subbands as get_lets() does, running the operations           */
+/* compiled into work.  Falls back to get_lets() when they cannot be    */
+/* compiled.  Returns nonzero if work could not be allocated.           */
+/************************************************************************/
+int get_lets_work(float *new, float *old, const int len1, const int len2,
+                  const int pitch, const int stride,
+                  float *hi, const int hsz, float *lo, const int lsz,
+                  const int inv, WSQ_WORK *work)
+{
+   int ret;
+
+   if((ret = alloc_lets_ops(work, len2, hsz, lsz)))
+      return(ret);
+   if((ret = alloc_lets_tbuf(work, len2)))
+      return(ret);
+
+   /* Filter operations that get_lets() would not produce in range */
+   /* are left to get_lets() itself.                               */
+   if(get_lets_ops(work, len2, hi, hsz, lo, lsz, inv)){
+      get_lets(new, old, len1, len2, pitch, stride, hi, hsz, lo, lsz, inv);
+      return(0);
+   }
+
+   apply_lets(new, old, len1, len2, pitch, stride, work);
+   return(0);
+}
+
+/************************************************************************/
+/* Joins the lowpass and hipass subbands of the len1 rows or columns    */
+/* of a region as join_lets() does, running the operations compiled     */
+/* into work.  Falls back to join_lets() when they cannot be compiled.  */
+/* Returns nonzero if work could not be allocated.                      */
+/************************************************************************/
+int join_lets_work(float *new, float *old, const int len1, const int len2,
+                   const int pitch, const int stride,
+                   float *hi, const int hsz, float *lo, const int lsz,
+                   const int inv, WSQ_WORK *work)
+{
+   int ret;
+
+   if((ret = alloc_lets_ops(work, len2, hsz, lsz)))
+      return(ret);
+   if((ret = alloc_lets_tbuf(work, len2)))
+      return(ret);
+
+   if(join_lets_ops(work, len2, hi, hsz, lo, lsz, inv)){
+      join_lets(new, old, len1, len2, pitch, stride, hi, hsz, lo, lsz, inv);
+      return(0);
+   }
+
+   apply_lets(new, old, len1, len2, pitch, stride, work);
+   return(0);
+}
@@ -66,16 +66,26 @@ of the software.
 #cat:
 #cat: quantize - Quantizes the image's wavelet subbands.
 #cat:
+#cat: quantize_count - Quantizes the image's wavelet subbands into a
+#cat:                  given buffer, counting Huffman categories as it goes.
 #cat: quant_block_sizes - Quantizes an image's subband block.
 #cat:
 #cat: unquantize - Unquantizes an image's wavelet subbands.
 #cat:
 #cat: wsq_decompose - Computes the wavelet decomposition of an input image.
 #cat:
+#cat: wsq_decompose_work - Same as wsq_decompose(), using scratch buffers
+#cat:                  that are kept between images.
 #cat: get_lets - Compute the wavelet subband decomposition for the image.
 #cat:
 #cat: wsq_reconstruct - Reconstructs a lossy floating point pixmap from
 #cat:                  a WSQ compressed datastream.
+#cat: wsq_reconstruct_work - Same as wsq_reconstruct(), using scratch
+#cat:                  buffers that are kept between images.
+#cat: wsq_reconstruct_scaled_work - Same as wsq_reconstruct_work(), but
+#cat:                  stops at a reduced scale of the image.
+#cat: wsq_scaled_node - Returns the wavelet tree node holding the image
+#cat:                  at a reduced scale.
 #cat: join_lets - Reconstruct the image from the wavelet subbands.
 #cat:
 #cat: int_sign - Get the sign of the sythesis filter coefficients.
@@ -353,10 +363,51 @@ int quantize(
    const int width,        /* image width                  */
    const int height)       /* image height                 */
 {
+   int ret;
+   short *sip;            /* quantized image */
+
+   /* Set up output buffer. */
+   if((sip = (short *) calloc(width*height, sizeof(short))) == NULL) {
+      fprintf(stderr,"ERROR : quantize : calloc : sip\n");
+      return(-90);
+   }
+
+   if((ret = quantize_count(sip, ocmp_siz, quant_vals, q_tree, q_treelen,
+                            fip, width, height, (int *)NULL, (int *)NULL))){
+      free(sip);
+      return(ret);
+   }
+
+   *osip = sip;
+   return(0);
+}
+
+/************************************************************************/
+/* Same as quantize(), but stores the quantized subbands in "sip",      */
+/* which must hold width*height values.  If "counts1" and "counts2" are */
+/* not NULL, each subband row is counted as soon as it is quantized,    */
+/* leaving in them the Huffman category counts that gen_hufftable_wsq() */
+/* would compute for block 1 and for blocks 2 and 3, so the encoder     */
+/* does not have to pass over the quantized data again.  Each array     */
+/* holds MAX_HUFFCOUNTS_WSQ+1 counts.                                   */
+/************************************************************************/
+int quantize_count(
+   short *sip,             /* quantized output             */
+   int *ocmp_siz,          /* size of quantized output     */
+   QUANT_VALS *quant_vals, /* quantization parameters      */
+   Q_TREE q_tree[],        /* quantization "tree"          */
+   const int q_treelen,    /* size of q_tree               */
+   float *fip,             /* floating point image pointer */
+   const int width,        /* image width                  */
+   const int height,       /* image height                 */
+   int *counts1,           /* block 1 category counts      */
+   int *counts2)           /* blocks 2 & 3 category counts */
+{
+   int ret;
    int i;                 /* temp counter */
    int j;                 /* interation index */
    float *fptr;           /* temp image pointer */
-   short *sip, *sptr;     /* pointers to quantized image */
+   short *sptr, *srow;    /* pointers to quantized image */
    int row, col;          /* temp image characteristic parameters */
    int cnt;               /* subband counter */
    float zbin;            /* zero bin size */
@@ -375,6 +426,8 @@ int quantize(
    float S;               /* current frac of subbands w/positive bit rate */
    float q;               /* current proportionality constant */
    float P;               /* product of 'q/Q' ratios */
+   HUFF_COUNT_WSQ hc[3];  /* category counters for the 3 blocks */
+   HUFF_COUNT_WSQ *hcp;   /* counter of current subband's block */
 
    /* Set up 'A' table. */   
    for(cnt = 0; cnt < STRT_SUBBAND_3; cnt++)
@@ -408,11 +461,6 @@ int quantize(
    }
 
 
-   /* Set up output buffer. */
-   if((sip = (short *) calloc(width*height, sizeof(short))) == NULL) {
-      fprintf(stderr,"ERROR : quantize : calloc : sip\n");
-      return(-90);
-   }
    sptr = sip;
 
    /* Set up 'm' table (these values are the reciprocal of 'm' in */
@@ -506,10 +554,31 @@ int quantize(
       quant_vals->qzbs[cnt] = 1.2 * quant_vals->qbss[cnt];
    }
 
+   /* Set up the category counts as gen_hufftable_wsq() does, with */
+   /* the last count set to 1 for block 1 and for blocks 2 & 3.    */
+   if(counts1 != (int *)NULL){
+      memset(counts1, 0, (MAX_HUFFCOUNTS_WSQ+1) * sizeof(int));
+      memset(counts2, 0, (MAX_HUFFCOUNTS_WSQ+1) * sizeof(int));
+      counts1[MAX_HUFFCOUNTS_WSQ] = 1;
+      counts2[MAX_HUFFCOUNTS_WSQ] = 1;
+      init_count_block(&hc[0], counts1);
+      init_count_block(&hc[1], counts2);
+      init_count_block(&hc[2], counts2);
+   }
+
    /* Now ready to compute and store bin widths for subbands. */
    for(cnt = 0; cnt < NUM_SUBBANDS; cnt++) {
       fptr = fip + (q_tree[cnt].y * width) + q_tree[cnt].x;
 
+      if(counts1 == (int *)NULL)
+         hcp = (HUFF_COUNT_WSQ *)NULL;
+      else if(cnt < STRT_SUBBAND_2)
+         hcp = &hc[0];
+      else if(cnt < STRT_SUBBAND_3)
+         hcp = &hc[1];
+      else
+         hcp = &hc[2];
+
       if(quant_vals->qbss[cnt] != 0.0) {
 
          zbin = quant_vals->qzbs[cnt] / 2.0;
@@ -517,6 +586,7 @@ int quantize(
          for(row = 0;
             row < q_tree[cnt].leny;
             row++, fptr += width - q_tree[cnt].lenx){
+            srow = sptr;
             for(col = 0; col < q_tree[cnt].lenx; col++) {
                if(-zbin <= *fptr && *fptr <= zbin)
                   *sptr = 0;
@@ -527,13 +597,22 @@ int quantize(
                sptr++;
                fptr++;
             }
+            /* Count the row while it is still in cache. */
+            if(hcp != (HUFF_COUNT_WSQ *)NULL &&
+               (ret = count_block_part(hcp, srow, q_tree[cnt].lenx,
+                                       MAX_HUFFCOEFF, MAX_HUFFZRUN)))
+               return(ret);
          }
       }
       else if(debug > 0)
          fprintf(stderr, "%d -> %3.6f\n", cnt, quant_vals->qbss[cnt]);
    }
 
-   *osip = sip;
+   if(counts1 != (int *)NULL)
+      for(cnt = 0; cnt < 3; cnt++)
+         if((ret = end_count_block(&hc[cnt], MAX_HUFFZRUN)))
+            return(ret);
+
    *ocmp_siz = sptr - sip;
    return(0);
 }
@@ -646,25 +725,50 @@ int wsq_decompose(float *fdata, const int width, const int height,
                   float *hifilt, const int hisz,
                   float *lofilt, const int losz)
 {
-   int num_pix, node;
+   int ret;
+   WSQ_WORK work;
+
+   init_wsq_work(&work);
+   ret = wsq_decompose_work(fdata, width, height, w_tree, w_treelen,
+                            hifilt, hisz, lofilt, losz, &work);
+   free_wsq_work(&work);
+
+   return(ret);
+}
+
+/************************************************************************/
+/* Same as wsq_decompose(), but takes the temporary pixmap and filter   */
+/* buffers from "work", growing them as needed, so that they may be     */
+/* reused for the next image.                                           */
+/************************************************************************/
+int wsq_decompose_work(float *fdata, const int width, const int height,
+                  W_TREE w_tree[], const int w_treelen,
+                  float *hifilt, const int hisz,
+                  float *lofilt, const int losz, WSQ_WORK *work)
+{
+   int num_pix, node, ret;
    float *fdata1, *fdata_bse;
 
    num_pix = width * height;
    /* Allocate temporary floating point pixmap. */
-   if((fdata1 = (float *) malloc(num_pix*sizeof(float))) == NULL) {
+   if(alloc_wsq_work_fdata(work, num_pix)) {
       fprintf(stderr,"ERROR : wsq_decompose : malloc : fdata1\n");
       return(-94);
    }
+   fdata1 = work->fdata1;
 
    /* Compute the Wavelet image decomposition. */
    for(node = 0; node < w_treelen; node++) {
       fdata_bse = fdata + (w_tree[node].y * width) + w_tree[node].x;
-      get_lets(fdata1, fdata_bse, w_tree[node].leny, w_tree[node].lenx,
-               width, 1, hifilt, hisz, lofilt, losz, w_tree[node].inv_rw);
-      get_lets(fdata_bse, fdata1, w_tree[node].lenx, w_tree[node].leny,
-               1, width, hifilt, hisz, lofilt, losz, w_tree[node].inv_cl);
+      if((ret = get_lets_work(fdata1, fdata_bse, w_tree[node].leny,
+                  w_tree[node].lenx, width, 1, hifilt, hisz, lofilt, losz,
+                  w_tree[node].inv_rw, work)))
+         return(ret);
+      if((ret = get_lets_work(fdata_bse, fdata1, w_tree[node].lenx,
+                  w_tree[node].leny, 1, width, hifilt, hisz, lofilt, losz,
+                  w_tree[node].inv_cl, work)))
+         return(ret);
    }
-   free(fdata1);
 
    return(0);
 }
@@ -890,7 +994,64 @@ int wsq_reconstruct(float *fdata, const int width, const int height,
                   W_TREE w_tree[], const int w_treelen,
                   const DTT_TABLE *dtt_table)
 {
-   int num_pix, node;
+   int ret;
+   WSQ_WORK work;
+
+   init_wsq_work(&work);
+   ret = wsq_reconstruct_work(fdata, width, height, w_tree, w_treelen,
+                              dtt_table, &work);
+   free_wsq_work(&work);
+
+   return(ret);
+}
+
+/************************************************************************/
+/* Same as wsq_reconstruct(), but takes the temporary pixmap and filter */
+/* buffers from "work", growing them as needed, so that they may be     */
+/* reused for the next image.                                           */
+/************************************************************************/
+int wsq_reconstruct_work(float *fdata, const int width, const int height,
+                  W_TREE w_tree[], const int w_treelen,
+                  const DTT_TABLE *dtt_table, WSQ_WORK *work)
+{
+   return(wsq_reconstruct_scaled_work(fdata, width, height, w_tree, w_treelen,
+                                      dtt_table, 0, work));
+}
+
+/* Parent of each node of the wavelet tree built by build_w_tree(). */
+static const int w_tree_parent[W_TREELEN] = {
+   -1, 0, 0, 0, 1, 1, 4, 4, 4, 4, 5, 5, 5, 5, 1, 14, 14, 14, 14, 15 };
+
+/* Node whose region holds the lowpass image at each reduced scale. */
+static const int w_tree_scale_node[WSQ_MAX_DECODE_SCALE+1] = {
+   0, 1, 14, 15 };
+
+/************************************************************************/
+/* Returns the node of the wavelet tree whose region holds the image    */
+/* reduced by 2^scale in each direction, once the nodes below it are    */
+/* joined, or -1 if scale is not in [0,WSQ_MAX_DECODE_SCALE].            */
+/************************************************************************/
+int wsq_scaled_node(const int scale)
+{
+   if(scale < 0 || scale > WSQ_MAX_DECODE_SCALE)
+      return(-1);
+   return(w_tree_scale_node[scale]);
+}
+
+/************************************************************************/
+/* Same as wsq_reconstruct_work(), but only the nodes at and below      */
+/* wsq_scaled_node(scale) are joined, so that the region of that node,  */
+/* at the upper left of "fdata", is left holding the lowpass image      */
+/* reduced by 2^scale in each direction.  Its pixels are those of the   */
+/* full image times the gain of the lowpass filter, squared, per level. */
+/* A scale of zero reconstructs the whole image.                        */
+/************************************************************************/
+int wsq_reconstruct_scaled_work(float *fdata, const int width,
+                  const int height, W_TREE w_tree[], const int w_treelen,
+                  const DTT_TABLE *dtt_table, const int scale,
+                  WSQ_WORK *work)
+{
+   int num_pix, node, top, up, ret;
    float *fdata1, *fdata_bse;
 
    if(dtt_table->lodef != 1) {
@@ -903,29 +1064,43 @@ int wsq_reconstruct(float *fdata, const int width, const int height,
       "ERROR: wsq_reconstruct : Hipass filter coefficients not defined\n");
       return(-96);
    }
+   if((top = wsq_scaled_node(scale)) < 0 ||
+      (scale > 0 && w_treelen != W_TREELEN)) {
+      fprintf(stderr,
+      "ERROR: wsq_reconstruct_scaled_work : invalid scale %d\n", scale);
+      return(-24);
+   }
 
    num_pix = width * height;
    /* Allocate temporary floating point pixmap. */
-   if((fdata1 = (float *) malloc(num_pix*sizeof(float))) == NULL) {
+   if(alloc_wsq_work_fdata(work, num_pix)) {
       fprintf(stderr,"ERROR : wsq_reconstruct : malloc : fdata1\n");
       return(-97);
    }
+   fdata1 = work->fdata1;
 
    /* Reconstruct floating point pixmap from wavelet subband data. */
-   for (node = w_treelen - 1; node >= 0; node--) {
+   for (node = w_treelen - 1; node >= top; node--) {
+      /* Skip nodes outside the region of the top node. */
+      if(scale > 0){
+         for(up = node; up > top; up = w_tree_parent[up]);
+         if(up != top)
+            continue;
+      }
       fdata_bse = fdata + (w_tree[node].y * width) + w_tree[node].x;
-      join_lets(fdata1, fdata_bse, w_tree[node].lenx, w_tree[node].leny,
-                  1, width,
+      if((ret = join_lets_work(fdata1, fdata_bse, w_tree[node].lenx,
+                  w_tree[node].leny, 1, width,
                   dtt_table->hifilt, dtt_table->hisz,
                   dtt_table->lofilt, dtt_table->losz,
-                  w_tree[node].inv_cl);
-      join_lets(fdata_bse, fdata1, w_tree[node].leny, w_tree[node].lenx,
-                  width, 1,
+                  w_tree[node].inv_cl, work)))
+         return(ret);
+      if((ret = join_lets_work(fdata_bse, fdata1, w_tree[node].leny,
+                  w_tree[node].lenx, width, 1,
                   dtt_table->hifilt, dtt_table->hisz,
                   dtt_table->lofilt, dtt_table->losz,
-                  w_tree[node].inv_rw);
+                  w_tree[node].inv_rw, work)))
+         return(ret);
    }
-   free(fdata1);
 
    return(0);
 }
@@ -81,6 +81,24 @@ of the software.
 #define BINARY_IMG_EXT        "brw"
 #define XYT_EXT               "xyt"
 
+/*************************************************************************/
+/*        OUTPUT SELECTION FLAGS                                         */
+/*************************************************************************/
+/* Bits of a mask selecting the results an extraction passes back and  */
+/* the files written from them.  Results that are not selected are     */
+/* passed back as NULL and, where the algorithm allows, never built.    */
+#define LFS_OUT_XYT              0x0001 /* minutiae XYT's & qualities    */
+#define LFS_OUT_MIN              0x0002 /* minutiae with neighbor ridge  */
+                                        /* counts                        */
+#define LFS_OUT_QUALITY_MAP      0x0004
+#define LFS_OUT_DIRECTION_MAP    0x0008
+#define LFS_OUT_LOW_CONTRAST_MAP 0x0010
+#define LFS_OUT_LOW_FLOW_MAP     0x0020
+#define LFS_OUT_HIGH_CURVE_MAP   0x0040
+#define LFS_OUT_BINARY_IMAGE     0x0080
+#define LFS_OUT_AN2K             0x0100 /* updated ANSI/NIST file        */
+#define LFS_OUT_ALL              0x01ff
+
 /*************************************************************************/
 /*        MINUTIAE XYT REPRESENTATION SCHEMES                            */
 /*************************************************************************/
@@ -281,8 +299,59 @@ typedef struct lfsparms{
    /* Ridge Counting Controls */
    int    max_nbrs;
    int    max_ridge_steps;
+
+   /* Threading Controls */
+   int    num_threads;
 } LFSPARMS;
 
+/* Indices of the false minutia removal steps of remove_false_minutia_V2() */
+/* counted in LFSSTATS.                                                   */
+#define RM_ISLANDS_AND_LAKES     0
+#define RM_HOLES                 1
+#define RM_POINTING_INVBLOCK     2
+#define RM_NEAR_INVBLOCK         3
+#define RM_SIDE_MINUTIAE         4
+#define RM_HOOKS                 5
+#define RM_OVERLAPS              6
+#define RM_MALFORMATIONS         7
+#define RM_PORES                 8
+#define NUM_RM_STEPS             9
+
+/* Wall times (in seconds) and counts recorded for one image by */
+/* lfs_detect_minutiae_V2_ex() and get_minutiae_ex().           */
+typedef struct lfsstats{
+   int iw, ih;
+   double maps_time;
+   double binarize_time;
+   double detect_time;
+   double remove_time;
+   double ridge_count_time;
+   double quality_time;      /* Zero unless from get_minutiae_ex(). */
+   double total_time;
+   int num_blocks;
+   int low_contrast_blocks;
+   int low_flow_blocks;
+   int high_curve_blocks;
+   int candidate_minutiae;   /* Detected, before any were removed.  */
+   int removed[NUM_RM_STEPS];
+   int num_minutiae;         /* Remaining after removal.            */
+} LFSSTATS;
+
+/* Lookup tables used by lfs_detect_minutiae_V2() that depend only */
+/* on the LFS parameters and the width of the input image.  They   */
+/* are built by init_lfs_extractor() and init_extractor_grids(),   */
+/* and reused across images by get_minutiae_ex().                  */
+typedef struct lfsextractor{
+   LFSPARMS lfsparms;      /* Copy of the parameters the tables are for. */
+   int maxpad;
+   DIR2RAD *dir2rad;
+   DFTWAVES *dftwaves;
+   int grids_w;            /* Image width of the grids below, 0 if none. */
+   ROTGRIDS *dftgrids;
+   ROTGRIDS *dirbingrids;
+   LFSSTATS stats;         /* Times and counts of the last image.        */
+} LFSEXTRACTOR;
+
 /*************************************************************************/
 /*        LFS CONSTANT DEFINITIONS                                       */
 /*************************************************************************/
@@ -636,6 +705,30 @@ typedef struct lfsparms{
 /* Maximum number of contour steps taken to validate a ridge crossing. */
 #define MAX_RIDGE_STEPS         10
 
+
+/***** THREADING CONSTANTS *****/
+
+/* Number of threads used to analyze and binarize the blocks of a  */
+/* single image.  One processes the image serially; zero uses one   */
+/* thread per online processor.  Results do not depend on it.       */
+#define NUM_THREADS              1
+
+
+/***** VECTOR INSTRUCTION CONSTANTS *****/
+
+/* Vector kernels are built for x86-64 with GCC 4.9+ or Clang, */
+/* unless LFS_NO_SIMD is defined.  The kernel used is chosen at */
+/* run time from the host's CPU features.                        */
+#if !defined(LFS_NO_SIMD) && defined(__x86_64__) && \
+    (defined(__clang__) || __GNUC__ > 4 || \
+     (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define LFS_X86_SIMD
+#endif
+
+#define LFS_ISA_SCALAR           0
+#define LFS_ISA_SSE2             1
+#define LFS_ISA_AVX2             2
+
 /*************************************************************************/
 /*         QUALITY/RELIABILITY DEFINITIONS                               */
 /*************************************************************************/
@@ -741,6 +834,10 @@ extern int binarize_image_V2(unsigned char **, int *, int *,
                      unsigned char *, const int, const int,
                      const int *, const int, const int,
                      const int, const ROTGRIDS *);
+extern int binarize_image_V2_ex(unsigned char **, int *, int *,
+                     unsigned char *, const int, const int,
+                     const int *, const int, const int,
+                     const int, const ROTGRIDS *, const int);
 extern int dirbinarize(const unsigned char *, const int, const ROTGRIDS *);
 extern int isobinarize(unsigned char *, const int, const int, const int);
 
@@ -799,6 +896,17 @@ extern int lfs_detect_minutiae_V2(MINUTIAE **,
                      unsigned char *, const int, const int,
                      const LFSPARMS *);
 
+extern int lfs_detect_minutiae_V2_ex(MINUTIAE **,
+                     int **, int **, int **, int **, int *, int *,
+                     unsigned char **, int *, int *,
+                     unsigned char *, const int, const int,
+                     LFSEXTRACTOR *);
+extern int lfs_detect_minutiae_V2_sel(MINUTIAE **,
+                     int **, int **, int **, int **, int *, int *,
+                     unsigned char **, int *, int *,
+                     unsigned char *, const int, const int,
+                     const int, LFSEXTRACTOR *);
+
 /* dft.c */
 extern int dft_dir_powers(double **, unsigned char *, const int,
                      const int, const int, const DFTWAVES *,
@@ -816,6 +924,7 @@ extern void free_dir2rad(DIR2RAD *);
 extern void free_dftwaves(DFTWAVES *);
 extern void free_rotgrids(ROTGRIDS *);
 extern void free_dir_powers(double **, const int);
+extern void free_lfs_extractor(LFSEXTRACTOR *);
 
 /* getmin.c */
 extern int get_minutiae(MINUTIAE **, int **, int **, int **,
@@ -823,6 +932,16 @@ extern int get_minutiae(MINUTIAE **, int **, int **, int **,
                  unsigned char **, int *, int *, int *,
                  unsigned char *, const int, const int,
                  const int, const double, const LFSPARMS *);
+extern int get_minutiae_ex(MINUTIAE **, int **, int **, int **,
+                 int **, int **, int *, int *,
+                 unsigned char **, int *, int *, int *,
+                 unsigned char *, const int, const int,
+                 const int, const double, LFSEXTRACTOR *);
+extern int get_minutiae_sel(MINUTIAE **, int **, int **, int **,
+                 int **, int **, int *, int *,
+                 unsigned char **, int *, int *, int *,
+                 unsigned char *, const int, const int,
+                 const int, const double, const int, LFSEXTRACTOR *);
 
 /* imgutil.c */
 extern void bits_6to8(unsigned char *, const int, const int);
@@ -846,6 +965,8 @@ extern int get_max_padding(const int, const int, const int, const int);
 extern int get_max_padding_V2(const int, const int, const int, const int);
 extern int init_rotgrids(ROTGRIDS **, const int, const int, const int,
                      const double, const int, const int, const int, const int);
+extern int init_lfs_extractor(LFSEXTRACTOR **, const LFSPARMS *);
+extern int init_extractor_grids(LFSEXTRACTOR *, const int, const int);
 extern int alloc_dir_powers(double ***, const int, const int);
 extern int alloc_power_stats(int **, double **, int **, double **, const int);
 
@@ -1107,6 +1228,10 @@ extern int remove_false_minutia_V2(MINUTIAE *,
                   unsigned char *, const int, const int,
                   int *, int *, int *, const int, const int,
                   const LFSPARMS *);
+extern int remove_false_minutia_V2_ex(MINUTIAE *,
+                  unsigned char *, const int, const int,
+                  int *, int *, int *, const int, const int,
+                  const LFSPARMS *, int *);
 extern int remove_holes(MINUTIAE *, unsigned char *, const int, const int,
                   const LFSPARMS *);
 extern int remove_hooks(MINUTIAE *,
@@ -1145,6 +1270,10 @@ extern int remove_or_adjust_side_minutiae_V2(MINUTIAE *,
 extern int write_text_results(char *, const int, const int, const int,
                  const MINUTIAE *, int *, int *, int *, int *, int *,
                  const int, const int);
+extern int write_text_results_sel(char *, const int, const int,
+                 const int, const int,
+                 const MINUTIAE *, int *, int *, int *, int *, int *,
+                 const int, const int);
 extern int write_minutiae_XYTQ(char *ofile, const int,
                  const MINUTIAE *, const int, const int);
 extern void dump_map(FILE *, int *, const int, const int);
@@ -1195,6 +1324,26 @@ extern void dump_shape(FILE *, const SHAPE *);
 extern int shape_from_contour(SHAPE **, const int *, const int *, const int);
 extern void sort_row_on_x(ROW *);
 
+/* simd.c */
+extern int lfs_simd_isa(void);
+#ifdef LFS_X86_SIMD
+extern void dft_dir_powers_sse2(double **, const unsigned char *,
+                     const DFTWAVES *, const ROTGRIDS *, double *);
+extern void dft_dir_powers_avx2(double **, const unsigned char *,
+                     const DFTWAVES *, const ROTGRIDS *, double *);
+extern void dirbinarize_tile_sse2(unsigned char *, const int,
+                     const unsigned char *, const int, const int,
+                     const int, const ROTGRIDS *, const int);
+extern void dirbinarize_tile_avx2(unsigned char *, const int,
+                     const unsigned char *, const int, const int,
+                     const int, const ROTGRIDS *, const int);
+#endif
+
+/* stats.c */
+extern double lfs_wall_time(void);
+extern int count_map_flags(const int *, const int, const int);
+extern void print_lfs_stats_json(FILE *, const char *, const LFSSTATS *);
+
 /* sort.c */
 extern int sort_indices_int_inc(int **, int *, const int);
 extern int sort_indices_double_inc(int **, double *, const int);
@@ -1238,6 +1387,10 @@ extern void lfs2nist_format(MINUTIAE *, int, int);
 /*************************************************************************/
 /*        EXTERNAL GLOBAL VARIABLE DEFINITIONS                           */
 /*************************************************************************/
+/* These are only read by the library, so any number of threads may  */
+/* extract minutiae at once, each with its own LFSEXTRACTOR (or with  */
+/* get_minutiae()).  To use other parameters, modify a copy of        */
+/* lfsparms_V2 rather than the global itself.                         */
 extern double dft_coefs[];
 extern LFSPARMS lfsparms;
 extern LFSPARMS lfsparms_V2;
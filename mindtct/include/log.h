@@ -57,10 +57,9 @@ of the software.
 #define LOG_FILE     "log.txt"
 #endif
 
+/* The log report file is shared by the whole process, so a library */
+/* built with LOG_REPORT must only extract one image at a time.      */
 extern FILE *logfp;
-extern int avrdir;
-extern float dir_strength;
-extern int nvalid;
 
 extern int open_logfile(void);
 extern int close_logfile(void);
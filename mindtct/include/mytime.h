@@ -48,6 +48,9 @@ of the software.
 /* this file needed to support timer and ticks */
 /* UPDATED: 03/16/2005 by MDG */
 
+/* The timers and time accumulators named in these macros are local */
+/* variables of the routine being timed, so each call keeps its own. */
+
 #ifdef TIMER
 #include <sys/types.h>
 #endif
@@ -84,23 +87,5 @@ of the software.
 extern clock_t ticks(void);
 extern int ticksPerSec(void);
 
-extern clock_t total_timer;
-extern float total_time;
-
-extern clock_t imap_timer;
-extern float imap_time;
-
-extern clock_t bin_timer;
-extern float bin_time;
-
-extern clock_t minutia_timer;
-extern float minutia_time;
-
-extern clock_t rm_minutia_timer;
-extern float rm_minutia_time;
-
-extern clock_t ridge_count_timer;
-extern float ridge_count_time;
-
 #endif
 
@@ -0,0 +1,426 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+/***********************************************************************
+      PACKAGE: NIST Fingerprint Minutiae Detection
+
+      FILE:    LFSSTRESS.C
+
+#cat: lfsstress - Checks that LFS extractors can be used concurrently.
+#cat:             Each grayscale image given is first processed serially
+#cat:             with get_minutiae().  Then a number of threads, each
+#cat:             with its own LFSEXTRACTOR, process every image again
+#cat:             with get_minutiae_ex(), all at once and starting at
+#cat:             different images, and their minutiae, maps and
+#cat:             binarized images are compared with the serial ones.
+#cat:             Exits with 1 if any result differs.
+
+***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <an2k.h>
+#include <lfs.h>
+#include <imgdecod.h>
+#include <version.h>
+
+#define MAX_STRESS_THREADS  64
+
+/* The results of one detection. */
+typedef struct lfsresult{
+   MINUTIAE *minutiae;
+   int *quality_map, *direction_map, *low_contrast_map;
+   int *low_flow_map, *high_curve_map;
+   int map_w, map_h;
+   unsigned char *bdata;
+   int bw, bh, bd;
+} LFSRESULT;
+
+/* A decoded input image and its serial results. */
+typedef struct stressimg{
+   char *file;
+   unsigned char *idata;
+   int iw, ih, id;
+   double ippmm;
+   LFSRESULT ref;
+} STRESSIMG;
+
+/* State shared by the stress threads. */
+typedef struct stress{
+   STRESSIMG *imgs;
+   int nimgs;
+   int repeats;
+   LFSPARMS *lfsparms;
+   int ndiffs;
+   int nfailed;
+   pthread_mutex_t lock;
+} STRESS;
+
+/* One stress thread. */
+typedef struct stressthr{
+   STRESS *stress;
+   int id;
+   pthread_t thread;
+} STRESSTHR;
+
+void procargs(int, char **, int *, int *, int *, int *);
+void usage(char *);
+int detect_image(LFSRESULT *, STRESSIMG *, const LFSPARMS *,
+                 LFSEXTRACTOR *);
+int same_result(LFSRESULT *, LFSRESULT *);
+void free_result(LFSRESULT *);
+void *stress_thread(void *);
+
+int debug = 0;
+
+/*************************************************************************
+**************************************************************************/
+int main(int argc, char *argv[])
+{
+   int nthreads, repeats, map_threads, optind;
+   int i, ret, img_type, ilen, ippi;
+   LFSPARMS serial_parms, stress_parms;
+   STRESS stress;
+   STRESSTHR threads[MAX_STRESS_THREADS];
+
+   procargs(argc, argv, &nthreads, &repeats, &map_threads, &optind);
+
+   /* Modify copies, as lfs.h asks, rather than lfsparms_V2. */
+   memcpy(&serial_parms, &lfsparms_V2, sizeof(LFSPARMS));
+   serial_parms.num_threads = 1;
+   memcpy(&stress_parms, &lfsparms_V2, sizeof(LFSPARMS));
+   stress_parms.num_threads = map_threads;
+
+   stress.nimgs = argc - optind;
+   stress.repeats = repeats;
+   stress.lfsparms = &stress_parms;
+   stress.ndiffs = 0;
+   stress.nfailed = 0;
+   stress.imgs = (STRESSIMG *)calloc(stress.nimgs, sizeof(STRESSIMG));
+   if(stress.imgs == (STRESSIMG *)NULL){
+      fprintf(stderr, "ERROR : main : calloc : imgs\n");
+      exit(-2);
+   }
+
+   /* Decode the images and process them serially, one at a time. */
+   for(i = 0; i < stress.nimgs; i++){
+      STRESSIMG *img = &(stress.imgs[i]);
+
+      img->file = argv[optind + i];
+      if((ret = read_and_decode_grayscale_image(img->file, &img_type,
+                           &(img->idata), &ilen, &(img->iw), &(img->ih),
+                           &(img->id), &ippi)))
+         exit(ret);
+      if(img->id != 8){
+         fprintf(stderr, "ERROR : main : %s : image depth %d != 8\n",
+                 img->file, img->id);
+         exit(-3);
+      }
+      if(ippi == UNDEFINED)
+         img->ippmm = DEFAULT_PPI / (double)MM_PER_INCH;
+      else
+         img->ippmm = ippi / (double)MM_PER_INCH;
+
+      if((ret = detect_image(&(img->ref), img, &serial_parms,
+                             (LFSEXTRACTOR *)NULL)))
+         exit(ret);
+   }
+
+   /* Then process them again, all threads at once. */
+   pthread_mutex_init(&(stress.lock), (pthread_mutexattr_t *)NULL);
+   for(i = 0; i < nthreads; i++){
+      threads[i].stress = &stress;
+      threads[i].id = i;
+      if(pthread_create(&(threads[i].thread), (pthread_attr_t *)NULL,
+                        stress_thread, &(threads[i]))){
+         fprintf(stderr, "ERROR : main : pthread_create failed\n");
+         exit(-4);
+      }
+   }
+   for(i = 0; i < nthreads; i++)
+      pthread_join(threads[i].thread, (void **)NULL);
+   pthread_mutex_destroy(&(stress.lock));
+
+   printf("%d threads x %d images x %d repeats: %d failed, %d differ\n",
+          nthreads, stress.nimgs, repeats, stress.nfailed, stress.ndiffs);
+
+   for(i = 0; i < stress.nimgs; i++){
+      free(stress.imgs[i].idata);
+      free_result(&(stress.imgs[i].ref));
+   }
+   free(stress.imgs);
+
+   exit((stress.ndiffs || stress.nfailed) ? 1 : 0);
+}
+
+/*************************************************************************
+**************************************************************************
+   PROCARGS - Process command line arguments
+   Input:
+      argc         - system provided number of arguments on the command line
+      argv         - system provided list of command line argument strings
+   Output:
+      onthreads    - number of concurrent extractor threads
+      orepeats     - times each thread processes every image
+      omap_threads - LFSPARMS num_threads used by the extractors
+      ooptind      - index of the first image file in argv
+**************************************************************************/
+void procargs(int argc, char **argv, int *onthreads, int *orepeats,
+              int *omap_threads, int *ooptind)
+{
+   int i;
+
+   *onthreads = 4;
+   *orepeats = 3;
+   *omap_threads = 1;
+
+   if((argc == 2) && (strcmp(argv[1], "-version") == 0)) {
+      getVersion();
+      exit(0);
+   }
+
+   i = 1;
+   while((i < argc) && (argv[i][0] == '-')){
+      if(i + 1 >= argc)
+         usage(argv[0]);
+      if(strcmp(argv[i], "-t") == 0){
+         *onthreads = atoi(argv[i+1]);
+         if((*onthreads < 1) || (*onthreads > MAX_STRESS_THREADS)){
+            fprintf(stderr, "ERROR : procargs : threads must be 1..%d\n",
+                    MAX_STRESS_THREADS);
+            exit(-1);
+         }
+      }
+      else if(strcmp(argv[i], "-r") == 0){
+         *orepeats = atoi(argv[i+1]);
+         if(*orepeats < 1){
+            fprintf(stderr, "ERROR : procargs : repeats must be >= 1\n");
+            exit(-1);
+         }
+      }
+      else if(strcmp(argv[i], "-m") == 0){
+         *omap_threads = atoi(argv[i+1]);
+         if(*omap_threads < 0){
+            fprintf(stderr, "ERROR : procargs : map threads must be >= 0\n");
+            exit(-1);
+         }
+      }
+      else
+         usage(argv[0]);
+      i += 2;
+   }
+
+   if(i >= argc)
+      usage(argv[0]);
+   *ooptind = i;
+}
+
+/*************************************************************************
+**************************************************************************
+   USAGE - Print the command line options and exit
+**************************************************************************/
+void usage(char *prog)
+{
+   fprintf(stderr, "Usage:\n");
+   fprintf(stderr, "       %s [-t threads] [-r repeats] [-m map-threads] "
+                   "image ...\n", prog);
+   fprintf(stderr, "       -t threads     : concurrent extractors [4]\n");
+   fprintf(stderr, "       -r repeats     : times each thread processes "
+                   "every image [3]\n");
+   fprintf(stderr, "       -m map-threads : threads each extractor uses "
+                   "for the maps,\n");
+   fprintf(stderr, "                        0 for one per processor [1]\n");
+   exit(-1);
+}
+
+/*************************************************************************
+**************************************************************************
+   DETECT_IMAGE - Detect the minutiae of an image, with an extractor if
+                  given, else with get_minutiae() and the parameters
+   Input:
+      img       - decoded image
+      lfsparms  - parameters used when extractor is NULL
+      extractor - if not NULL, the extractor to use
+   Output:
+      result    - minutiae, maps and binarized image
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int detect_image(LFSRESULT *result, STRESSIMG *img,
+                 const LFSPARMS *lfsparms, LFSEXTRACTOR *extractor)
+{
+   if(extractor != (LFSEXTRACTOR *)NULL)
+      return(get_minutiae_ex(&(result->minutiae), &(result->quality_map),
+                    &(result->direction_map), &(result->low_contrast_map),
+                    &(result->low_flow_map), &(result->high_curve_map),
+                    &(result->map_w), &(result->map_h), &(result->bdata),
+                    &(result->bw), &(result->bh), &(result->bd),
+                    img->idata, img->iw, img->ih, img->id, img->ippmm,
+                    extractor));
+
+   return(get_minutiae(&(result->minutiae), &(result->quality_map),
+                 &(result->direction_map), &(result->low_contrast_map),
+                 &(result->low_flow_map), &(result->high_curve_map),
+                 &(result->map_w), &(result->map_h), &(result->bdata),
+                 &(result->bw), &(result->bh), &(result->bd),
+                 img->idata, img->iw, img->ih, img->id, img->ippmm,
+                 lfsparms));
+}
+
+/*************************************************************************
+**************************************************************************
+   SAME_RESULT - Compare two detections of the same image
+   Return Code:
+      TRUE      - minutiae, neighbors, ridge counts, maps and binarized
+                  images are identical
+      FALSE     - otherwise
+**************************************************************************/
+int same_result(LFSRESULT *a, LFSRESULT *b)
+{
+   int i, map_size;
+   MINUTIA *ma, *mb;
+
+   if((a->minutiae->num != b->minutiae->num) ||
+      (a->map_w != b->map_w) || (a->map_h != b->map_h) ||
+      (a->bw != b->bw) || (a->bh != b->bh) || (a->bd != b->bd))
+      return(FALSE);
+
+   for(i = 0; i < a->minutiae->num; i++){
+      ma = a->minutiae->list[i];
+      mb = b->minutiae->list[i];
+      if((ma->x != mb->x) || (ma->y != mb->y) ||
+         (ma->ex != mb->ex) || (ma->ey != mb->ey) ||
+         (ma->direction != mb->direction) ||
+         (ma->reliability != mb->reliability) ||
+         (ma->type != mb->type) || (ma->appearing != mb->appearing) ||
+         (ma->feature_id != mb->feature_id) ||
+         (ma->num_nbrs != mb->num_nbrs))
+         return(FALSE);
+      if(ma->num_nbrs > 0 &&
+         (memcmp(ma->nbrs, mb->nbrs, ma->num_nbrs * sizeof(int)) ||
+          memcmp(ma->ridge_counts, mb->ridge_counts,
+                 ma->num_nbrs * sizeof(int))))
+         return(FALSE);
+   }
+
+   map_size = a->map_w * a->map_h * sizeof(int);
+   if(memcmp(a->quality_map, b->quality_map, map_size) ||
+      memcmp(a->direction_map, b->direction_map, map_size) ||
+      memcmp(a->low_contrast_map, b->low_contrast_map, map_size) ||
+      memcmp(a->low_flow_map, b->low_flow_map, map_size) ||
+      memcmp(a->high_curve_map, b->high_curve_map, map_size))
+      return(FALSE);
+
+   if(memcmp(a->bdata, b->bdata, a->bw * a->bh * (a->bd >> 3)))
+      return(FALSE);
+
+   return(TRUE);
+}
+
+/*************************************************************************
+**************************************************************************
+   FREE_RESULT - Deallocate the results of a detection
+**************************************************************************/
+void free_result(LFSRESULT *result)
+{
+   free_minutiae(result->minutiae);
+   free(result->quality_map);
+   free(result->direction_map);
+   free(result->low_contrast_map);
+   free(result->low_flow_map);
+   free(result->high_curve_map);
+   free(result->bdata);
+}
+
+/*************************************************************************
+**************************************************************************
+   STRESS_THREAD - Process every image repeats times with the thread's
+                   own extractor, starting at a different image in each
+                   thread, and count the results that fail or differ
+                   from the serial ones
+**************************************************************************/
+void *stress_thread(void *arg)
+{
+   STRESSTHR *thr = (STRESSTHR *)arg;
+   STRESS *stress = thr->stress;
+   LFSEXTRACTOR *extractor;
+   LFSRESULT result;
+   int r, i, k, ret, differ;
+
+   if((ret = init_lfs_extractor(&extractor, stress->lfsparms))){
+      pthread_mutex_lock(&(stress->lock));
+      stress->nfailed += stress->repeats * stress->nimgs;
+      pthread_mutex_unlock(&(stress->lock));
+      return(NULL);
+   }
+
+   for(r = 0; r < stress->repeats; r++){
+      for(i = 0; i < stress->nimgs; i++){
+         k = (i + thr->id) % stress->nimgs;
+         ret = detect_image(&result, &(stress->imgs[k]),
+                            stress->lfsparms, extractor);
+         differ = 0;
+         if(!ret){
+            differ = !same_result(&result, &(stress->imgs[k].ref));
+            free_result(&result);
+         }
+         if(ret || differ){
+            pthread_mutex_lock(&(stress->lock));
+            if(ret)
+               stress->nfailed++;
+            else
+               stress->ndiffs++;
+            fprintf(stderr, "%s : thread %d, repeat %d : %s\n",
+                    stress->imgs[k].file, thr->id, r,
+                    ret ? "failed" : "differs from the serial result");
+            pthread_mutex_unlock(&(stress->lock));
+         }
+      }
+   }
+
+   free_lfs_extractor(extractor);
+   return(NULL);
+}
@@ -61,18 +61,85 @@ of the software.
 #cat:           Results are written to various output files with
 #cat:           predefined extensions appeneded to a specified output
 #cat:           root path.
+#cat:           In batch mode, a list of input files and output roots, or
+#cat:           every file in a directory, is processed in one run by
+#cat:           a pool of worker threads, and one status line with the
+#cat:           time taken is printed per image.  The NFIQ of each
+#cat:           image may also be computed from the same detection.
 
 ***********************************************************************/
 
+#include <usebsd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/param.h>
 #include <an2k.h>
 #include <lfs.h>
+#include <nfiq.h>
 #include <imgdecod.h>
 #include <imgboost.h>
 #include <img_io.h>
 #include <version.h>
-void procargs(int, char **, int *, int *, char **, char **);
+#include <util.h>
+
+/* An input image and the root name of its output files.  */
+/* Both names share one allocation, starting at ifile.     */
+typedef struct imgjob{
+   char *ifile;
+   char *oroot;
+} IMGJOB;
+
+/* State shared by the workers of a batch run. */
+typedef struct batch{
+   IMGJOB *jobs;
+   int njobs;
+   int boostflag, m1flag, jsonflag, nfiqflag, files;
+   LFSEXTRACTOR **extractors;   /* One per worker. */
+   int nfailed;
+   pthread_mutex_t iolock;      /* Serializes image decoding and     */
+                                /* ANSI/NIST output, which use       */
+                                /* library globals.                  */
+   pthread_mutex_t outlock;     /* Serializes status lines.          */
+} BATCH;
+
+/* The output files, each named "<oroot>.<ext>". */
+static const struct {
+   char *ext;
+   int flag;
+} outfiles[] = {
+   { MIN_TXT_EXT,          LFS_OUT_MIN },
+   { XYT_EXT,              LFS_OUT_XYT },
+   { QUALITY_MAP_EXT,      LFS_OUT_QUALITY_MAP },
+   { DIRECTION_MAP_EXT,    LFS_OUT_DIRECTION_MAP },
+   { LOW_CONTRAST_MAP_EXT, LFS_OUT_LOW_CONTRAST_MAP },
+   { LOW_FLOW_MAP_EXT,     LFS_OUT_LOW_FLOW_MAP },
+   { HIGH_CURVE_MAP_EXT,   LFS_OUT_HIGH_CURVE_MAP },
+   { BINARY_IMG_EXT,       LFS_OUT_BINARY_IMAGE },
+   { AN2K_OUT_EXT,         LFS_OUT_AN2K }
+};
+
+void procargs(int, char **, int *, int *, int *, int *, int *, int *,
+              int *, char **, int *, char **, char **);
+int parse_outputs(char *);
+int oroot_fits(const char *);
+void usage(char *);
+int mindtct_image(char *, char *, const int, const int, const int,
+                  int *, float *, LFSEXTRACTOR *, pthread_mutex_t *);
+int read_finger_image(char *, int *, unsigned char **, int *, int *, int *,
+                  double *, int *, int *, ANSI_NIST **);
+int run_batch(IMGJOB *, const int, const int, const int, const int,
+                  const int, const int, const int, const LFSPARMS *);
+int batch_image(void *, const int, const int);
+int read_job_list(IMGJOB **, int *, char *);
+int read_job_dir(IMGJOB **, int *, char *, char *);
+int add_job(IMGJOB **, int *, int *, const char *, const char *);
+void free_jobs(IMGJOB *, const int);
+static int cmp_jobs(const void *, const void *);
 
 int debug = 0;
 
@@ -80,103 +147,158 @@ int debug = 0;
 **************************************************************************/
 int main(int argc, char *argv[])
 {
-   int boostflag, m1flag;
-   char *ifile, *oroot, ofile[MAXPATHLEN];
+   int boostflag, m1flag, jsonflag, nfiqflag, nthreads, files;
+   int nworkers, dirflag;
+   char *listfile, *ifile, *oroot;
+   int ret, nfiq;
+   float conf;
+   LFSPARMS parms;
+   LFSEXTRACTOR *extractor;
+   IMGJOB *jobs;
+   int njobs;
+
+   /* Process command line arguments. */
+   procargs(argc, argv, &boostflag, &m1flag, &jsonflag, &nfiqflag,
+            &nthreads, &files, &nworkers, &listfile, &dirflag,
+            &ifile, &oroot);
+
+   /* Set the map threads in a copy, leaving lfsparms_V2 unchanged. */
+   memcpy(&parms, &lfsparms_V2, sizeof(LFSPARMS));
+   parms.num_threads = nthreads;
+
+   /* If batch mode ... */
+   if((listfile != (char *)NULL) || dirflag){
+      if(listfile != (char *)NULL)
+         ret = read_job_list(&jobs, &njobs, listfile);
+      else
+         ret = read_job_dir(&jobs, &njobs, ifile, oroot);
+      if(ret)
+         exit(ret);
+
+      ret = run_batch(jobs, njobs, nworkers,
+                      boostflag, m1flag, jsonflag, nfiqflag, files,
+                      &parms);
+      free_jobs(jobs, njobs);
+      exit(ret);
+   }
+
+   if(!oroot_fits(oroot)){
+      fprintf(stderr, "ERROR : main : path too long : %s\n", oroot);
+      exit(-3);
+   }
+
+   if((ret = init_lfs_extractor(&extractor, &parms)))
+      exit(ret);
+
+   ret = mindtct_image(ifile, oroot, boostflag, m1flag, files,
+                       nfiqflag ? &nfiq : (int *)NULL, &conf,
+                       extractor, (pthread_mutex_t *)NULL);
+
+   /* Print NFIQ as "nfiq -v" would, if requested. */
+   if(!ret && nfiqflag)
+      printf("%d\t%4.2f\n", nfiq, conf);
+
+   /* Print stage times and counts if requested. */
+   if(!ret && jsonflag)
+      print_lfs_stats_json(stdout, ifile, &(extractor->stats));
+
+   free_lfs_extractor(extractor);
+
+   exit(ret);
+}
+
+/*************************************************************************
+**************************************************************************
+   MINDTCT_IMAGE - Detect the minutiae in one fingerprint image file and
+                   write the selected results
+   Input:
+      ifile     - input image file name
+      oroot     - root name of the output files to be created
+      boostflag - if set, contrast boost the image
+      m1flag    - if set, write "*.xyt" according to ANSI INCITS 378-2004
+      files     - mask of LFS_OUT_* bits selecting the output files
+      extractor - LFS parameters and lookup tables
+      iolock    - if not NULL, held while decoding the image and writing
+                  the ANSI/NIST output
+   Output:
+      onfiq     - if not NULL, NFIQ computed from the same detection
+      oconf     - NFIQ confidence, set when onfiq is not NULL
+      extractor - stats holds the times and counts for the image
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int mindtct_image(char *ifile, char *oroot, const int boostflag,
+                  const int m1flag, const int files,
+                  int *onfiq, float *oconf,
+                  LFSEXTRACTOR *extractor, pthread_mutex_t *iolock)
+{
+   char ofile[MAXPATHLEN];
    unsigned char *idata, *bdata;
    int img_type;
-   int ilen, iw, ih, id, ippi, bw, bh, bd;
+   int iw, ih, id, bw, bh, bd;
    double ippmm;
    int img_idc, img_imp;
    int *direction_map, *low_contrast_map, *low_flow_map;
    int *high_curve_map, *quality_map;
    int map_w, map_h;
-   int ret;
+   int ret, outputs, nfiq_opt = 0;
    MINUTIAE *minutiae;
    ANSI_NIST *ansi_nist;
-   RECORD *imgrecord;
-   int imgrecord_i;
-
-   /* Process command line arguments. */
-   procargs(argc, argv, &boostflag, &m1flag, &ifile, &oroot);
 
    /* 1. READ FINGERPRINT IMAGE FROM FILE INTO MEMORY. */
-
-   /* Is input file in ANSI/NIST format? */
-   if((ret = is_ANSI_NIST_file(ifile)) < 0) {
-      /* If error ... */
-      exit(ret);
-   }
-
-   /* If file is ANSI/NIST format ... */
-   if(ret){
-      img_type = ANSI_NIST_IMG;
-      /* Parse ANSI/NIST file into memory structure */
-      if((ret = read_ANSI_NIST_file(ifile, &ansi_nist)))
-         exit(ret);
-      /* Get first grayscale fingerprint record in ANSI/NIST file. */
-      if((ret = get_first_grayprint(&idata, &iw, &ih, &id,
-                                &ippmm, &img_idc, &img_imp,
-                                &imgrecord, &imgrecord_i, ansi_nist)) < 0){
-         /* If error ... */
-         free_ANSI_NIST(ansi_nist);
-         exit(ret);
-      }
-      /* If grayscale fingerprint not found ... */
-      if(!ret){
-         free_ANSI_NIST(ansi_nist);
-         fprintf(stderr, "ERROR : main : ");
-         fprintf(stderr, "grayscale image record not found in %s\n", ifile);
-         exit(-2);
-      }
-   }
-   /* Otherwise, not an ANSI/NIST file */
-   else{
-      /* Read the image data from file into memory */
-      if((ret = read_and_decode_grayscale_image(ifile, &img_type,
-                    &idata, &ilen, &iw, &ih, &id, &ippi))){
-         exit(ret);
-      }
-      /* If image ppi not defined, then assume 500 */
-      if(ippi == UNDEFINED)
-         ippmm = DEFAULT_PPI / (double)MM_PER_INCH;
-      else 
-         ippmm = ippi / (double)MM_PER_INCH;
-   }
+   if(iolock != (pthread_mutex_t *)NULL)
+      pthread_mutex_lock(iolock);
+   ret = read_finger_image(ifile, &img_type, &idata, &iw, &ih, &id,
+                           &ippmm, &img_idc, &img_imp, &ansi_nist);
+   if(iolock != (pthread_mutex_t *)NULL)
+      pthread_mutex_unlock(iolock);
+   if(ret)
+      return(ret);
 
    /* 2. ENHANCE IMAGE CONTRAST IF REQUESTED */
    if(boostflag)
-      trim_histtails_contrast_boost(idata, iw, ih); 
+      trim_histtails_contrast_boost(idata, iw, ih);
 
    /* 3. GET MINUTIAE & BINARIZED IMAGE. */
-   if((ret = get_minutiae(&minutiae, &quality_map, &direction_map,
+
+   /* Only build the results needed by the selected output files.  */
+   /* The ANSI/NIST output records ridge counts and binarized image. */
+   outputs = files;
+   if((img_type == ANSI_NIST_IMG) && (files & LFS_OUT_AN2K))
+      outputs |= LFS_OUT_MIN | LFS_OUT_BINARY_IMAGE;
+
+   /* If NFIQ requested, compute it from the same detection. */
+   if(onfiq != (int *)NULL){
+      ret = get_minutiae_nfiq(&minutiae, &quality_map, &direction_map,
+                         &low_contrast_map, &low_flow_map, &high_curve_map,
+                         &map_w, &map_h, &bdata, &bw, &bh, &bd,
+                         onfiq, oconf, idata, iw, ih, id, ippmm, outputs,
+                         extractor, &nfiq_opt);
+      /* Empty images and too few minutiae still have an NFIQ. */
+      if(ret > 0)
+         ret = 0;
+   }
+   else
+      ret = get_minutiae_sel(&minutiae, &quality_map, &direction_map,
                          &low_contrast_map, &low_flow_map, &high_curve_map,
                          &map_w, &map_h, &bdata, &bw, &bh, &bd,
-                         idata, iw, ih, id, ippmm, &lfsparms_V2))){
+                         idata, iw, ih, id, ippmm, outputs, extractor);
+   if(ret){
       if(img_type == ANSI_NIST_IMG)
          free_ANSI_NIST(ansi_nist);
       free(idata);
-      exit(ret);
+      return(ret);
    }
 
    /* Done with input image data */
    free(idata);
 
    /* 4. WRITE MINUTIAE & MAP RESULTS TO TEXT FILES */
-   if((ret = write_text_results(oroot, m1flag, bw, bh,
+   ret = write_text_results_sel(oroot, m1flag, files, bw, bh,
                                minutiae, quality_map,
                                direction_map, low_contrast_map,
-                               low_flow_map, high_curve_map, map_w, map_h))){
-      if(img_type == ANSI_NIST_IMG)
-         free_ANSI_NIST(ansi_nist);
-      free_minutiae(minutiae);
-      free(quality_map);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
-      free(bdata);
-      exit(ret);
-   }
+                               low_flow_map, high_curve_map, map_w, map_h);
 
    /* Done with minutiae detection maps. */
    free(quality_map);
@@ -190,46 +312,466 @@ int main(int argc, char *argv[])
    /* If input is ANSI/NIST ... */
    if(img_type == ANSI_NIST_IMG){
 
-      /* Update ansi/nist structure with results. */
-      if((ret = update_ANSI_NIST_lfs_results(ansi_nist, minutiae,
+      /* If updated ANSI/NIST file was selected ... */
+      if(!ret && (files & LFS_OUT_AN2K)){
+         if(iolock != (pthread_mutex_t *)NULL)
+            pthread_mutex_lock(iolock);
+
+         /* Update ansi/nist structure with results. */
+         ret = update_ANSI_NIST_lfs_results(ansi_nist, minutiae,
                                             bdata, bw, bh, bd,
-                                            ippmm, img_idc, img_imp))){
-         if(img_type == ANSI_NIST_IMG)
-            free_ANSI_NIST(ansi_nist);
-         free_minutiae(minutiae);
-         free(bdata);
-         exit(ret);
-      }
+                                            ippmm, img_idc, img_imp);
 
-      /* Write updated ANSI/NIST structure to output file */
-      sprintf(ofile, "%s.%s", oroot, AN2K_OUT_EXT);
-      if((ret = write_ANSI_NIST_file(ofile, ansi_nist))){
-         if(img_type == ANSI_NIST_IMG)
-            free_ANSI_NIST(ansi_nist);
-         free_minutiae(minutiae);
-         free(bdata);
-         exit(ret);
+         /* Write updated ANSI/NIST structure to output file */
+         if(!ret){
+            sprintf(ofile, "%s.%s", oroot, AN2K_OUT_EXT);
+            ret = write_ANSI_NIST_file(ofile, ansi_nist);
+         }
+
+         if(iolock != (pthread_mutex_t *)NULL)
+            pthread_mutex_unlock(iolock);
       }
 
       /* Done with ANSI/NIST structure */
       free_ANSI_NIST(ansi_nist);
    }
    /* Otherwise, input image is not ANSI/NIST ... */
-   else{
+   else if(!ret && (files & LFS_OUT_BINARY_IMAGE)){
       sprintf(ofile, "%s.%s", oroot, BINARY_IMG_EXT);
-      if((ret = write_raw_from_memsize(ofile, bdata, bw*bh))){
-         free_minutiae(minutiae);
-         free(bdata);
-         exit(ret);
-      }
+      ret = write_raw_from_memsize(ofile, bdata, bw*bh);
    }
 
    /* Done with minutiae and binary image results */
    free_minutiae(minutiae);
    free(bdata);
 
-   /* Exit normally. */
-   exit(0);
+   return(ret);
+}
+
+/*************************************************************************
+**************************************************************************
+   READ_FINGER_IMAGE - Read the first grayscale fingerprint image from an
+                       ANSI/NIST file, or decode a WSQ, JPEGB, JPEGL or
+                       IHead image file
+   Input:
+      ifile     - input image file name
+   Output:
+      oimg_type - ANSI_NIST_IMG or the type of image file decoded
+      oidata    - grayscale image data
+      oiw       - width (in pixels) of the image
+      oih       - height (in pixels) of the image
+      oid       - pixel depth (in bits) of the image
+      oippmm    - scan resolution (in pixels/mm) of the image
+      oimg_idc  - ANSI/NIST image designation character
+      oimg_imp  - ANSI/NIST impression type
+      oansi_nist - parsed ANSI/NIST file, if the input is one
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int read_finger_image(char *ifile, int *oimg_type, unsigned char **oidata,
+                      int *oiw, int *oih, int *oid, double *oippmm,
+                      int *oimg_idc, int *oimg_imp, ANSI_NIST **oansi_nist)
+{
+   int ret, ilen, ippi;
+   RECORD *imgrecord;
+   int imgrecord_i;
+
+   /* Is input file in ANSI/NIST format? */
+   if((ret = is_ANSI_NIST_file(ifile)) < 0) {
+      /* If error ... */
+      return(ret);
+   }
+
+   /* If file is ANSI/NIST format ... */
+   if(ret){
+      *oimg_type = ANSI_NIST_IMG;
+      /* Parse ANSI/NIST file into memory structure */
+      if((ret = read_ANSI_NIST_file(ifile, oansi_nist)))
+         return(ret);
+      /* Get first grayscale fingerprint record in ANSI/NIST file. */
+      if((ret = get_first_grayprint(oidata, oiw, oih, oid,
+                                oippmm, oimg_idc, oimg_imp,
+                                &imgrecord, &imgrecord_i, *oansi_nist)) < 0){
+         /* If error ... */
+         free_ANSI_NIST(*oansi_nist);
+         return(ret);
+      }
+      /* If grayscale fingerprint not found ... */
+      if(!ret){
+         free_ANSI_NIST(*oansi_nist);
+         fprintf(stderr, "ERROR : read_finger_image : ");
+         fprintf(stderr, "grayscale image record not found in %s\n", ifile);
+         return(-2);
+      }
+   }
+   /* Otherwise, not an ANSI/NIST file */
+   else{
+      *oansi_nist = (ANSI_NIST *)NULL;
+      /* Read the image data from file into memory */
+      if((ret = read_and_decode_grayscale_image(ifile, oimg_type,
+                    oidata, &ilen, oiw, oih, oid, &ippi))){
+         return(ret);
+      }
+      /* If image ppi not defined, then assume 500 */
+      if(ippi == UNDEFINED)
+         *oippmm = DEFAULT_PPI / (double)MM_PER_INCH;
+      else
+         *oippmm = ippi / (double)MM_PER_INCH;
+   }
+
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+   RUN_BATCH - Process a list of images with a pool of workers, each with
+               its own extractor, and print one status line per image
+               as it finishes:
+                  <ifile> ok <secs> [<nfiq> <conf>]
+                  <ifile> FAILED <return code> <secs>
+               A failed image does not stop the run.
+   Input:
+      jobs      - input images and output roots
+      njobs     - number of images
+      nworkers  - number of workers (0 = one per online processor)
+      boostflag - if set, contrast boost the images
+      m1flag    - if set, write "*.xyt" according to ANSI INCITS 378-2004
+      jsonflag  - if set, also print the stats of each image as JSON
+      nfiqflag  - if set, add the NFIQ and its confidence to the
+                  status line of each image
+      files     - mask of LFS_OUT_* bits selecting the output files
+      lfsparms  - parameters of each worker's extractor
+   Return Code:
+      Zero      - every image was processed
+      Positive  - some image failed
+      Negative  - system error
+**************************************************************************/
+int run_batch(IMGJOB *jobs, const int njobs, const int nworkers,
+              const int boostflag, const int m1flag, const int jsonflag,
+              const int nfiqflag, const int files,
+              const LFSPARMS *lfsparms)
+{
+   BATCH batch;
+   int i, n, ret;
+   double start;
+
+   start = lfs_wall_time();
+
+   batch.jobs = jobs;
+   batch.njobs = njobs;
+   batch.boostflag = boostflag;
+   batch.m1flag = m1flag;
+   batch.jsonflag = jsonflag;
+   batch.nfiqflag = nfiqflag;
+   batch.files = files;
+   batch.nfailed = 0;
+   pthread_mutex_init(&batch.iolock, (pthread_mutexattr_t *)NULL);
+   pthread_mutex_init(&batch.outlock, (pthread_mutexattr_t *)NULL);
+
+   n = work_pool_nthreads(nworkers, njobs);
+   batch.extractors = (LFSEXTRACTOR **)calloc(n, sizeof(LFSEXTRACTOR *));
+   if(batch.extractors == (LFSEXTRACTOR **)NULL){
+      fprintf(stderr, "ERROR : run_batch : calloc : extractors\n");
+      return(-2);
+   }
+
+   /* Build the lookup tables once per worker. */
+   ret = 0;
+   for(i = 0; i < n && !ret; i++)
+      ret = init_lfs_extractor(&(batch.extractors[i]), lfsparms);
+
+   if(!ret && (njobs > 0))
+      ret = work_pool_run(batch_image, &batch, njobs, n);
+
+   for(i = 0; i < n; i++){
+      if(batch.extractors[i] != (LFSEXTRACTOR *)NULL)
+         free_lfs_extractor(batch.extractors[i]);
+   }
+   free(batch.extractors);
+   pthread_mutex_destroy(&batch.iolock);
+   pthread_mutex_destroy(&batch.outlock);
+
+   if(ret)
+      return(ret);
+
+   fprintf(stderr, "%d images, %d failed, %d workers, %f secs\n",
+           njobs, batch.nfailed, n, lfs_wall_time() - start);
+
+   return(batch.nfailed ? 1 : 0);
+}
+
+/*************************************************************************
+**************************************************************************
+   BATCH_IMAGE - Pool work function that processes one image of a batch
+   Input:
+      arg       - the BATCH being run
+      worker    - index of the worker, selecting its extractor
+      item      - index of the image in the batch
+   Return Code:
+      Zero      - always, so that one failed image does not stop the rest
+**************************************************************************/
+int batch_image(void *arg, const int worker, const int item)
+{
+   BATCH *batch = (BATCH *)arg;
+   IMGJOB *job = &(batch->jobs[item]);
+   LFSEXTRACTOR *extractor = batch->extractors[worker];
+   double start, secs;
+   int ret, nfiq;
+   float conf;
+
+   start = lfs_wall_time();
+   ret = mindtct_image(job->ifile, job->oroot, batch->boostflag,
+                       batch->m1flag, batch->files,
+                       batch->nfiqflag ? &nfiq : (int *)NULL, &conf,
+                       extractor, &(batch->iolock));
+   secs = lfs_wall_time() - start;
+
+   pthread_mutex_lock(&(batch->outlock));
+   if(ret){
+      batch->nfailed++;
+      printf("%s FAILED %d %f\n", job->ifile, ret, secs);
+   }
+   else{
+      if(batch->nfiqflag)
+         printf("%s ok %f %d %4.2f\n", job->ifile, secs, nfiq, conf);
+      else
+         printf("%s ok %f\n", job->ifile, secs);
+      if(batch->jsonflag)
+         print_lfs_stats_json(stdout, job->ifile, &(extractor->stats));
+   }
+   fflush(stdout);
+   pthread_mutex_unlock(&(batch->outlock));
+
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+   READ_JOB_LIST - Read a list file with one input image file name and
+                   output root name per line, separated by white space.
+                   Blank lines are skipped.
+   Input:
+      listfile  - name of the list file
+   Output:
+      ojobs     - list of input images and output roots
+      onjobs    - number of entries in the list
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int read_job_list(IMGJOB **ojobs, int *onjobs, char *listfile)
+{
+   FILE *fp;
+   IMGJOB *jobs;
+   int njobs, alloc, lineno, ret;
+   char line[2*MAXPATHLEN+2], *ifile, *oroot, *extra;
+   static char *seps = " \t\r\n";
+
+   if((fp = fopen(listfile, "r")) == (FILE *)NULL){
+      fprintf(stderr, "ERROR : read_job_list : fopen : %s\n", listfile);
+      return(-2);
+   }
+
+   jobs = (IMGJOB *)NULL;
+   njobs = 0;
+   alloc = 0;
+   lineno = 0;
+   while(fgets(line, sizeof(line), fp) != (char *)NULL){
+      lineno++;
+      /* A line without a newline, other than the last, did not fit. */
+      if((strchr(line, '\n') == (char *)NULL) && !feof(fp)){
+         fprintf(stderr, "ERROR : read_job_list : %s line %d : ",
+                 listfile, lineno);
+         fprintf(stderr, "line too long\n");
+         free_jobs(jobs, njobs);
+         fclose(fp);
+         return(-3);
+      }
+      ifile = strtok(line, seps);
+      /* Skip blank lines. */
+      if(ifile == (char *)NULL)
+         continue;
+      oroot = strtok((char *)NULL, seps);
+      extra = strtok((char *)NULL, seps);
+      if((oroot == (char *)NULL) || (extra != (char *)NULL)){
+         fprintf(stderr, "ERROR : read_job_list : %s line %d : ",
+                 listfile, lineno);
+         fprintf(stderr, "expected \"<finger_img_in> <oroot>\"\n");
+         free_jobs(jobs, njobs);
+         fclose(fp);
+         return(-3);
+      }
+      if((strlen(ifile) >= MAXPATHLEN) || !oroot_fits(oroot)){
+         fprintf(stderr, "ERROR : read_job_list : %s line %d : ",
+                 listfile, lineno);
+         fprintf(stderr, "path too long\n");
+         free_jobs(jobs, njobs);
+         fclose(fp);
+         return(-3);
+      }
+
+      if((ret = add_job(&jobs, &njobs, &alloc, ifile, oroot))){
+         free_jobs(jobs, njobs);
+         fclose(fp);
+         return(ret);
+      }
+   }
+   fclose(fp);
+
+   *ojobs = jobs;
+   *onjobs = njobs;
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+   READ_JOB_DIR - List the regular files of a directory, such as one
+                  holding ANSI/NIST files, as batch inputs in name order.
+                  Each output root is the file name, less its last
+                  extension, in the output directory.  Names starting
+                  with "." are skipped.
+   Input:
+      idir      - input directory
+      odir      - output directory
+   Output:
+      ojobs     - list of input images and output roots
+      onjobs    - number of files listed
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int read_job_dir(IMGJOB **ojobs, int *onjobs, char *idir, char *odir)
+{
+   DIR *dp;
+   struct dirent *de;
+   struct stat st;
+   IMGJOB *jobs;
+   int njobs, alloc, ret;
+   char ifile[MAXPATHLEN], oroot[MAXPATHLEN], *dot;
+
+   if((dp = opendir(idir)) == (DIR *)NULL){
+      fprintf(stderr, "ERROR : read_job_dir : opendir : %s\n", idir);
+      return(-2);
+   }
+
+   jobs = (IMGJOB *)NULL;
+   njobs = 0;
+   alloc = 0;
+   while((de = readdir(dp)) != (struct dirent *)NULL){
+      if(de->d_name[0] == '.')
+         continue;
+      if((snprintf(ifile, MAXPATHLEN, "%s/%s", idir, de->d_name)
+          >= MAXPATHLEN) ||
+         (snprintf(oroot, MAXPATHLEN, "%s/%s", odir, de->d_name)
+          >= MAXPATHLEN)){
+         fprintf(stderr, "ERROR : read_job_dir : path too long : %s\n",
+                 de->d_name);
+         free_jobs(jobs, njobs);
+         closedir(dp);
+         return(-3);
+      }
+      if((stat(ifile, &st) != 0) || !S_ISREG(st.st_mode))
+         continue;
+      if((dot = strrchr(oroot, '.')) != (char *)NULL &&
+         (dot > oroot + strlen(odir) + 1))
+         *dot = '\0';
+      if(!oroot_fits(oroot)){
+         fprintf(stderr, "ERROR : read_job_dir : path too long : %s\n",
+                 de->d_name);
+         free_jobs(jobs, njobs);
+         closedir(dp);
+         return(-3);
+      }
+
+      if((ret = add_job(&jobs, &njobs, &alloc, ifile, oroot))){
+         free_jobs(jobs, njobs);
+         closedir(dp);
+         return(ret);
+      }
+   }
+   closedir(dp);
+
+   if(njobs > 1)
+      qsort(jobs, njobs, sizeof(IMGJOB), cmp_jobs);
+
+   *ojobs = jobs;
+   *onjobs = njobs;
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+   ADD_JOB - Append an input file and output root to a list of batch
+             inputs, growing the list as needed
+   Input:
+      jobs      - input images and output roots
+      njobs     - number of entries in the list
+      alloc     - number of entries allocated
+      ifile     - input image file name
+      oroot     - root name of the output files
+   Output:
+      jobs      - possibly reallocated list, with the new entry
+      njobs     - incremented
+      alloc     - possibly increased
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int add_job(IMGJOB **jobs, int *njobs, int *alloc,
+            const char *ifile, const char *oroot)
+{
+   IMGJOB *newjobs;
+   char *names;
+
+   if(*njobs >= *alloc){
+      newjobs = (IMGJOB *)realloc(*jobs,
+                         ((*alloc == 0) ? 256 : 2 * *alloc) * sizeof(IMGJOB));
+      if(newjobs == (IMGJOB *)NULL){
+         fprintf(stderr, "ERROR : add_job : realloc : jobs\n");
+         return(-10);
+      }
+      *jobs = newjobs;
+      *alloc = (*alloc == 0) ? 256 : 2 * *alloc;
+   }
+
+   names = (char *)malloc(strlen(ifile) + strlen(oroot) + 2);
+   if(names == (char *)NULL){
+      fprintf(stderr, "ERROR : add_job : malloc : names\n");
+      return(-11);
+   }
+   strcpy(names, ifile);
+   (*jobs)[*njobs].ifile = names;
+   (*jobs)[*njobs].oroot = names + strlen(ifile) + 1;
+   strcpy((*jobs)[*njobs].oroot, oroot);
+   (*njobs)++;
+
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+   FREE_JOBS - Free a list of batch inputs
+   Input:
+      jobs      - input images and output roots
+      njobs     - number of entries in the list
+**************************************************************************/
+void free_jobs(IMGJOB *jobs, const int njobs)
+{
+   int i;
+
+   for(i = 0; i < njobs; i++)
+      free(jobs[i].ifile);
+   free(jobs);
+}
+
+/*************************************************************************
+**************************************************************************
+   CMP_JOBS - qsort() comparison of batch inputs by input file name
+**************************************************************************/
+static int cmp_jobs(const void *a, const void *b)
+{
+   return(strcmp(((const IMGJOB *)a)->ifile, ((const IMGJOB *)b)->ifile));
 }
 
 /*************************************************************************
@@ -240,63 +782,226 @@ int main(int argc, char *argv[])
       argv  - system provided list of command line argument strings
    Output:
       boostflag - contrast boost flag "-b"
-      ifile     - input image file name to be processed by this program
-      ifile     - output image file name to be created by this program
+      m1flag    - ANSI INCITS 378-2004 output flag "-m1"
+      jsonflag  - print stage times and counts as JSON flag "-j"
+      nfiqflag  - compute NFIQ from the same detection flag "-q"
+      nthreads  - number of threads used per image "-t"
+      files     - mask of output files to be written "-o"
+      nworkers  - number of images processed at once in batch mode "-w"
+      listfile  - batch list of input files and output roots "-l",
+                  or NULL
+      dirflag   - batch process the files of a directory flag "-d"
+      ifile     - input image file (or directory) name to be processed
+      oroot     - root name of the output files (or output directory)
 **************************************************************************/
 void procargs(int argc, char **argv, int *boostflag, int *m1flag,
-              char **ifile, char **oroot)
+              int *jsonflag, int *nfiqflag, int *nthreads, int *files,
+              int *nworkers,
+              char **listfile, int *dirflag, char **ifile, char **oroot)
 {
-   int a;
+   int a, npos, count;
+   char *endp;
 
    *boostflag = FALSE;
    *m1flag = FALSE;
+   *jsonflag = FALSE;
+   *nfiqflag = FALSE;
+   *nthreads = NUM_THREADS;
+   *files = LFS_OUT_ALL;
+   *nworkers = 1;
+   *listfile = (char *)NULL;
+   *dirflag = FALSE;
+   *ifile = (char *)NULL;
+   *oroot = (char *)NULL;
 
    if ((argc == 2) && (strcmp(argv[1], "-version") == 0)) {
       getVersion();
       exit(0);
    }
 
-   if(argc == 3){
-      *ifile = argv[1];
-      *oroot = argv[2];
-      return;
-   }
-
-   if((argc == 4) || (argc == 5)){
-      a = 1;
-      while(a < argc-2){
-         if(strcmp(argv[a], "-b") == 0){
-            *boostflag = TRUE;
+   a = 1;
+   while((a < argc) && (argv[a][0] == '-')){
+      if(strcmp(argv[a], "-b") == 0){
+         *boostflag = TRUE;
+      }
+      else if(strcmp(argv[a], "-m1") == 0){
+         *m1flag = TRUE;
+      }
+      else if(strcmp(argv[a], "-j") == 0){
+         *jsonflag = TRUE;
+      }
+      else if(strcmp(argv[a], "-q") == 0){
+         *nfiqflag = TRUE;
+      }
+      else if(strcmp(argv[a], "-d") == 0){
+         *dirflag = TRUE;
+      }
+      else if((strcmp(argv[a], "-t") == 0) ||
+              (strcmp(argv[a], "-w") == 0)){
+         if(a+1 >= argc){
+            fprintf(stderr, "Missing count after \"%s\"\n", argv[a]);
+            usage(argv[0]);
+            exit(2);
          }
-         else if(strcmp(argv[a], "-m1") == 0){
-               *m1flag = TRUE;
+         a++;
+         count = (int)strtol(argv[a], &endp, 10);
+         if((*endp != '\0') || (endp == argv[a]) || (count < 0)){
+            fprintf(stderr, "Invalid count \"%s\"\n", argv[a]);
+            usage(argv[0]);
+            exit(1);
          }
-         else{
-            fprintf(stderr, "Unrecognized flag \"%s\"\n", argv[a]);
-            fprintf(stderr,
-                    "Usage : %s [-b] [-m1] <finger_img_in> <oroot>\n",
-                    argv[0]);
-            fprintf(stderr,
-   "        -b  = contrast boost image\n");
-            fprintf(stderr,
-   "        -m1 = output \"*.xyt\" according to ANSI INCITS 378-2004\n");
+         if(strcmp(argv[a-1], "-t") == 0)
+            *nthreads = count;
+         else
+            *nworkers = count;
+      }
+      else if(strcmp(argv[a], "-o") == 0){
+         if(a+1 >= argc){
+            fprintf(stderr, "Missing output list after \"-o\"\n");
+            usage(argv[0]);
+            exit(2);
+         }
+         a++;
+         if((*files = parse_outputs(argv[a])) < 0){
+            usage(argv[0]);
             exit(1);
          }
+      }
+      else if(strcmp(argv[a], "-l") == 0){
+         if(a+1 >= argc){
+            fprintf(stderr, "Missing list file after \"-l\"\n");
+            usage(argv[0]);
+            exit(2);
+         }
          a++;
+         *listfile = argv[a];
+      }
+      else{
+         fprintf(stderr, "Unrecognized flag \"%s\"\n", argv[a]);
+         usage(argv[0]);
+         exit(1);
       }
+      a++;
    }
-   else{
+
+   /* A list file replaces the input file and output root; */
+   /* otherwise both must follow the flags.                */
+   npos = argc - a;
+   if((*listfile != (char *)NULL) && *dirflag){
+      fprintf(stderr, "Flags \"-l\" and \"-d\" may not be combined\n");
+      usage(argv[0]);
+      exit(1);
+   }
+   if(npos != ((*listfile != (char *)NULL) ? 0 : 2)){
       fprintf(stderr, "Invalid number of arguments on command line\n");
-      fprintf(stderr,
-              "Usage : %s [-b] [-m1] <finger_img_in> <oroot>\n",
-              argv[0]);
-      fprintf(stderr,
+      usage(argv[0]);
+      exit(2);
+   }
+
+   if(npos == 2){
+      *ifile = argv[a++];
+      *oroot = argv[a];
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+   PARSE_OUTPUTS - Convert a comma-separated list of output file
+                   extensions into a mask of LFS_OUT_* bits
+   Input:
+      list  - list of extensions, such as "xyt,min"
+   Return Code:
+      Non-negative - mask of selected output files
+      Negative     - list names an unknown extension
+**************************************************************************/
+int parse_outputs(char *list)
+{
+   int i, n, files;
+   char *ext;
+
+   n = sizeof(outfiles) / sizeof(outfiles[0]);
+   files = 0;
+   for(ext = strtok(list, ","); ext != (char *)NULL;
+       ext = strtok((char *)NULL, ",")){
+      for(i = 0; i < n; i++){
+         if(strcmp(ext, outfiles[i].ext) == 0)
+            break;
+      }
+      if(i == n){
+         fprintf(stderr, "Unknown output \"%s\"\n", ext);
+         return(-1);
+      }
+      files |= outfiles[i].flag;
+   }
+
+   return(files);
+}
+
+/*************************************************************************
+**************************************************************************
+   OROOT_FITS - Tell whether every output file name built from an output
+                root, "<oroot>.<ext>", fits in the MAXPATHLEN buffers
+                mindtct_image() and the results routines format it in.
+   Input:
+      oroot - root path of the output files
+   Return Code:
+      TRUE  - all output file names fit
+      FALSE - some output file name is too long
+**************************************************************************/
+int oroot_fits(const char *oroot)
+{
+   int i, n, len, maxext;
+
+   n = sizeof(outfiles) / sizeof(outfiles[0]);
+   maxext = 0;
+   for(i = 0; i < n; i++){
+      len = strlen(outfiles[i].ext);
+      if(len > maxext)
+         maxext = len;
+   }
+
+   /* Room for the ".", the extension, and the terminating NUL. */
+   return(strlen(oroot) + 1 + maxext < MAXPATHLEN);
+}
+
+/*************************************************************************
+**************************************************************************
+   USAGE - Print the command line syntax to stderr
+   Input:
+      arg0  - name the program was invoked by
+**************************************************************************/
+void usage(char *arg0)
+{
+   fprintf(stderr,
+      "Usage : %s [-b] [-m1] [-j] [-q] [-t threads] [-o outputs]\n", arg0);
+   fprintf(stderr,
+   "               <finger_img_in> <oroot>\n");
+   fprintf(stderr,
+      "        %s [options] [-w workers] -l <pairs.lis>\n", arg0);
+   fprintf(stderr,
+      "        %s [options] [-w workers] -d <in_dir> <out_dir>\n", arg0);
+   fprintf(stderr,
    "        -b  = contrast boost image\n");
-      fprintf(stderr,
+   fprintf(stderr,
    "        -m1 = output \"*.xyt\" according to ANSI INCITS 378-2004\n");
-            exit(2);
-   }
-         
-   *ifile = argv[a++];
-   *oroot = argv[a];
+   fprintf(stderr,
+   "        -j  = print stage times and counts as JSON to stdout\n");
+   fprintf(stderr,
+   "        -q  = also print the NFIQ and its confidence to stdout\n");
+   fprintf(stderr,
+   "        -t  = threads used to analyze the image (0 = one per CPU)\n");
+   fprintf(stderr,
+   "        -o  = comma-separated output files to write, out of\n");
+   fprintf(stderr,
+   "              min,xyt,qm,dm,lcm,lfm,hcm,brw,mdt (default all)\n");
+   fprintf(stderr,
+   "        -w  = images processed at once in batch mode (0 = one per CPU)\n");
+   fprintf(stderr,
+   "        -l  = batch process the \"<finger_img_in> <oroot>\" lines of a\n");
+   fprintf(stderr,
+   "              list file\n");
+   fprintf(stderr,
+   "        -d  = batch process the files of <in_dir>, writing output\n");
+   fprintf(stderr,
+   "              roots in <out_dir>\n");
 }
@@ -61,6 +61,7 @@ of the software.
                         binarize_V2()
 			binarize_image()
 			binarize_image_V2()
+                        binarize_image_V2_ex()
                         dirbinarize()
                         isobinarize()
 
@@ -68,6 +69,7 @@ of the software.
 
 #include <stdio.h>
 #include <lfs.h>
+#include <util.h>
 
 /*************************************************************************
 **************************************************************************
@@ -158,9 +160,10 @@ int binarize_V2(unsigned char **odata, int *ow, int *oh,
    int i, bw, bh, ret; /* return code */
 
    /* 1. Binarize the padded input image using directional block info. */
-   if((ret = binarize_image_V2(&bdata, &bw, &bh, pdata, pw, ph,
+   if((ret = binarize_image_V2_ex(&bdata, &bw, &bh, pdata, pw, ph,
                             direction_map, mw, mh,
-                            lfsparms->blocksize, dirbingrids))){
+                            lfsparms->blocksize, dirbingrids,
+                            lfsparms->num_threads))){
       return(ret);
    }
 
@@ -289,50 +292,180 @@ int binarize_image_V2(unsigned char **odata, int *ow, int *oh,
                    const int *direction_map, const int mw, const int mh,
                    const int blocksize, const ROTGRIDS *dirbingrids)
 {
-   int ix, iy, bw, bh, bx, by, mapval;
-   unsigned char *bdata, *bptr;
-   unsigned char *pptr, *spptr;
+   return(binarize_image_V2_ex(odata, ow, oh, pdata, pw, ph,
+                               direction_map, mw, mh,
+                               blocksize, dirbingrids, 1));
+}
+
+/* Inputs and outputs shared by all threads of binarize_image_V2_ex(). */
+typedef struct binarjob{
+   unsigned char *bdata;
+   int bw, bh;
+   const unsigned char *spdata;  /* First unpadded pixel in padded image. */
+   int pw;
+   const int *direction_map;
+   int mw;
+   int blocksize;
+   const ROTGRIDS *dirbingrids;
+   int cy;                       /* Center row of the rotated grids.      */
+   int isa;                      /* Vector kernels to be used.            */
+} BINARJOB;
+
+/*************************************************************************
+**************************************************************************
+   dirbinarize_block - Directionally binarizes the pixels [x0,x1) of rows
+             [y0,y1) of the image, all of which lie in one block with
+             the given direction.  Where possible, 8 adjacent pixels
+             are binarized at a time by a vector kernel.
+**************************************************************************/
+static void dirbinarize_block(const BINARJOB *job, const int x0, const int x1,
+                              const int y0, const int y1, const int idir)
+{
+   int ix, iy, xs;
+   unsigned char *bptr;
+   const unsigned char *pptr;
+
+   /* First column left to be binarized one pixel at a time. */
+   xs = x0;
+
+#ifdef LFS_X86_SIMD
+   if(job->isa != LFS_ISA_SCALAR){
+      for(; xs + 8 <= x1; xs += 8){
+         bptr = job->bdata + (y0 * job->bw) + xs;
+         pptr = job->spdata + (y0 * job->pw) + xs;
+         if(job->isa == LFS_ISA_AVX2)
+            dirbinarize_tile_avx2(bptr, job->bw, pptr, job->pw, y1 - y0,
+                                  idir, job->dirbingrids, job->cy);
+         else
+            dirbinarize_tile_sse2(bptr, job->bw, pptr, job->pw, y1 - y0,
+                                  idir, job->dirbingrids, job->cy);
+      }
+   }
+#endif
+
+   for(iy = y0; iy < y1; iy++){
+      bptr = job->bdata + (iy * job->bw);
+      pptr = job->spdata + (iy * job->pw);
+      for(ix = xs; ix < x1; ix++)
+         bptr[ix] = dirbinarize(pptr + ix, idir, job->dirbingrids);
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+   binarize_block_row - Work item of binarize_image_V2_ex() that
+             binarizes the rows of pixels in the row of blocks "by".
+**************************************************************************/
+static int binarize_block_row(void *arg, const int worker, const int by)
+{
+   const BINARJOB *job = (const BINARJOB *)arg;
+   int bx, x0, x1, y0, y1, iy, mapval;
+
+   (void)worker;
+   y0 = by * job->blocksize;
+   y1 = min(y0 + job->blocksize, job->bh);
+
+   for(bx = 0, x0 = 0; x0 < job->bw; bx++, x0 += job->blocksize){
+      x1 = min(x0 + job->blocksize, job->bw);
+      /* Get corresponding value in Direction Map. */
+      mapval = job->direction_map[(by * job->mw) + bx];
+      /* If current block has has INVALID direction ... */
+      if(mapval == INVALID_DIR){
+         /* Set binary pixels to white (255). */
+         for(iy = y0; iy < y1; iy++)
+            memset(job->bdata + (iy * job->bw) + x0, WHITE_PIXEL, x1 - x0);
+      }
+      /* Otherwise, block has a valid direction ... */
+      else
+         /* Use directional binarization based on block's direction. */
+         dirbinarize_block(job, x0, x1, y0, y1, mapval);
+   }
+
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: binarize_image_V2_ex - Takes a grayscale input image and its
+#cat:              associated Direction Map and generates a binarized
+#cat:              version of the image, like binarize_image_V2().  Rows
+#cat:              of blocks are binarized by the given number of threads,
+#cat:              and the pixels of a block, which share a direction,
+#cat:              by vector kernels when the host supports them.  The
+#cat:              binary image does not depend on either.
+
+   Input:
+      pdata       - padded input grayscale image
+      pw          - padded width (in pixels) of input image
+      ph          - padded height (in pixels) of input image
+      direction_map - 2-D vector of discrete ridge flow directions
+      mw          - width (in blocks) of the map
+      mh          - height (in blocks) of the map
+      blocksize   - dimension (in pixels) of each NMAP block
+      dirbingrids - set of rotated grid offsets used for directional
+                    binarization
+      nthreads    - number of threads (0 = one per online processor)
+   Output:
+      odata  - points to binary image results
+      ow     - points to binary image width
+      oh     - points to binary image height
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+int binarize_image_V2_ex(unsigned char **odata, int *ow, int *oh,
+                   unsigned char *pdata, const int pw, const int ph,
+                   const int *direction_map, const int mw, const int mh,
+                   const int blocksize, const ROTGRIDS *dirbingrids,
+                   const int nthreads)
+{
+   BINARJOB job;
+   double dcy;
+   int bw, bh, nrows, nworkers, ret; /* return code */
 
    /* Compute dimensions of "unpadded" binary image results. */
    bw = pw - (dirbingrids->pad<<1);
    bh = ph - (dirbingrids->pad<<1);
 
-   bdata = (unsigned char *)malloc(bw*bh*sizeof(unsigned char));
-   if(bdata == (unsigned char *)NULL){
-      fprintf(stderr, "ERROR : binarize_image_V2 : malloc : bdata\n");
+   job.bdata = (unsigned char *)malloc(bw*bh*sizeof(unsigned char));
+   if(job.bdata == (unsigned char *)NULL){
+      fprintf(stderr, "ERROR : binarize_image_V2_ex : malloc : bdata\n");
       return(-600);
    }
 
-   bptr = bdata;
-   spptr = pdata + (dirbingrids->pad * pw) + dirbingrids->pad;
-   for(iy = 0; iy < bh; iy++){
-      /* Set pixel pointer to start of next row in grid. */
-      pptr = spptr;
-      for(ix = 0; ix < bw; ix++){
+   job.bw = bw;
+   job.bh = bh;
+   job.spdata = pdata + (dirbingrids->pad * pw) + dirbingrids->pad;
+   job.pw = pw;
+   job.direction_map = direction_map;
+   job.mw = mw;
+   job.blocksize = blocksize;
+   job.dirbingrids = dirbingrids;
 
-         /* Compute which block the current pixel is in. */
-         bx = (int)(ix/blocksize);
-         by = (int)(iy/blocksize);
-         /* Get corresponding value in Direction Map. */
-         mapval = *(direction_map + (by*mw) + bx);
-         /* If current block has has INVALID direction ... */
-         if(mapval == INVALID_DIR)
-            /* Set binary pixel to white (255). */
-            *bptr = WHITE_PIXEL;
-         /* Otherwise, if block has a valid direction ... */
-         else /*if(mapval >= 0)*/
-            /* Use directional binarization based on block's direction. */
-            *bptr = dirbinarize(pptr, mapval, dirbingrids);
-
-         /* Bump input and output pixel pointers. */
-         pptr++;
-         bptr++;
-      }
-      /* Bump pointer to the next row in padded input image. */
-      spptr += pw;
+   /* Calculate center (0-oriented) row in grid, as dirbinarize() does. */
+   dcy = (dirbingrids->grid_h-1)/(double)2.0;
+   dcy = trunc_dbl_precision(dcy, TRUNC_SCALE);
+   job.cy = sround(dcy);
+
+   /* The vector kernels sum a grid in 16-bit lanes, so they are only */
+   /* used when the largest possible sum fits.                         */
+   job.isa = lfs_simd_isa();
+   if(dirbingrids->grid_w * dirbingrids->grid_h * 255 > 32767)
+      job.isa = LFS_ISA_SCALAR;
+
+   /* Each row of blocks is one work item. */
+   nrows = (bh + blocksize - 1) / blocksize;
+#ifdef LOG_REPORT
+   nworkers = 1;
+#else
+   nworkers = work_pool_nthreads(nthreads, nrows);
+#endif
+   if((ret = work_pool_run(binarize_block_row, &job, nrows, nworkers))){
+      free(job.bdata);
+      return(ret);
    }
 
-   *odata = bdata;
+   *odata = job.bdata;
    *ow = bw;
    *oh = bh;
    return(0);
@@ -58,6 +58,8 @@ of the software.
                ROUTINES:
                         lfs_detect_minutiae()
                         lfs_detect_minutiae_V2()
+                        lfs_detect_minutiae_V2_ex()
+                        lfs_detect_minutiae_V2_sel()
 
 ***********************************************************************/
 
@@ -110,6 +112,12 @@ int lfs_detect_minutiae(MINUTIAE **ominutiae,
    int *imap, *nmap, mw, mh;
    int ret, maxpad;
    MINUTIAE *minutiae;
+#ifdef TIMER
+   clock_t total_timer, imap_timer, bin_timer;
+   clock_t minutia_timer, rm_minutia_timer, ridge_count_timer;
+   float total_time = 0.0, imap_time = 0.0, bin_time = 0.0;
+   float minutia_time = 0.0, rm_minutia_time = 0.0, ridge_count_time = 0.0;
+#endif
 
    set_timer(total_timer);
 
@@ -429,19 +437,102 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
                         unsigned char **obdata, int *obw, int *obh,
                         unsigned char *idata, const int iw, const int ih,
                         const LFSPARMS *lfsparms)
+{
+   LFSEXTRACTOR *extractor;
+   int ret;
+
+   /* Build the lookup tables for this image alone. */
+   if((ret = init_lfs_extractor(&extractor, lfsparms)))
+      return(ret);
+
+   ret = lfs_detect_minutiae_V2_ex(ominutiae, odmap, olcmap, olfmap, ohcmap,
+                                omw, omh, obdata, obw, obh,
+                                idata, iw, ih, extractor);
+
+   free_lfs_extractor(extractor);
+   return(ret);
+}
+
+/*************************************************************************
+#cat: lfs_detect_minutiae_V2_ex - Same as lfs_detect_minutiae_V2(), but
+#cat:          takes its parameters and lookup tables from an extractor
+#cat:          built by init_lfs_extractor(), which may be reused for
+#cat:          any number of images.  The rotated grids are rebuilt
+#cat:          only when the image width changes.  The wall time of
+#cat:          each stage, and counts of flagged blocks and of the
+#cat:          minutiae removed by each test, are left in the
+#cat:          extractor's stats.
+
+   Input:
+      idata     - input 8-bit grayscale fingerprint image data
+      iw        - width (in pixels) of the image
+      ih        - height (in pixels) of the image
+      extractor - LFS parameters and lookup tables
+   Output:
+      (as lfs_detect_minutiae_V2())
+      extractor - rotated grids are built for width iw, and stats
+                  holds the times and counts for this image
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int lfs_detect_minutiae_V2_ex(MINUTIAE **ominutiae,
+                        int **odmap, int **olcmap, int **olfmap, int **ohcmap,
+                        int *omw, int *omh,
+                        unsigned char **obdata, int *obw, int *obh,
+                        unsigned char *idata, const int iw, const int ih,
+                        LFSEXTRACTOR *extractor)
+{
+   return(lfs_detect_minutiae_V2_sel(ominutiae, odmap, olcmap, olfmap, ohcmap,
+                                  omw, omh, obdata, obw, obh,
+                                  idata, iw, ih, LFS_OUT_ALL, extractor));
+}
+
+/*************************************************************************
+#cat: lfs_detect_minutiae_V2_sel - Same as lfs_detect_minutiae_V2_ex(), but
+#cat:          passes back only the maps and binarized image selected
+#cat:          in an output mask; the others are freed as soon as
+#cat:          detection is done with them and passed back as NULL.
+#cat:          Neighbor ridge counts are computed only when the
+#cat:          LFS_OUT_MIN bit is set, and the binarized image is
+#cat:          rescaled to [0,255] only when it is passed back.
+
+   Input:
+      idata     - input 8-bit grayscale fingerprint image data
+      iw        - width (in pixels) of the image
+      ih        - height (in pixels) of the image
+      outputs   - mask of LFS_OUT_* bits selecting the results wanted
+      extractor - LFS parameters and lookup tables
+   Output:
+      (as lfs_detect_minutiae_V2(), with unselected maps and
+       binarized image set to NULL)
+      extractor - rotated grids are built for width iw, and stats
+                  holds the times and counts for this image
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int lfs_detect_minutiae_V2_sel(MINUTIAE **ominutiae,
+                        int **odmap, int **olcmap, int **olfmap, int **ohcmap,
+                        int *omw, int *omh,
+                        unsigned char **obdata, int *obw, int *obh,
+                        unsigned char *idata, const int iw, const int ih,
+                        const int outputs, LFSEXTRACTOR *extractor)
 {
    unsigned char *pdata, *bdata;
    int pw, ph, bw, bh;
-   DIR2RAD *dir2rad;
-   DFTWAVES *dftwaves;
-   ROTGRIDS *dftgrids;
-   ROTGRIDS *dirbingrids;
+   const LFSPARMS *lfsparms = &(extractor->lfsparms);
    int *direction_map, *low_contrast_map, *low_flow_map, *high_curve_map;
    int mw, mh;
    int ret, maxpad;
    MINUTIAE *minutiae;
+   LFSSTATS *stats = &(extractor->stats);
+   double total_start, stage_start;
 
-   set_timer(total_timer);
+   total_start = lfs_wall_time();
+   memset(stats, 0, sizeof(LFSSTATS));
+   stats->iw = iw;
+   stats->ih = ih;
 
    /******************/
    /* INITIALIZATION */
@@ -452,36 +543,9 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
       /* If system error, exit with error code. */
       return(ret);
 
-   /* Determine the maximum amount of image padding required to support */
-   /* LFS processes.                                                    */
-   maxpad = get_max_padding_V2(lfsparms->windowsize, lfsparms->windowoffset,
-                          lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h);
-
-   /* Initialize lookup table for converting integer directions */
-   /* to angles in radians.                                     */
-   if((ret = init_dir2rad(&dir2rad, lfsparms->num_directions))){
-      /* Free memory allocated to this point. */
-      return(ret);
-   }
-
-   /* Initialize wave form lookup tables for DFT analyses. */
-   /* used for direction binarization.                             */
-   if((ret = init_dftwaves(&dftwaves, dft_coefs, lfsparms->num_dft_waves,
-                        lfsparms->windowsize))){
-      /* Free memory allocated to this point. */
-      free_dir2rad(dir2rad);
-      return(ret);
-   }
-
-   /* Initialize lookup table for pixel offsets to rotated grids */
-   /* used for DFT analyses.                                     */
-   if((ret = init_rotgrids(&dftgrids, iw, ih, maxpad,
-                        lfsparms->start_dir_angle, lfsparms->num_directions,
-                        lfsparms->windowsize, lfsparms->windowsize,
-                        RELATIVE2ORIGIN))){
-      /* Free memory allocated to this point. */
-      free_dir2rad(dir2rad);
-      free_dftwaves(dftwaves);
+   /* Make sure the extractor's rotated grids match this image. */
+   maxpad = extractor->maxpad;
+   if((ret = init_extractor_grids(extractor, iw, ih))){
       return(ret);
    }
 
@@ -489,10 +553,6 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    if(maxpad > 0){   /* May not need to pad at all */
       if((ret = pad_uchar_image(&pdata, &pw, &ph, idata, iw, ih,
                              maxpad, lfsparms->pad_value))){
-         /* Free memory allocated to this point. */
-         free_dir2rad(dir2rad);
-         free_dftwaves(dftwaves);
-         free_rotgrids(dftgrids);
          return(ret);
       }
    }
@@ -500,11 +560,8 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
       /* If padding is unnecessary, then copy the input image. */
       pdata = (unsigned char *)malloc(iw*ih);
       if(pdata == (unsigned char *)NULL){
-         /* Free memory allocated to this point. */
-         free_dir2rad(dir2rad);
-         free_dftwaves(dftwaves);
-         free_rotgrids(dftgrids);
-         fprintf(stderr, "ERROR : lfs_detect_minutiae_V2 : malloc : pdata\n");
+         fprintf(stderr,
+                 "ERROR : lfs_detect_minutiae_V2_sel : malloc : pdata\n");
          return(-580);
       }
       memcpy(pdata, idata, iw*ih);
@@ -525,65 +582,50 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    /******************/
    /*      MAPS      */
    /******************/
-   set_timer(imap_timer);
+   stage_start = lfs_wall_time();
 
    /* Generate block maps from the input image. */
    if((ret = gen_image_maps(&direction_map, &low_contrast_map,
                     &low_flow_map, &high_curve_map, &mw, &mh,
-                    pdata, pw, ph, dir2rad, dftwaves, dftgrids, lfsparms))){
+                    pdata, pw, ph, extractor->dir2rad, extractor->dftwaves,
+                    extractor->dftgrids, lfsparms))){
       /* Free memory allocated to this point. */
-      free_dir2rad(dir2rad);
-      free_dftwaves(dftwaves);
-      free_rotgrids(dftgrids);
       free(pdata);
       return(ret);
    }
-   /* Deallocate working memories. */
-   free_dir2rad(dir2rad);
-   free_dftwaves(dftwaves);
-   free_rotgrids(dftgrids);
 
    print2log("\nMAPS DONE\n");
 
-   time_accum(imap_timer, imap_time);
+   stats->maps_time = lfs_wall_time() - stage_start;
+   stats->num_blocks = mw * mh;
+   stats->low_contrast_blocks = count_map_flags(low_contrast_map, mw, mh);
+   stats->low_flow_blocks = count_map_flags(low_flow_map, mw, mh);
+   stats->high_curve_blocks = count_map_flags(high_curve_map, mw, mh);
+
+   /* The low contrast map is not needed to detect minutiae. */
+   if(!(outputs & LFS_OUT_LOW_CONTRAST_MAP)){
+      free(low_contrast_map);
+      low_contrast_map = (int *)NULL;
+   }
 
    /******************/
    /* BINARIZARION   */
    /******************/
-   set_timer(bin_timer);
-
-   /* Initialize lookup table for pixel offsets to rotated grids */
-   /* used for directional binarization.                         */
-   if((ret = init_rotgrids(&dirbingrids, iw, ih, maxpad,
-                        lfsparms->start_dir_angle, lfsparms->num_directions,
-                        lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h,
-                        RELATIVE2CENTER))){
-      /* Free memory allocated to this point. */
-      free(pdata);
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free(high_curve_map);
-      return(ret);
-   }
+   stage_start = lfs_wall_time();
 
    /* Binarize input image based on NMAP information. */
    if((ret = binarize_V2(&bdata, &bw, &bh,
                       pdata, pw, ph, direction_map, mw, mh,
-                      dirbingrids, lfsparms))){
+                      extractor->dirbingrids, lfsparms))){
       /* Free memory allocated to this point. */
       free(pdata);
       free(direction_map);
       free(low_contrast_map);
       free(low_flow_map);
       free(high_curve_map);
-      free_rotgrids(dirbingrids);
       return(ret);
    }
 
-   /* Deallocate working memory. */
-   free_rotgrids(dirbingrids);
-
    /* Check dimension of binary image.  If they are different from */
    /* the input image, then ERROR.                                 */
    if((iw != bw) || (ih != bh)){
@@ -594,7 +636,7 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
       free(low_flow_map);
       free(high_curve_map);
       free(bdata);
-      fprintf(stderr, "ERROR : lfs_detect_minutiae_V2 :");
+      fprintf(stderr, "ERROR : lfs_detect_minutiae_V2_sel :");
       fprintf(stderr,"binary image has bad dimensions : %d, %d\n",
               bw, bh);
       return(-581);
@@ -602,12 +644,12 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
 
    print2log("\nBINARIZATION DONE\n");
 
-   time_accum(bin_timer, bin_time);
+   stats->binarize_time = lfs_wall_time() - stage_start;
 
    /******************/
    /*   DETECTION    */
    /******************/
-   set_timer(minutia_timer);
+   stage_start = lfs_wall_time();
 
    /* Convert 8-bit grayscale binary image [0,255] to */
    /* 8-bit binary image [0,1].                       */
@@ -632,13 +674,14 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
       return(ret);
    }
 
-   time_accum(minutia_timer, minutia_time);
+   stats->detect_time = lfs_wall_time() - stage_start;
+   stats->candidate_minutiae = minutiae->num;
 
-   set_timer(rm_minutia_timer);
+   stage_start = lfs_wall_time();
 
-   if((ret = remove_false_minutia_V2(minutiae, bdata, iw, ih,
+   if((ret = remove_false_minutia_V2_ex(minutiae, bdata, iw, ih,
                        direction_map, low_flow_map, high_curve_map, mw, mh,
-                       lfsparms))){
+                       lfsparms, stats->removed))){
       /* Free memory allocated to this point. */
       free(pdata);
       free(direction_map);
@@ -652,36 +695,74 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
 
    print2log("\nMINUTIA DETECTION DONE\n");
 
-   time_accum(rm_minutia_timer, rm_minutia_time);
+   stats->remove_time = lfs_wall_time() - stage_start;
+   stats->num_minutiae = minutiae->num;
 
    /******************/
    /*  RIDGE COUNTS  */
    /******************/
-   set_timer(ridge_count_timer);
+   /* Neighbors and ridge counts are only reported in "min" output. */
+   if(outputs & LFS_OUT_MIN){
+      stage_start = lfs_wall_time();
 
-   if((ret = count_minutiae_ridges(minutiae, bdata, iw, ih, lfsparms))){
+      if((ret = count_minutiae_ridges(minutiae, bdata, iw, ih, lfsparms))){
+         /* Free memory allocated to this point. */
+         free(pdata);
+         free(direction_map);
+         free(low_contrast_map);
+         free(low_flow_map);
+         free(high_curve_map);
+         free(bdata);
+         free_minutiae(minutiae);
+         return(ret);
+      }
+
+      print2log("\nNEIGHBOR RIDGE COUNT DONE\n");
+
+      stats->ridge_count_time = lfs_wall_time() - stage_start;
+   }
+   /* Otherwise, order the list and drop duplicates just as */
+   /* ridge counting would, so the minutiae are the same.   */
+   else if((ret = sort_minutiae_x_y(minutiae, iw, ih)) ||
+           (ret = rm_dup_minutiae(minutiae))){
       /* Free memory allocated to this point. */
       free(pdata);
       free(direction_map);
       free(low_contrast_map);
       free(low_flow_map);
       free(high_curve_map);
+      free(bdata);
       free_minutiae(minutiae);
       return(ret);
    }
 
-
-   print2log("\nNEIGHBOR RIDGE COUNT DONE\n");
-
-   time_accum(ridge_count_timer, ridge_count_time);
-
    /******************/
    /*    WRAP-UP     */
    /******************/
 
-   /* Convert 8-bit binary image [0,1] to 8-bit */
-   /* grayscale binary image [0,255].           */
-   gray2bin(1, 255, 0, bdata, iw, ih);
+   if(outputs & LFS_OUT_BINARY_IMAGE){
+      /* Convert 8-bit binary image [0,1] to 8-bit */
+      /* grayscale binary image [0,255].           */
+      gray2bin(1, 255, 0, bdata, iw, ih);
+   }
+   else{
+      free(bdata);
+      bdata = (unsigned char *)NULL;
+   }
+
+   /* Free the maps that were only needed for detection. */
+   if(!(outputs & LFS_OUT_DIRECTION_MAP)){
+      free(direction_map);
+      direction_map = (int *)NULL;
+   }
+   if(!(outputs & LFS_OUT_LOW_FLOW_MAP)){
+      free(low_flow_map);
+      low_flow_map = (int *)NULL;
+   }
+   if(!(outputs & LFS_OUT_HIGH_CURVE_MAP)){
+      free(high_curve_map);
+      high_curve_map = (int *)NULL;
+   }
 
    /* Deallocate working memory. */
    free(pdata);
@@ -698,27 +779,28 @@ int lfs_detect_minutiae_V2(MINUTIAE **ominutiae,
    *obh = bh;
    *ominutiae = minutiae;
 
-   time_accum(total_timer, total_time);
+   stats->total_time = lfs_wall_time() - total_start;
 
    /******************/
    /* PRINT TIMINGS  */
    /******************/
    /* These Timings will print when TIMER is defined. */
    /* print MAP generation timing statistics */
-   print_time(stderr, "TIMER: MAPS time   = %f (secs)\n", imap_time);
+   print_time(stderr, "TIMER: MAPS time   = %f (secs)\n", stats->maps_time);
    /* print binarization timing statistics */
-   print_time(stderr, "TIMER: Binarization time   = %f (secs)\n", bin_time);
+   print_time(stderr, "TIMER: Binarization time   = %f (secs)\n",
+              stats->binarize_time);
    /* print minutia detection timing statistics */
    print_time(stderr, "TIMER: Minutia Detection time   = %f (secs)\n",
-              minutia_time);
+              stats->detect_time);
    /* print minutia removal timing statistics */
    print_time(stderr, "TIMER: Minutia Removal time   = %f (secs)\n",
-              rm_minutia_time);
+              stats->remove_time);
    /* print neighbor ridge count timing statistics */
    print_time(stderr, "TIMER: Neighbor Ridge Counting time   = %f (secs)\n",
-              ridge_count_time);
+              stats->ridge_count_time);
    /* print total timing statistics */
-   print_time(stderr, "TIMER: Total time   = %f (secs)\n", total_time);
+   print_time(stderr, "TIMER: Total time   = %f (secs)\n", stats->total_time);
 
    /* If LOG_REPORT defined, close log report file. */
    if((ret = close_logfile()))
@@ -81,6 +81,8 @@ of the software.
 #cat:         power vectors are of dimension (N Waves X M Directions).
 #cat:         The power signatures derived form this process are used to
 #cat:         determine dominant direction flow within the image block.
+#cat:         On hosts with vector instructions, the same powers are
+#cat:         computed by the kernels in simd.c.
 
    Input:
       pdata     - the padded input image.  It is important that the image
@@ -106,6 +108,10 @@ int dft_dir_powers(double **powers, unsigned char *pdata,
    int w, dir;
    int *rowsums;
    unsigned char *blkptr;
+#ifdef LFS_X86_SIMD
+   int isa;
+   double *rowsums_t;
+#endif
 
    /* Allocate line sum vector, and initialize to zeros */
    /* This routine requires square block (grid), so ERROR otherwise. */
@@ -113,6 +119,33 @@ int dft_dir_powers(double **powers, unsigned char *pdata,
       fprintf(stderr, "ERROR : dft_dir_powers : DFT grids must be square\n");
       return(-90);
    }
+
+#ifdef LFS_X86_SIMD
+   /* If the host has vector instructions, use the vector kernels, */
+   /* which compute the same powers.                               */
+   if((isa = lfs_simd_isa()) != LFS_ISA_SCALAR){
+      rowsums_t = (double *)malloc(dftgrids->grid_w * dftgrids->ngrids *
+                                   sizeof(double));
+      if(rowsums_t == (double *)NULL){
+         fprintf(stderr, "ERROR : dft_dir_powers : malloc : rowsums_t\n");
+         return(-92);
+      }
+      blkptr = pdata + blkoffset;
+      /* The AVX2 gathers read 3 bytes past each sampled pixel, so */
+      /* they are used only when the rotated grids, which stay     */
+      /* within "pad" pixels of the block, end at least 3 bytes    */
+      /* before the end of the padded image.                       */
+      if((isa == LFS_ISA_AVX2) &&
+         (blkoffset + ((dftgrids->grid_h + dftgrids->pad) * pw) +
+          dftgrids->grid_w + dftgrids->pad + 3 < pw * ph))
+         dft_dir_powers_avx2(powers, blkptr, dftwaves, dftgrids, rowsums_t);
+      else
+         dft_dir_powers_sse2(powers, blkptr, dftwaves, dftgrids, rowsums_t);
+      free(rowsums_t);
+      return(0);
+   }
+#endif
+
    rowsums = (int *)malloc(dftgrids->grid_w * sizeof(int));
    if(rowsums == (int *)NULL){
       fprintf(stderr, "ERROR : dft_dir_powers : malloc : rowsums\n");
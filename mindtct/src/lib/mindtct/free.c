@@ -58,6 +58,7 @@ of the software.
                         free_dftwaves()
                         free_rotgrids()
                         free_dir_powers()
+                        free_lfs_extractor()
 ***********************************************************************/
 
 #include <stdio.h>
@@ -134,3 +135,21 @@ void free_dir_powers(double **powers, const int nwaves)
    free(powers);
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: free_lfs_extractor - Deallocates an LFSEXTRACTOR and all the lookup
+#cat:                 tables it holds
+
+   Input:
+      extractor - pointer to memory to be freed
+**************************************************************************/
+void free_lfs_extractor(LFSEXTRACTOR *extractor)
+{
+   free_dir2rad(extractor->dir2rad);
+   free_dftwaves(extractor->dftwaves);
+   if(extractor->dftgrids != (ROTGRIDS *)NULL)
+      free_rotgrids(extractor->dftgrids);
+   if(extractor->dirbingrids != (ROTGRIDS *)NULL)
+      free_rotgrids(extractor->dirbingrids);
+   free(extractor);
+}
@@ -58,6 +58,8 @@ of the software.
 ***********************************************************************
                ROUTINES:
                         get_minutiae()
+                        get_minutiae_ex()
+                        get_minutiae_sel()
 
 ***********************************************************************/
 
@@ -103,6 +105,101 @@ int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
                  unsigned char **obdata, int *obw, int *obh, int *obd,
                  unsigned char *idata, const int iw, const int ih,
                  const int id, const double ppmm, const LFSPARMS *lfsparms)
+{
+   LFSEXTRACTOR *extractor;
+   int ret;
+
+   /* Build the lookup tables for this image alone. */
+   if((ret = init_lfs_extractor(&extractor, lfsparms)))
+      return(ret);
+
+   ret = get_minutiae_ex(ominutiae, oquality_map, odirection_map,
+                         olow_contrast_map, olow_flow_map, ohigh_curve_map,
+                         omap_w, omap_h, obdata, obw, obh, obd,
+                         idata, iw, ih, id, ppmm, extractor);
+
+   free_lfs_extractor(extractor);
+   return(ret);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat:   get_minutiae_ex - Same as get_minutiae(), but takes the LFS
+#cat:                parameters and lookup tables from an extractor built
+#cat:                by init_lfs_extractor().  When many images are
+#cat:                processed with the same parameters, building the
+#cat:                extractor once and passing it to each call avoids
+#cat:                rebuilding the DFT wave forms and rotated grids per
+#cat:                image; the grids are rebuilt only when the image
+#cat:                width changes.  An extractor must be used by only
+#cat:                one thread at a time.  The times and counts for the
+#cat:                image, including quality assessment, are left in
+#cat:                the extractor's stats.
+
+   Input:
+      idata     - grayscale fingerprint image data
+      iw        - width (in pixels) of the grayscale image
+      ih        - height (in pixels) of the grayscale image
+      id        - pixel depth (in bits) of the grayscale image
+      ppmm      - the scan resolution (in pixels/mm) of the grayscale image
+      extractor - LFS parameters and lookup tables
+   Output:
+      (as get_minutiae())
+      extractor - stats holds the times and counts for this image
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+int get_minutiae_ex(MINUTIAE **ominutiae, int **oquality_map,
+                 int **odirection_map, int **olow_contrast_map,
+                 int **olow_flow_map, int **ohigh_curve_map,
+                 int *omap_w, int *omap_h,
+                 unsigned char **obdata, int *obw, int *obh, int *obd,
+                 unsigned char *idata, const int iw, const int ih,
+                 const int id, const double ppmm, LFSEXTRACTOR *extractor)
+{
+   return(get_minutiae_sel(ominutiae, oquality_map, odirection_map,
+                           olow_contrast_map, olow_flow_map, ohigh_curve_map,
+                           omap_w, omap_h, obdata, obw, obh, obd,
+                           idata, iw, ih, id, ppmm, LFS_OUT_ALL, extractor));
+}
+
+/*************************************************************************
+**************************************************************************
+#cat:   get_minutiae_sel - Same as get_minutiae_ex(), but passes back only
+#cat:                the maps and binarized image selected by an output
+#cat:                mask of LFS_OUT_* bits; the rest are passed back as
+#cat:                NULL.  All the maps are still needed to detect the
+#cat:                minutiae and to assign their reliabilities, but each
+#cat:                unselected one is freed as soon as it is used.  The
+#cat:                binarized image is not rescaled unless selected, and
+#cat:                neighbor ridge counts are only computed if LFS_OUT_MIN
+#cat:                is set.
+
+   Input:
+      idata     - grayscale fingerprint image data
+      iw        - width (in pixels) of the grayscale image
+      ih        - height (in pixels) of the grayscale image
+      id        - pixel depth (in bits) of the grayscale image
+      ppmm      - the scan resolution (in pixels/mm) of the grayscale image
+      outputs   - mask of LFS_OUT_* bits selecting the results wanted
+      extractor - LFS parameters and lookup tables
+   Output:
+      (as get_minutiae(), with unselected maps and binarized image
+       set to NULL)
+      extractor - stats holds the times and counts for this image
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+int get_minutiae_sel(MINUTIAE **ominutiae, int **oquality_map,
+                 int **odirection_map, int **olow_contrast_map,
+                 int **olow_flow_map, int **ohigh_curve_map,
+                 int *omap_w, int *omap_h,
+                 unsigned char **obdata, int *obw, int *obh, int *obd,
+                 unsigned char *idata, const int iw, const int ih,
+                 const int id, const double ppmm, const int outputs,
+                 LFSEXTRACTOR *extractor)
 {
    int ret;
    MINUTIAE *minutiae;
@@ -111,24 +208,34 @@ int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
    int map_w, map_h;
    unsigned char *bdata;
    int bw, bh;
+   double total_start, quality_start;
+
+   total_start = lfs_wall_time();
 
    /* If input image is not 8-bit grayscale ... */
    if(id != 8){
-      fprintf(stderr, "ERROR : get_minutiae : input image pixel ");
+      fprintf(stderr, "ERROR : get_minutiae_sel : input image pixel ");
       fprintf(stderr, "depth = %d != 8.\n", id);
       return(-2);
    }
 
-   /* Detect minutiae in grayscale fingerpeint image. */
-   if((ret = lfs_detect_minutiae_V2(&minutiae,
+   /* Detect minutiae in grayscale fingerpeint image, keeping every */
+   /* map for the integrated quality map.                           */
+   if((ret = lfs_detect_minutiae_V2_sel(&minutiae,
                                    &direction_map, &low_contrast_map,
                                    &low_flow_map, &high_curve_map,
                                    &map_w, &map_h,
                                    &bdata, &bw, &bh,
-                                   idata, iw, ih, lfsparms))){
+                                   idata, iw, ih,
+                                   outputs | LFS_OUT_DIRECTION_MAP |
+                                   LFS_OUT_LOW_CONTRAST_MAP |
+                                   LFS_OUT_LOW_FLOW_MAP |
+                                   LFS_OUT_HIGH_CURVE_MAP, extractor))){
       return(ret);
    }
 
+   quality_start = lfs_wall_time();
+
    /* Build integrated quality map. */
    if((ret = gen_quality_map(&quality_map,
                             direction_map, low_contrast_map,
@@ -142,9 +249,27 @@ int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
       return(ret);
    }
 
+   /* Free the maps that were only needed for the quality map. */
+   if(!(outputs & LFS_OUT_DIRECTION_MAP)){
+      free(direction_map);
+      direction_map = (int *)NULL;
+   }
+   if(!(outputs & LFS_OUT_LOW_CONTRAST_MAP)){
+      free(low_contrast_map);
+      low_contrast_map = (int *)NULL;
+   }
+   if(!(outputs & LFS_OUT_LOW_FLOW_MAP)){
+      free(low_flow_map);
+      low_flow_map = (int *)NULL;
+   }
+   if(!(outputs & LFS_OUT_HIGH_CURVE_MAP)){
+      free(high_curve_map);
+      high_curve_map = (int *)NULL;
+   }
+
    /* Assign reliability from quality map. */
    if((ret = combined_minutia_quality(minutiae, quality_map, map_w, map_h,
-                                     lfsparms->blocksize,
+                                     extractor->lfsparms.blocksize,
                                      idata, iw, ih, id, ppmm))){
       free_minutiae(minutiae);
       free(direction_map);
@@ -156,6 +281,14 @@ int get_minutiae(MINUTIAE **ominutiae, int **oquality_map,
       return(ret);
    }
 
+   if(!(outputs & LFS_OUT_QUALITY_MAP)){
+      free(quality_map);
+      quality_map = (int *)NULL;
+   }
+
+   extractor->stats.quality_time = lfs_wall_time() - quality_start;
+   extractor->stats.total_time = lfs_wall_time() - total_start;
+
    /* Set output pointers. */
    *ominutiae = minutiae;
    *oquality_map = quality_map;
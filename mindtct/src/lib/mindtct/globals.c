@@ -60,10 +60,6 @@ of the software.
 /*        GOBAL DECLARATIONS                                             */
 /*************************************************************************/
 
-#ifdef LOG_REPORT
-FILE *logfp;
-#endif
-
 /* Constants (C) for defining 4 DFT frequencies, where  */
 /* frequency is defined as C*(PI_FACTOR).  PI_FACTOR    */
 /* regulates the period of the function in x, so:       */
@@ -153,7 +149,10 @@ LFSPARMS lfsparms = {
 
    /* Ridge Counting Controls */
    MAX_NBRS,
-   MAX_RIDGE_STEPS
+   MAX_RIDGE_STEPS,
+
+   /* Threading Controls */
+   NUM_THREADS
 };
 
 
@@ -237,7 +236,10 @@ LFSPARMS lfsparms_V2 = {
 
    /* Ridge Counting Controls */
    MAX_NBRS,
-   MAX_RIDGE_STEPS
+   MAX_RIDGE_STEPS,
+
+   /* Threading Controls */
+   NUM_THREADS
 };
 
 /* Variables for conducting 8-connected neighbor analyses. */
@@ -61,6 +61,8 @@ of the software.
                         get_max_padding()
                         get_max_padding_V2()
                         init_rotgrids()
+                        init_lfs_extractor()
+                        init_extractor_grids()
                         alloc_dir_powers()
                         alloc_power_stats()
 ***********************************************************************/
@@ -660,6 +662,130 @@ int init_rotgrids(ROTGRIDS **optr, const int iw, const int ih, const int ipad,
    return(0);
 }
 
+/*************************************************************************
+**************************************************************************
+#cat: init_lfs_extractor - Allocates an extractor holding a copy of the
+#cat:                LFS parameters and the lookup tables that depend
+#cat:                only on them, so that a series of images can be
+#cat:                processed without rebuilding the tables each time.
+#cat:                The rotated grids, which also depend on the image
+#cat:                width, are built later by init_extractor_grids().
+
+   Input:
+      lfsparms - parameters and thresholds for controlling LFS
+   Output:
+      optr     - points to the allocated/initialized LFSEXTRACTOR
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+int init_lfs_extractor(LFSEXTRACTOR **optr, const LFSPARMS *lfsparms)
+{
+   LFSEXTRACTOR *extractor;
+   int ret;
+
+   extractor = (LFSEXTRACTOR *)malloc(sizeof(LFSEXTRACTOR));
+   if(extractor == (LFSEXTRACTOR *)NULL){
+      fprintf(stderr, "ERROR : init_lfs_extractor : malloc : extractor\n");
+      return(-670);
+   }
+   extractor->lfsparms = *lfsparms;
+   extractor->grids_w = 0;
+   extractor->dftgrids = (ROTGRIDS *)NULL;
+   extractor->dirbingrids = (ROTGRIDS *)NULL;
+   memset(&(extractor->stats), 0, sizeof(LFSSTATS));
+
+   /* Determine the maximum amount of image padding required to support */
+   /* LFS processes.                                                    */
+   extractor->maxpad = get_max_padding_V2(lfsparms->windowsize,
+                          lfsparms->windowoffset,
+                          lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h);
+
+   /* Initialize lookup table for converting integer directions */
+   /* to angles in radians.                                     */
+   if((ret = init_dir2rad(&(extractor->dir2rad),
+                          lfsparms->num_directions))){
+      free(extractor);
+      return(ret);
+   }
+
+   /* Initialize wave form lookup tables for DFT analyses. */
+   if((ret = init_dftwaves(&(extractor->dftwaves), dft_coefs,
+                           lfsparms->num_dft_waves, lfsparms->windowsize))){
+      free_dir2rad(extractor->dir2rad);
+      free(extractor);
+      return(ret);
+   }
+
+   *optr = extractor;
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: init_extractor_grids - Makes sure an extractor's rotated grids
+#cat:                (for DFT analysis and for directional binarization)
+#cat:                are those for images of the given dimensions,
+#cat:                rebuilding them only if the width has changed.  The
+#cat:                grid offsets address the padded image, so they
+#cat:                depend on its width but not on its height.
+
+   Input:
+      extractor - extractor from init_lfs_extractor()
+      iw        - width (in pixels) of the input image
+      ih        - height (in pixels) of the input image
+   Output:
+      extractor - dftgrids and dirbingrids are built for width iw
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+int init_extractor_grids(LFSEXTRACTOR *extractor, const int iw, const int ih)
+{
+   const LFSPARMS *lfsparms = &(extractor->lfsparms);
+   int ret;
+
+   if((extractor->grids_w == iw) &&
+      (extractor->dftgrids != (ROTGRIDS *)NULL) &&
+      (extractor->dirbingrids != (ROTGRIDS *)NULL))
+      return(0);
+
+   /* Discard any grids built for another width. */
+   if(extractor->dftgrids != (ROTGRIDS *)NULL)
+      free_rotgrids(extractor->dftgrids);
+   if(extractor->dirbingrids != (ROTGRIDS *)NULL)
+      free_rotgrids(extractor->dirbingrids);
+   extractor->dftgrids = (ROTGRIDS *)NULL;
+   extractor->dirbingrids = (ROTGRIDS *)NULL;
+   extractor->grids_w = 0;
+
+   /* Initialize lookup table for pixel offsets to rotated grids */
+   /* used for DFT analyses.                                     */
+   if((ret = init_rotgrids(&(extractor->dftgrids), iw, ih, extractor->maxpad,
+                        lfsparms->start_dir_angle, lfsparms->num_directions,
+                        lfsparms->windowsize, lfsparms->windowsize,
+                        RELATIVE2ORIGIN))){
+      extractor->dftgrids = (ROTGRIDS *)NULL;
+      return(ret);
+   }
+
+   /* Initialize lookup table for pixel offsets to rotated grids */
+   /* used for directional binarization.                         */
+   if((ret = init_rotgrids(&(extractor->dirbingrids), iw, ih,
+                        extractor->maxpad,
+                        lfsparms->start_dir_angle, lfsparms->num_directions,
+                        lfsparms->dirbin_grid_w, lfsparms->dirbin_grid_h,
+                        RELATIVE2CENTER))){
+      free_rotgrids(extractor->dftgrids);
+      extractor->dftgrids = (ROTGRIDS *)NULL;
+      extractor->dirbingrids = (ROTGRIDS *)NULL;
+      return(ret);
+   }
+
+   extractor->grids_w = iw;
+   return(0);
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: alloc_dir_powers - Allocates the memory associated with DFT power
@@ -61,12 +61,8 @@ of the software.
 
 #include <log.h>
 
-/* If logging is on, declare global file pointer and supporting */
-/* global variable for logging intermediate results.            */
+/* If logging is on, declare global file pointer. */
 FILE *logfp;
-int avrdir;
-float dir_strength;
-int nvalid;
 
 /***************************************************************************/
 /***************************************************************************/
@@ -91,6 +91,7 @@ of the software.
 #include <lfs.h>
 #include <morph.h>
 #include <log.h>
+#include <util.h>
 
 /*************************************************************************
 **************************************************************************
@@ -207,6 +208,183 @@ int gen_image_maps(int **odmap, int **olcmap, int **olfmap, int **ohcmap,
    return(0);
 }
 
+/* Working memory used by one thread of gen_initial_maps() */
+/* for the DFT analysis of one block at a time.           */
+typedef struct initmapscratch{
+   double **powers;
+   int *wis;
+   double *powmaxs;
+   int *powmax_dirs;
+   double *pownorms;
+} INITMAPSCRATCH;
+
+/* Inputs and outputs shared by all threads of gen_initial_maps(). */
+typedef struct initmapjob{
+   int *direction_map;
+   int *low_contrast_map;
+   int *low_flow_map;
+   int *blkoffs;
+   int mw;
+   unsigned char *pdata;
+   int pw, ph;
+   const DFTWAVES *dftwaves;
+   const ROTGRIDS *dftgrids;
+   const LFSPARMS *lfsparms;
+   int xminlimit, xmaxlimit, yminlimit, ymaxlimit;
+   INITMAPSCRATCH *scratch;   /* One per worker thread. */
+} INITMAPJOB;
+
+/*************************************************************************
+**************************************************************************
+   initial_map_block - Determines the initial Direction, Low Contrast,
+             and Low Flow Map entries of the block at index bi, using
+             the given working memory.  Only the entries of this block
+             are written.
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+static int initial_map_block(INITMAPJOB *job, INITMAPSCRATCH *scratch,
+                             const int bi)
+{
+   const LFSPARMS *lfsparms = job->lfsparms;
+   const int pw = job->pw;
+   int nstats, blkdir;
+   int ret; /* return code */
+   int dft_offset;
+   int win_x, win_y, low_contrast_offset;
+
+   /* Statistics not needed for the first DFT wave. */
+   nstats = job->dftwaves->nwaves - 1;
+
+   /* Adjust block offset from pointing to block origin to pointing */
+   /* to surrounding window origin.                                 */
+   dft_offset = job->blkoffs[bi] - (lfsparms->windowoffset * pw) -
+                   lfsparms->windowoffset;
+
+   /* Compute pixel coords of window origin. */
+   win_x = dft_offset % pw;
+   win_y = (int)(dft_offset / pw);
+
+   /* Make sure the current window does not access padded image pixels */
+   /* for analyzing low contrast.                                      */
+   win_x = max(job->xminlimit, win_x);
+   win_x = min(job->xmaxlimit, win_x);
+   win_y = max(job->yminlimit, win_y);
+   win_y = min(job->ymaxlimit, win_y);
+   low_contrast_offset = (win_y * pw) + win_x;
+
+   print2log("   BLOCK %2d (%2d, %2d) ", bi, bi%job->mw, bi/job->mw);
+
+   /* If block is low contrast ... */
+   if((ret = low_contrast_block(low_contrast_offset, lfsparms->windowsize,
+                               job->pdata, pw, job->ph, lfsparms))){
+      /* If system error ... */
+      if(ret < 0)
+         return(ret);
+
+      /* Otherwise, block is low contrast ... */
+      print2log("LOW CONTRAST\n");
+      job->low_contrast_map[bi] = TRUE;
+      /* Direction Map's block is already set to INVALID. */
+      return(0);
+   }
+
+   /* Otherwise, sufficient contrast for DFT processing ... */
+   print2log("\n");
+
+   /* Compute DFT powers */
+   if((ret = dft_dir_powers(scratch->powers, job->pdata, low_contrast_offset,
+                            pw, job->ph, job->dftwaves, job->dftgrids)))
+      return(ret);
+
+   /* Compute DFT power statistics, skipping first applied DFT  */
+   /* wave.  This is dependent on how the primary and secondary */
+   /* direction tests work below.                               */
+   if((ret = dft_power_stats(scratch->wis, scratch->powmaxs,
+                             scratch->powmax_dirs, scratch->pownorms,
+                             scratch->powers, 1, job->dftwaves->nwaves,
+                             job->dftgrids->ngrids)))
+      return(ret);
+
+#ifdef LOG_REPORT /*vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv*/
+   {  int _w;
+      fprintf(logfp, "      Power\n");
+      for(_w = 0; _w < nstats; _w++){
+         /* Add 1 to wis[w] to create index to original dft_coefs[] */
+         fprintf(logfp, "         wis[%d] %d %12.3f %2d %9.3f %12.3f\n",
+              _w, scratch->wis[_w]+1,
+              scratch->powmaxs[scratch->wis[_w]],
+              scratch->powmax_dirs[scratch->wis[_w]],
+              scratch->pownorms[scratch->wis[_w]],
+              scratch->powers[0][scratch->powmax_dirs[scratch->wis[_w]]]);
+      }
+   }
+#endif /*^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^*/
+
+   /* Conduct primary direction test */
+   blkdir = primary_dir_test(scratch->powers, scratch->wis, scratch->powmaxs,
+                             scratch->powmax_dirs, scratch->pownorms,
+                             nstats, lfsparms);
+
+   if(blkdir != INVALID_DIR)
+      job->direction_map[bi] = blkdir;
+   else{
+      /* Conduct secondary (fork) direction test */
+      blkdir = secondary_fork_test(scratch->powers, scratch->wis,
+                             scratch->powmaxs, scratch->powmax_dirs,
+                             scratch->pownorms, nstats, lfsparms);
+      if(blkdir != INVALID_DIR)
+         job->direction_map[bi] = blkdir;
+      /* Otherwise current direction in Direction Map remains INVALID */
+      else
+         /* Flag the block as having LOW RIDGE FLOW. */
+         job->low_flow_map[bi] = TRUE;
+   }
+
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+   initial_map_row - Work item of gen_initial_maps() that analyzes
+             the row of blocks "by" with the working memory of the
+             calling worker thread.
+**************************************************************************/
+static int initial_map_row(void *arg, const int worker, const int by)
+{
+   INITMAPJOB *job = (INITMAPJOB *)arg;
+   int bx, ret;
+
+   for(bx = 0; bx < job->mw; bx++){
+      if((ret = initial_map_block(job, &(job->scratch[worker]),
+                                  (by * job->mw) + bx)))
+         return(ret);
+   }
+
+   return(0);
+}
+
+/*************************************************************************
+**************************************************************************
+   free_initial_map_scratch - Deallocates the working memory of the
+             first n worker threads of gen_initial_maps().
+**************************************************************************/
+static void free_initial_map_scratch(INITMAPSCRATCH *scratch, const int n,
+                                     const int nwaves)
+{
+   int i;
+
+   for(i = 0; i < n; i++){
+      free_dir_powers(scratch[i].powers, nwaves);
+      free(scratch[i].wis);
+      free(scratch[i].powmaxs);
+      free(scratch[i].powmax_dirs);
+      free(scratch[i].pownorms);
+   }
+   free(scratch);
+}
+
 /*************************************************************************
 **************************************************************************
 #cat: gen_initial_maps - Creates an initial Direction Map from the given
@@ -225,7 +403,9 @@ int gen_image_maps(int **odmap, int **olcmap, int **olfmap, int **ohcmap,
 #cat:             The Low Flow Map flags blocks in which the DFT analyses
 #cat:             could not determine a significant ridge flow.  Blocks with
 #cat:             low ridge flow also have a corresponding direction of
-#cat:             INVALID in the Direction Map.
+#cat:             INVALID in the Direction Map.  Rows of blocks are
+#cat:             analyzed by lfsparms->num_threads threads; the maps
+#cat:             are the same for any number of threads.
 
    Input:
       blkoffs   - offsets to the pixel origin of each block in the padded image
@@ -251,14 +431,12 @@ int gen_initial_maps(int **odmap, int **olcmap, int **olfmap,
                 const LFSPARMS *lfsparms)
 {
    int *direction_map, *low_contrast_map, *low_flow_map;
-   int bi, bsize, blkdir;
-   int *wis, *powmax_dirs;
-   double **powers, *powmaxs, *pownorms;
+   int bsize;
+   INITMAPJOB job;
+   INITMAPSCRATCH *scratch;
+   int nthreads, nscratch;
    int nstats;
    int ret; /* return code */
-   int dft_offset;
-   int xminlimit, xmaxlimit, yminlimit, ymaxlimit;
-   int win_x, win_y, low_contrast_offset;
 
    print2log("INITIAL MAP\n");
 
@@ -298,154 +476,87 @@ int gen_initial_maps(int **odmap, int **olcmap, int **olfmap,
    /* Initialize the Low Flow Map to FALSE (0). */
    memset(low_flow_map, 0, bsize * sizeof(int));
 
-   /* Allocate DFT directional power vectors */
-   if((ret = alloc_dir_powers(&powers, dftwaves->nwaves, dftgrids->ngrids))){
-      /* Free memory allocated to this point. */
+   /* Each row of blocks is one work item. */
+#ifdef LOG_REPORT
+   /* Log output is written in row order, so stay serial. */
+   nthreads = 1;
+#else
+   nthreads = work_pool_nthreads(lfsparms->num_threads, mh);
+#endif
+
+   /* Allocate working memory for each thread. */
+   scratch = (INITMAPSCRATCH *)malloc(nthreads * sizeof(INITMAPSCRATCH));
+   if(scratch == (INITMAPSCRATCH *)NULL){
       free(direction_map);
       free(low_contrast_map);
       free(low_flow_map);
-      return(ret);
+      fprintf(stderr,
+              "ERROR : gen_initial_maps : malloc : scratch\n");
+      return(-553);
    }
 
-   /* Allocate DFT power statistic arrays */
    /* Compute length of statistics arrays.  Statistics not needed   */
    /* for the first DFT wave, so the length is number of waves - 1. */
    nstats = dftwaves->nwaves - 1;
-   if((ret = alloc_power_stats(&wis, &powmaxs, &powmax_dirs,
-                            &pownorms, nstats))){
-      /* Free memory allocated to this point. */
-      free(direction_map);
-      free(low_contrast_map);
-      free(low_flow_map);
-      free_dir_powers(powers, dftwaves->nwaves);
-      return(ret);
-   }
-
-   /* Compute special window origin limits for determining low contrast.  */
-   /* These pixel limits avoid analyzing the padded borders of the image. */
-   xminlimit = dftgrids->pad;
-   yminlimit = dftgrids->pad;
-   xmaxlimit = pw - dftgrids->pad - lfsparms->windowsize - 1;
-   ymaxlimit = ph - dftgrids->pad - lfsparms->windowsize - 1;
-
-   /* Foreach block in image ... */
-   for(bi = 0; bi < bsize; bi++){
-      /* Adjust block offset from pointing to block origin to pointing */
-      /* to surrounding window origin.                                 */
-      dft_offset = blkoffs[bi] - (lfsparms->windowoffset * pw) -
-                      lfsparms->windowoffset;
-
-      /* Compute pixel coords of window origin. */
-      win_x = dft_offset % pw;
-      win_y = (int)(dft_offset / pw);
-
-      /* Make sure the current window does not access padded image pixels */
-      /* for analyzing low contrast.                                      */
-      win_x = max(xminlimit, win_x);
-      win_x = min(xmaxlimit, win_x);
-      win_y = max(yminlimit, win_y);
-      win_y = min(ymaxlimit, win_y);
-      low_contrast_offset = (win_y * pw) + win_x;
-
-      print2log("   BLOCK %2d (%2d, %2d) ", bi, bi%mw, bi/mw);
-
-      /* If block is low contrast ... */
-      if((ret = low_contrast_block(low_contrast_offset, lfsparms->windowsize,
-                                  pdata, pw, ph, lfsparms))){
-         /* If system error ... */
-         if(ret < 0){
-            free(direction_map);
-            free(low_contrast_map);
-            free(low_flow_map);
-            free_dir_powers(powers, dftwaves->nwaves);
-            free(wis);
-            free(powmaxs);
-            free(powmax_dirs);
-            free(pownorms);
-            return(ret);
-         }
-
-         /* Otherwise, block is low contrast ... */
-         print2log("LOW CONTRAST\n");
-         low_contrast_map[bi] = TRUE;
-         /* Direction Map's block is already set to INVALID. */
+   for(nscratch = 0; nscratch < nthreads; nscratch++){
+      /* Allocate DFT directional power vectors */
+      if((ret = alloc_dir_powers(&(scratch[nscratch].powers),
+                                 dftwaves->nwaves, dftgrids->ngrids))){
+         /* Free memory allocated to this point. */
+         free(direction_map);
+         free(low_contrast_map);
+         free(low_flow_map);
+         free_initial_map_scratch(scratch, nscratch, dftwaves->nwaves);
+         return(ret);
       }
-      /* Otherwise, sufficient contrast for DFT processing ... */
-      else {
-         print2log("\n");
-
-         /* Compute DFT powers */
-         if((ret = dft_dir_powers(powers, pdata, low_contrast_offset, pw, ph,
-                               dftwaves, dftgrids))){
-            /* Free memory allocated to this point. */
-            free(direction_map);
-            free(low_contrast_map);
-            free(low_flow_map);
-            free_dir_powers(powers, dftwaves->nwaves);
-            free(wis);
-            free(powmaxs);
-            free(powmax_dirs);
-            free(pownorms);
-            return(ret);
-         }
 
-         /* Compute DFT power statistics, skipping first applied DFT  */
-         /* wave.  This is dependent on how the primary and secondary */
-         /* direction tests work below.                               */
-         if((ret = dft_power_stats(wis, powmaxs, powmax_dirs, pownorms, powers,
-                                1, dftwaves->nwaves, dftgrids->ngrids))){
-            /* Free memory allocated to this point. */
-            free(direction_map);
-            free(low_contrast_map);
-            free(low_flow_map);
-            free_dir_powers(powers, dftwaves->nwaves);
-            free(wis);
-            free(powmaxs);
-            free(powmax_dirs);
-            free(pownorms);
-            return(ret);
-         }
-
-#ifdef LOG_REPORT /*vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv*/
-         {  int _w;
-            fprintf(logfp, "      Power\n");
-            for(_w = 0; _w < nstats; _w++){
-               /* Add 1 to wis[w] to create index to original dft_coefs[] */
-               fprintf(logfp, "         wis[%d] %d %12.3f %2d %9.3f %12.3f\n",
-                    _w, wis[_w]+1, 
-                    powmaxs[wis[_w]], powmax_dirs[wis[_w]], pownorms[wis[_w]],
-                    powers[0][powmax_dirs[wis[_w]]]);
-            }
-         }
-#endif /*^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^*/
+      /* Allocate DFT power statistic arrays */
+      if((ret = alloc_power_stats(&(scratch[nscratch].wis),
+                                  &(scratch[nscratch].powmaxs),
+                                  &(scratch[nscratch].powmax_dirs),
+                                  &(scratch[nscratch].pownorms), nstats))){
+         /* Free memory allocated to this point. */
+         free(direction_map);
+         free(low_contrast_map);
+         free(low_flow_map);
+         free_dir_powers(scratch[nscratch].powers, dftwaves->nwaves);
+         free_initial_map_scratch(scratch, nscratch, dftwaves->nwaves);
+         return(ret);
+      }
+   }
 
-         /* Conduct primary direction test */
-         blkdir = primary_dir_test(powers, wis, powmaxs, powmax_dirs,
-                                  pownorms, nstats, lfsparms);
+   job.direction_map = direction_map;
+   job.low_contrast_map = low_contrast_map;
+   job.low_flow_map = low_flow_map;
+   job.blkoffs = blkoffs;
+   job.mw = mw;
+   job.pdata = pdata;
+   job.pw = pw;
+   job.ph = ph;
+   job.dftwaves = dftwaves;
+   job.dftgrids = dftgrids;
+   job.lfsparms = lfsparms;
+   job.scratch = scratch;
 
-         if(blkdir != INVALID_DIR)
-            direction_map[bi] = blkdir;
-         else{
-            /* Conduct secondary (fork) direction test */
-            blkdir = secondary_fork_test(powers, wis, powmaxs, powmax_dirs,
-                                  pownorms, nstats, lfsparms);
-            if(blkdir != INVALID_DIR)
-               direction_map[bi] = blkdir;
-            /* Otherwise current direction in Direction Map remains INVALID */
-            else
-               /* Flag the block as having LOW RIDGE FLOW. */
-               low_flow_map[bi] = TRUE;
-         }
+   /* Compute special window origin limits for determining low contrast.  */
+   /* These pixel limits avoid analyzing the padded borders of the image. */
+   job.xminlimit = dftgrids->pad;
+   job.yminlimit = dftgrids->pad;
+   job.xmaxlimit = pw - dftgrids->pad - lfsparms->windowsize - 1;
+   job.ymaxlimit = ph - dftgrids->pad - lfsparms->windowsize - 1;
 
-      } /* End DFT */
-   } /* bi */
+   /* Foreach row of blocks in image ... */
+   ret = work_pool_run(initial_map_row, &job, mh, nthreads);
 
    /* Deallocate working memory */
-   free_dir_powers(powers, dftwaves->nwaves);
-   free(wis);
-   free(powmaxs);
-   free(powmax_dirs);
-   free(pownorms);
+   free_initial_map_scratch(scratch, nthreads, dftwaves->nwaves);
+
+   if(ret){
+      free(direction_map);
+      free(low_contrast_map);
+      free(low_flow_map);
+      return(ret);
+   }
 
    *odmap = direction_map;
    *olcmap = low_contrast_map;
@@ -58,6 +58,7 @@ of the software.
                ROUTINES:
                         remove_false_minutia()
                         remove_false_minutia_V2()
+                        remove_false_minutia_V2_ex()
                         remove_holes()
                         remove_hooks()
                         remove_hooks_islands_overlaps()
@@ -174,7 +175,38 @@ int remove_false_minutia_V2(MINUTIAE *minutiae,
            int *direction_map, int *low_flow_map, int *high_curve_map,
            const int mw, const int mh, const LFSPARMS *lfsparms)
 {
-   int ret;
+   return(remove_false_minutia_V2_ex(minutiae, bdata, iw, ih,
+                          direction_map, low_flow_map, high_curve_map,
+                          mw, mh, lfsparms, (int *)NULL));
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: remove_false_minutia_V2_ex - Same as remove_false_minutia_V2(), but
+#cat:                also counts the minutiae removed by each test.
+
+   Input:
+      (as remove_false_minutia_V2())
+   Output:
+      minutiae  - list of pruned minutiae
+      nremoved  - if not NULL, the number of minutiae removed by each
+                  test, indexed by RM_ISLANDS_AND_LAKES ... RM_PORES
+   Return Code:
+      Zero     - successful completion
+      Negative - system error
+**************************************************************************/
+int remove_false_minutia_V2_ex(MINUTIAE *minutiae,
+           unsigned char *bdata, const int iw, const int ih,
+           int *direction_map, int *low_flow_map, int *high_curve_map,
+           const int mw, const int mh, const LFSPARMS *lfsparms,
+           int *nremoved)
+{
+   int ret, num;
+   int dummy[NUM_RM_STEPS];
+
+   /* Counts are discarded if the caller did not ask for them. */
+   if(nremoved == (int *)NULL)
+      nremoved = dummy;
 
    /* 1. Sort minutiae points top-to-bottom and left-to-right. */
    if((ret = sort_minutiae_y_x(minutiae, iw, ih))){
@@ -184,60 +216,78 @@ int remove_false_minutia_V2(MINUTIAE *minutiae,
    /* 2. Remove minutiae on lakes (filled with white pixels) and        */
    /*    islands (filled with black pixels), both  defined by a pair of */
    /*    minutia points.                                                */
+   num = minutiae->num;
    if((ret = remove_islands_and_lakes(minutiae, bdata, iw, ih, lfsparms))){
       return(ret);
    }
+   nremoved[RM_ISLANDS_AND_LAKES] = num - minutiae->num;
 
    /* 3. Remove minutiae on holes in the binary image defined by a */
    /*    single point.                                             */
+   num = minutiae->num;
    if((ret = remove_holes(minutiae, bdata, iw, ih, lfsparms))){
       return(ret);
    }
+   nremoved[RM_HOLES] = num - minutiae->num;
 
    /* 4. Remove minutiae that point sufficiently close to a block with */
    /*    INVALID direction.                                            */
+   num = minutiae->num;
    if((ret = remove_pointing_invblock_V2(minutiae, direction_map, mw, mh,
                                         lfsparms))){
       return(ret);
    }
+   nremoved[RM_POINTING_INVBLOCK] = num - minutiae->num;
 
    /* 5. Remove minutiae that are sufficiently close to a block with */
    /*    INVALID direction.                                          */
+   num = minutiae->num;
    if((ret = remove_near_invblock_V2(minutiae, direction_map, mw, mh,
                                     lfsparms))){
       return(ret);
    }
+   nremoved[RM_NEAR_INVBLOCK] = num - minutiae->num;
 
    /* 6. Remove or adjust minutiae that reside on the side of a ridge */
    /*    or valley.                                                   */
+   num = minutiae->num;
    if((ret = remove_or_adjust_side_minutiae_V2(minutiae, bdata, iw, ih,
                                   direction_map, mw, mh, lfsparms))){
       return(ret);
    }
+   nremoved[RM_SIDE_MINUTIAE] = num - minutiae->num;
 
    /* 7. Remove minutiae that form a hook on the side of a ridge or valley. */
+   num = minutiae->num;
    if((ret = remove_hooks(minutiae, bdata, iw, ih, lfsparms))){
       return(ret);
    }
+   nremoved[RM_HOOKS] = num - minutiae->num;
 
    /* 8. Remove minutiae that are on opposite sides of an overlap. */
+   num = minutiae->num;
    if((ret = remove_overlaps(minutiae, bdata, iw, ih, lfsparms))){
       return(ret);
    }
+   nremoved[RM_OVERLAPS] = num - minutiae->num;
 
    /* 9. Remove minutiae that are "irregularly" shaped. */
+   num = minutiae->num;
    if((ret = remove_malformations(minutiae, bdata, iw, ih,
                                  low_flow_map, mw, mh, lfsparms))){
       return(ret);
    }
+   nremoved[RM_MALFORMATIONS] = num - minutiae->num;
 
    /* 10. Remove minutiae that form long, narrow, loops in the */
    /*     "unreliable" regions in the binary image.            */
+   num = minutiae->num;
    if((ret = remove_pores_V2(minutiae,  bdata, iw, ih,
                             direction_map, low_flow_map, high_curve_map,
                             mw, mh, lfsparms))){
       return(ret);
    }
+   nremoved[RM_PORES] = num - minutiae->num;
 
    return(0);
 }
@@ -1358,11 +1408,11 @@ int remove_near_invblock(MINUTIAE *minutiae, int *nmap,
    /*                                |    |                       */
 
    /* MDG: LUT for starting neighbor index given (ix, iy).        */
-   static int startblk[9] = { 6, 0, 0,
+   static const int startblk[9] = { 6, 0, 0,
                                   6,-1, 2,
                                   4, 4, 2 };
    /* MDG: LUT for ending neighbor index given (ix, iy).          */
-   static int endblk[9] =   { 8, 0, 2,
+   static const int endblk[9] =   { 8, 0, 2,
                                   6,-1, 2,
                                   6, 4, 4 };
 
@@ -1376,8 +1426,8 @@ int remove_near_invblock(MINUTIAE *minutiae, int *nmap,
    /*                           5 4 3                                    */
    /*                                                                    */
    /*                       0  1  2  3  4  5  6  7  8                    */
-   static int blkdx[9] = {  0, 1, 1, 1, 0,-1,-1,-1, 0 };  /* Delta-X     */
-   static int blkdy[9] = { -1,-1, 0, 1, 1, 1, 0,-1,-1 };  /* Delta-Y     */
+   static const int blkdx[9] = {  0, 1, 1, 1, 0,-1,-1,-1, 0 };  /* Delta-X     */
+   static const int blkdy[9] = { -1,-1, 0, 1, 1, 1, 0,-1,-1 };  /* Delta-Y     */
 
    print2log("\nREMOVING MINUTIA NEAR INVALID BLOCKS:\n");
 
@@ -1588,11 +1638,11 @@ int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
    /*                           |    |                       */
 
    /* LUT for starting neighbor index given (ix, iy).        */
-   static int startblk[9] = { 6, 0, 0,
+   static const int startblk[9] = { 6, 0, 0,
                               6,-1, 2,
                               4, 4, 2 };
    /* LUT for ending neighbor index given (ix, iy).          */
-   static int endblk[9] =   { 8, 0, 2,
+   static const int endblk[9] =   { 8, 0, 2,
                               6,-1, 2,
                               6, 4, 4 };
 
@@ -1606,8 +1656,8 @@ int remove_near_invblock_V2(MINUTIAE *minutiae, int *direction_map,
    /*                      5 4 3                                    */
    /*                                                               */
    /*                       0  1  2  3  4  5  6  7  8                    */
-   static int blkdx[9] = {  0, 1, 1, 1, 0,-1,-1,-1, 0 };  /* Delta-X     */
-   static int blkdy[9] = { -1,-1, 0, 1, 1, 1, 0,-1,-1 };  /* Delta-Y     */
+   static const int blkdx[9] = {  0, 1, 1, 1, 0,-1,-1,-1, 0 };  /* Delta-X     */
+   static const int blkdy[9] = { -1,-1, 0, 1, 1, 1, 0,-1,-1 };  /* Delta-Y     */
 
    print2log("\nREMOVING MINUTIA NEAR INVALID BLOCKS:\n");
 
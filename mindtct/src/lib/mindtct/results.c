@@ -58,6 +58,7 @@ of the software.
 ***********************************************************************
                ROUTINES:
                         write_text_results()
+                        write_text_results_sel()
                         write_minutiae_XYTQ()
                         dump_map()
                         drawmap()
@@ -115,135 +116,191 @@ int write_text_results(char *oroot, const int m1flag,
                        int *direction_map, int *low_contrast_map,
                        int *low_flow_map, int *high_curve_map,
                        const int map_w, const int map_h)
+{
+   return(write_text_results_sel(oroot, m1flag, LFS_OUT_ALL, iw, ih,
+                                 minutiae, quality_map,
+                                 direction_map, low_contrast_map,
+                                 low_flow_map, high_curve_map,
+                                 map_w, map_h));
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: write_text_results_sel - Same as write_text_results(), but writes
+#cat:              only the files selected by a mask of LFS_OUT_* bits.
+#cat:              Maps whose files are not selected may be NULL.
+
+   Input:
+      oroot     - root pathname for output files
+      m1flag    - if flag set, write (X,Y,T)'s out to "*.xyt" file according
+                  to M1 (ANSI INCITS 378-2004) minutiae representation
+      files     - mask of LFS_OUT_* bits selecting the files written
+      (the rest as write_text_results())
+   Return Code:
+      Zero      - successful completion
+      Negative  - system error
+**************************************************************************/
+int write_text_results_sel(char *oroot, const int m1flag, const int files,
+                       const int iw, const int ih,
+                       const MINUTIAE *minutiae, int *quality_map,
+                       int *direction_map, int *low_contrast_map,
+                       int *low_flow_map, int *high_curve_map,
+                       const int map_w, const int map_h)
 {
    FILE *fp;
    int  ret;
    char ofile[MAXPATHLEN];
 
-   /* 1. Write Minutiae results to text file "<oroot>.min". */
-   /*    XYT's written in LFS native representation:        */
-   /*       1. pixel coordinates with origin top-left       */
-   /*       2. 11.25 degrees quantized integer orientation  */
-   /*          on range [0..31]                             */
-   /*       3. minutiae reliability on range [0.0 .. 1.0]   */
-   /*          with 0.0 lowest and 1.0 highest reliability  */
-   sprintf(ofile, "%s.%s", oroot, MIN_TXT_EXT);
-   if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
-      fprintf(stderr, "ERROR : write_text_results : fopen : %s\n", ofile);
-      return(-2);
-   }
-   /* Print out Image Dimensions Header */
-   /* !!!! Image dimension header added 09-13-04 !!!! */
-   fprintf(fp, "Image (w,h) %d %d\n", iw, ih);
-   /* Print text report from the structure containing detected minutiae. */
-   dump_minutiae(fp, minutiae);
-   if(fclose(fp)){
-      fprintf(stderr, "ERROR : write_text_results : fclose : %s\n", ofile);
-      return(-3);
+   if(files & LFS_OUT_MIN){
+      /* 1. Write Minutiae results to text file "<oroot>.min". */
+      /*    XYT's written in LFS native representation:        */
+      /*       1. pixel coordinates with origin top-left       */
+      /*       2. 11.25 degrees quantized integer orientation  */
+      /*          on range [0..31]                             */
+      /*       3. minutiae reliability on range [0.0 .. 1.0]   */
+      /*          with 0.0 lowest and 1.0 highest reliability  */
+      sprintf(ofile, "%s.%s", oroot, MIN_TXT_EXT);
+      if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
+         fprintf(stderr, "ERROR : write_text_results_sel : fopen : %s\n",
+                 ofile);
+         return(-2);
+      }
+      /* Print out Image Dimensions Header */
+      /* !!!! Image dimension header added 09-13-04 !!!! */
+      fprintf(fp, "Image (w,h) %d %d\n", iw, ih);
+      /* Print text report from the structure containing detected minutiae. */
+      dump_minutiae(fp, minutiae);
+      if(fclose(fp)){
+         fprintf(stderr, "ERROR : write_text_results_sel : fclose : %s\n",
+                 ofile);
+         return(-3);
+      }
    }
 
-   /* 2. Write just minutiae XYT's & Qualities to text      */
-   /*    file "<oroot>.xyt".                                */
-   /*                                                       */
-   /*    A. If M1 flag set:                                 */
-   /*       XYTQ's written according to M1 (ANSI INCITS     */
-   /*          378-2004) representation:                    */
-   /*       1. pixel coordinates with origin top-left       */
-   /*       2. orientation in degrees on range [0..360]     */
-   /*          with 0 pointing east and increasing counter  */
-   /*          clockwise                                    */
-   /*       3. direction pointing up the ridge ending or    */
-   /*             bifurcaiton valley                        */
-   /*       4. minutiae qualities on integer range [0..100] */
-   /*             (non-standard)                            */
-   /*                                                       */
-   /*    B. If M1 flag NOT set:                             */
-   /*       XYTQ's written according to NIST internal rep.  */
-   /*       1. pixel coordinates with origin bottom-left    */
-   /*       2. orientation in degrees on range [0..360]     */
-   /*          with 0 pointing east and increasing counter  */
-   /*          clockwise (same as M1)                       */
-   /*       3. direction pointing out and away from the     */
-   /*             ridge ending or bifurcation valley        */
-   /*             (opposite direction from M1)              */
-   /*       4. minutiae qualities on integer range [0..100] */
-   /*             (non-standard)                            */
-   sprintf(ofile, "%s.%s", oroot, XYT_EXT);
-   if(m1flag){
-      if((ret = write_minutiae_XYTQ(ofile, M1_XYT_REP, minutiae, iw, ih))){
-         return(ret);
+   if(files & LFS_OUT_XYT){
+      /* 2. Write just minutiae XYT's & Qualities to text      */
+      /*    file "<oroot>.xyt".                                */
+      /*                                                       */
+      /*    A. If M1 flag set:                                 */
+      /*       XYTQ's written according to M1 (ANSI INCITS     */
+      /*          378-2004) representation:                    */
+      /*       1. pixel coordinates with origin top-left       */
+      /*       2. orientation in degrees on range [0..360]     */
+      /*          with 0 pointing east and increasing counter  */
+      /*          clockwise                                    */
+      /*       3. direction pointing up the ridge ending or    */
+      /*             bifurcaiton valley                        */
+      /*       4. minutiae qualities on integer range [0..100] */
+      /*             (non-standard)                            */
+      /*                                                       */
+      /*    B. If M1 flag NOT set:                             */
+      /*       XYTQ's written according to NIST internal rep.  */
+      /*       1. pixel coordinates with origin bottom-left    */
+      /*       2. orientation in degrees on range [0..360]     */
+      /*          with 0 pointing east and increasing counter  */
+      /*          clockwise (same as M1)                       */
+      /*       3. direction pointing out and away from the     */
+      /*             ridge ending or bifurcation valley        */
+      /*             (opposite direction from M1)              */
+      /*       4. minutiae qualities on integer range [0..100] */
+      /*             (non-standard)                            */
+      sprintf(ofile, "%s.%s", oroot, XYT_EXT);
+      if(m1flag){
+         if((ret = write_minutiae_XYTQ(ofile, M1_XYT_REP, minutiae, iw, ih))){
+            return(ret);
+         }
       }
-   }
-   else{
-      if((ret = write_minutiae_XYTQ(ofile, NIST_INTERNAL_XYT_REP,
-                                   minutiae, iw, ih))){
-         return(ret);
+      else{
+         if((ret = write_minutiae_XYTQ(ofile, NIST_INTERNAL_XYT_REP,
+                                      minutiae, iw, ih))){
+            return(ret);
+         }
       }
    }
 
-   /* 3. Write Integrated Quality Map results to text file. */
-   sprintf(ofile, "%s.%s", oroot, QUALITY_MAP_EXT);
-   if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
-      fprintf(stderr, "ERROR : write_text_results : fopen : %s\n", ofile);
-      return(-4);
-   }
-   /* Print a text report from the map. */
-   dump_map(fp, quality_map, map_w, map_h);
-   if(fclose(fp)){
-      fprintf(stderr, "ERROR : write_text_results : fclose : %s\n", ofile);
-      return(-5);
+   if(files & LFS_OUT_QUALITY_MAP){
+      /* 3. Write Integrated Quality Map results to text file. */
+      sprintf(ofile, "%s.%s", oroot, QUALITY_MAP_EXT);
+      if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
+         fprintf(stderr, "ERROR : write_text_results_sel : fopen : %s\n",
+                 ofile);
+         return(-4);
+      }
+      /* Print a text report from the map. */
+      dump_map(fp, quality_map, map_w, map_h);
+      if(fclose(fp)){
+         fprintf(stderr, "ERROR : write_text_results_sel : fclose : %s\n",
+                 ofile);
+         return(-5);
+      }
    }
 
-   /* 4. Write Direction Map results to text file. */
-   sprintf(ofile, "%s.%s", oroot, DIRECTION_MAP_EXT);
-   if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
-      fprintf(stderr, "ERROR : write_text_results : fopen : %s\n", ofile);
-      return(-6);
-   }
-   /* Print a text report from the map. */
-   dump_map(fp, direction_map, map_w, map_h);
-   if(fclose(fp)){
-      fprintf(stderr, "ERROR : write_text_results : fclose : %s\n", ofile);
-      return(-7);
+   if(files & LFS_OUT_DIRECTION_MAP){
+      /* 4. Write Direction Map results to text file. */
+      sprintf(ofile, "%s.%s", oroot, DIRECTION_MAP_EXT);
+      if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
+         fprintf(stderr, "ERROR : write_text_results_sel : fopen : %s\n",
+                 ofile);
+         return(-6);
+      }
+      /* Print a text report from the map. */
+      dump_map(fp, direction_map, map_w, map_h);
+      if(fclose(fp)){
+         fprintf(stderr, "ERROR : write_text_results_sel : fclose : %s\n",
+                 ofile);
+         return(-7);
+      }
    }
 
-   /* 5. Write Low Contrast Map results to text file. */
-   sprintf(ofile, "%s.%s", oroot, LOW_CONTRAST_MAP_EXT);
-   if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
-      fprintf(stderr, "ERROR : write_text_results : fopen : %s\n", ofile);
-      return(-8);
-   }
-   /* Print a text report from the map. */
-   dump_map(fp, low_contrast_map, map_w, map_h);
-   if(fclose(fp)){
-      fprintf(stderr, "ERROR : write_text_results : fclose : %s\n", ofile);
-      return(-9);
+   if(files & LFS_OUT_LOW_CONTRAST_MAP){
+      /* 5. Write Low Contrast Map results to text file. */
+      sprintf(ofile, "%s.%s", oroot, LOW_CONTRAST_MAP_EXT);
+      if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
+         fprintf(stderr, "ERROR : write_text_results_sel : fopen : %s\n",
+                 ofile);
+         return(-8);
+      }
+      /* Print a text report from the map. */
+      dump_map(fp, low_contrast_map, map_w, map_h);
+      if(fclose(fp)){
+         fprintf(stderr, "ERROR : write_text_results_sel : fclose : %s\n",
+                 ofile);
+         return(-9);
+      }
    }
 
-   /* 6. Write Low Flow Map results to text file. */
-   sprintf(ofile, "%s.%s", oroot, LOW_FLOW_MAP_EXT);
-   if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
-      fprintf(stderr, "ERROR : write_text_results : fopen : %s\n", ofile);
-      return(-10);
-   }
-   /* Print a text report from the map. */
-   dump_map(fp, low_flow_map, map_w, map_h);
-   if(fclose(fp)){
-      fprintf(stderr, "ERROR : write_text_results : fclose : %s\n", ofile);
-      return(-11);
+   if(files & LFS_OUT_LOW_FLOW_MAP){
+      /* 6. Write Low Flow Map results to text file. */
+      sprintf(ofile, "%s.%s", oroot, LOW_FLOW_MAP_EXT);
+      if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
+         fprintf(stderr, "ERROR : write_text_results_sel : fopen : %s\n",
+                 ofile);
+         return(-10);
+      }
+      /* Print a text report from the map. */
+      dump_map(fp, low_flow_map, map_w, map_h);
+      if(fclose(fp)){
+         fprintf(stderr, "ERROR : write_text_results_sel : fclose : %s\n",
+                 ofile);
+         return(-11);
+      }
    }
 
-   /* 7. Write High Curvature Map results to text file. */
-   sprintf(ofile, "%s.%s", oroot, HIGH_CURVE_MAP_EXT);
-   if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
-      fprintf(stderr, "ERROR : write_text_results : fopen : %s\n", ofile);
-      return(-12);
-   }
-   /* Print a text report from the map. */
-   dump_map(fp, high_curve_map, map_w, map_h);
-   if(fclose(fp)){
-      fprintf(stderr, "ERROR : write_text_results : fclose : %s\n", ofile);
-      return(-13);
+   if(files & LFS_OUT_HIGH_CURVE_MAP){
+      /* 7. Write High Curvature Map results to text file. */
+      sprintf(ofile, "%s.%s", oroot, HIGH_CURVE_MAP_EXT);
+      if((fp = fopen(ofile, "wb")) == (FILE *)NULL){
+         fprintf(stderr, "ERROR : write_text_results_sel : fopen : %s\n",
+                 ofile);
+         return(-12);
+      }
+      /* Print a text report from the map. */
+      dump_map(fp, high_curve_map, map_w, map_h);
+      if(fclose(fp)){
+         fprintf(stderr, "ERROR : write_text_results_sel : fclose : %s\n",
+                 ofile);
+         return(-13);
+      }
    }
 
    /* Return normally. */
@@ -0,0 +1,410 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+
+/***********************************************************************
+      LIBRARY: LFS - NIST Latent Fingerprint System
+
+      FILE:    SIMD.C
+
+      Contains vector versions of the DFT analysis conducted on each
+      block of the image, and of the directional binarization of its
+      pixels, for x86-64 hosts built with GCC or Clang.
+
+      The SSE2 DFT kernel applies each DFT wave form to 2 directions
+      at a time, and the AVX2 kernel to 4 directions at a time, after
+      gathering the rotated pixel row sums 8 pixels at a time.  Each
+      direction's DFT power is accumulated in double precision in the
+      same order, and with the same operations, as dft_power(), so
+      the powers, and the maps derived from them, are the same as
+      those of the scalar routines in dft.c.
+
+      The binarization kernels sum the rotated grids of 8 adjacent
+      pixels (SSE2) or of 8 adjacent pixels in each of 2 rows (AVX2)
+      at a time, in 16-bit integers.  Integer sums do not depend on
+      their order, so the binary pixels are those of dirbinarize().
+
+***********************************************************************
+               ROUTINES:
+                        lfs_simd_isa()
+                        dft_dir_powers_sse2()
+                        dft_dir_powers_avx2()
+                        dirbinarize_tile_sse2()
+                        dirbinarize_tile_avx2()
+***********************************************************************/
+
+#include <stdio.h>
+#include <lfs.h>
+
+#ifdef LFS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/*************************************************************************
+**************************************************************************
+#cat: lfs_simd_isa - Returns the fastest set of vector kernels the host
+#cat:             processor is able to run.
+
+   Return Code:
+      LFS_ISA_AVX2   - AVX2 kernels
+      LFS_ISA_SSE2   - SSE2 kernels
+      LFS_ISA_SCALAR - no vector kernels were built
+**************************************************************************/
+int lfs_simd_isa(void)
+{
+#ifdef LFS_X86_SIMD
+   __builtin_cpu_init();
+   if(__builtin_cpu_supports("avx2"))
+      return(LFS_ISA_AVX2);
+   /* SSE2 is part of every x86-64 processor. */
+   return(LFS_ISA_SSE2);
+#else
+   return(LFS_ISA_SCALAR);
+#endif
+}
+
+#ifdef LFS_X86_SIMD
+
+/*************************************************************************
+**************************************************************************
+   dft_wave_powers_t - Applies a DFT wave form to the row sums of the
+             directions [dir0, ngrids), one direction at a time.  The
+             row sums are stored by row, then by direction.
+**************************************************************************/
+static void dft_wave_powers_t(double *power, const double *rowsums_t,
+                              const DFTWAVE *wave, const int wavelen,
+                              const int ngrids, const int dir0)
+{
+   int dir, i;
+   double cospart, sinpart;
+
+   for(dir = dir0; dir < ngrids; dir++){
+      cospart = 0.0;
+      sinpart = 0.0;
+      for(i = 0; i < wavelen; i++){
+         cospart += (rowsums_t[(i * ngrids) + dir] * wave->cos[i]);
+         sinpart += (rowsums_t[(i * ngrids) + dir] * wave->sin[i]);
+      }
+      power[dir] = (cospart * cospart) + (sinpart * sinpart);
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: dft_dir_powers_sse2 - Computes the DFT powers of an image block at
+#cat:             every orientation like dft_dir_powers(), applying each
+#cat:             wave form to 2 orientations at a time.
+
+   Input:
+      blkptr    - the pixel address of the origin of the current image block
+      dftwaves  - structure containing the DFT wave forms
+      dftgrids  - structure containing the rotated pixel grid offsets
+      rowsums_t - scratch space for grid_w * ngrids pixel row sums
+   Output:
+      powers    - DFT power computed from each wave form frequencies at each
+                  orientation (direction) in the current image block
+**************************************************************************/
+void dft_dir_powers_sse2(double **powers, const unsigned char *blkptr,
+                         const DFTWAVES *dftwaves, const ROTGRIDS *dftgrids,
+                         double *rowsums_t)
+{
+   const int ngrids = dftgrids->ngrids;
+   const int grid_w = dftgrids->grid_w;
+   const int *grid;
+   const double *cs, *sn;
+   __m128d cospart, sinpart, rowsum;
+   int dir, iy, ix, w, i, sum;
+
+   /* Sum the pixels along each rotated row of each grid. */
+   for(dir = 0; dir < ngrids; dir++){
+      grid = dftgrids->grids[dir];
+      for(iy = 0; iy < grid_w; iy++){
+         sum = 0;
+         for(ix = 0; ix < grid_w; ix++)
+            sum += blkptr[grid[ix]];
+         rowsums_t[(iy * ngrids) + dir] = (double)sum;
+         grid += grid_w;
+      }
+   }
+
+   /* Foreach DFT wave ... */
+   for(w = 0; w < dftwaves->nwaves; w++){
+      cs = dftwaves->waves[w]->cos;
+      sn = dftwaves->waves[w]->sin;
+      /* Foreach pair of directions ... */
+      for(dir = 0; dir + 2 <= ngrids; dir += 2){
+         cospart = _mm_setzero_pd();
+         sinpart = _mm_setzero_pd();
+         for(i = 0; i < dftwaves->wavelen; i++){
+            rowsum = _mm_loadu_pd(rowsums_t + (i * ngrids) + dir);
+            cospart = _mm_add_pd(cospart,
+                                 _mm_mul_pd(rowsum, _mm_set1_pd(cs[i])));
+            sinpart = _mm_add_pd(sinpart,
+                                 _mm_mul_pd(rowsum, _mm_set1_pd(sn[i])));
+         }
+         _mm_storeu_pd(powers[w] + dir,
+                       _mm_add_pd(_mm_mul_pd(cospart, cospart),
+                                  _mm_mul_pd(sinpart, sinpart)));
+      }
+      dft_wave_powers_t(powers[w], rowsums_t, dftwaves->waves[w],
+                        dftwaves->wavelen, ngrids, dir);
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: dft_dir_powers_avx2 - Computes the DFT powers of an image block at
+#cat:             every orientation like dft_dir_powers(), gathering 8
+#cat:             rotated grid pixels at a time and applying each wave
+#cat:             form to 4 orientations at a time.  Each gather loads
+#cat:             4 bytes at a sampled pixel, so the 3 bytes following
+#cat:             every pixel sampled must be addressable.
+
+   Input:
+      blkptr    - the pixel address of the origin of the current image block
+      dftwaves  - structure containing the DFT wave forms
+      dftgrids  - structure containing the rotated pixel grid offsets
+      rowsums_t - scratch space for grid_w * ngrids pixel row sums
+   Output:
+      powers    - DFT power computed from each wave form frequencies at each
+                  orientation (direction) in the current image block
+**************************************************************************/
+__attribute__((target("avx2")))
+void dft_dir_powers_avx2(double **powers, const unsigned char *blkptr,
+                         const DFTWAVES *dftwaves, const ROTGRIDS *dftgrids,
+                         double *rowsums_t)
+{
+   const int ngrids = dftgrids->ngrids;
+   const int grid_w = dftgrids->grid_w;
+   const __m256i lowbyte = _mm256_set1_epi32(0xFF);
+   const int *grid;
+   const double *cs, *sn;
+   __m256i pixels;
+   __m128i sums;
+   __m256d cospart, sinpart, rowsum;
+   int dir, iy, ix, w, i, sum;
+
+   /* Sum the pixels along each rotated row of each grid. */
+   for(dir = 0; dir < ngrids; dir++){
+      grid = dftgrids->grids[dir];
+      for(iy = 0; iy < grid_w; iy++){
+         pixels = _mm256_setzero_si256();
+         for(ix = 0; ix + 8 <= grid_w; ix += 8){
+            pixels = _mm256_add_epi32(pixels, _mm256_and_si256(lowbyte,
+                        _mm256_i32gather_epi32((const int *)blkptr,
+                           _mm256_loadu_si256((const __m256i *)(grid + ix)),
+                           1)));
+         }
+         sums = _mm_add_epi32(_mm256_castsi256_si128(pixels),
+                              _mm256_extracti128_si256(pixels, 1));
+         sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, 0x4E));
+         sums = _mm_add_epi32(sums, _mm_shuffle_epi32(sums, 0xB1));
+         sum = _mm_cvtsi128_si32(sums);
+         for(; ix < grid_w; ix++)
+            sum += blkptr[grid[ix]];
+         rowsums_t[(iy * ngrids) + dir] = (double)sum;
+         grid += grid_w;
+      }
+   }
+
+   /* Foreach DFT wave ... */
+   for(w = 0; w < dftwaves->nwaves; w++){
+      cs = dftwaves->waves[w]->cos;
+      sn = dftwaves->waves[w]->sin;
+      /* Foreach group of 4 directions ... */
+      for(dir = 0; dir + 4 <= ngrids; dir += 4){
+         cospart = _mm256_setzero_pd();
+         sinpart = _mm256_setzero_pd();
+         for(i = 0; i < dftwaves->wavelen; i++){
+            rowsum = _mm256_loadu_pd(rowsums_t + (i * ngrids) + dir);
+            cospart = _mm256_add_pd(cospart,
+                                  _mm256_mul_pd(rowsum, _mm256_set1_pd(cs[i])));
+            sinpart = _mm256_add_pd(sinpart,
+                                  _mm256_mul_pd(rowsum, _mm256_set1_pd(sn[i])));
+         }
+         _mm256_storeu_pd(powers[w] + dir,
+                          _mm256_add_pd(_mm256_mul_pd(cospart, cospart),
+                                        _mm256_mul_pd(sinpart, sinpart)));
+      }
+      dft_wave_powers_t(powers[w], rowsums_t, dftwaves->waves[w],
+                        dftwaves->wavelen, ngrids, dir);
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: dirbinarize_tile_sse2 - Directionally binarizes a tile of pixels
+#cat:             8 wide, all of which share the same direction, like
+#cat:             dirbinarize(), 8 pixels at a time.  The rotated grid
+#cat:             sums must fit in 16 bits.
+
+   Input:
+      pptr        - pointer to the tile's first grayscale pixel
+      pw          - padded width (in pixels) of the grayscale image
+      nrows       - number of rows in the tile
+      idir        - integer direction of the tile's pixels
+      dirbingrids - set of precomputed rotated grid offsets
+      cy          - center (0-oriented) row in the grids
+      bw          - width (in pixels) of the binary image
+   Output:
+      bptr        - the tile's first pixel in the binary image
+**************************************************************************/
+void dirbinarize_tile_sse2(unsigned char *bptr, const int bw,
+                           const unsigned char *pptr, const int pw,
+                           const int nrows, const int idir,
+                           const ROTGRIDS *dirbingrids, const int cy)
+{
+   const int *grid = dirbingrids->grids[idir];
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i grid_h = _mm_set1_epi16((short)dirbingrids->grid_h);
+   __m128i rsum, gsum, csum, black;
+   int iy, gx, gy, gi;
+
+   csum = zero;
+   for(iy = 0; iy < nrows; iy++){
+      gi = 0;
+      gsum = zero;
+      /* Foreach row in grid ... */
+      for(gy = 0; gy < dirbingrids->grid_h; gy++){
+         rsum = zero;
+         /* Accumulate next pixel along rotated row in each grid. */
+         for(gx = 0; gx < dirbingrids->grid_w; gx++){
+            rsum = _mm_add_epi16(rsum, _mm_unpacklo_epi8(
+                      _mm_loadl_epi64((const __m128i *)(pptr + grid[gi])),
+                      zero));
+            gi++;
+         }
+         gsum = _mm_add_epi16(gsum, rsum);
+         if(gy == cy)
+            csum = rsum;
+      }
+
+      /* BLACK where center row sum times grid height < grid sum. */
+      black = _mm_cmplt_epi16(_mm_mullo_epi16(csum, grid_h), gsum);
+      black = _mm_packs_epi16(black, black);
+      _mm_storel_epi64((__m128i *)bptr,
+                       _mm_or_si128(
+                          _mm_and_si128(black,
+                             _mm_set1_epi8((char)BLACK_PIXEL)),
+                          _mm_andnot_si128(black,
+                             _mm_set1_epi8((char)WHITE_PIXEL))));
+      bptr += bw;
+      pptr += pw;
+   }
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: dirbinarize_tile_avx2 - Directionally binarizes a tile of pixels
+#cat:             8 wide, all of which share the same direction, like
+#cat:             dirbinarize(), 8 pixels in each of 2 rows at a time.
+#cat:             The rotated grid sums must fit in 16 bits.
+
+   Input:
+      pptr        - pointer to the tile's first grayscale pixel
+      pw          - padded width (in pixels) of the grayscale image
+      nrows       - number of rows in the tile
+      idir        - integer direction of the tile's pixels
+      dirbingrids - set of precomputed rotated grid offsets
+      cy          - center (0-oriented) row in the grids
+      bw          - width (in pixels) of the binary image
+   Output:
+      bptr        - the tile's first pixel in the binary image
+**************************************************************************/
+__attribute__((target("avx2")))
+void dirbinarize_tile_avx2(unsigned char *bptr, const int bw,
+                           const unsigned char *pptr, const int pw,
+                           const int nrows, const int idir,
+                           const ROTGRIDS *dirbingrids, const int cy)
+{
+   const int *grid = dirbingrids->grids[idir];
+   const __m256i zero = _mm256_setzero_si256();
+   const __m256i grid_h = _mm256_set1_epi16((short)dirbingrids->grid_h);
+   const unsigned char *p;
+   __m256i rsum, gsum, csum, black;
+   __m128i pixels;
+   int iy, gx, gy, gi;
+
+   csum = zero;
+   /* Foreach pair of rows in the tile ... */
+   for(iy = 0; iy + 2 <= nrows; iy += 2){
+      gi = 0;
+      gsum = zero;
+      /* Foreach row in grid ... */
+      for(gy = 0; gy < dirbingrids->grid_h; gy++){
+         rsum = zero;
+         /* Accumulate next pixel along rotated row in each grid, */
+         /* for 8 pixels in each of the 2 rows.                   */
+         for(gx = 0; gx < dirbingrids->grid_w; gx++){
+            p = pptr + grid[gi];
+            pixels = _mm_unpacklo_epi64(
+                        _mm_loadl_epi64((const __m128i *)p),
+                        _mm_loadl_epi64((const __m128i *)(p + pw)));
+            rsum = _mm256_add_epi16(rsum, _mm256_cvtepu8_epi16(pixels));
+            gi++;
+         }
+         gsum = _mm256_add_epi16(gsum, rsum);
+         if(gy == cy)
+            csum = rsum;
+      }
+
+      /* BLACK where center row sum times grid height < grid sum. */
+      black = _mm256_cmpgt_epi16(gsum, _mm256_mullo_epi16(csum, grid_h));
+      pixels = _mm_packs_epi16(_mm256_castsi256_si128(black),
+                               _mm256_extracti128_si256(black, 1));
+      pixels = _mm_or_si128(
+                  _mm_and_si128(pixels, _mm_set1_epi8((char)BLACK_PIXEL)),
+                  _mm_andnot_si128(pixels, _mm_set1_epi8((char)WHITE_PIXEL)));
+      _mm_storel_epi64((__m128i *)bptr, pixels);
+      _mm_storel_epi64((__m128i *)(bptr + bw), _mm_unpackhi_epi64(pixels,
+                                                                  pixels));
+      bptr += (bw << 1);
+      pptr += (pw << 1);
+   }
+
+   /* Binarize an odd last row 8 pixels at a time. */
+   if(iy < nrows)
+      dirbinarize_tile_sse2(bptr, bw, pptr, pw, 1, idir, dirbingrids, cy);
+}
+
+#endif /* LFS_X86_SIMD */
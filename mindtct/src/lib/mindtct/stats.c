@@ -0,0 +1,180 @@
+/*******************************************************************************
+
+License: 
+This software and/or related materials was developed at the National Institute
+of Standards and Technology (NIST) by employees of the Federal Government
+in the course of their official duties. Pursuant to title 17 Section 105
+of the United States Code, this software is not subject to copyright
+protection and is in the public domain. 
+
+This software and/or related materials have been determined to be not subject
+to the EAR (see Part 734.3 of the EAR for exact details) because it is
+a publicly available technology and software, and is freely distributed
+to any interested party with no licensing requirements.  Therefore, it is 
+permissible to distribute this software as a free download from the internet.
+
+Disclaimer: 
+This software and/or related materials was developed to promote biometric
+standards and biometric technology testing for the Federal Government
+in accordance with the USA PATRIOT Act and the Enhanced Border Security
+and Visa Entry Reform Act. Specific hardware and software products identified
+in this software were used in order to perform the software development.
+In no case does such identification imply recommendation or endorsement
+by the National Institute of Standards and Technology, nor does it imply that
+the products and equipment identified are necessarily the best available
+for the purpose.
+
+This software and/or related materials are provided "AS-IS" without warranty
+of any kind including NO WARRANTY OF PERFORMANCE, MERCHANTABILITY,
+NO WARRANTY OF NON-INFRINGEMENT OF ANY 3RD PARTY INTELLECTUAL PROPERTY
+or FITNESS FOR A PARTICULAR PURPOSE or for any purpose whatsoever, for the
+licensed product, however used. In no event shall NIST be liable for any
+damages and/or costs, including but not limited to incidental or consequential
+damages of any kind, including economic damage or injury to property and lost
+profits, regardless of whether NIST shall be advised, have reason to know,
+or in fact shall know of the possibility.
+
+By using this software, you agree to bear all risk relating to quality,
+use and performance of the software and/or related materials.  You agree
+to hold the Government harmless from any claim arising from your use
+of the software.
+
+*******************************************************************************/
+
+
+/***********************************************************************
+      LIBRARY: LFS - NIST Latent Fingerprint System
+
+      FILE:    STATS.C
+
+      Contains routines used to time the stages of minutiae detection
+      and to report the times and counts recorded in an LFSSTATS
+      structure as part of the NIST Latent Fingerprint System (LFS).
+
+***********************************************************************
+               ROUTINES:
+                        lfs_wall_time()
+                        count_map_flags()
+                        print_lfs_stats_json()
+***********************************************************************/
+
+#include <stdio.h>
+#include <sys/time.h>
+#include <lfs.h>
+
+/* Names of the false minutia removal steps, indexed by RM_* */
+static const char *rm_step_names[NUM_RM_STEPS] = {
+   "islands_and_lakes",
+   "holes",
+   "pointing_invblock",
+   "near_invblock",
+   "side_minutiae",
+   "hooks",
+   "overlaps",
+   "malformations",
+   "pores"
+};
+
+/*************************************************************************
+**************************************************************************
+#cat: lfs_wall_time - Returns the current wall clock time in seconds,
+#cat:             for measuring elapsed times.
+
+   Return Code:
+      Seconds since the Epoch, with microsecond resolution
+**************************************************************************/
+double lfs_wall_time(void)
+{
+   struct timeval tv;
+
+   gettimeofday(&tv, (void *)NULL);
+   return((double)tv.tv_sec + ((double)tv.tv_usec / 1000000.0));
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: count_map_flags - Returns the number of blocks in a map of TRUE or
+#cat:             FALSE flags (such as a Low Contrast Map) that are set.
+
+   Input:
+      map       - map of flagged blocks
+      mw        - width (in blocks) of the map
+      mh        - height (in blocks) of the map
+   Return Code:
+      Number of nonzero blocks in the map
+**************************************************************************/
+int count_map_flags(const int *map, const int mw, const int mh)
+{
+   int i, n;
+
+   n = 0;
+   for(i = 0; i < mw*mh; i++){
+      if(map[i])
+         n++;
+   }
+
+   return(n);
+}
+
+/*************************************************************************
+**************************************************************************
+   print_json_string - Prints a string as a quoted JSON string,
+             escaping the characters JSON requires.
+**************************************************************************/
+static void print_json_string(FILE *fp, const char *str)
+{
+   const unsigned char *cptr;
+
+   fputc('"', fp);
+   for(cptr = (const unsigned char *)str; *cptr != '\0'; cptr++){
+      if((*cptr == '"') || (*cptr == '\\'))
+         fprintf(fp, "\\%c", *cptr);
+      else if(*cptr < 0x20)
+         fprintf(fp, "\\u%04x", *cptr);
+      else
+         fputc(*cptr, fp);
+   }
+   fputc('"', fp);
+}
+
+/*************************************************************************
+**************************************************************************
+#cat: print_lfs_stats_json - Prints the times and counts recorded for one
+#cat:             image as a JSON object on a single line.
+
+   Input:
+      fp        - open file pointer to be written to
+      name      - name of the image, or NULL to omit it
+      stats     - times and counts recorded for the image
+**************************************************************************/
+void print_lfs_stats_json(FILE *fp, const char *name, const LFSSTATS *stats)
+{
+   int i;
+
+   fputc('{', fp);
+   if(name != (char *)NULL){
+      fprintf(fp, "\"image\":");
+      print_json_string(fp, name);
+      fputc(',', fp);
+   }
+   fprintf(fp, "\"width\":%d,\"height\":%d,", stats->iw, stats->ih);
+
+   fprintf(fp, "\"time\":{\"maps\":%.6f,\"binarize\":%.6f,",
+           stats->maps_time, stats->binarize_time);
+   fprintf(fp, "\"detect\":%.6f,\"remove\":%.6f,",
+           stats->detect_time, stats->remove_time);
+   fprintf(fp, "\"ridge_count\":%.6f,\"quality\":%.6f,\"total\":%.6f},",
+           stats->ridge_count_time, stats->quality_time, stats->total_time);
+
+   fprintf(fp, "\"blocks\":{\"total\":%d,\"low_contrast\":%d,",
+           stats->num_blocks, stats->low_contrast_blocks);
+   fprintf(fp, "\"low_flow\":%d,\"high_curve\":%d},",
+           stats->low_flow_blocks, stats->high_curve_blocks);
+
+   fprintf(fp, "\"minutiae\":{\"candidates\":%d,\"removed\":{",
+           stats->candidate_minutiae);
+   for(i = 0; i < NUM_RM_STEPS; i++)
+      fprintf(fp, "%s\"%s\":%d", (i ? "," : ""),
+              rm_step_names[i], stats->removed[i]);
+   fprintf(fp, "},\"final\":%d}}\n", stats->num_minutiae);
+}
@@ -73,6 +73,15 @@ int comp_nfiq_flex(int *, float *, unsigned char *,
               const int, const int, const int, const int,
               float *, float *, const int, const int, const int,
               const char, const char, float *, int *);
+int comp_nfiq_minutiae(int *, float *, MINUTIAE *, int *,
+              const int, const int, float *, float *,
+              const int, const int, const int,
+              const char, const char, float *, int *);
+int get_minutiae_nfiq(MINUTIAE **, int **, int **, int **,
+              int **, int **, int *, int *,
+              unsigned char **, int *, int *, int *, int *, float *,
+              unsigned char *, const int, const int, const int,
+              const double, const int, LFSEXTRACTOR *, int *);
 
 /***********************************************************************/
 /* ZNORM.C : Routines supporting Z-Normalization */
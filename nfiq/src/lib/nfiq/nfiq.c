@@ -62,6 +62,8 @@ of the software.
                         comp_nfiq_featvctr()
                         comp_nfiq()
                         comp_nfiq_flex()
+                        comp_nfiq_minutiae()
+                        get_minutiae_nfiq()
 
 ***********************************************************************/
 
@@ -251,7 +253,6 @@ int comp_nfiq_flex(int *onfiq, float *oconf, unsigned char *idata,
               int *optflag)
 {
    int ret;
-   float featvctr[NFIQ_VCTRLEN], outacs[NFIQ_NUM_CLASSES];
    unsigned char *bdata;
    int bw, bh, bd;
    double ippmm;
@@ -259,8 +260,6 @@ int comp_nfiq_flex(int *onfiq, float *oconf, unsigned char *idata,
    int *direction_map, *low_contrast_map, *low_flow_map;
    int *high_curve_map, *quality_map;
    int map_w, map_h;
-   int class_i;
-   float maxact;
 
    /* If image ppi not defined, then assume 500 */
    if(ippi == UNDEFINED)
@@ -281,10 +280,63 @@ int comp_nfiq_flex(int *onfiq, float *oconf, unsigned char *idata,
    free(high_curve_map);
    free(bdata);
 
+   /* Compute NFIQ from the minutiae and quality map */
+   ret = comp_nfiq_minutiae(onfiq, oconf, minutiae, quality_map,
+                            map_w, map_h, znorm_means, znorm_stds,
+                            nInps, nHids, nOuts, acfunc_hids, acfunc_outs,
+                            wts, optflag);
+
+   free_minutiae(minutiae);
+   free(quality_map);
+
+   return(ret);
+}
+
+/***********************************************************************
+************************************************************************
+#cat: comp_nfiq_minutiae - Routine computes NFIQ from the minutiae and
+#cat:             integrated quality map already detected in an image
+#cat:             by NIST's Mindtct, so that a caller who needs both
+#cat:             runs the detection only once.  The minutiae and map
+#cat:             are not modified or freed.
+
+   Input:
+      minutiae    - list of minutiae from NIST's Mindtct
+      quality_map - quality map computed by NIST's Mindtct
+      map_w       - width of map
+      map_h       - height of map
+      znorm_means - global mean for each feature vector coef used for Z-Norm
+      znorm_stds  - global stddev for each feature vector coef used for Z-Norm
+      nInps       - feature vector length (number of MLP inputs)
+      nHids       - number of hidden layer neurodes in MLP
+      nOuts       - number of NFIQ levels (number of MLP output classes)
+      acfunc_hids - type of MLP activiation function used at MLP hidden layer
+      acfunc_outs - type of MLP activiation function used at MLP output layer
+      wts         - MLP classification weights
+   Output:
+      onfiq       - resulting NFIQ value
+      oconf       - max output class MLP activation
+   Return Code:
+      Zero        - successful completion
+      EMPTY_IMG   - empty image detected (feature vector set to 0's)
+      TOO_FEW_MINUTIAE - too few minutiae detected from fingerprint image,
+                    indicating poor quality fingerprint
+      Negative    - system error
+************************************************************************/
+int comp_nfiq_minutiae(int *onfiq, float *oconf, MINUTIAE *minutiae,
+              int *quality_map, const int map_w, const int map_h,
+              float *znorm_means, float *znorm_stds,
+              const int nInps, const int nHids, const int nOuts,
+              const char acfunc_hids, const char acfunc_outs, float *wts,
+              int *optflag)
+{
+   int ret;
+   float featvctr[NFIQ_VCTRLEN], outacs[NFIQ_NUM_CLASSES];
+   int class_i;
+   float maxact;
+
    /* Catch case where too few minutiae detected */
    if(minutiae->num <= MIN_MINUTIAE){
-      free_minutiae(minutiae);
-      free(quality_map);
       *onfiq = MIN_MINUTIAE_QUAL;
       *oconf = 1.0;
       return(TOO_FEW_MINUTIAE);
@@ -294,16 +346,11 @@ int comp_nfiq_flex(int *onfiq, float *oconf, unsigned char *idata,
    ret = comp_nfiq_featvctr(featvctr, NFIQ_VCTRLEN,
                             minutiae, quality_map, map_w, map_h, optflag);
    if(ret == EMPTY_IMG){
-      free_minutiae(minutiae);
-      free(quality_map);
       *onfiq = EMPTY_IMG_QUAL;
       *oconf = 1.0;
       return(ret);
    }
 
-   free_minutiae(minutiae);
-   free(quality_map);
-
    /* ZNormalize feature vector */
    znorm_fniq_featvctr(featvctr, znorm_means, znorm_stds, NFIQ_VCTRLEN);
 
@@ -319,3 +366,89 @@ int comp_nfiq_flex(int *onfiq, float *oconf, unsigned char *idata,
    /* return normally */
    return(0);
 }
+
+/***********************************************************************
+************************************************************************
+#cat: get_minutiae_nfiq - Routine detects minutiae in an image with
+#cat:             NIST's Mindtct and computes the image's NFIQ from the
+#cat:             same detection, using default statistics for
+#cat:             Z-Normalization and default weights for MLP
+#cat:             classification.  The Mindtct results selected by an
+#cat:             output mask are passed back as by get_minutiae_sel();
+#cat:             the quality map is always built, but is freed unless
+#cat:             selected.  The minutiae and NFIQ are the same as
+#cat:             from separate calls to get_minutiae() and comp_nfiq().
+
+   Input:
+      idata       - grayscale fingerprint image data
+      iw          - image pixel width
+      ih          - image pixel height
+      id          - image pixel depth (should always be 8)
+      ppmm        - image scan density in pixels/mm
+      outputs     - mask of LFS_OUT_* bits selecting the Mindtct
+                    results wanted
+      extractor   - LFS parameters and lookup tables
+      optflag     - if set to 1, the NFIQ feature vector is printed
+   Output:
+      ominutiae ... obd - Mindtct results (as get_minutiae_sel())
+      onfiq       - resulting NFIQ value
+      oconf       - max output class MLP activation
+      extractor   - stats holds the times and counts for this image
+   Return Code:
+      Zero        - successful completion
+      EMPTY_IMG   - empty image detected, with all outputs set
+      TOO_FEW_MINUTIAE - too few minutiae detected from fingerprint image,
+                    with all outputs set
+      Negative    - system error
+************************************************************************/
+int get_minutiae_nfiq(MINUTIAE **ominutiae, int **oquality_map,
+              int **odirection_map, int **olow_contrast_map,
+              int **olow_flow_map, int **ohigh_curve_map,
+              int *omap_w, int *omap_h,
+              unsigned char **obdata, int *obw, int *obh, int *obd,
+              int *onfiq, float *oconf,
+              unsigned char *idata, const int iw, const int ih,
+              const int id, const double ppmm, const int outputs,
+              LFSEXTRACTOR *extractor, int *optflag)
+{
+   int ret, nfiq_ret;
+   MINUTIAE *minutiae;
+   int *quality_map;
+
+   /* Detect minutiae, keeping the quality map for NFIQ */
+   if((ret = get_minutiae_sel(&minutiae, &quality_map, odirection_map,
+                         olow_contrast_map, olow_flow_map, ohigh_curve_map,
+                         omap_w, omap_h, obdata, obw, obh, obd,
+                         idata, iw, ih, id, ppmm,
+                         outputs | LFS_OUT_QUALITY_MAP, extractor))){
+      return(ret);
+   }
+
+   /* Compute NFIQ from the same minutiae and quality map */
+   nfiq_ret = comp_nfiq_minutiae(onfiq, oconf, minutiae, quality_map,
+                            *omap_w, *omap_h,
+                            dflt_znorm_means, dflt_znorm_stds,
+                            dflt_nInps, dflt_nHids, dflt_nOuts,
+                            dflt_acfunc_hids, dflt_acfunc_outs, dflt_wts,
+                            optflag);
+   if(nfiq_ret < 0){
+      free_minutiae(minutiae);
+      free(quality_map);
+      free(*odirection_map);
+      free(*olow_contrast_map);
+      free(*olow_flow_map);
+      free(*ohigh_curve_map);
+      free(*obdata);
+      return(nfiq_ret);
+   }
+
+   if(!(outputs & LFS_OUT_QUALITY_MAP)){
+      free(quality_map);
+      quality_map = (int *)NULL;
+   }
+
+   *ominutiae = minutiae;
+   *oquality_map = quality_map;
+
+   return(nfiq_ret);
+}